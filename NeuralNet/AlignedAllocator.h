@@ -0,0 +1,44 @@
+#pragma once
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+// --- ALIGNED ALLOCATOR ---
+// std::vector allocator that starts every buffer on a 64-byte (cache line / zmm) boundary,
+// so packed weights never split a vector load across two cache lines.
+template <class T, size_t Alignment = 64>
+struct AlignedAllocator {
+	typedef T value_type;
+
+	AlignedAllocator() {}
+	template <class U> AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+	template <class U> struct rebind { typedef AlignedAllocator<U, Alignment> other; };
+
+	T* allocate(size_t count) {
+		if (count == 0) return nullptr;
+#ifdef _WIN32
+		void* p = _aligned_malloc(count * sizeof(T), Alignment);
+#else
+		void* p = nullptr;
+		if (posix_memalign(&p, Alignment, count * sizeof(T)) != 0) p = nullptr;
+#endif
+		if (!p) throw std::bad_alloc();
+		return (T*)p;
+	}
+
+	void deallocate(T* p, size_t) {
+#ifdef _WIN32
+		_aligned_free(p);
+#else
+		free(p);
+#endif
+	}
+};
+
+template <class T, class U, size_t A>
+bool operator==(const AlignedAllocator<T, A>&, const AlignedAllocator<U, A>&) { return true; }
+template <class T, class U, size_t A>
+bool operator!=(const AlignedAllocator<T, A>&, const AlignedAllocator<U, A>&) { return false; }
@@ -0,0 +1,502 @@
+#include "Conv.h"
+#include "Gemm.h"
+#include "Simd.h"
+#include "SimdTargets.h"
+#include <vector>
+#include <algorithm>
+
+// The direct loops make one pass per (output channel, input channel) pair of planes; past this many input
+// channels the GEMM's register blocking wins, even counting the unrolled matrix, for 3x3 and 5x5 alike
+// (NeuralNetBench's [Conv] check measures the crossover)
+static const int DIRECT_MAX_CHANNELS = 8;
+
+// --- SCRATCH ---
+// Per-thread buffers, grown once to the largest layer and then reused by every call
+static float* Scratch(std::vector<float>& buffer, size_t size) {
+    if (buffer.size() < size) buffer.resize(size);
+    return buffer.data();
+}
+
+static float* ColumnScratch(size_t size) {
+    thread_local std::vector<float> columns;
+    return Scratch(columns, size);
+}
+
+static float* PlaneScratch(size_t size) {
+    thread_local std::vector<float> planes;
+    return Scratch(planes, size);
+}
+
+// --- IM2COL ---
+// Output columns [begin, end) of kernel column kx read an input pixel inside the row; the rest read padding
+static void InsideColumns(const ConvShape& s, int kx, int& begin, int& end) {
+    int first = s.padding - kx;  // ox * stride >= first
+    int last = s.width - 1 - kx + s.padding; // ox * stride <= last
+    begin = (first <= 0) ? 0 : (first + s.stride - 1) / s.stride;
+    end = (last < 0) ? 0 : std::min(s.outWidth, last / s.stride + 1);
+    if (begin > end) begin = end;
+}
+
+// columns[(c, ky, kx)][(oy, ox)] = scale * input[c][oy * stride + ky - padding][ox * stride + kx - padding], 0 in the padding
+static void Im2Col(const ConvShape& s, const float* input, float scale, float* columns) {
+    const int K = s.kernel;
+    const int positions = s.outHeight * s.outWidth;
+    for (int c = 0; c < s.channels; c++) {
+        const float* plane = input + (size_t)c * s.height * s.width;
+        for (int ky = 0; ky < K; ky++) {
+            for (int kx = 0; kx < K; kx++) {
+                float* row = columns + ((size_t)(c * K + ky) * K + kx) * positions;
+                int begin, end;
+                InsideColumns(s, kx, begin, end);
+
+                for (int oy = 0; oy < s.outHeight; oy++) {
+                    float* dst = row + (size_t)oy * s.outWidth;
+                    int iy = oy * s.stride + ky - s.padding;
+                    if (iy < 0 || iy >= s.height) {
+                        std::fill(dst, dst + s.outWidth, 0.0f);
+                        continue;
+                    }
+                    const float* src = plane + (size_t)iy * s.width + kx - s.padding;
+                    std::fill(dst, dst + begin, 0.0f);
+                    if (s.stride == 1) {
+                        for (int ox = begin; ox < end; ox++) dst[ox] = scale * src[ox];
+                    }
+                    else {
+                        for (int ox = begin; ox < end; ox++) dst[ox] = scale * src[ox * s.stride];
+                    }
+                    std::fill(dst + end, dst + s.outWidth, 0.0f);
+                }
+            }
+        }
+    }
+}
+
+// The reverse: every entry of columns is added back onto the input pixel it came from (errors must start at 0)
+static void Col2Im(const ConvShape& s, const float* columns, float* errors) {
+    const int K = s.kernel;
+    const int positions = s.outHeight * s.outWidth;
+    for (int c = 0; c < s.channels; c++) {
+        float* plane = errors + (size_t)c * s.height * s.width;
+        for (int ky = 0; ky < K; ky++) {
+            for (int kx = 0; kx < K; kx++) {
+                const float* row = columns + ((size_t)(c * K + ky) * K + kx) * positions;
+                int begin, end;
+                InsideColumns(s, kx, begin, end);
+
+                for (int oy = 0; oy < s.outHeight; oy++) {
+                    int iy = oy * s.stride + ky - s.padding;
+                    if (iy < 0 || iy >= s.height) continue;
+                    const float* src = row + (size_t)oy * s.outWidth;
+                    float* dst = plane + (size_t)iy * s.width + kx - s.padding;
+                    for (int ox = begin; ox < end; ox++) dst[ox * s.stride] += src[ox];
+                }
+            }
+        }
+    }
+}
+
+// --- DIRECT KERNELS ---
+// out[oy][ox] += sum over ky, kx of taps[ky][kx] * in[oy + ky][ox + kx]: a stride-1 K x K correlation of a
+// plane that already holds its padding (in is (outHeight + K - 1) x inWidth)
+template <int K>
+static void DirectPlaneScalar(const float* in, int inWidth, const float* weights, float* out, int outHeight, int outWidth) {
+    for (int oy = 0; oy < outHeight; oy++) {
+        float* dst = out + (size_t)oy * outWidth;
+        for (int ox = 0; ox < outWidth; ox++) {
+            float sum = dst[ox];
+            for (int ky = 0; ky < K; ky++) {
+                const float* row = in + (size_t)(oy + ky) * inWidth + ox;
+                for (int kx = 0; kx < K; kx++) sum += weights[ky * K + kx] * row[kx];
+            }
+            dst[ox] = sum;
+        }
+    }
+}
+
+// grads[ky][kx] += alpha * sum over oy, ox of deltas[oy][ox] * in[oy + ky][ox + kx]: the filter gradient of one
+// (output channel, input channel) pair, over the same padded plane
+template <int K>
+static void DirectGradientScalar(const float* in, int inWidth, const float* deltas, int outHeight, int outWidth, float alpha, float* grads) {
+    for (int ky = 0; ky < K; ky++) {
+        float sums[K] = {};
+        for (int oy = 0; oy < outHeight; oy++) {
+            const float* d = deltas + (size_t)oy * outWidth;
+            const float* row = in + (size_t)(oy + ky) * inWidth;
+            for (int ox = 0; ox < outWidth; ox++) {
+                for (int kx = 0; kx < K; kx++) sums[kx] += d[ox] * row[ox + kx];
+            }
+        }
+        for (int kx = 0; kx < K; kx++) grads[ky * K + kx] += alpha * sums[kx];
+    }
+}
+
+typedef void (*DirectPlaneKernel)(const float* in, int inWidth, const float* weights, float* out, int outHeight, int outWidth);
+typedef void (*DirectGradientKernel)(const float* in, int inWidth, const float* deltas, int outHeight, int outWidth, float alpha, float* grads);
+
+#ifdef NN_X86
+
+// Output rows per block: each gets its own accumulator, so ROWS FMA chains run side by side
+static const int DIRECT_ROWS = 4;
+
+// --- AVX2 DIRECT KERNEL (8 outputs of a row per vector) ---
+template <int K, int ROWS>
+static inline NN_TARGET_AVX2 void DirectRowsAvx2(const float* in, int inWidth, const float* weights, float* out, int outWidth) {
+    __m256 acc[ROWS];
+    for (int r = 0; r < ROWS; r++) acc[r] = _mm256_loadu_ps(out + (size_t)r * outWidth);
+    for (int ky = 0; ky < K; ky++) {
+        for (int kx = 0; kx < K; kx++) {
+            __m256 tap = _mm256_broadcast_ss(&weights[ky * K + kx]);
+            for (int r = 0; r < ROWS; r++) acc[r] = _mm256_fmadd_ps(tap, _mm256_loadu_ps(in + (size_t)(r + ky) * inWidth + kx), acc[r]);
+        }
+    }
+    for (int r = 0; r < ROWS; r++) _mm256_storeu_ps(out + (size_t)r * outWidth, acc[r]);
+}
+
+template <int K>
+static NN_TARGET_AVX2 void DirectPlaneAvx2(const float* in, int inWidth, const float* weights, float* out, int outHeight, int outWidth) {
+    int ox = 0;
+    for (; ox + 8 <= outWidth; ox += 8) {
+        int oy = 0;
+        for (; oy + DIRECT_ROWS <= outHeight; oy += DIRECT_ROWS) {
+            DirectRowsAvx2<K, DIRECT_ROWS>(in + (size_t)oy * inWidth + ox, inWidth, weights, out + (size_t)oy * outWidth + ox, outWidth);
+        }
+        for (; oy < outHeight; oy++) {
+            DirectRowsAvx2<K, 1>(in + (size_t)oy * inWidth + ox, inWidth, weights, out + (size_t)oy * outWidth + ox, outWidth);
+        }
+    }
+    // Leftover columns (outWidth not a multiple of 8)
+    if (ox < outWidth) {
+        for (int oy = 0; oy < outHeight; oy++) {
+            for (int x = ox; x < outWidth; x++) {
+                float sum = out[(size_t)oy * outWidth + x];
+                for (int ky = 0; ky < K; ky++) {
+                    const float* row = in + (size_t)(oy + ky) * inWidth + x;
+                    for (int kx = 0; kx < K; kx++) sum += weights[ky * K + kx] * row[kx];
+                }
+                out[(size_t)oy * outWidth + x] = sum;
+            }
+        }
+    }
+}
+
+// One kernel row's K gradient sums at a time: K accumulators, the deltas reloaded for each row (from L1)
+template <int K>
+static NN_TARGET_AVX2 void DirectGradientAvx2(const float* in, int inWidth, const float* deltas, int outHeight, int outWidth, float alpha, float* grads) {
+    const int full = outWidth / 8 * 8;
+    for (int ky = 0; ky < K; ky++) {
+        __m256 acc[K];
+        float tail[K] = {};
+        for (int kx = 0; kx < K; kx++) acc[kx] = _mm256_setzero_ps();
+        for (int oy = 0; oy < outHeight; oy++) {
+            const float* d = deltas + (size_t)oy * outWidth;
+            const float* row = in + (size_t)(oy + ky) * inWidth;
+            for (int ox = 0; ox < full; ox += 8) {
+                __m256 dv = _mm256_loadu_ps(d + ox);
+                for (int kx = 0; kx < K; kx++) acc[kx] = _mm256_fmadd_ps(dv, _mm256_loadu_ps(row + ox + kx), acc[kx]);
+            }
+            for (int ox = full; ox < outWidth; ox++) {
+                for (int kx = 0; kx < K; kx++) tail[kx] += d[ox] * row[ox + kx];
+            }
+        }
+        for (int kx = 0; kx < K; kx++) {
+            __m128 sum = _mm_add_ps(_mm256_castps256_ps128(acc[kx]), _mm256_extractf128_ps(acc[kx], 1));
+            sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+            sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+            grads[ky * K + kx] += alpha * (_mm_cvtss_f32(sum) + tail[kx]);
+        }
+    }
+}
+
+// --- AVX-512 DIRECT KERNEL (16 outputs of a row per vector, masked at the row's end) ---
+template <int K, int ROWS>
+static inline NN_TARGET_AVX512 void DirectRowsAvx512(const float* in, int inWidth, const __m512* taps, float* out, int outWidth, __mmask16 mask) {
+    __m512 acc[ROWS];
+    for (int r = 0; r < ROWS; r++) acc[r] = _mm512_maskz_loadu_ps(mask, out + (size_t)r * outWidth);
+    for (int ky = 0; ky < K; ky++) {
+        for (int kx = 0; kx < K; kx++) {
+            for (int r = 0; r < ROWS; r++) acc[r] = _mm512_fmadd_ps(taps[ky * K + kx], _mm512_maskz_loadu_ps(mask, in + (size_t)(r + ky) * inWidth + kx), acc[r]);
+        }
+    }
+    for (int r = 0; r < ROWS; r++) _mm512_mask_storeu_ps(out + (size_t)r * outWidth, mask, acc[r]);
+}
+
+template <int K>
+static NN_TARGET_AVX512 void DirectPlaneAvx512(const float* in, int inWidth, const float* weights, float* out, int outHeight, int outWidth) {
+    __m512 taps[K * K];
+    for (int t = 0; t < K * K; t++) taps[t] = _mm512_set1_ps(weights[t]);
+
+    for (int ox = 0; ox < outWidth; ox += 16) {
+        __mmask16 mask = (outWidth - ox >= 16) ? (__mmask16)0xFFFF : (__mmask16)((1u << (outWidth - ox)) - 1);
+        int oy = 0;
+        for (; oy + DIRECT_ROWS <= outHeight; oy += DIRECT_ROWS) {
+            DirectRowsAvx512<K, DIRECT_ROWS>(in + (size_t)oy * inWidth + ox, inWidth, taps, out + (size_t)oy * outWidth + ox, outWidth, mask);
+        }
+        for (; oy < outHeight; oy++) {
+            DirectRowsAvx512<K, 1>(in + (size_t)oy * inWidth + ox, inWidth, taps, out + (size_t)oy * outWidth + ox, outWidth, mask);
+        }
+    }
+}
+
+template <int K>
+static NN_TARGET_AVX512 void DirectGradientAvx512(const float* in, int inWidth, const float* deltas, int outHeight, int outWidth, float alpha, float* grads) {
+    for (int ky = 0; ky < K; ky++) {
+        __m512 acc[K];
+        for (int kx = 0; kx < K; kx++) acc[kx] = _mm512_setzero_ps();
+        for (int oy = 0; oy < outHeight; oy++) {
+            const float* d = deltas + (size_t)oy * outWidth;
+            const float* row = in + (size_t)(oy + ky) * inWidth;
+            for (int ox = 0; ox < outWidth; ox += 16) {
+                __mmask16 mask = (outWidth - ox >= 16) ? (__mmask16)0xFFFF : (__mmask16)((1u << (outWidth - ox)) - 1);
+                __m512 dv = _mm512_maskz_loadu_ps(mask, d + ox);
+                for (int kx = 0; kx < K; kx++) acc[kx] = _mm512_fmadd_ps(dv, _mm512_maskz_loadu_ps(mask, row + ox + kx), acc[kx]);
+            }
+        }
+        for (int kx = 0; kx < K; kx++) grads[ky * K + kx] += alpha * _mm512_reduce_add_ps(acc[kx]);
+    }
+}
+
+#endif // NN_X86
+
+template <int K>
+static DirectGradientKernel DirectGradientFor(SimdLevel level) {
+#ifdef NN_X86
+    if (level == SimdLevel::AVX512) return DirectGradientAvx512<K>;
+    if (level == SimdLevel::AVX2) return DirectGradientAvx2<K>;
+#endif
+    return DirectGradientScalar<K>;
+}
+
+static DirectGradientKernel DirectGradient(int kernel) {
+    const SimdLevel level = Simd().level;
+    return (kernel == 3) ? DirectGradientFor<3>(level) : DirectGradientFor<5>(level);
+}
+
+template <int K>
+static DirectPlaneKernel DirectPlaneFor(SimdLevel level) {
+#ifdef NN_X86
+    if (level == SimdLevel::AVX512) return DirectPlaneAvx512<K>;
+    if (level == SimdLevel::AVX2) return DirectPlaneAvx2<K>;
+#endif
+    return DirectPlaneScalar<K>;
+}
+
+static DirectPlaneKernel DirectPlane(int kernel) {
+    const SimdLevel level = Simd().level;
+    return (kernel == 3) ? DirectPlaneFor<3>(level) : DirectPlaneFor<5>(level);
+}
+
+// Copies channels planes of height x width into the middle of (height + 2 * border) x (width + 2 * border) zeroed ones
+static void PadPlanes(const float* planes, int channels, int height, int width, int border, float* padded) {
+    const int paddedWidth = width + 2 * border;
+    const size_t paddedSize = (size_t)(height + 2 * border) * paddedWidth;
+    std::fill(padded, padded + channels * paddedSize, 0.0f);
+    for (int c = 0; c < channels; c++) {
+        for (int y = 0; y < height; y++) {
+            const float* src = planes + ((size_t)c * height + y) * width;
+            std::copy(src, src + width, padded + c * paddedSize + (size_t)(y + border) * paddedWidth + border);
+        }
+    }
+}
+
+bool ConvHasDirect(const ConvShape& shape) {
+    return shape.stride == 1 && (shape.kernel == 3 || shape.kernel == 5) && shape.padding < shape.kernel;
+}
+
+bool ConvPrefersDirect(const ConvShape& shape) {
+    return ConvHasDirect(shape) && shape.channels <= DIRECT_MAX_CHANNELS;
+}
+
+// --- CONV2D ---
+void ConvForward(const Layer& layer, const float* inputs, int batchSize, float* outputs, float inputScale, bool direct) {
+    const ConvShape& s = layer.shape;
+    const int taps = s.channels * s.kernel * s.kernel;
+    const int positions = s.outHeight * s.outWidth;
+
+    for (int n = 0; n < batchSize; n++) {
+        const float* in = inputs + (size_t)n * layer.numInputs;
+        float* out = outputs + (size_t)n * layer.numNeurons;
+
+        if (direct) {
+            // Unpadded inputs are read in place (paddedSize is then the plane size); the input scale goes into the taps
+            const int kernel = s.kernel;
+            const int paddedWidth = s.width + 2 * s.padding;
+            const size_t paddedSize = (size_t)(s.height + 2 * s.padding) * paddedWidth;
+            const float* planes = in;
+            if (s.padding > 0) {
+                float* padded = PlaneScratch(s.channels * paddedSize);
+                PadPlanes(in, s.channels, s.height, s.width, s.padding, padded);
+                planes = padded;
+            }
+
+            DirectPlaneKernel plane = DirectPlane(kernel);
+            float scaled[25];
+            for (int oc = 0; oc < s.outChannels; oc++) {
+                float* dst = out + (size_t)oc * positions;
+                std::fill(dst, dst + positions, layer.biasData()[oc]);
+                for (int c = 0; c < s.channels; c++) {
+                    const float* w = &layer.weightData()[(size_t)oc * taps + c * kernel * kernel];
+                    for (int t = 0; t < kernel * kernel; t++) scaled[t] = inputScale * w[t];
+                    plane(planes + c * paddedSize, paddedWidth, scaled, dst, s.outHeight, s.outWidth);
+                }
+            }
+            continue;
+        }
+
+        // outputs (outChannels x positions) = filters (outChannels x taps) * columns (taps x positions)
+        float* columns = ColumnScratch((size_t)taps * positions);
+        Im2Col(s, in, inputScale, columns);
+        Sgemm(false, false, s.outChannels, positions, taps,
+            1.0f, layer.weightData(), taps, columns, positions,
+            0.0f, out, positions);
+        for (int oc = 0; oc < s.outChannels; oc++) {
+            float* dst = out + (size_t)oc * positions;
+            const float bias = layer.biasData()[oc];
+            for (int p = 0; p < positions; p++) dst[p] += bias;
+        }
+    }
+}
+
+void ConvPropagate(const Layer& layer, const float* deltas, int batchSize, float* errors, bool direct) {
+    const ConvShape& s = layer.shape;
+    const int taps = s.channels * s.kernel * s.kernel;
+    const int positions = s.outHeight * s.outWidth;
+    const int planeSize = s.height * s.width;
+
+    for (int n = 0; n < batchSize; n++) {
+        const float* d = deltas + (size_t)n * layer.numNeurons;
+        float* err = errors + (size_t)n * layer.numInputs;
+        std::fill(err, err + layer.numInputs, 0.0f);
+
+        if (direct) {
+            // A full correlation of the zero-bordered deltas with the flipped filters lands on every input
+            const int kernel = s.kernel;
+            const int border = kernel - 1 - s.padding;
+            const int paddedWidth = s.outWidth + 2 * border;
+            const size_t paddedSize = (size_t)(s.outHeight + 2 * border) * paddedWidth;
+            float* padded = PlaneScratch(s.outChannels * paddedSize);
+            PadPlanes(d, s.outChannels, s.outHeight, s.outWidth, border, padded);
+
+            DirectPlaneKernel plane = DirectPlane(kernel);
+            float flipped[25];
+            for (int c = 0; c < s.channels; c++) {
+                for (int oc = 0; oc < s.outChannels; oc++) {
+                    const float* w = &layer.weightData()[(size_t)oc * taps + c * kernel * kernel];
+                    for (int t = 0; t < kernel * kernel; t++) flipped[t] = w[kernel * kernel - 1 - t];
+                    plane(padded + oc * paddedSize, paddedWidth, flipped, err + (size_t)c * planeSize, s.height, s.width);
+                }
+            }
+            continue;
+        }
+
+        // columns (taps x positions) = filters^T * deltas, then each column entry goes back to its pixel
+        float* columns = ColumnScratch((size_t)taps * positions);
+        Sgemm(true, false, taps, positions, s.outChannels,
+            1.0f, layer.weightData(), taps, d, positions,
+            0.0f, columns, positions);
+        Col2Im(s, columns, err);
+    }
+}
+
+void ConvGradients(const Layer& layer, const float* inputs, const float* deltas, int batchSize, float inputScale,
+    float alpha, float* weightGrads, float* biasGrads, bool direct) {
+
+    const ConvShape& s = layer.shape;
+    const int taps = s.channels * s.kernel * s.kernel;
+    const int positions = s.outHeight * s.outWidth;
+
+    for (int n = 0; n < batchSize; n++) {
+        const float* d = deltas + (size_t)n * layer.numNeurons;
+        for (int oc = 0; oc < s.outChannels; oc++) {
+            const float* row = d + (size_t)oc * positions;
+            float sum = 0.0f;
+            for (int p = 0; p < positions; p++) sum += row[p];
+            biasGrads[oc] += alpha * sum;
+        }
+
+        if (direct) {
+            // Every (output channel, input channel) pair of planes gives that filter slice's kernel^2 sums
+            const int kernel = s.kernel;
+            const int paddedWidth = s.width + 2 * s.padding;
+            const size_t paddedSize = (size_t)(s.height + 2 * s.padding) * paddedWidth;
+            const float* planes = inputs + (size_t)n * layer.numInputs;
+            if (s.padding > 0) {
+                float* padded = PlaneScratch(s.channels * paddedSize);
+                PadPlanes(planes, s.channels, s.height, s.width, s.padding, padded);
+                planes = padded;
+            }
+
+            DirectGradientKernel gradient = DirectGradient(kernel);
+            for (int oc = 0; oc < s.outChannels; oc++) {
+                for (int c = 0; c < s.channels; c++) {
+                    gradient(planes + c * paddedSize, paddedWidth, d + (size_t)oc * positions, s.outHeight, s.outWidth,
+                        alpha * inputScale, weightGrads + (size_t)oc * taps + c * kernel * kernel);
+                }
+            }
+            continue;
+        }
+
+        // weightGrads (outChannels x taps) += alpha * deltas (outChannels x positions) * columns^T
+        float* columns = ColumnScratch((size_t)taps * positions);
+        Im2Col(s, inputs + (size_t)n * layer.numInputs, inputScale, columns);
+        Sgemm(false, true, s.outChannels, taps, positions,
+            alpha, d, positions, columns, positions,
+            1.0f, weightGrads, taps);
+    }
+}
+
+// --- MAXPOOL ---
+void MaxPoolForward(const Layer& layer, const float* inputs, int batchSize, float* outputs, float inputScale) {
+    const ConvShape& s = layer.shape;
+    const int size = s.kernel;
+
+    for (int n = 0; n < batchSize; n++) {
+        const float* in = inputs + (size_t)n * layer.numInputs;
+        float* out = outputs + (size_t)n * layer.numNeurons;
+        for (int c = 0; c < s.channels; c++) {
+            for (int oy = 0; oy < s.outHeight; oy++) {
+                // A whole output row at a time: the window's first input, then the max with each of the others
+                const float* src = in + ((size_t)c * s.height + (size_t)oy * size) * s.width;
+                float* dst = out + ((size_t)c * s.outHeight + oy) * s.outWidth;
+                for (int ox = 0; ox < s.outWidth; ox++) dst[ox] = src[ox * size];
+                for (int y = 0; y < size; y++) {
+                    const float* row = src + (size_t)y * s.width;
+                    for (int x = (y == 0) ? 1 : 0; x < size; x++) {
+                        for (int ox = 0; ox < s.outWidth; ox++) dst[ox] = std::max(dst[ox], row[ox * size + x]);
+                    }
+                }
+                for (int ox = 0; ox < s.outWidth; ox++) dst[ox] *= inputScale;
+            }
+        }
+    }
+}
+
+void MaxPoolPropagate(const Layer& layer, const float* inputs, const float* deltas, int batchSize, float* errors) {
+    const ConvShape& s = layer.shape;
+    const int size = s.kernel;
+
+    for (int n = 0; n < batchSize; n++) {
+        const float* in = inputs + (size_t)n * layer.numInputs;
+        const float* d = deltas + (size_t)n * layer.numNeurons;
+        float* err = errors + (size_t)n * layer.numInputs;
+        std::fill(err, err + layer.numInputs, 0.0f);
+
+        for (int c = 0; c < s.channels; c++) {
+            for (int oy = 0; oy < s.outHeight; oy++) {
+                const size_t top = ((size_t)c * s.height + (size_t)oy * size) * s.width;
+                for (int ox = 0; ox < s.outWidth; ox++) {
+                    size_t winner = top + (size_t)ox * size;
+                    float best = in[winner];
+                    for (int y = 0; y < size; y++) {
+                        const size_t row = top + (size_t)y * s.width + (size_t)ox * size;
+                        for (int x = 0; x < size; x++) {
+                            bool larger = in[row + x] > best;
+                            best = larger ? in[row + x] : best;
+                            winner = larger ? row + x : winner;
+                        }
+                    }
+                    err[winner] = *d++;
+                }
+            }
+        }
+    }
+}
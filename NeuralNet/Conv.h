@@ -0,0 +1,36 @@
+#pragma once
+#include "NeuNetCode.h"
+
+// --- CONVOLUTION KERNELS ---
+// The CONV2D and MAXPOOL halves of Layer's passes (Layer dispatches here on its type). Like the dense
+// passes they take a batch: one sample per row, numInputs values in, numNeurons values out, each sample
+// stored channel by channel and row by row.
+//
+// A convolution runs one of two ways:
+//   - im2col + Sgemm: a sample's input patches are unrolled into a (channels x kernel^2) x (outHeight x outWidth)
+//     matrix, so the layer is one blocked GEMM against the outChannels x (channels x kernel^2) filters.
+//     Any kernel, stride and padding.
+//   - direct: 3x3 and 5x5 filters at stride 1, slid straight over the input planes with the taps unrolled
+//     (the kernel size is a template parameter). No unrolled matrix to write and read back, which is most
+//     of the work when channels x kernel^2 is small, as in the first layer.
+// ConvPrefersDirect() picks one from the shape, for all three passes (the direct filter gradient keeps one
+// accumulator per tap and sums the deltas times the shifted input rows).
+// Scratch (the unrolled matrix, padded planes) is per thread, grown on a thread's first pass and then reused.
+
+// Whether the direct kernels handle this shape at all, and whether they beat im2col + Sgemm on it
+bool ConvHasDirect(const ConvShape& shape);
+bool ConvPrefersDirect(const ConvShape& shape);
+
+// outputs = filters * inputs + bias, before the activation
+void ConvForward(const Layer& layer, const float* inputs, int batchSize, float* outputs, float inputScale, bool direct);
+// errors = what the outputs' deltas contribute to every input (the transposed convolution)
+void ConvPropagate(const Layer& layer, const float* deltas, int batchSize, float* errors, bool direct);
+// weightGrads += alpha * summed filter gradient, biasGrads += alpha * summed deltas of each output channel
+void ConvGradients(const Layer& layer, const float* inputs, const float* deltas, int batchSize, float inputScale,
+	float alpha, float* weightGrads, float* biasGrads, bool direct);
+
+// Largest input of every window (windows don't overlap: stride = kernel)
+void MaxPoolForward(const Layer& layer, const float* inputs, int batchSize, float* outputs, float inputScale);
+// Each window's delta goes to the input that won the max (the first one on a tie), the others get 0.
+// The winners are found again from the inputs, so the forward pass stores no indices.
+void MaxPoolPropagate(const Layer& layer, const float* inputs, const float* deltas, int batchSize, float* errors);
@@ -0,0 +1,409 @@
+#include "DataStream.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+// --- IDX FILE SOURCE ---
+static unsigned long long StreamSize(std::ifstream& stream) {
+    stream.seekg(0, std::ios::end);
+    unsigned long long size = (unsigned long long)stream.tellg();
+    stream.seekg(0, std::ios::beg);
+    return size;
+}
+
+bool IdxFileSource::open(const std::string& imageFilename, const std::string& labelFilename) {
+    count = rows = cols = 0;
+    imageStream.close();
+    labelStream.close();
+    imageStream.clear();
+    labelStream.clear();
+
+    imageStream.open(imageFilename, std::ios::binary);
+    labelStream.open(labelFilename, std::ios::binary);
+    if (!imageStream.is_open() || !labelStream.is_open()) {
+        std::cout << "error: cannot open " << (imageStream.is_open() ? labelFilename : imageFilename) << std::endl;
+        return false;
+    }
+
+    unsigned long long imageSize = StreamSize(imageStream);
+    unsigned long long labelSize = StreamSize(labelStream);
+    unsigned char imageHeader[16] = {};
+    unsigned char labelHeader[8] = {};
+    imageStream.read((char*)imageHeader, sizeof(imageHeader));
+    labelStream.read((char*)labelHeader, sizeof(labelHeader));
+
+    int numImages, numRows, numCols;
+    if (!ReadIdxHeaders(imageHeader, imageSize, imageFilename, labelHeader, labelSize, labelFilename, numImages, numRows, numCols)) {
+        return false;
+    }
+    count = numImages;
+    rows = numRows;
+    cols = numCols;
+    return true;
+}
+
+bool IdxFileSource::readRange(int first, int count, unsigned char* pixels, unsigned char* labels) {
+    size_t bytes = (size_t)count * recordSize();
+
+    imageStream.clear();
+    labelStream.clear();
+    imageStream.seekg(16 + (std::streamoff)first * recordSize());
+    labelStream.seekg(8 + (std::streamoff)first);
+    imageStream.read((char*)pixels, bytes);
+    labelStream.read((char*)labels, count);
+    if (!imageStream || !labelStream) {
+        std::cout << "error: short read at record " << first << std::endl;
+        return false;
+    }
+
+    for (int i = 0; i < count; i++) {
+        if (labels[i] > 9) {
+            std::cout << "error: label " << (int)labels[i] << " at index " << first + i << " is not a digit" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// --- MAPPED DATASET SOURCE ---
+bool MnistDatasetSource::readRange(int first, int count, unsigned char* pixels, unsigned char* labels) {
+    memcpy(pixels, dataset.image(first), (size_t)count * dataset.imageSize());
+    for (int i = 0; i < count; i++) labels[i] = (unsigned char)dataset.label(first + i);
+    return true;
+}
+
+// --- BATCH STREAM ---
+BatchStream::BatchStream(DataSource& source, int batchSize, int numClasses, int chunkRecords, int bufferChunks, int prefetch)
+    : source(source),
+      batchSize(batchSize < 1 ? 1 : batchSize),
+      numClasses(numClasses),
+      chunkRecords(chunkRecords < 1 ? 1 : chunkRecords),
+      bufferChunks(bufferChunks < 1 ? 1 : bufferChunks),
+      recordSize(source.recordSize()),
+      bufferCount(0),
+      currentSlot(-1),
+      epoch(0),
+      epochSeed(0),
+      epochDone(true),
+      readFailed(false),
+      stopping(false),
+      stalled(0.0) {
+
+    // Everything is allocated here, once
+    size_t capacity = (size_t)this->bufferChunks * this->chunkRecords;
+    bufferPixels.resize(capacity * recordSize);
+    bufferLabels.resize(capacity);
+
+    if (prefetch < 1) prefetch = 1;
+    slots.resize(prefetch + 1); // +1: the batch the caller is holding
+    for (int i = 0; i < (int)slots.size(); i++) {
+        slots[i].count = 0;
+        slots[i].pixels.resize((size_t)this->batchSize * recordSize);
+        slots[i].labels.resize(this->batchSize);
+        slots[i].targets.resize((size_t)this->batchSize * numClasses);
+        freeSlots.push_back(i);
+    }
+
+    producer = std::thread(&BatchStream::producerLoop, this);
+}
+
+BatchStream::~BatchStream() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    changed.notify_all();
+    producer.join();
+}
+
+void BatchStream::startEpoch(unsigned int seed) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (currentSlot >= 0) freeSlots.push_back(currentSlot);
+        currentSlot = -1;
+        for (int slot : readySlots) freeSlots.push_back(slot);
+        readySlots.clear();
+
+        epoch++;
+        epochSeed = seed;
+        epochDone = false;
+        readFailed = false;
+    }
+    changed.notify_all();
+}
+
+void BatchStream::releaseCurrent() {
+    if (currentSlot < 0) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        freeSlots.push_back(currentSlot);
+        currentSlot = -1;
+    }
+    changed.notify_all();
+}
+
+const Batch* BatchStream::next() {
+    releaseCurrent();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    if (readySlots.empty() && !epochDone) {
+        auto start = std::chrono::steady_clock::now();
+        changed.wait(lock, [this] { return !readySlots.empty() || epochDone || stopping; });
+        stalled += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    if (readySlots.empty()) return nullptr;
+
+    currentSlot = readySlots.front();
+    readySlots.erase(readySlots.begin());
+    return &slots[currentSlot];
+}
+
+void BatchStream::producerLoop() {
+    long long seen = 0;
+
+    while (true) {
+        unsigned int seed;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [&] { return stopping || epoch != seen; });
+            if (stopping) return;
+            seen = epoch;
+            seed = epochSeed;
+        }
+
+        bool ok = produceEpoch(seed, seen);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (epoch == seen) {
+                epochDone = true;
+                readFailed = !ok;
+            }
+        }
+        changed.notify_all();
+    }
+}
+
+bool BatchStream::produceEpoch(unsigned int seed, long long myEpoch) {
+    std::mt19937 rng(seed);
+
+    // 1. Permute the chunk order
+    int numChunks = (source.size() + chunkRecords - 1) / chunkRecords;
+    std::vector<int> chunkOrder(numChunks);
+    for (int c = 0; c < numChunks; c++) chunkOrder[c] = c;
+    std::shuffle(chunkOrder.begin(), chunkOrder.end(), rng);
+    int nextChunk = 0;
+    bufferCount = 0;
+
+    // 2. Fill free slots until the data runs out
+    while (true) {
+        int slot;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [&] { return stopping || epoch != myEpoch || !freeSlots.empty(); });
+            if (stopping || epoch != myEpoch) return true;
+            slot = freeSlots.back();
+            freeSlots.pop_back();
+        }
+
+        bool ok = fillBatch(slots[slot], rng, chunkOrder, nextChunk);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!ok || slots[slot].count == 0 || epoch != myEpoch) {
+                freeSlots.push_back(slot);
+                return ok;
+            }
+            readySlots.push_back(slot);
+        }
+        changed.notify_all();
+    }
+}
+
+bool BatchStream::fillBatch(Batch& batch, std::mt19937& rng, std::vector<int>& chunkOrder, int& nextChunk) {
+    int capacity = bufferChunks * chunkRecords;
+    std::fill(batch.targets.begin(), batch.targets.end(), 0.0f);
+    batch.count = 0;
+
+    for (int n = 0; n < batchSize; n++) {
+        // Keep the shuffle buffer topped up
+        while (nextChunk < (int)chunkOrder.size() && bufferCount + chunkRecords <= capacity) {
+            if (!loadChunk(chunkOrder[nextChunk++])) return false;
+        }
+        if (bufferCount == 0) break; // end of the epoch
+
+        // Draw a random buffered record and fill its hole with the last one
+        int pick = std::uniform_int_distribution<int>(0, bufferCount - 1)(rng);
+        int last = bufferCount - 1;
+        unsigned char label = bufferLabels[pick];
+        if (label >= numClasses) {
+            std::cout << "error: label " << (int)label << " does not fit " << numClasses << " classes" << std::endl;
+            return false;
+        }
+
+        memcpy(&batch.pixels[(size_t)n * recordSize], &bufferPixels[(size_t)pick * recordSize], recordSize);
+        batch.labels[n] = label;
+        batch.targets[(size_t)n * numClasses + label] = 1.0f;
+
+        if (pick != last) {
+            memcpy(&bufferPixels[(size_t)pick * recordSize], &bufferPixels[(size_t)last * recordSize], recordSize);
+            bufferLabels[pick] = bufferLabels[last];
+        }
+        bufferCount--;
+        batch.count++;
+    }
+    return true;
+}
+
+bool BatchStream::loadChunk(int chunk) {
+    int first = chunk * chunkRecords;
+    int count = std::min(chunkRecords, source.size() - first);
+    if (!source.readRange(first, count, &bufferPixels[(size_t)bufferCount * recordSize], &bufferLabels[bufferCount])) return false;
+    bufferCount += count;
+    return true;
+}
+
+// --- AUGMENT STREAM ---
+AugmentStream::AugmentStream(BatchStream& stream, const AugmentSettings& settings, int width, int height, int threads, int prefetch)
+    : stream(stream), recordSize(stream.recordBytes()), currentSlot(-1), nextBatch(0), epoch(0), epochSeed(0),
+      epochBatches(0), readFailed(false), stopping(false), stalled(0.0), sourceEpoch(0), pulled(0) {
+    threads = std::max(1, threads);
+    const int batchSize = stream.maxBatchSize();
+    slots.resize(threads + std::max(1, prefetch));
+    for (int i = 0; i < (int)slots.size(); i++) {
+        slots[i].count = 0;
+        slots[i].inputs.resize((size_t)batchSize * recordSize);
+        slots[i].targets.resize((size_t)batchSize * stream.classCount());
+        slots[i].labels.resize(batchSize);
+        slots[i].pixels.resize((size_t)batchSize * recordSize);
+        freeSlots.push_back(i);
+    }
+
+    augmenters.reserve(threads);
+    for (int t = 0; t < threads; t++) augmenters.emplace_back(settings, width, height);
+    for (int t = 0; t < threads; t++) workers.emplace_back(&AugmentStream::workerLoop, this, t);
+}
+
+AugmentStream::~AugmentStream() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    changed.notify_all();
+    for (std::thread& worker : workers) worker.join();
+}
+
+void AugmentStream::startEpoch(unsigned int seed) {
+    // Holding sourceMutex keeps every worker off the stream until it has been restarted
+    {
+        std::lock_guard<std::mutex> source(sourceMutex);
+        long long started;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (currentSlot >= 0) freeSlots.push_back(currentSlot);
+            currentSlot = -1;
+            for (const auto& ready : readySlots) freeSlots.push_back(ready.second);
+            readySlots.clear();
+
+            started = ++epoch;
+            epochSeed = seed;
+            epochBatches = -1;
+            nextBatch = 0;
+            readFailed = false;
+        }
+        stream.startEpoch(seed);
+        sourceEpoch = started;
+        pulled = 0;
+    }
+    changed.notify_all();
+}
+
+void AugmentStream::releaseCurrent() {
+    if (currentSlot < 0) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        freeSlots.push_back(currentSlot);
+        currentSlot = -1;
+    }
+    changed.notify_all();
+}
+
+const AugmentedBatch* AugmentStream::next() {
+    releaseCurrent();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    auto available = [this] {
+        return stopping || readySlots.count(nextBatch) || (epochBatches >= 0 && nextBatch >= epochBatches);
+    };
+    if (!available()) {
+        auto start = std::chrono::steady_clock::now();
+        changed.wait(lock, available);
+        stalled += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    auto ready = readySlots.find(nextBatch);
+    if (ready == readySlots.end()) return nullptr;
+    currentSlot = ready->second;
+    readySlots.erase(ready);
+    nextBatch++;
+    return &slots[currentSlot];
+}
+
+void AugmentStream::workerLoop(int index) {
+    Augmenter& augmenter = augmenters[index];
+
+    while (true) {
+        int slot;
+        long long myEpoch;
+        unsigned int seed;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [this] { return stopping || (epochBatches < 0 && !freeSlots.empty()); });
+            if (stopping) return;
+            slot = freeSlots.back();
+            freeSlots.pop_back();
+            myEpoch = epoch;
+            seed = epochSeed;
+        }
+
+        // 1. Take the stream's next batch (copied: it is only valid until the stream's next call)
+        AugmentedBatch& batch = slots[slot];
+        int number = -1, total = 0;
+        bool current, ok = true;
+        {
+            std::lock_guard<std::mutex> source(sourceMutex);
+            current = (sourceEpoch == myEpoch);
+            const Batch* raw = current ? stream.next() : nullptr;
+            if (raw) {
+                batch.count = raw->count;
+                memcpy(batch.pixels.data(), raw->pixels.data(), (size_t)raw->count * recordSize);
+                memcpy(batch.labels.data(), raw->labels.data(), raw->count);
+                std::copy(raw->targets.begin(), raw->targets.end(), batch.targets.begin());
+                number = pulled++;
+            }
+            else {
+                ok = !stream.failed();
+                total = pulled;
+            }
+        }
+
+        // 2. Augment it outside any lock, with the generator of its batch number
+        if (number >= 0) {
+            std::seed_seq seeds{ seed, (unsigned int)number };
+            std::mt19937 rng(seeds);
+            augmenter.applyBatch(batch.pixels.data(), batch.count, batch.inputs.data(), rng);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (number >= 0 && epoch == myEpoch) readySlots[number] = slot;
+            else freeSlots.push_back(slot);
+            if (number < 0 && current && epoch == myEpoch) {
+                epochBatches = total;
+                readFailed = !ok;
+            }
+        }
+        changed.notify_all();
+    }
+}
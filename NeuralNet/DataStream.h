@@ -0,0 +1,211 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <fstream>
+#include <random>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <map>
+#include "MnistDataset.h"
+#include "Preprocess.h"
+
+// --- DATA SOURCE ---
+// Random access to fixed-size labelled records (one 8-bit image + one class each), read a range at a time.
+// Sources never have to hold the whole dataset: BatchStream only asks for one chunk at a time.
+class DataSource {
+
+public:
+	virtual ~DataSource() {}
+
+	virtual int size() const = 0;
+	virtual int recordSize() const = 0; // bytes per record (pixels)
+
+	// Copies records [first, first + count) into pixels (count x recordSize()) and labels (count).
+	// Prints why and returns false on a read error or a bad record.
+	virtual bool readRange(int first, int count, unsigned char* pixels, unsigned char* labels) = 0;
+};
+
+// IDX image + label files read with plain positioned reads: nothing is kept but the two open streams
+class IdxFileSource : public DataSource {
+
+public:
+	IdxFileSource() : count(0), rows(0), cols(0) {}
+
+	bool open(const std::string& imageFilename, const std::string& labelFilename);
+
+	int size() const override { return count; }
+	int recordSize() const override { return rows * cols; }
+	bool readRange(int first, int count, unsigned char* pixels, unsigned char* labels) override;
+
+private:
+	std::ifstream imageStream;
+	std::ifstream labelStream;
+	int count;
+	int rows;
+	int cols;
+};
+
+// An already mapped MnistDataset (which must outlive the source)
+class MnistDatasetSource : public DataSource {
+
+public:
+	MnistDatasetSource(const MnistDataset& dataset) : dataset(dataset) {}
+
+	int size() const override { return dataset.size(); }
+	int recordSize() const override { return dataset.imageSize(); }
+	bool readRange(int first, int count, unsigned char* pixels, unsigned char* labels) override;
+
+private:
+	const MnistDataset& dataset;
+};
+
+// --- BATCH ---
+// One ready-to-train batch: pixels feed Network's unsigned char overloads, targets are one-hot.
+struct Batch {
+	int count;                   // samples in this batch (the last one of an epoch can be short)
+	std::vector<unsigned char> pixels; // count x recordSize
+	std::vector<unsigned char> labels; // count
+	std::vector<float> targets;        // count x numClasses
+};
+
+// --- BATCH STREAM ---
+// Shuffled mini-batches from a DataSource, assembled on a background thread while the caller trains.
+//
+// Shuffling never needs the whole dataset in memory:
+//   1. the dataset is cut into chunks of chunkRecords consecutive records and the chunk ORDER is permuted
+//      (an index permutation: one int per chunk),
+//   2. chunks are read in that order into a shuffle buffer of bufferChunks chunks, and every sample is drawn
+//      from a random slot of the buffer, which is then topped up with the next chunk.
+// With bufferChunks >= the number of chunks this is a full uniform shuffle.
+//
+// Memory is bounded by (bufferChunks * chunkRecords + prefetch * batchSize) records, whatever the dataset size.
+// Up to 'prefetch' batches are built ahead; next() only waits if the producer falls behind.
+class BatchStream {
+
+public:
+	BatchStream(DataSource& source, int batchSize, int numClasses = 10,
+		int chunkRecords = 1024, int bufferChunks = 8, int prefetch = 3);
+	~BatchStream();
+
+	BatchStream(const BatchStream&) = delete;
+	BatchStream& operator=(const BatchStream&) = delete;
+
+	// Starts a new pass over the data, shuffled with 'seed'. Any batches left from the last epoch are dropped.
+	void startEpoch(unsigned int seed);
+
+	// The next batch of the current epoch, or nullptr at the end of it (or after a read error).
+	// The batch stays valid until the following next() / startEpoch() call.
+	const Batch* next();
+
+	// Total time next() has spent waiting for the producer (the stall the prefetch is there to hide)
+	double stallSeconds() const { return stalled; }
+	bool failed() const { return readFailed; }
+
+	int maxBatchSize() const { return batchSize; }
+	int classCount() const { return numClasses; }
+	int recordBytes() const { return recordSize; }
+
+private:
+	void producerLoop();
+	bool produceEpoch(unsigned int seed, long long epoch);
+	bool fillBatch(Batch& batch, std::mt19937& rng, std::vector<int>& chunkOrder, int& nextChunk);
+	bool loadChunk(int chunk);
+	void releaseCurrent();
+
+	DataSource& source;
+	int batchSize;
+	int numClasses;
+	int chunkRecords;
+	int bufferChunks;
+	int recordSize;
+
+	// Shuffle buffer (producer thread only)
+	std::vector<unsigned char> bufferPixels;
+	std::vector<unsigned char> bufferLabels;
+	int bufferCount;
+
+	// Batch slots handed between the threads
+	std::vector<Batch> slots;
+	std::vector<int> freeSlots;
+	std::vector<int> readySlots; // in production order
+	int currentSlot;             // slot the caller is holding, or -1
+
+	std::thread producer;
+	std::mutex mutex;
+	std::condition_variable changed;
+	long long epoch;       // bumped by startEpoch()
+	unsigned int epochSeed;
+	bool epochDone;        // producer finished the current epoch
+	bool readFailed;
+	bool stopping;
+	double stalled;
+};
+
+// --- AUGMENT STREAM ---
+// A BatchStream's batches as network inputs: every image widened to float and run through an Augmenter
+// (Preprocess.h) by a set of worker threads, several batches ahead of the trainer.
+//
+// Batches come out in the BatchStream's order, and batch n of an epoch is augmented with a generator seeded
+// from (epoch seed, n), so a run gives the same inputs whatever the number of threads. Up to 'prefetch'
+// batches wait ready while the workers augment the next ones; next() only waits if they fall behind.
+struct AugmentedBatch {
+	int count;                  // samples in this batch
+	std::vector<float> inputs;  // count x recordSize, augmented and normalized
+	std::vector<float> targets; // count x numClasses
+	std::vector<unsigned char> labels; // count
+	std::vector<unsigned char> pixels; // count x recordSize, the images as read (the workers' input)
+};
+
+class AugmentStream {
+
+public:
+	// Images are width x height records of the stream (width * height == its record size)
+	AugmentStream(BatchStream& stream, const AugmentSettings& settings, int width, int height, int threads, int prefetch = 4);
+	~AugmentStream();
+
+	AugmentStream(const AugmentStream&) = delete;
+	AugmentStream& operator=(const AugmentStream&) = delete;
+
+	// Starts a new pass over the data (and the BatchStream's), shuffled and augmented with 'seed'
+	void startEpoch(unsigned int seed);
+
+	// The next batch of the current epoch, or nullptr at the end of it (or after a read error).
+	// The batch stays valid until the following next() / startEpoch() call.
+	const AugmentedBatch* next();
+
+	// Total time next() has spent waiting for the workers
+	double stallSeconds() const { return stalled; }
+	bool failed() const { return readFailed; }
+	int numThreads() const { return (int)workers.size(); }
+
+private:
+	void workerLoop(int index);
+	void releaseCurrent();
+
+	BatchStream& stream;
+	int recordSize;
+	std::vector<Augmenter> augmenters; // one per worker
+	std::vector<std::thread> workers;
+
+	// Batch slots handed between the threads
+	std::vector<AugmentedBatch> slots;
+	std::vector<int> freeSlots;
+	std::map<int, int> readySlots; // batch number in the epoch -> slot
+	int currentSlot;               // slot the caller is holding, or -1
+	int nextBatch;                 // batch number next() hands out next
+
+	std::mutex mutex;
+	std::condition_variable changed;
+	long long epoch;       // bumped by startEpoch()
+	unsigned int epochSeed;
+	int epochBatches;      // batches in the current epoch once the stream ran dry, -1 before
+	bool readFailed;
+	bool stopping;
+	double stalled;
+
+	// The BatchStream has one consumer at a time: the worker holding sourceMutex
+	std::mutex sourceMutex;
+	long long sourceEpoch; // epoch the stream was last started for
+	int pulled;            // batches taken from the stream this epoch
+};
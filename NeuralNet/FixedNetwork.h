@@ -0,0 +1,270 @@
+#pragma once
+#include <array>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <iostream>
+#include "NeuNetCode.h"
+#include "ModelFile.h"
+#include "Simd.h"
+#include "SimdTargets.h"
+
+// --- FIXED-TOPOLOGY NETWORK ---
+// A Network whose shape is a template argument. Every size and activation is known at compile time, so:
+//   - parameters live in std::array members (no heap, no per-layer indirection)
+//   - every loop has a constant trip count the compiler can fully unroll and vectorize; the block kernel
+//     is compiled once per instruction set and the widest one the CPU runs is used (see Simd.h)
+//   - the activation is picked by template specialization, never by a runtime switch
+// It reads the same model files as Network and converts to/from one, so the dynamic Network stays
+// the type for training and the fixed one can take over inference once the shape is settled.
+//
+//   typedef FixedNetwork<784, Dense<100, ActivationType::RELU>, Dense<10, ActivationType::SOFTMAX>> MnistNetwork;
+//
+// The parameters are stored inline (about 310 KB for MnistNetwork), so create it on the heap.
+
+template <int Neurons, ActivationType Act>
+struct Dense {
+	static const int numNeurons = Neurons;
+	static const ActivationType actType = Act;
+};
+
+namespace fixed {
+
+// --- ACTIVATIONS ---
+// Same math as the scalar kernels in Simd.cpp
+template <ActivationType Act> struct Activation;
+
+template <> struct Activation<ActivationType::RELU> {
+	template <int N> static void apply(float* x) {
+		for (int i = 0; i < N; i++) x[i] = (x[i] > 0.0f) ? x[i] : 0.0f;
+	}
+};
+
+template <> struct Activation<ActivationType::SIGMOID> {
+	template <int N> static void apply(float* x) {
+		for (int i = 0; i < N; i++) x[i] = 1.0f / (1.0f + std::exp(-x[i]));
+	}
+};
+
+template <> struct Activation<ActivationType::TANH> {
+	template <int N> static void apply(float* x) {
+		for (int i = 0; i < N; i++) x[i] = std::tanh(x[i]);
+	}
+};
+
+template <> struct Activation<ActivationType::SOFTMAX> {
+	template <int N> static void apply(float* x) {
+		float maxVal = x[0];
+		for (int i = 1; i < N; i++) maxVal = (x[i] > maxVal) ? x[i] : maxVal;
+		float sum = 0.0f;
+		for (int i = 0; i < N; i++) {
+			x[i] = std::exp(x[i] - maxVal);
+			sum += x[i];
+		}
+		float inv = 1.0f / sum;
+		for (int i = 0; i < N; i++) x[i] *= inv;
+	}
+};
+
+// --- LAYER ---
+// Weights are stored input-major in blocks of BLOCK neurons: block b holds, for every input i, the weights
+// of neurons [b * BLOCK, b * BLOCK + BLOCK) contiguously. A block's sums fit in registers, and the inner
+// loop (x[i] times one weight row of the block) vectorizes without reordering any float additions.
+template <int Inputs, int Neurons, ActivationType Act>
+struct FixedLayer {
+	static const int BLOCK = 64; // 2 x 64 sums: 8 zmm or 16 ymm registers
+	static const int FULL_BLOCKS = Neurons / BLOCK;
+	static const int TAIL = Neurons % BLOCK;
+
+	std::array<float, Neurons * Inputs> weights;
+	std::array<float, Neurons> biases;
+
+	void feedForward(const float* x, float* y) const {
+		const SimdLevel level = Simd().level;
+		const float* w = weights.data();
+		for (int b = 0; b < FULL_BLOCKS; b++) {
+			block<BLOCK>(level, w, &biases[b * BLOCK], x, y + b * BLOCK);
+			w += BLOCK * Inputs;
+		}
+		if (TAIL > 0) block<(TAIL > 0 ? TAIL : 1)>(level, w, &biases[FULL_BLOCKS * BLOCK], x, y + FULL_BLOCKS * BLOCK);
+		Activation<Act>::template apply<Neurons>(y);
+	}
+
+	// y[0..B) = bias + x * (Inputs x B weight block). Even and odd inputs go to separate sums,
+	// which doubles the independent add chains the loop can keep in flight.
+	template <int B>
+	static NN_FORCE_INLINE void blockBody(const float* w, const float* bias, const float* x, float* y) {
+		float even[B], odd[B];
+		for (int c = 0; c < B; c++) {
+			even[c] = bias[c];
+			odd[c] = 0.0f;
+		}
+		for (int i = 0; i + 1 < Inputs; i += 2) {
+			const float x0 = x[i], x1 = x[i + 1];
+			for (int c = 0; c < B; c++) {
+				even[c] += x0 * w[c];
+				odd[c] += x1 * w[B + c];
+			}
+			w += 2 * B;
+		}
+		if (Inputs % 2) {
+			const float x0 = x[Inputs - 1];
+			for (int c = 0; c < B; c++) even[c] += x0 * w[c];
+		}
+		for (int c = 0; c < B; c++) y[c] = even[c] + odd[c];
+	}
+
+	template <int B>
+	static void blockGeneric(const float* w, const float* bias, const float* x, float* y) { blockBody<B>(w, bias, x, y); }
+#ifdef NN_X86
+	template <int B>
+	static NN_TARGET_AVX2 void blockAvx2(const float* w, const float* bias, const float* x, float* y) { blockBody<B>(w, bias, x, y); }
+	template <int B>
+	static NN_TARGET_AVX512 void blockAvx512(const float* w, const float* bias, const float* x, float* y) { blockBody<B>(w, bias, x, y); }
+#endif
+
+	template <int B>
+	static void block(SimdLevel level, const float* w, const float* bias, const float* x, float* y) {
+#ifdef NN_X86
+		if (level == SimdLevel::AVX512) return blockAvx512<B>(w, bias, x, y);
+		if (level == SimdLevel::AVX2) return blockAvx2<B>(w, bias, x, y);
+#endif
+		blockGeneric<B>(w, bias, x, y);
+	}
+
+	// Index of neuron j's weight for input i in the blocked layout
+	static int index(int j, int i) {
+		int b = j / BLOCK;
+		int width = (b < FULL_BLOCKS) ? BLOCK : TAIL;
+		return b * BLOCK * Inputs + i * width + (j - b * BLOCK);
+	}
+
+	bool copyFrom(const Layer& src) {
+		if (src.type != LayerType::DENSE || src.numInputs != Inputs || src.numNeurons != Neurons || src.actType != Act) return false;
+		for (int j = 0; j < Neurons; j++) {
+			for (int i = 0; i < Inputs; i++) weights[index(j, i)] = src.weightData()[(size_t)j * Inputs + i];
+			biases[j] = src.biasData()[j];
+		}
+		return true;
+	}
+
+	// dst must already have this layer's shape
+	void copyTo(Layer& dst) const {
+		for (int j = 0; j < Neurons; j++) {
+			for (int i = 0; i < Inputs; i++) dst.weights[(size_t)j * Inputs + i] = weights[index(j, i)];
+			dst.biases[j] = biases[j];
+		}
+	}
+};
+
+// --- LAYER STACK ---
+// Layer 0 plus the stack of the remaining layers, fed by layer 0's outputs
+template <int Inputs, class... Specs> struct Stack;
+
+template <int Inputs, class Spec>
+struct Stack<Inputs, Spec> {
+	static const int numOutputs = Spec::numNeurons;
+	static const int numLayers = 1;
+
+	FixedLayer<Inputs, Spec::numNeurons, Spec::actType> layer;
+
+	void feedForward(const float* x, float* out) const { layer.feedForward(x, out); }
+	bool copyFrom(const std::vector<Layer>& layers, int first) { return layer.copyFrom(layers[first]); }
+	void copyTo(std::vector<Layer>& layers) const {
+		layers.push_back(Layer(Spec::numNeurons, Inputs, Spec::actType, false));
+		layer.copyTo(layers.back());
+	}
+	static void shape(std::vector<int>& neurons) { neurons.push_back(int(Spec::numNeurons)); }
+};
+
+template <int Inputs, class Spec, class Next, class... Rest>
+struct Stack<Inputs, Spec, Next, Rest...> {
+	typedef Stack<Spec::numNeurons, Next, Rest...> Tail;
+	static const int numOutputs = Tail::numOutputs;
+	static const int numLayers = 1 + Tail::numLayers;
+
+	FixedLayer<Inputs, Spec::numNeurons, Spec::actType> layer;
+	Tail rest;
+
+	// The hidden activations live on the stack: the pass is allocation-free and needs no workspace
+	void feedForward(const float* x, float* out) const {
+		float hidden[Spec::numNeurons];
+		layer.feedForward(x, hidden);
+		rest.feedForward(hidden, out);
+	}
+	bool copyFrom(const std::vector<Layer>& layers, int first) {
+		return layer.copyFrom(layers[first]) && rest.copyFrom(layers, first + 1);
+	}
+	void copyTo(std::vector<Layer>& layers) const {
+		layers.push_back(Layer(Spec::numNeurons, Inputs, Spec::actType, false));
+		layer.copyTo(layers.back());
+		rest.copyTo(layers);
+	}
+	static void shape(std::vector<int>& neurons) {
+		neurons.push_back(int(Spec::numNeurons));
+		Tail::shape(neurons);
+	}
+};
+
+} // namespace fixed
+
+template <int Inputs, class... Specs>
+class FixedNetwork {
+
+public:
+	static_assert(sizeof...(Specs) > 0, "FixedNetwork needs at least one layer");
+	typedef fixed::Stack<Inputs, Specs...> Layers;
+
+	static const int numInputs = Inputs;
+	static const int numOutputs = Layers::numOutputs;
+	static const int numLayers = Layers::numLayers;
+
+	// outputs must hold numOutputs floats. Does not allocate; safe to call from any number of threads.
+	void feedForward(const float* inputs, float* outputs) const {
+		layers.feedForward(inputs, outputs);
+	}
+
+	// Copies the parameters of a Network with exactly this shape and these activations
+	bool copyFrom(const Network& net) {
+		if ((int)net.layers.size() != numLayers) return false;
+		return layers.copyFrom(net.layers, 0);
+	}
+
+	// Rebuilds net as a dynamic Network with the same shape and parameters
+	void copyTo(Network& net) const {
+		std::vector<Layer> converted;
+		layers.copyTo(converted);
+		net.layers.swap(converted);
+	}
+
+	// Binary model file (ModelFile.h); fails if the stored shape differs from this one
+	bool load(const std::string& filename) {
+		Network net;
+		if (!LoadModel(filename, net)) return false;
+		if (!copyFrom(net)) {
+			std::cout << "error: " << filename << " does not have the layer sizes and activations of this FixedNetwork" << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	bool save(const std::string& filename) const {
+		Network net;
+		copyTo(net);
+		return SaveModel(net, filename);
+	}
+
+	// Neuron counts of the hidden layers, as Network's constructor and ConvertTextModel take them
+	static std::vector<int> hiddenLayers() {
+		std::vector<int> neurons;
+		Layers::shape(neurons);
+		neurons.pop_back();
+		return neurons;
+	}
+
+private:
+	Layers layers;
+};
+
+// The shape the GUI and the trainers use
+typedef FixedNetwork<784, Dense<100, ActivationType::RELU>, Dense<10, ActivationType::SOFTMAX>> MnistNetwork;
@@ -0,0 +1,163 @@
+#include "Gemm.h"
+#include "Simd.h"
+#include <cstddef>
+#include <vector>
+
+// --- BLOCKING PARAMETERS ---
+// The micro-kernel computes an MR x NR tile of C held entirely in registers
+// (the tile size comes from the SIMD kernel set picked at startup).
+// A KC x NR sliver of packed B stays in L1, an MC x KC block of packed A stays in L2,
+// and a KC x NC panel of packed B stays in L3 while every A block streams past it.
+// MC is a multiple of every MR (4, 6, 8) and NC of every NR (8, 16, 32).
+static const int MIN_MR = 4;
+static const int MC = 120;
+static const int KC = 256;
+static const int NC = 2048;
+
+// Below this many multiply-adds (or for skinny shapes) packing costs more than it saves
+static const double SMALL_GEMM_FLOPS = 64.0 * 64.0 * 64.0;
+
+// Element access for op(A)[i][k] and op(B)[k][j]
+static inline float GetA(bool transA, const float* A, int lda, int i, int k) {
+    return transA ? A[(size_t)k * lda + i] : A[(size_t)i * lda + k];
+}
+
+static inline float GetB(bool transB, const float* B, int ldb, int k, int j) {
+    return transB ? B[(size_t)j * ldb + k] : B[(size_t)k * ldb + j];
+}
+
+// --- SIMPLE PATH ---
+// Matrix-vector shapes (one sample, rank-1 updates) go straight through without packing
+static void SgemmSimple(bool transA, bool transB, int M, int N, int K,
+    float alpha, const float* A, int lda, const float* B, int ldb, float* C, int ldc) {
+
+    const SimdKernels& simd = Simd();
+
+    if (transB && !transA) {
+        // Rows of A and B are both contiguous: every C[i][j] is one dot product
+        for (int i = 0; i < M; i++) {
+            const float* a = &A[(size_t)i * lda];
+            float* c = &C[(size_t)i * ldc];
+            for (int j = 0; j < N; j++) {
+                c[j] += alpha * simd.dot(a, &B[(size_t)j * ldb], K);
+            }
+        }
+        return;
+    }
+
+    if (transB) {
+        for (int i = 0; i < M; i++) {
+            float* c = &C[(size_t)i * ldc];
+            for (int j = 0; j < N; j++) {
+                const float* b = &B[(size_t)j * ldb];
+                float sum = 0.0f;
+                for (int k = 0; k < K; k++) sum += GetA(transA, A, lda, i, k) * b[k];
+                c[j] += alpha * sum;
+            }
+        }
+        return;
+    }
+
+    // i-k-j order: every step streams a row of B into a row of C
+    for (int i = 0; i < M; i++) {
+        float* c = &C[(size_t)i * ldc];
+        for (int k = 0; k < K; k++) {
+            float a = alpha * GetA(transA, A, lda, i, k);
+            if (a == 0.0f) continue;
+            simd.axpy(a, &B[(size_t)k * ldb], c, N);
+        }
+    }
+}
+
+// --- PACKING ---
+// Packed A: for every mr-row sliver, kc columns of mr consecutive values (rows padded with zeros).
+static void PackA(bool transA, const float* A, int lda, int i0, int mc, int k0, int kc, int mr, float* packed) {
+    for (int ir = 0; ir < mc; ir += mr) {
+        int rows = (mc - ir < mr) ? mc - ir : mr;
+        for (int k = 0; k < kc; k++) {
+            for (int r = 0; r < rows; r++) *packed++ = GetA(transA, A, lda, i0 + ir + r, k0 + k);
+            for (int r = rows; r < mr; r++) *packed++ = 0.0f;
+        }
+    }
+}
+
+// Packed B: for every nr-column sliver, kc rows of nr consecutive values (columns padded with zeros).
+static void PackB(bool transB, const float* B, int ldb, int k0, int kc, int j0, int nc, int nr, float* packed) {
+    for (int jr = 0; jr < nc; jr += nr) {
+        int cols = (nc - jr < nr) ? nc - jr : nr;
+        for (int k = 0; k < kc; k++) {
+            if (!transB && cols == nr) {
+                const float* b = &B[(size_t)(k0 + k) * ldb + j0 + jr];
+                for (int c = 0; c < nr; c++) packed[c] = b[c];
+            }
+            else {
+                for (int c = 0; c < cols; c++) packed[c] = GetB(transB, B, ldb, k0 + k, j0 + jr + c);
+                for (int c = cols; c < nr; c++) packed[c] = 0.0f;
+            }
+            packed += nr;
+        }
+    }
+}
+
+// --- BLOCKED PATH ---
+static void SgemmBlocked(bool transA, bool transB, int M, int N, int K,
+    float alpha, const float* A, int lda, const float* B, int ldb, float* C, int ldc) {
+
+    const SimdKernels& simd = Simd();
+    const int mr = simd.gemmMR;
+    const int nr = simd.gemmNR;
+
+    // Per-thread pack buffers, grown once and then reused by every call
+    thread_local std::vector<float> packedA;
+    thread_local std::vector<float> packedB;
+    if (packedA.size() < (size_t)MC * KC) packedA.resize((size_t)MC * KC);
+    if (packedB.size() < (size_t)KC * NC) packedB.resize((size_t)KC * NC);
+
+    for (int jc = 0; jc < N; jc += NC) {
+        int nc = (N - jc < NC) ? N - jc : NC;
+
+        for (int pc = 0; pc < K; pc += KC) {
+            int kc = (K - pc < KC) ? K - pc : KC;
+            PackB(transB, B, ldb, pc, kc, jc, nc, nr, packedB.data());
+
+            for (int ic = 0; ic < M; ic += MC) {
+                int mc = (M - ic < MC) ? M - ic : MC;
+                PackA(transA, A, lda, ic, mc, pc, kc, mr, packedA.data());
+
+                for (int jr = 0; jr < nc; jr += nr) {
+                    int cols = (nc - jr < nr) ? nc - jr : nr;
+                    const float* b = &packedB[(size_t)jr * kc];
+
+                    for (int ir = 0; ir < mc; ir += mr) {
+                        int rows = (mc - ir < mr) ? mc - ir : mr;
+                        const float* a = &packedA[(size_t)ir * kc];
+                        simd.gemmKernel(kc, a, b, alpha, &C[(size_t)(ic + ir) * ldc + jc + jr], ldc, rows, cols);
+                    }
+                }
+            }
+        }
+    }
+}
+
+void Sgemm(bool transA, bool transB, int M, int N, int K,
+    float alpha, const float* A, int lda, const float* B, int ldb,
+    float beta, float* C, int ldc) {
+
+    // 1. Scale C by beta (beta == 0 must ignore whatever garbage C holds)
+    if (beta != 1.0f) {
+        for (int i = 0; i < M; i++) {
+            float* c = &C[(size_t)i * ldc];
+            for (int j = 0; j < N; j++) c[j] = (beta == 0.0f) ? 0.0f : c[j] * beta;
+        }
+    }
+    if (M <= 0 || N <= 0 || K <= 0 || alpha == 0.0f) return;
+
+    // 2. Accumulate alpha * op(A) * op(B)
+    double flops = (double)M * N * K;
+    if (M < MIN_MR || K < 4 || flops < SMALL_GEMM_FLOPS) {
+        SgemmSimple(transA, transB, M, N, K, alpha, A, lda, B, ldb, C, ldc);
+    }
+    else {
+        SgemmBlocked(transA, transB, M, N, K, alpha, A, lda, B, ldb, C, ldc);
+    }
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+// --- SGEMM ---
+// Row-major single precision matrix multiply:
+//
+//     C = alpha * op(A) * op(B) + beta * C
+//
+// op(A) is M x K and op(B) is K x N, C is M x N.
+// transA / transB mean the matrix is stored transposed (A is then K x M, B is N x K).
+// lda, ldb and ldc are the row strides of A, B and C in floats.
+void Sgemm(bool transA, bool transB, int M, int N, int K,
+	float alpha, const float* A, int lda, const float* B, int ldb,
+	float beta, float* C, int ldc);
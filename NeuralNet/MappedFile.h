@@ -0,0 +1,34 @@
+#pragma once
+#include <string>
+#include <cstddef>
+
+// --- MAPPED FILE ---
+// A whole file mapped read-only into memory. Pages are read in by the OS on first touch
+// and shared with every other process mapping the same file, so "loading" costs nothing up front.
+class MappedFile {
+
+public:
+	MappedFile();
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// Closes whatever was open first. Prints why and returns false on failure.
+	bool open(const std::string& filename);
+	void close();
+
+	bool isOpen() const { return bytes != nullptr; }
+	const unsigned char* data() const { return bytes; }
+	size_t size() const { return length; }
+
+private:
+	const unsigned char* bytes;
+	size_t length;
+#ifdef _WIN32
+	void* fileHandle;
+	void* mappingHandle;
+#else
+	int fd;
+#endif
+};
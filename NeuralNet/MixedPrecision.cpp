@@ -0,0 +1,152 @@
+#include "MixedPrecision.h"
+#include <algorithm>
+#include <iostream>
+
+// --- HELPERS: ACTIVATIONS ---
+// Same rules as NeuNetCode.cpp; derivatives are taken from the fp32 outputs
+static void ActivateRow(float* sums, int count, ActivationType type) {
+    const SimdKernels& simd = Simd();
+
+    if (type == ActivationType::TANH) simd.tanh(sums, count);
+    else if (type == ActivationType::RELU) simd.relu(sums, count);
+    else if (type == ActivationType::SIGMOID) simd.sigmoid(sums, count);
+    else if (type == ActivationType::SOFTMAX) simd.softmax(sums, count);
+}
+
+static float ActivationDerivative(float output, ActivationType type) {
+    if (type == ActivationType::TANH) return 1.0f - output * output;
+    if (type == ActivationType::RELU) return (output > 0) ? 1.0f : 0.0f;
+    if (type == ActivationType::SIGMOID) return output * (1.0f - output);
+    return 0.0f;
+}
+
+MixedWorkspace::MixedWorkspace(const MixedPrecisionNetwork& net) {
+    for (const Layer& layer : net.master.layers) {
+        inputs.push_back(std::vector<unsigned short>(layer.numInputs, 0));
+        activations.push_back(std::vector<float>(layer.numNeurons, 0.0f));
+        deltas.push_back(std::vector<float>(layer.numNeurons, 0.0f));
+    }
+    pixels.assign(net.numInputs(), 0.0f);
+}
+
+MixedPrecisionNetwork::MixedPrecisionNetwork(const Network& net, HalfType type)
+    : master(net), type(type), kernels(&SimdHalf(type)) {
+    refresh();
+}
+
+MixedPrecisionNetwork::MixedPrecisionNetwork(const Network& net, HalfType type, SimdLevel level)
+    : master(net), type(type), kernels(SimdHalfFor(type, level)) {
+    if (!kernels) kernels = SimdHalfFor(type, SimdLevel::SCALAR);
+    refresh();
+}
+
+void MixedPrecisionNetwork::refresh() {
+    if (!master.isDense()) {
+        std::cout << "error: 16-bit weights take dense layers only, this network has convolution or pooling layers" << std::endl;
+        master.layers.clear();
+    }
+    weights.resize(master.layers.size());
+    for (int i = 0; i < master.layers.size(); i++) {
+        const Layer& source = master.layers[i];
+        weights[i].resize(source.weightCount());
+        kernels->fromFloat(source.weightData(), weights[i].data(), (int)source.weightCount());
+    }
+}
+
+int MixedPrecisionNetwork::numInputs() const {
+    return master.numInputs();
+}
+
+int MixedPrecisionNetwork::numOutputs() const {
+    return master.numOutputs();
+}
+
+size_t MixedPrecisionNetwork::weightBytes() const {
+    size_t bytes = 0;
+    for (int i = 0; i < master.layers.size(); i++) {
+        bytes += weights[i].size() * sizeof(unsigned short) + master.layers[i].biasCount() * sizeof(float);
+    }
+    return bytes;
+}
+
+// What an empty network (refresh() refused its layers) answers
+static const std::vector<float> noOutputs;
+
+const std::vector<float>& MixedPrecisionNetwork::feedForward(const float* inputs, MixedWorkspace& ws) const {
+    if (master.layers.empty()) return noOutputs;
+    kernels->fromFloat(inputs, ws.inputs[0].data(), numInputs());
+    return runLayers(ws);
+}
+
+const std::vector<float>& MixedPrecisionNetwork::feedForward(const unsigned char* pixels, MixedWorkspace& ws) const {
+    if (master.layers.empty()) return noOutputs;
+    float* scaled = ws.pixels.data();
+    for (int k = 0; k < numInputs(); k++) scaled[k] = pixels[k] * PIXEL_SCALE;
+    kernels->fromFloat(scaled, ws.inputs[0].data(), numInputs());
+    return runLayers(ws);
+}
+
+const std::vector<float>& MixedPrecisionNetwork::runLayers(MixedWorkspace& ws) const {
+    for (int i = 0; i < master.layers.size(); i++) {
+        const Layer& layer = master.layers[i];
+        float* out = ws.activations[i].data();
+        kernels->gemv(weights[i].data(), ws.inputs[i].data(), layer.numInputs, layer.numNeurons, out);
+        const float* bias = layer.biasData();
+        for (int j = 0; j < layer.numNeurons; j++) out[j] += bias[j];
+        ActivateRow(out, layer.numNeurons, layer.actType);
+
+        // The next layer reads these rounded to 16 bits
+        if (i + 1 < master.layers.size()) kernels->fromFloat(out, ws.inputs[i + 1].data(), layer.numNeurons);
+    }
+    return ws.activations.back();
+}
+
+void MixedPrecisionNetwork::backPropagate(const float* inputs, const float* targets, float learningRate, MixedWorkspace& ws) {
+    if (master.layers.empty()) return;
+    if (master.isReadOnly()) {
+        std::cout << "error: this network views a model file read-only, train a copy of it" << std::endl;
+        return;
+    }
+    feedForward(inputs, ws);
+
+    const Layer& outputLayer = master.layers.back();
+    const float* outputs = ws.activations.back().data();
+    float* outputDeltas = ws.deltas.back().data();
+    for (int j = 0; j < outputLayer.numNeurons; j++) {
+        float error = targets[j] - outputs[j];
+
+        // Softmax + cross-entropy: the derivative cancels out
+        outputDeltas[j] = (outputLayer.actType == ActivationType::SOFTMAX) ? error : error * ActivationDerivative(outputs[j], outputLayer.actType);
+    }
+
+    // Layer i + 1 pushes its error terms down into layer i, through its 16-bit weights
+    for (int i = (int)master.layers.size() - 2; i >= 0; i--) {
+        const Layer& above = master.layers[i + 1];
+        const float* aboveDeltas = ws.deltas[i + 1].data();
+        float* errors = ws.deltas[i].data();
+        std::fill(errors, errors + above.numInputs, 0.0f);
+        for (int j = 0; j < above.numNeurons; j++) {
+            if (aboveDeltas[j] == 0.0f) continue;
+            kernels->axpy(aboveDeltas[j], &weights[i + 1][(size_t)j * above.numInputs], errors, above.numInputs);
+        }
+
+        const Layer& layer = master.layers[i];
+        const float* act = ws.activations[i].data();
+        for (int j = 0; j < layer.numNeurons; j++) errors[j] *= ActivationDerivative(act[j], layer.actType);
+    }
+
+    // fp32 step on the master, rounded into the 16-bit copy in the same pass
+    for (int i = 0; i < master.layers.size(); i++) {
+        Layer& layer = master.layers[i];
+        const unsigned short* layerInputs = ws.inputs[i].data();
+        const float* deltas = ws.deltas[i].data();
+        for (int j = 0; j < layer.numNeurons; j++) {
+            float step = learningRate * deltas[j];
+            if (step == 0.0f) continue; // e.g. a ReLU that was off for this sample
+
+            size_t row = (size_t)j * layer.numInputs;
+            kernels->axpyMaster(step, layerInputs, &layer.weights[row], &weights[i][row], layer.numInputs);
+            layer.biases[j] += step;
+        }
+    }
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <vector>
+#include "NeuNetCode.h"
+#include "Simd.h"
+
+// --- MIXED PRECISION ---
+// A Network whose weights and activations are stored in 16 bits (bfloat16 or IEEE fp16), trained and run
+// one sample at a time like Network::feedForward / backPropagate.
+//
+//   weights:      the passes read a 16-bit copy of every weight matrix, half the bytes of the fp32 path.
+//                 The fp32 master weights stay: every update is added to them and the result rounded back
+//                 into the 16-bit copy, so steps smaller than a 16-bit rounding step still add up.
+//   activations:  each layer's inputs (the network inputs too) are rounded to 16 bits once per sample
+//   accumulation: fp32 throughout, as are the biases, the output layer's outputs and the error terms
+//
+// bf16 has fp32's range, so nothing can overflow; fp16 has 3 more mantissa bits but tops out at 65504,
+// far above any weight, pixel or activation here. The kernels come from SimdHalf() (vdpbf16ps on AVX-512 BF16).
+// Dense layers only: a Network with CONV2D or MAXPOOL layers gives an empty one (numInputs() == 0), whose
+// feedForward returns no outputs and whose backPropagate does nothing.
+class MixedPrecisionNetwork;
+
+// Per-thread buffers for MixedPrecisionNetwork (allocated once)
+class MixedWorkspace {
+
+public:
+	MixedWorkspace() {}
+	MixedWorkspace(const MixedPrecisionNetwork& net);
+
+	std::vector<std::vector<unsigned short>> inputs; // inputs[i] = 16-bit inputs of layers[i]
+	std::vector<std::vector<float>> activations;     // activations[i] = fp32 outputs of layers[i]
+	std::vector<std::vector<float>> deltas;          // deltas[i] = error terms of layers[i]
+	std::vector<float> pixels;                       // raw 8-bit inputs scaled to float (numInputs)
+};
+
+class MixedPrecisionNetwork {
+
+public:
+	MixedPrecisionNetwork() : type(HalfType::BF16), kernels(nullptr) {}
+	// Copies net as the fp32 master and rounds the 16-bit weights from it
+	MixedPrecisionNetwork(const Network& net, HalfType type);
+	// Kernels of one specific SIMD level (falls back to scalar if this CPU can't run it)
+	MixedPrecisionNetwork(const Network& net, HalfType type, SimdLevel level);
+
+	// Output of the last layer (numOutputs() floats). Does not allocate.
+	const std::vector<float>& feedForward(const float* inputs, MixedWorkspace& ws) const;
+	const std::vector<float>& feedForward(const unsigned char* pixels, MixedWorkspace& ws) const;
+
+	// One SGD step on one sample, as Network::backPropagate: forward and error propagation through the
+	// 16-bit weights, the update added to the fp32 master and rounded into the 16-bit copy in the same pass
+	void backPropagate(const float* inputs, const float* targets, float learningRate, MixedWorkspace& ws);
+
+	// Rounds the 16-bit weights from the master again (after changing master directly, e.g. loading it)
+	void refresh();
+
+	int numInputs() const;
+	int numOutputs() const;
+	HalfType halfType() const { return type; }
+	const char* kernelName() const { return kernels ? kernels->name : "none"; }
+
+	// Bytes a forward pass reads: 16-bit weights and fp32 biases (the fp32 path reads 4 bytes per weight)
+	size_t weightBytes() const;
+
+	Network master;                                   // fp32 master weights; save and load through this
+	std::vector<std::vector<unsigned short>> weights; // weights[i] = master.layers[i].weights in 16 bits
+
+private:
+	// Forward pass from ws.inputs[0]
+	const std::vector<float>& runLayers(MixedWorkspace& ws) const;
+
+	HalfType type;
+	const HalfKernels* kernels;
+};
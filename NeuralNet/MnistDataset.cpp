@@ -0,0 +1,94 @@
+#include "MnistDataset.h"
+#include <iostream>
+
+// IDX magic numbers: 0x00 0x00, element type (0x08 = unsigned byte), number of dimensions
+static const unsigned int IDX_IMAGES_MAGIC = 0x00000803;
+static const unsigned int IDX_LABELS_MAGIC = 0x00000801;
+
+// IDX integers are big-endian
+static unsigned int ReadBigEndian(const unsigned char* p) {
+    return ((unsigned int)p[0] << 24) | ((unsigned int)p[1] << 16) | ((unsigned int)p[2] << 8) | (unsigned int)p[3];
+}
+
+bool ReadIdxImageHeader(const unsigned char* header, unsigned long long fileSize, const std::string& filename,
+    int& count, int& rows, int& cols) {
+
+    // magic, count, rows, cols
+    if (fileSize < 16 || ReadBigEndian(header) != IDX_IMAGES_MAGIC) {
+        std::cout << "error: " << filename << " is not an IDX image file" << std::endl;
+        return false;
+    }
+    unsigned int numImages = ReadBigEndian(header + 4);
+    unsigned int numRows = ReadBigEndian(header + 8);
+    unsigned int numCols = ReadBigEndian(header + 12);
+    if (numImages == 0 || numImages > 0x7fffffff || numRows == 0 || numCols == 0 || numRows > 4096 || numCols > 4096) {
+        std::cout << "error: " << filename << " has bad dimensions " << numImages << " x " << numRows << " x " << numCols << std::endl;
+        return false;
+    }
+    if (fileSize - 16 < (unsigned long long)numImages * numRows * numCols) {
+        std::cout << "error: " << filename << " is truncated" << std::endl;
+        return false;
+    }
+
+    count = (int)numImages;
+    rows = (int)numRows;
+    cols = (int)numCols;
+    return true;
+}
+
+bool ReadIdxLabelHeader(const unsigned char* header, unsigned long long fileSize, const std::string& filename, int& count) {
+    // magic, count
+    if (fileSize < 8 || ReadBigEndian(header) != IDX_LABELS_MAGIC) {
+        std::cout << "error: " << filename << " is not an IDX label file" << std::endl;
+        return false;
+    }
+    unsigned int numLabels = ReadBigEndian(header + 4);
+    if (numLabels > 0x7fffffff || fileSize - 8 < numLabels) {
+        std::cout << "error: " << filename << " is truncated" << std::endl;
+        return false;
+    }
+
+    count = (int)numLabels;
+    return true;
+}
+
+bool ReadIdxHeaders(const unsigned char* imageHeader, unsigned long long imageFileSize, const std::string& imageFilename,
+    const unsigned char* labelHeader, unsigned long long labelFileSize, const std::string& labelFilename,
+    int& count, int& rows, int& cols) {
+
+    int numLabels;
+    if (!ReadIdxImageHeader(imageHeader, imageFileSize, imageFilename, count, rows, cols)) return false;
+    if (!ReadIdxLabelHeader(labelHeader, labelFileSize, labelFilename, numLabels)) return false;
+    if (numLabels != count) {
+        std::cout << "error: " << count << " images but " << numLabels << " labels" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool MnistDataset::load(const std::string& imageFilename, const std::string& labelFilename) {
+    count = rows = cols = 0;
+    imagePixels = labelBytes = nullptr;
+
+    if (!imageFile.open(imageFilename) || !labelFile.open(labelFilename)) return false;
+
+    int numImages, numRows, numCols;
+    if (!ReadIdxHeaders(imageFile.data(), imageFile.size(), imageFilename,
+        labelFile.data(), labelFile.size(), labelFilename, numImages, numRows, numCols)) {
+        return false;
+    }
+
+    for (int i = 0; i < numImages; i++) {
+        if (labelFile.data()[8 + i] > 9) {
+            std::cout << "error: label " << (int)labelFile.data()[8 + i] << " at index " << i << " is not a digit" << std::endl;
+            return false;
+        }
+    }
+
+    count = numImages;
+    rows = numRows;
+    cols = numCols;
+    imagePixels = imageFile.data() + 16;
+    labelBytes = labelFile.data() + 8;
+    return true;
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <string>
+#include "MappedFile.h"
+
+// Check a 16-byte IDX image header / 8-byte IDX label header against the file size
+// (magic number, sane dimensions, nothing truncated). Print why and return false on failure.
+bool ReadIdxImageHeader(const unsigned char* header, unsigned long long fileSize, const std::string& filename,
+	int& count, int& rows, int& cols);
+bool ReadIdxLabelHeader(const unsigned char* header, unsigned long long fileSize, const std::string& filename, int& count);
+
+// Both of the above, plus the image and label counts must match
+bool ReadIdxHeaders(const unsigned char* imageHeader, unsigned long long imageFileSize, const std::string& imageFilename,
+	const unsigned char* labelHeader, unsigned long long labelFileSize, const std::string& labelFilename,
+	int& count, int& rows, int& cols);
+
+// --- MNIST DATASET (memory-mapped IDX files) ---
+// Maps an IDX image file and its IDX label file and hands out pointers straight into them:
+// no copies, no per-image allocations and no float expansion. Pixels stay 0..255 bytes;
+// Network's unsigned char overloads normalize them inside the first layer.
+// The headers are checked (magic numbers, dimensions, file sizes, label range) before anything is exposed.
+class MnistDataset {
+
+public:
+	MnistDataset() : count(0), rows(0), cols(0), imagePixels(nullptr), labelBytes(nullptr) {}
+
+	// Prints the reason and returns false if either file is missing or malformed
+	bool load(const std::string& imageFilename, const std::string& labelFilename);
+
+	int size() const { return count; }
+	int imageRows() const { return rows; }
+	int imageCols() const { return cols; }
+	int imageSize() const { return rows * cols; }
+
+	// Image i: imageSize() bytes, row-major. Images are back to back, so image(i) .. image(i + n - 1)
+	// is one batchSize x imageSize() block ready for Network::feedForwardBatch.
+	const unsigned char* image(int i) const { return imagePixels + (size_t)i * rows * cols; }
+	int label(int i) const { return labelBytes[i]; }
+
+private:
+	MappedFile imageFile;
+	MappedFile labelFile;
+	int count;
+	int rows;
+	int cols;
+	const unsigned char* imagePixels;
+	const unsigned char* labelBytes;
+};
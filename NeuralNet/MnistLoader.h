@@ -4,6 +4,9 @@
 #include <iostream>
 #include <string>
 
+// Simple stream loader that copies everything into normalized floats.
+// MnistDataset (MnistDataset.h) maps the same files zero-copy and is what the tools use.
+
 // Define the Data Structure for an Image
 struct MnistImage {
     std::vector<float> pixels; // 784 floats (0.0 to 1.0)
@@ -0,0 +1,376 @@
+#include "ModelFile.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+static const char MODEL_MAGIC[8] = { 'N', 'N', 'M', 'O', 'D', 'E', 'L', '\0' };
+static const uint64_t PAYLOAD_ALIGNMENT = 64;
+static const uint32_t MAX_LAYER_SIZE = 1 << 24;
+
+static_assert(sizeof(ModelFileHeader) == 48, "ModelFileHeader must stay 48 bytes");
+static_assert(sizeof(ModelFileLayer) == 8, "ModelFileLayer must stay 8 bytes");
+static_assert(sizeof(ModelFileLayerV2) == 40, "ModelFileLayerV2 must stay 40 bytes");
+
+// --- CRC-32 ---
+// Slicing-by-8: eight table lookups per 8 input bytes instead of one per byte
+struct Crc32Table {
+    uint32_t entries[8][256];
+
+    Crc32Table() {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            entries[0][i] = c;
+        }
+        for (uint32_t i = 0; i < 256; i++) {
+            for (int t = 1; t < 8; t++) entries[t][i] = (entries[t - 1][i] >> 8) ^ entries[0][entries[t - 1][i] & 0xFF];
+        }
+    }
+};
+
+uint32_t Crc32(const unsigned char* data, size_t length, uint32_t crc) {
+    static const Crc32Table table; // built once, thread-safe
+    const uint32_t (*t)[256] = table.entries;
+
+    crc = ~crc;
+    while (length >= 8) {
+        uint32_t lo = crc ^ ((uint32_t)data[0] | (uint32_t)data[1] << 8 | (uint32_t)data[2] << 16 | (uint32_t)data[3] << 24);
+        uint32_t hi = (uint32_t)data[4] | (uint32_t)data[5] << 8 | (uint32_t)data[6] << 16 | (uint32_t)data[7] << 24;
+        crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24]
+            ^ t[3][hi & 0xFF] ^ t[2][(hi >> 8) & 0xFF] ^ t[1][(hi >> 16) & 0xFF] ^ t[0][hi >> 24];
+        data += 8;
+        length -= 8;
+    }
+    while (length--) crc = t[0][(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+static size_t LayerEntrySize(uint32_t version) {
+    return (version == MODEL_FILE_DENSE_VERSION) ? sizeof(ModelFileLayer) : sizeof(ModelFileLayerV2);
+}
+
+static uint64_t PayloadOffset(uint32_t numLayers, uint32_t version) {
+    uint64_t end = sizeof(ModelFileHeader) + (uint64_t)numLayers * LayerEntrySize(version);
+    return (end + PAYLOAD_ALIGNMENT - 1) / PAYLOAD_ALIGNMENT * PAYLOAD_ALIGNMENT;
+}
+
+// --- LAYER TABLE ---
+static ModelFileLayerV2 LayerEntry(const Layer& layer) {
+    ModelFileLayerV2 entry = {};
+    entry.numNeurons = (uint32_t)layer.numNeurons;
+    entry.activation = (uint32_t)layer.actType;
+    entry.type = (uint32_t)layer.type;
+    if (layer.type != LayerType::DENSE) {
+        entry.channels = (uint32_t)layer.shape.channels;
+        entry.height = (uint32_t)layer.shape.height;
+        entry.width = (uint32_t)layer.shape.width;
+        entry.outChannels = (uint32_t)layer.shape.outChannels;
+        entry.kernel = (uint32_t)layer.shape.kernel;
+        entry.stride = (uint32_t)layer.shape.stride;
+        entry.padding = (uint32_t)layer.shape.padding;
+    }
+    return entry;
+}
+
+// Whether the entry describes a layer this build can rebuild, taking inputs values; adds its payload to bytes
+static bool ValidLayerEntry(const ModelFileLayerV2& entry, uint32_t inputs, uint64_t& bytes) {
+    if (entry.numNeurons == 0 || entry.numNeurons > MAX_LAYER_SIZE || entry.activation > (uint32_t)ActivationType::LINEAR) return false;
+    if (entry.type == (uint32_t)LayerType::DENSE) {
+        bytes += ((uint64_t)entry.numNeurons * inputs + entry.numNeurons) * sizeof(float);
+        return true;
+    }
+    if (entry.type > (uint32_t)LayerType::MAXPOOL) return false;
+
+    const uint32_t sizes[] = { entry.channels, entry.height, entry.width, entry.outChannels, entry.kernel, entry.stride };
+    for (uint32_t size : sizes) {
+        if (size == 0 || size > MAX_LAYER_SIZE) return false;
+    }
+    if ((uint64_t)entry.channels * entry.height * entry.width != inputs) return false;
+    if (entry.padding >= entry.kernel || entry.kernel > entry.height + 2 * entry.padding || entry.kernel > entry.width + 2 * entry.padding) return false;
+
+    uint64_t outHeight = (entry.height + 2 * entry.padding - entry.kernel) / entry.stride + 1;
+    uint64_t outWidth = (entry.width + 2 * entry.padding - entry.kernel) / entry.stride + 1;
+    if (entry.type == (uint32_t)LayerType::MAXPOOL) {
+        if (entry.stride != entry.kernel || entry.padding != 0 || entry.outChannels != entry.channels
+            || entry.activation != (uint32_t)ActivationType::LINEAR) return false;
+    }
+    else {
+        bytes += ((uint64_t)entry.outChannels * entry.channels * entry.kernel * entry.kernel + entry.outChannels) * sizeof(float);
+    }
+    return entry.outChannels * outHeight * outWidth == entry.numNeurons;
+}
+
+static Layer BuildLayer(const ModelFileLayerV2& entry, uint32_t inputs) {
+    ActivationType activation = (ActivationType)entry.activation;
+    if (entry.type == (uint32_t)LayerType::CONV2D) {
+        return Layer::Conv2D((int)entry.channels, (int)entry.height, (int)entry.width, (int)entry.outChannels, (int)entry.kernel,
+            activation, (int)entry.stride, (int)entry.padding, false);
+    }
+    if (entry.type == (uint32_t)LayerType::MAXPOOL) {
+        return Layer::MaxPool((int)entry.channels, (int)entry.height, (int)entry.width, (int)entry.kernel);
+    }
+    return Layer((int)entry.numNeurons, (int)inputs, activation, false);
+}
+
+// --- SAVE ---
+// Moves a finished file over another in one step; whoever has the old one open or mapped keeps it intact
+static bool ReplaceFile(const std::string& from, const std::string& to) {
+#ifdef _WIN32
+    return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    return std::rename(from.c_str(), to.c_str()) == 0;
+#endif
+}
+
+bool SaveModel(const Network& net, const std::string& filename) {
+    if (net.layers.empty()) {
+        std::cout << "error: nothing to save, the network has no layers" << std::endl;
+        return false;
+    }
+
+    // 1. Everything after the header goes into one buffer, so the checksum is a single pass
+    uint32_t version = net.isDense() ? MODEL_FILE_DENSE_VERSION : MODEL_FILE_VERSION;
+    uint32_t numLayers = (uint32_t)net.layers.size();
+    uint64_t payloadOffset = PayloadOffset(numLayers, version);
+    uint64_t payloadBytes = 0;
+    for (const Layer& layer : net.layers) payloadBytes += (layer.weightCount() + layer.biasCount()) * sizeof(float);
+
+    std::vector<unsigned char> body((size_t)(payloadOffset - sizeof(ModelFileHeader) + payloadBytes), 0);
+    unsigned char* p = body.data();
+    for (const Layer& layer : net.layers) {
+        // A version 1 entry is the first 8 bytes of a version 2 one
+        ModelFileLayerV2 entry = LayerEntry(layer);
+        memcpy(p, &entry, LayerEntrySize(version));
+        p += LayerEntrySize(version);
+    }
+    p = body.data() + (payloadOffset - sizeof(ModelFileHeader));
+    for (const Layer& layer : net.layers) {
+        memcpy(p, layer.weightData(), layer.weightCount() * sizeof(float));
+        p += layer.weightCount() * sizeof(float);
+        memcpy(p, layer.biasData(), layer.biasCount() * sizeof(float));
+        p += layer.biasCount() * sizeof(float);
+    }
+
+    // 2. Header
+    ModelFileHeader header;
+    memcpy(header.magic, MODEL_MAGIC, sizeof(header.magic));
+    header.version = version;
+    header.byteOrder = MODEL_BYTE_ORDER;
+    header.dtype = (uint32_t)ModelDType::FLOAT32;
+    header.numLayers = numLayers;
+    header.numInputs = (uint32_t)net.numInputs();
+    header.checksum = Crc32(body.data(), body.size());
+    header.payloadOffset = payloadOffset;
+    header.payloadBytes = payloadBytes;
+
+    // 3. Written beside the target, then renamed over it
+    const std::string temporary = filename + ".tmp";
+    std::ofstream file(temporary, std::ios::binary);
+    if (!file.is_open()) {
+        std::cout << "error: could not save to file " << filename << std::endl;
+        return false;
+    }
+    file.write((const char*)&header, sizeof(header));
+    file.write((const char*)body.data(), body.size());
+    file.close();
+    if (!file) {
+        std::cout << "error: could not write " << filename << std::endl;
+        std::remove(temporary.c_str());
+        return false;
+    }
+    if (!ReplaceFile(temporary, filename)) {
+        std::cout << "error: could not replace " << filename << std::endl;
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+// --- LOAD ---
+// Checks everything about a mapped model file and reads its layer table. Prints why and returns false if
+// the file can't be used as is.
+static bool ReadModelFile(const MappedFile& file, const std::string& filename, ModelFileHeader& header,
+    std::vector<ModelFileLayerV2>& entries) {
+
+    // 1. Header
+    if (file.size() < sizeof(header)) {
+        std::cout << "error: " << filename << " is too small to be a model file" << std::endl;
+        return false;
+    }
+    memcpy(&header, file.data(), sizeof(header));
+
+    if (memcmp(header.magic, MODEL_MAGIC, sizeof(MODEL_MAGIC)) != 0) {
+        std::cout << "error: " << filename << " is not a model file" << std::endl;
+        return false;
+    }
+    if (header.version != MODEL_FILE_DENSE_VERSION && header.version != MODEL_FILE_VERSION) {
+        std::cout << "error: " << filename << " is model format version " << header.version
+            << ", this build reads versions " << MODEL_FILE_DENSE_VERSION << " to " << MODEL_FILE_VERSION << std::endl;
+        return false;
+    }
+    if (header.byteOrder != MODEL_BYTE_ORDER) {
+        std::cout << "error: " << filename << " was written with a different byte order" << std::endl;
+        return false;
+    }
+    if (header.dtype != (uint32_t)ModelDType::FLOAT32) {
+        std::cout << "error: " << filename << " has unsupported weight type " << header.dtype << std::endl;
+        return false;
+    }
+    if (header.numLayers == 0 || header.numLayers > 1024 || header.numInputs == 0 || header.numInputs > MAX_LAYER_SIZE) {
+        std::cout << "error: " << filename << " has a bad shape (" << header.numLayers << " layers, "
+            << header.numInputs << " inputs)" << std::endl;
+        return false;
+    }
+    if (header.payloadOffset != PayloadOffset(header.numLayers, header.version) || header.payloadOffset > file.size()
+        || file.size() - header.payloadOffset != header.payloadBytes) {
+        std::cout << "error: " << filename << " is truncated or has trailing data" << std::endl;
+        return false;
+    }
+    if (Crc32(file.data() + sizeof(header), file.size() - sizeof(header)) != header.checksum) {
+        std::cout << "error: " << filename << " is corrupt (checksum mismatch)" << std::endl;
+        return false;
+    }
+
+    // 2. Layer table: sizes must chain and account for the whole payload
+    entries.assign(header.numLayers, ModelFileLayerV2());
+    const size_t entrySize = LayerEntrySize(header.version);
+    for (uint32_t i = 0; i < header.numLayers; i++) {
+        memcpy(&entries[i], file.data() + sizeof(header) + i * entrySize, entrySize);
+    }
+
+    uint64_t expectedBytes = 0;
+    uint32_t inputs = header.numInputs;
+    for (uint32_t i = 0; i < header.numLayers; i++) {
+        const ModelFileLayerV2& entry = entries[i];
+        if (!ValidLayerEntry(entry, inputs, expectedBytes)) {
+            std::cout << "error: " << filename << " layer " << i << " is invalid ("
+                << entry.numNeurons << " neurons, activation " << entry.activation << ", type " << entry.type << ")" << std::endl;
+            return false;
+        }
+        inputs = entry.numNeurons;
+    }
+    if (expectedBytes != header.payloadBytes) {
+        std::cout << "error: " << filename << " holds " << header.payloadBytes << " bytes of weights, its layers need "
+            << expectedBytes << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool LoadModel(const std::string& filename, Network& net) {
+    MappedFile file;
+    ModelFileHeader header;
+    std::vector<ModelFileLayerV2> entries;
+    if (!file.open(filename) || !ReadModelFile(file, filename, header, entries)) return false;
+
+    // Weights: one copy per array straight out of the mapping
+    std::vector<Layer> layers;
+    const unsigned char* p = file.data() + header.payloadOffset;
+    uint32_t inputs = header.numInputs;
+    for (const ModelFileLayerV2& entry : entries) {
+        layers.push_back(BuildLayer(entry, inputs));
+        Layer& layer = layers.back();
+        memcpy(layer.weights.data(), p, layer.weights.size() * sizeof(float));
+        p += layer.weights.size() * sizeof(float);
+        memcpy(layer.biases.data(), p, layer.biases.size() * sizeof(float));
+        p += layer.biases.size() * sizeof(float);
+        inputs = entry.numNeurons;
+    }
+
+    net.layers.swap(layers);
+    return true;
+}
+
+// --- READ-ONLY MODELS ---
+std::shared_ptr<const ReadOnlyModel> ReadOnlyModel::map(const std::string& filename) {
+    std::shared_ptr<ReadOnlyModel> model(new ReadOnlyModel());
+    ModelFileHeader header;
+    std::vector<ModelFileLayerV2> entries;
+    if (!model->file.open(filename) || !ReadModelFile(model->file, filename, header, entries)) return nullptr;
+
+    // Every array stays where it is in the mapping; the payload starts 64-byte aligned and every array is
+    // a whole number of floats, so each one is float-aligned in place
+    const float* p = (const float*)(model->file.data() + header.payloadOffset);
+    uint32_t inputs = header.numInputs;
+    for (const ModelFileLayerV2& entry : entries) {
+        Layer layer = BuildLayer(entry, inputs);
+        layer.viewParameters(p, p + layer.weightCount());
+        p += layer.weightCount() + layer.biasCount();
+        model->net.layers.push_back(std::move(layer));
+        inputs = entry.numNeurons;
+    }
+    model->name = filename;
+    return model;
+}
+
+std::shared_ptr<const ReadOnlyModel> ReadOnlyModel::own(Network net, const std::string& source) {
+    std::shared_ptr<ReadOnlyModel> model(new ReadOnlyModel());
+    model->net.layers.swap(net.layers);
+    model->name = source;
+    return model;
+}
+
+// --- HOT RELOAD ---
+void ModelSlot::publish(std::shared_ptr<const ReadOnlyModel> next) {
+    std::atomic_store(&model, next);
+    swaps++;
+}
+
+bool ModelSlot::reload(const std::string& filename) {
+    std::lock_guard<std::mutex> lock(reloadMutex);
+    std::shared_ptr<const ReadOnlyModel> next = ReadOnlyModel::map(filename);
+    if (!next) return false;
+
+    std::shared_ptr<const ReadOnlyModel> now = current();
+    if (now && (next->network().numInputs() != now->network().numInputs() || next->network().numOutputs() != now->network().numOutputs())) {
+        std::cout << "error: " << filename << " takes " << next->network().numInputs() << " inputs and gives "
+            << next->network().numOutputs() << " outputs, the model in use " << now->network().numInputs() << " and "
+            << now->network().numOutputs() << "; not reloaded" << std::endl;
+        return false;
+    }
+    publish(next);
+    return true;
+}
+
+// --- TEXT MODELS ---
+bool LoadTextModel(const std::string& textFilename, std::vector<int> layerNeurons, int outputs, int inputs, Network& net) {
+    Network loaded(layerNeurons, outputs, inputs);
+    size_t expected = 0;
+    for (const Layer& layer : loaded.layers) expected += layer.weights.size() + layer.biases.size();
+
+    // loadNetwork trusts the shape blindly, so count the values first
+    std::ifstream text(textFilename);
+    if (!text.is_open()) {
+        std::cout << "error: cannot open " << textFilename << std::endl;
+        return false;
+    }
+    size_t count = 0;
+    float value;
+    while (text >> value) count++;
+    if (!text.eof()) {
+        std::cout << "error: " << textFilename << " has something that is not a number after value " << count << std::endl;
+        return false;
+    }
+    if (count != expected) {
+        std::cout << "error: " << textFilename << " holds " << count << " values, that shape needs " << expected << std::endl;
+        return false;
+    }
+
+    if (!loaded.loadNetwork(textFilename)) return false;
+    net.layers.swap(loaded.layers);
+    return true;
+}
+
+bool ConvertTextModel(const std::string& textFilename, std::vector<int> layerNeurons, int outputs, int inputs,
+    const std::string& modelFilename) {
+
+    Network net;
+    return LoadTextModel(textFilename, layerNeurons, outputs, inputs, net) && SaveModel(net, modelFilename);
+}
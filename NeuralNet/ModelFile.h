@@ -0,0 +1,145 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include "NeuNetCode.h"
+#include "MappedFile.h"
+
+// --- BINARY MODEL FILE (.nnm) ---
+// Everything needed to rebuild a Network, so a model file no longer depends on the code
+// knowing its shape in advance (the text format in brain.txt does).
+//
+//   ModelFileHeader                   48 bytes
+//   ModelFileLayer x numLayers         8 bytes each (version 2: ModelFileLayerV2, 40 bytes each)
+//   zero padding up to payloadOffset  (a multiple of 64, so the payload can be used in place)
+//   payload, layer by layer:          weights (numNeurons x numInputs, row-major), then biases
+//                                     (CONV2D: outChannels filters, then outChannels biases; MAXPOOL: nothing)
+//
+// All fields are little-endian; checksum is the CRC-32 of every byte after the header.
+// Version 2 adds the layer type and convolution shape. Networks of dense layers only are still written
+// as version 1, so older builds keep reading them; both versions load.
+
+const uint32_t MODEL_FILE_VERSION = 2;
+const uint32_t MODEL_FILE_DENSE_VERSION = 1;
+const uint32_t MODEL_BYTE_ORDER = 0x01020304;
+
+enum class ModelDType : uint32_t {
+	FLOAT32 = 1
+};
+
+struct ModelFileHeader {
+	char magic[8];          // "NNMODEL\0"
+	uint32_t version;       // MODEL_FILE_VERSION
+	uint32_t byteOrder;     // MODEL_BYTE_ORDER as the writer saw it
+	uint32_t dtype;         // ModelDType of the payload
+	uint32_t numLayers;
+	uint32_t numInputs;     // inputs of the first layer; each later layer takes the previous one's outputs
+	uint32_t checksum;
+	uint64_t payloadOffset;
+	uint64_t payloadBytes;
+};
+
+struct ModelFileLayer {
+	uint32_t numNeurons;
+	uint32_t activation;    // ActivationType
+};
+
+struct ModelFileLayerV2 {
+	uint32_t numNeurons;
+	uint32_t activation;    // ActivationType
+	uint32_t type;          // LayerType; the fields below are 0 for DENSE
+	uint32_t channels;      // input channels x height x width must equal the previous layer's outputs
+	uint32_t height;
+	uint32_t width;
+	uint32_t outChannels;
+	uint32_t kernel;
+	uint32_t stride;
+	uint32_t padding;
+};
+
+// Prints why and returns false if the file can't be written. The model is written next to filename and then
+// renamed over it, so a process that has the old file mapped (ReadOnlyModel) keeps its old weights instead of
+// seeing them change underneath it.
+bool SaveModel(const Network& net, const std::string& filename);
+
+// Rebuilds net (shape, activations, weights) from the file alone.
+// The file is mapped, checked (magic, version, byte order, dtype, sizes, checksum) and only then copied in;
+// on any failure net is left untouched and the reason is printed.
+bool LoadModel(const std::string& filename, Network& net);
+
+// Loads an old text model (saveNetwork format) into a new Network of the given shape,
+// refusing files whose value count doesn't match it (Network::loadNetwork can't tell)
+bool LoadTextModel(const std::string& textFilename, std::vector<int> layerNeurons, int outputs, int inputs, Network& net);
+
+// Converts an old text model (saveNetwork format) to a binary one. The text file doesn't record its shape,
+// so the topology is given the same way the Network constructor takes it; the value count must match exactly.
+bool ConvertTextModel(const std::string& textFilename, std::vector<int> layerNeurons, int outputs, int inputs,
+	const std::string& modelFilename);
+
+// CRC-32 (IEEE 802.3, as in zip/png)
+uint32_t Crc32(const unsigned char* data, size_t length, uint32_t crc = 0);
+
+// --- READ-ONLY MODELS ---
+// A model that is only run, never trained, shared by every thread that scores with it.
+//
+// map() uses a model file in place: the file is mapped read-only and checked as LoadModel checks it, and the
+// layers view their weights in the mapping (Layer::viewParameters) instead of copying them out. Every process
+// mapping the same file shares one copy of it in the page cache, rather than each holding a private one.
+// The mapping lives as long as the ReadOnlyModel. Files must be replaced whole (as SaveModel does), never
+// rewritten in place while something has them mapped.
+class ReadOnlyModel {
+
+public:
+	// Prints why and returns nullptr on failure
+	static std::shared_ptr<const ReadOnlyModel> map(const std::string& filename);
+	// An ordinary Network (a text model, or one built in memory) behind the same interface
+	static std::shared_ptr<const ReadOnlyModel> own(Network net, const std::string& source = "");
+
+	ReadOnlyModel(const ReadOnlyModel&) = delete;
+	ReadOnlyModel& operator=(const ReadOnlyModel&) = delete;
+
+	const Network& network() const { return net; }
+	const std::string& source() const { return name; }
+	bool isMapped() const { return file.isOpen(); }
+
+private:
+	ReadOnlyModel() {}
+
+	MappedFile file;
+	Network net;
+	std::string name;
+};
+
+// --- HOT RELOAD ---
+// The model in use right now, replaceable while other threads run it, RCU-style: a reader takes current()
+// (a shared_ptr copy) once per pass or batch and runs that snapshot to the end however many swaps happen
+// meanwhile, so it never waits for a load. reload() maps and checks the whole new file before the pointer
+// flips, so no reader sees half a model; the old one is unmapped when its last reader lets go of it.
+class ModelSlot {
+
+public:
+	ModelSlot() : swaps(0) {}
+	explicit ModelSlot(std::shared_ptr<const ReadOnlyModel> model) : model(model), swaps(model ? 1 : 0) {}
+
+	ModelSlot(const ModelSlot&) = delete;
+	ModelSlot& operator=(const ModelSlot&) = delete;
+
+	std::shared_ptr<const ReadOnlyModel> current() const { return std::atomic_load(&model); }
+	void publish(std::shared_ptr<const ReadOnlyModel> next);
+
+	// Maps filename and publishes it, provided it takes and gives as many values as the current model
+	// (callers size inputs and outputs by those; the layers in between may change).
+	// Prints why and keeps the current model otherwise.
+	bool reload(const std::string& filename);
+
+	// Models this slot has held: 1 for the one it was built with, plus one per publish / reload
+	long long generation() const { return swaps; }
+
+private:
+	std::shared_ptr<const ReadOnlyModel> model; // only through std::atomic_load / std::atomic_store
+	std::atomic<long long> swaps;
+	std::mutex reloadMutex;                     // one reload at a time; readers never take it
+};
@@ -1,103 +1,458 @@
 #include "NeuNetCode.h"
+#include "Conv.h"
+#include "Gemm.h"
+#include "Simd.h"
+#include "Profiler.h"
 #include <vector>
 #include <cstdlib>
+#include <cmath>
 #include <numeric>
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 
-Node::Node(int numInputs, ActivationType type) {
+// --- HELPER: PIXELS ---
+// 0..255 -> 0.0..255.0 (the 1/255 is applied later, inside the first layer's GEMM)
+static void WidenPixels(const unsigned char* pixels, size_t count, float* out) {
+    for (size_t i = 0; i < count; i++) out[i] = (float)pixels[i];
+}
+
+// --- HELPER: PROFILER COUNTS ---
+// Work of one layer pass over batchSize samples, for NN_PROFILE_SCOPE: a multiply-add per weight use
+// (once per output position for CONV2D), the parameters read once, the inputs and outputs once per sample
+static inline double LayerFlops(const Layer& layer, int batchSize) {
+    return 2.0 * layer.flopsPerSample() * batchSize;
+}
+
+static inline double LayerBytes(const Layer& layer, int batchSize) {
+    return 4.0 * (layer.weightCount() + layer.biasCount() + (double)batchSize * (layer.numInputs + layer.numNeurons));
+}
 
-    for (int i = 0; i < numInputs; i++) {
-        float randomWeight = ((float)rand() / RAND_MAX) * 0.2f - 0.1f;
-        weights.push_back(randomWeight);
+// --- INCREMENTAL INFERENCE ---
+// Above numInputs / INCREMENTAL_MAX_SHARE changed inputs, one full GEMV beats that many column updates
+static const int INCREMENTAL_MAX_SHARE = 8;
+// Every column update rounds a little; a full pass this often keeps the cached sums from drifting
+static const int INCREMENTAL_REFRESH = 1024;
+
+// --- HELPERS: ACTIVATIONS ---
+// Shared by Node (one neuron) and Layer (whole row of neurons at once)
+static float Activate(float sum, ActivationType type) {
+    if (type == ActivationType::TANH) {
+        return tanh(sum);
+    }
+    else if (type == ActivationType::RELU) {
+        return (sum > 0) ? sum : 0.0f;
     }
+    else if (type == ActivationType::SIGMOID) {
+        return 1.0f / (1.0f + exp(-sum));
+    }
+    // SOFTMAX: Pass the raw sum back to the Layer.
+    // The Layer will handle the exp() and division.
+    return sum;
+}
 
-    //bias = ((float)rand() / RAND_MAX) * 2.0f - 1.0f;
-    bias = 0.1f;
+static float ActivationDerivative(float output, ActivationType type) {
+    if (type == ActivationType::TANH) {
+        return 1.0f - (output * output);
+    }
+    else if (type == ActivationType::RELU) {
+        return (output > 0) ? 1.0f : 0.0f;
+    }
+    else if (type == ActivationType::SIGMOID) {
+        return output * (1.0f - output);
+    }
+    else if (type == ActivationType::LINEAR) {
+        return 1.0f;
+    }
+    return 0.0f;
+}
 
-    output_cache = 0.0f;
-    delta = 0.0f;
-    this->actType = type;
+// Turns one row of raw sums into activations (softmax needs the whole row)
+static void ActivateRow(float* sums, int count, ActivationType type) {
+    const SimdKernels& simd = Simd();
+
+    if (type == ActivationType::TANH) simd.tanh(sums, count);
+    else if (type == ActivationType::RELU) simd.relu(sums, count);
+    else if (type == ActivationType::SIGMOID) simd.sigmoid(sums, count);
+    else if (type == ActivationType::SOFTMAX) simd.softmax(sums, count);
+}
+
+// Error terms of the last layer for one sample
+static void OutputDeltas(const float* outputs, const float* targets, float* deltas, int count, ActivationType type) {
+    for (int i = 0; i < count; i++) {
+        float error = targets[i] - outputs[i];
+
+        // Softmax + cross-entropy: the derivative cancels out
+        deltas[i] = (type == ActivationType::SOFTMAX) ? error : error * ActivationDerivative(outputs[i], type);
+    }
+}
+
+// Hidden layer error terms: deltas[i] = propagated error * f'(output)
+static void ApplyDerivative(const float* outputs, float* deltas, int count, ActivationType type) {
+    if (type == ActivationType::LINEAR) return;
+    for (int i = 0; i < count; i++) {
+        deltas[i] *= ActivationDerivative(outputs[i], type);
+    }
 }
 
-float Node::feedForward(std::vector<float> inputs) {
-    float sum = 0.0f;
-    if (inputs.size() != weights.size()) {
+// A view's parameters are read through the same pointers; readOnly keeps updateWeights out of them
+Node::Node(Layer& layer, int index)
+    : weights(const_cast<float*>(layer.weightData()) + (size_t)index * layer.numInputs),
+      numInputs(layer.numInputs),
+      bias(const_cast<float&>(layer.biasData()[index])),
+      output_cache(0.0f),
+      delta(0.0f),
+      actType(layer.actType),
+      readOnly(layer.isView()) {
+}
+
+float Node::feedForward(const float* inputs) {
+    float sum = Simd().dot(inputs, weights, numInputs);
+
+    sum += bias;
+
+    this->output_cache = Activate(sum, this->actType);
+    return this->output_cache;
+}
+
+float Node::feedForward(const std::vector<float>& inputs) {
+    if (inputs.size() != numInputs) {
         std::cout << "error in inputs/weights size" << std::endl;
         return 0.0f;
     }
-    for (int i = 0; i < weights.size(); i++) {
-        sum += inputs[i] * weights[i];
+    return feedForward(inputs.data());
+}
+
+float Node::getActivationDerivative() {
+    return ActivationDerivative(output_cache, actType);
+}
+
+void Node::updateWeights(const float* inputs, float learningRate) {
+    if (readOnly) {
+        std::cout << "error: this neuron is in a read-only view of a model file" << std::endl;
+        return;
     }
+    Simd().axpy(learningRate * delta, inputs, weights, numInputs); // multiply learning rate by gradient
+    bias += learningRate * delta;
+}
 
-    sum += bias;
+void Node::updateWeights(const std::vector<float>& inputs, float learningRate) {
+    updateWeights(inputs.data(), learningRate);
+}
+
+void SparseInputs::compact(const float* inputs) {
+    count = Simd().compactNonzero(inputs, size, size, indices.data(), values.data());
+}
+
+void SparseInputs::compactIfSparse(const float* inputs) {
+    const SimdKernels& simd = Simd();
+    count = simd.compactNonzero(inputs, size, (int)(size * simd.sparseMaxDensity), indices.data(), values.data());
+}
 
-    if (this->actType == ActivationType::TANH) {
-        this->output_cache = tanh(sum);
+void SparseInputs::compact(const unsigned char* pixels, float scale) {
+    int found = 0;
+    for (int i = 0; i < size; i++) {
+        indices[found] = i;
+        values[found] = pixels[i] * scale;
+        found += pixels[i] != 0;
     }
-    else if (this->actType == ActivationType::RELU) {
-        this->output_cache = (sum > 0) ? sum : 0.0f;
+    count = found;
+}
+
+Layer::Layer(int numNeurons, int numInputs, ActivationType type, bool randomize)
+    : type(LayerType::DENSE), numNeurons(numNeurons), numInputs(numInputs), actType(type),
+      weights((size_t)numNeurons * numInputs, 0.0f),
+      biases(numNeurons, randomize ? 0.1f : 0.0f),
+      viewedWeights(nullptr), viewedBiases(nullptr) {
+
+    if (!randomize) return;
+
+    // Same order as the old per-Node constructor, so a given seed gives the same network
+    for (size_t i = 0; i < weights.size(); i++) {
+        weights[i] = ((float)rand() / RAND_MAX) * 0.2f - 0.1f;
     }
-    else if (this->actType == ActivationType::SIGMOID) {
-        this->output_cache = 1.0f / (1.0f + exp(-sum));
+    //bias = ((float)rand() / RAND_MAX) * 2.0f - 1.0f;
+}
+
+Layer::Layer(LayerType type, const ConvShape& shape, ActivationType actType)
+    : type(type), shape(shape),
+      numNeurons(shape.outChannels * shape.outHeight * shape.outWidth),
+      numInputs(shape.channels * shape.height * shape.width),
+      actType(actType), viewedWeights(nullptr), viewedBiases(nullptr) {
+
+    if (type == LayerType::CONV2D) {
+        weights.assign((size_t)shape.outChannels * shape.channels * shape.kernel * shape.kernel, 0.0f);
+        biases.assign(shape.outChannels, 0.0f);
     }
-    else if (this->actType == ActivationType::SOFTMAX) {
-        // Pass the raw sum back to the Layer. 
-        // The Layer will handle the exp() and division.
-        this->output_cache = sum;
+}
+
+Layer Layer::Conv2D(int channels, int height, int width, int outChannels, int kernel, ActivationType type,
+    int stride, int padding, bool randomize) {
+
+    ConvShape shape;
+    shape.channels = channels;
+    shape.height = height;
+    shape.width = width;
+    shape.kernel = kernel;
+    shape.stride = stride;
+    shape.padding = padding;
+    shape.outChannels = outChannels;
+    shape.outHeight = (height + 2 * padding - kernel) / stride + 1;
+    shape.outWidth = (width + 2 * padding - kernel) / stride + 1;
+    Layer layer(LayerType::CONV2D, shape, type);
+
+    if (randomize) {
+        // He uniform: a filter sees channels x kernel^2 inputs, far fewer than a dense neuron, so the
+        // dense layers' fixed +-0.1 would start it with almost no signal
+        float limit = sqrtf(6.0f / (channels * kernel * kernel));
+        for (float& w : layer.weights) w = ((float)rand() / RAND_MAX) * 2.0f * limit - limit;
     }
+    return layer;
+}
 
-    return this->output_cache;
+Layer Layer::MaxPool(int channels, int height, int width, int size) {
+    ConvShape shape;
+    shape.channels = channels;
+    shape.height = height;
+    shape.width = width;
+    shape.kernel = size;
+    shape.stride = size;
+    shape.outChannels = channels;
+    shape.outHeight = height / size;
+    shape.outWidth = width / size;
+    return Layer(LayerType::MAXPOOL, shape, ActivationType::LINEAR);
 }
 
-float Node::getActivationDerivative() {
-    if (this->actType == ActivationType::TANH) {
-        return 1.0f - (output_cache * output_cache);
+Node Layer::neuron(int index) {
+    return Node(*this, index);
+}
+
+double Layer::flopsPerSample() const {
+    if (type == LayerType::MAXPOOL) return (double)numInputs;
+    if (type == LayerType::CONV2D) return (double)weightCount() * shape.outHeight * shape.outWidth;
+    return (double)weightCount();
+}
+
+size_t Layer::weightCount() const {
+    if (type == LayerType::MAXPOOL) return 0;
+    if (type == LayerType::CONV2D) return (size_t)shape.outChannels * shape.channels * shape.kernel * shape.kernel;
+    return (size_t)numNeurons * numInputs;
+}
+
+size_t Layer::biasCount() const {
+    if (type == LayerType::MAXPOOL) return 0;
+    return type == LayerType::CONV2D ? (size_t)shape.outChannels : (size_t)numNeurons;
+}
+
+Layer::Layer(const Layer& other)
+    : type(other.type), shape(other.shape), numNeurons(other.numNeurons), numInputs(other.numInputs),
+      actType(other.actType), viewedWeights(nullptr), viewedBiases(nullptr) {
+
+    if (other.isView()) {
+        weights.assign(other.weightData(), other.weightData() + other.weightCount());
+        biases.assign(other.biasData(), other.biasData() + other.biasCount());
     }
-    else if (this->actType == ActivationType::RELU) {
-        return (output_cache > 0) ? 1.0f : 0.0f;
+    else {
+        weights = other.weights;
+        biases = other.biases;
     }
-    else if (this->actType == ActivationType::SIGMOID) {
-        return output_cache * (1.0f - output_cache);
+}
+
+Layer& Layer::operator=(const Layer& other) {
+    if (this != &other) *this = Layer(other);
+    return *this;
+}
+
+void Layer::viewParameters(const float* weights, const float* biases) {
+    viewedWeights = weights;
+    viewedBiases = biases;
+    std::vector<float>().swap(this->weights);
+    std::vector<float>().swap(this->biases);
+}
+
+// The single-sample passes are just batches of one; Sgemm picks a matrix-vector path for them
+void Layer::feedForward(const float* inputs, float* outputs) const {
+    feedForwardBatch(inputs, 1, outputs);
+}
+
+std::vector<float> Layer::feedForward(const std::vector<float>& inputs) const {
+    std::vector<float> outputs(numNeurons, 0.0f);
+    if (inputs.size() != numInputs) {
+        std::cout << "error in inputs/weights size" << std::endl;
+        return outputs;
     }
-    return 0.0f;
+    feedForward(inputs.data(), outputs.data());
+    return outputs;
+}
+
+void Layer::propagateError(const float* inputs, const float* deltas, float* errors) const {
+    propagateErrorBatch(inputs, deltas, 1, errors);
+}
+
+void Layer::updateWeights(const float* inputs, const float* deltas, float learningRate) {
+    updateWeightsBatch(inputs, deltas, 1, learningRate);
 }
 
-void Node::updateWeights(std::vector<float> inputs, float learningRate) {
-    for (int i = 0; i < weights.size(); i++) {
-        weights[i] += learningRate * (delta * inputs[i]); // multiply learning rate by gradient
+void Layer::feedForwardBatch(const float* inputs, int batchSize, float* outputs, float inputScale) const {
+    if (type == LayerType::MAXPOOL) {
+        MaxPoolForward(*this, inputs, batchSize, outputs, inputScale);
+        return;
     }
-    bias += learningRate * delta;
+    if (type == LayerType::CONV2D) {
+        ConvForward(*this, inputs, batchSize, outputs, inputScale, ConvPrefersDirect(shape));
+        for (int n = 0; n < batchSize; n++) ActivateRow(&outputs[(size_t)n * numNeurons], numNeurons, actType);
+        return;
+    }
+
+    // outputs = inputs * weights^T, then bias + activation on every row
+    Sgemm(false, true, batchSize, numNeurons, numInputs,
+        inputScale, inputs, numInputs, weightData(), numInputs,
+        0.0f, outputs, numNeurons);
+
+    const float* bias = biasData();
+    for (int n = 0; n < batchSize; n++) {
+        float* row = &outputs[(size_t)n * numNeurons];
+        for (int j = 0; j < numNeurons; j++) row[j] += bias[j];
+        ActivateRow(row, numNeurons, actType);
+    }
+}
+
+void Layer::feedForwardSparse(const SparseInputs& inputs, float* outputs) const {
+    const SimdKernels& simd = Simd();
+    const float* w = weightData();
+    const float* bias = biasData();
+    for (int j = 0; j < numNeurons; j++) {
+        outputs[j] = bias[j] + simd.dotSparse(&w[(size_t)j * numInputs], inputs.indices.data(), inputs.values.data(), inputs.count);
+    }
+    ActivateRow(outputs, numNeurons, actType);
 }
 
-Layer::Layer(int numNeurons, int numInputs, ActivationType type) {
-    for (int i = 0; i < numNeurons; i++) {
-        neurons.push_back(Node(numInputs, type));
+void Layer::updateWeightsSparse(const SparseInputs& inputs, const float* deltas, float learningRate) {
+    if (isView()) {
+        std::cout << "error: this layer is a read-only view of a model file, train a copy of it" << std::endl;
+        return;
+    }
+    const int* indices = inputs.indices.data();
+    const float* values = inputs.values.data();
+    for (int j = 0; j < numNeurons; j++) {
+        float step = learningRate * deltas[j];
+        if (step == 0.0f) continue; // e.g. a ReLU that was off for this sample
+
+        // The gradient is zero in every column whose input was zero
+        // (loads grouped ahead of the stores, the indices are distinct so nothing can overlap)
+        float* row = &weights[(size_t)j * numInputs];
+        int k = 0;
+        for (; k + 4 <= inputs.count; k += 4) {
+            float w0 = row[indices[k]], w1 = row[indices[k + 1]], w2 = row[indices[k + 2]], w3 = row[indices[k + 3]];
+            row[indices[k]] = w0 + step * values[k];
+            row[indices[k + 1]] = w1 + step * values[k + 1];
+            row[indices[k + 2]] = w2 + step * values[k + 2];
+            row[indices[k + 3]] = w3 + step * values[k + 3];
+        }
+        for (; k < inputs.count; k++) row[indices[k]] += step * values[k];
+        biases[j] += step;
     }
 }
 
-std::vector<float >Layer::feedForward(std::vector<float> inputs) {
-    std::vector<float> outputs;
+bool Layer::preferSparse(const SparseInputs& inputs) {
+    return inputs.density() < Simd().sparseMaxDensity;
+}
 
-    for (int i = 0; i < neurons.size(); i++) {
-        outputs.push_back(neurons[i].feedForward(inputs));
+void Layer::propagateErrorBatch(const float* inputs, const float* deltas, int batchSize, float* errors) const {
+    if (type == LayerType::MAXPOOL) {
+        MaxPoolPropagate(*this, inputs, deltas, batchSize, errors);
+        return;
+    }
+    if (type == LayerType::CONV2D) {
+        ConvPropagate(*this, deltas, batchSize, errors, ConvPrefersDirect(shape));
+        return;
     }
 
-    if (neurons.size() > 0 && neurons[0].actType == ActivationType::SOFTMAX) {
-        float sumExp = 0.0f;
+    // errors = deltas * weights
+    Sgemm(false, false, batchSize, numInputs, numNeurons,
+        1.0f, deltas, numNeurons, weightData(), numInputs,
+        0.0f, errors, numInputs);
+}
 
-        for (int i = 0; i < outputs.size(); i++) {
-            outputs[i] = exp(outputs[i]); // e^x
-            sumExp += outputs[i];
-        }
+void Layer::updateWeightsBatch(const float* inputs, const float* deltas, int batchSize, float learningRate, float inputScale) {
+    if (isView()) {
+        std::cout << "error: this layer is a read-only view of a model file, train a copy of it" << std::endl;
+        return;
+    }
+    float step = learningRate / batchSize; // average the gradient over the batch
+    if (type == LayerType::MAXPOOL) return;
+    if (type == LayerType::CONV2D) {
+        ConvGradients(*this, inputs, deltas, batchSize, inputScale, step, weights.data(), biases.data(), ConvPrefersDirect(shape));
+        return;
+    }
 
-        for (int i = 0; i < outputs.size(); i++) {
-            outputs[i] /= sumExp;
-            neurons[i].output_cache = outputs[i];
-        }
+    // weights += step * deltas^T * (inputScale * inputs)
+    Sgemm(true, false, numNeurons, numInputs, batchSize,
+        step * inputScale, deltas, numNeurons, inputs, numInputs,
+        1.0f, weights.data(), numInputs);
+
+    for (int n = 0; n < batchSize; n++) {
+        const float* d = &deltas[(size_t)n * numNeurons];
+        for (int j = 0; j < numNeurons; j++) biases[j] += step * d[j];
     }
+}
 
-    return outputs;
+void Layer::computeGradients(const float* inputs, const float* deltas, int batchSize, float* weightGrads, float* biasGrads, float inputScale) const {
+    if (type != LayerType::DENSE) {
+        std::fill(weightGrads, weightGrads + weightCount(), 0.0f);
+        std::fill(biasGrads, biasGrads + biasCount(), 0.0f);
+        if (type == LayerType::CONV2D) ConvGradients(*this, inputs, deltas, batchSize, inputScale, 1.0f, weightGrads, biasGrads, ConvPrefersDirect(shape));
+        return;
+    }
+
+    // weightGrads = deltas^T * (inputScale * inputs)
+    Sgemm(true, false, numNeurons, numInputs, batchSize,
+        inputScale, deltas, numNeurons, inputs, numInputs,
+        0.0f, weightGrads, numInputs);
+
+    for (int j = 0; j < numNeurons; j++) biasGrads[j] = 0.0f;
+    for (int n = 0; n < batchSize; n++) {
+        const float* d = &deltas[(size_t)n * numNeurons];
+        for (int j = 0; j < numNeurons; j++) biasGrads[j] += d[j];
+    }
+}
+
+Workspace::Workspace(const Network& net) {
+    for (const Layer& layer : net.layers) {
+        activations.push_back(std::vector<float>(layer.numNeurons, 0.0f));
+        deltas.push_back(std::vector<float>(layer.numNeurons, 0.0f));
+    }
+    pixels.assign(net.numInputs(), 0.0f);
+    sparse = SparseInputs(net.numInputs());
+}
+
+BatchWorkspace::BatchWorkspace(const Network& net, int maxBatch) : maxBatch(maxBatch) {
+    for (const Layer& layer : net.layers) {
+        activations.push_back(std::vector<float>((size_t)maxBatch * layer.numNeurons, 0.0f));
+        deltas.push_back(std::vector<float>((size_t)maxBatch * layer.numNeurons, 0.0f));
+    }
+    pixels.assign((size_t)maxBatch * net.numInputs(), 0.0f);
+}
+
+Gradients::Gradients(const Network& net) {
+    for (const Layer& layer : net.layers) {
+        weights.push_back(std::vector<float>(layer.weightCount(), 0.0f));
+        biases.push_back(std::vector<float>(layer.biasCount(), 0.0f));
+    }
+}
+
+IncrementalWorkspace::IncrementalWorkspace(const Network& net) : ws(net), valid(false), updatesSinceFull(0), fullPasses(0), partialPasses(0) {
+    if (net.layers.empty()) return;
+    const Layer& first = net.layers.front();
+    inputs.assign(first.numInputs, 0.0f);
+    changed.assign(first.numInputs, 0);
+    if (first.type != LayerType::DENSE) return;
+    sums.assign(first.numNeurons, 0.0f);
+    columns.resize((size_t)first.numInputs * first.numNeurons);
+    const float* weights = first.weightData();
+    for (int j = 0; j < first.numNeurons; j++) {
+        for (int i = 0; i < first.numInputs; i++) columns[(size_t)i * first.numNeurons + j] = weights[(size_t)j * first.numInputs + i];
+    }
 }
 
 Network::Network(std::vector<int> layerNeurons, int outputs, int inputs) {
@@ -105,71 +460,341 @@ Network::Network(std::vector<int> layerNeurons, int outputs, int inputs) {
     layers.push_back(Layer(layerNeurons[0], inputs, ActivationType::RELU));
 
     for (int i = 1; i < layerNeurons.size(); i++) {
-        layers.push_back(Layer(layerNeurons[i], layers.back().neurons.size(), ActivationType::RELU));
+        layers.push_back(Layer(layerNeurons[i], layers.back().numNeurons, ActivationType::RELU));
     }
 
-    layers.push_back(Layer(outputs, layers.back().neurons.size(), ActivationType::SOFTMAX));
+    layers.push_back(Layer(outputs, layers.back().numNeurons, ActivationType::SOFTMAX));
 
+    scratch = Workspace(*this);
 }
 
-std::vector<float> Network::feedForward(std::vector<float> inputs) {
-    std::vector<float> currentInputs = inputs;
-    for (int i = 0; i < layers.size(); i++) {
-        currentInputs = layers[i].feedForward(currentInputs);
+Network::Network(std::vector<Layer> features, std::vector<int> layerNeurons, int outputs) : layers(features) {
+    if (layers.empty() || outputs <= 0) return;
+    for (int neurons : layerNeurons) {
+        layers.push_back(Layer(neurons, layers.back().numNeurons, ActivationType::RELU));
     }
-    return currentInputs;
+    layers.push_back(Layer(outputs, layers.back().numNeurons, ActivationType::SOFTMAX));
+
+    scratch = Workspace(*this);
 }
 
-void Network::backPropagate(std::vector<float> inputs, std::vector<float> targets, float learningRate) {
-    std::vector<std::vector<float>> layerInputs;
-    std::vector<float> currentInputs = inputs;
-    layerInputs.push_back(currentInputs);
+int Network::numInputs() const {
+    return layers.empty() ? 0 : layers.front().numInputs;
+}
 
-    for (int i = 0; i < layers.size(); i++) {
-        currentInputs = layers[i].feedForward(currentInputs);
-        layerInputs.push_back(currentInputs);
+int Network::numOutputs() const {
+    return layers.empty() ? 0 : layers.back().numNeurons;
+}
+
+bool Network::isDense() const {
+    for (const Layer& layer : layers) {
+        if (layer.type != LayerType::DENSE) return false;
     }
+    return true;
+}
 
-    Layer& outputLayer = layers.back();
+bool Network::isReadOnly() const {
+    for (const Layer& layer : layers) {
+        if (layer.isView()) return true;
+    }
+    return false;
+}
 
-    for (int i = 0; i < outputLayer.neurons.size(); i++) {
-        float output = outputLayer.neurons[i].output_cache;
-        float target = targets[i];
+const std::vector<float>& Network::feedForward(const float* inputs, Workspace& ws) const {
+    // First layer: mostly-zero inputs go through their nonzero entries only
+    bool sparse = false;
+    if (layers[0].type == LayerType::DENSE) {
+        ws.sparse.compactIfSparse(inputs);
+        sparse = Layer::preferSparse(ws.sparse);
+    }
+    if (sparse) {
+        NN_PROFILE_SCOPE(FORWARD, 0, 2.0 * layers[0].numNeurons * ws.sparse.count, 8.0 * layers[0].numNeurons * ws.sparse.count);
+        layers[0].feedForwardSparse(ws.sparse, ws.activations[0].data());
+    }
+    else {
+        NN_PROFILE_SCOPE(FORWARD, 0, LayerFlops(layers[0], 1), LayerBytes(layers[0], 1));
+        layers[0].feedForward(inputs, ws.activations[0].data());
+    }
 
-        if (outputLayer.neurons[i].actType == ActivationType::SOFTMAX) {
-            outputLayer.neurons[i].delta = target - output;
-        } else {
-            float error = target - output;
+    for (int i = 1; i < layers.size(); i++) {
+        NN_PROFILE_SCOPE(FORWARD, i, LayerFlops(layers[i], 1), LayerBytes(layers[i], 1));
+        layers[i].feedForward(ws.activations[i - 1].data(), ws.activations[i].data());
+    }
+    return ws.activations.back();
+}
 
-            outputLayer.neurons[i].delta = error * outputLayer.neurons[i].getActivationDerivative();
-        }
+void Network::backPropagate(const float* inputs, const float* targets, float learningRate, Workspace& ws) {
+    if (isReadOnly()) {
+        std::cout << "error: this network views a model file read-only, train a copy of it" << std::endl;
+        return;
+    }
+    feedForward(inputs, ws);
+
+    Layer& outputLayer = layers.back();
+    {
+        NN_PROFILE_SCOPE(OUTPUT_DELTAS, (int)layers.size() - 1, 3.0 * outputLayer.numNeurons, 12.0 * outputLayer.numNeurons);
+        OutputDeltas(ws.activations.back().data(), targets, ws.deltas.back().data(), outputLayer.numNeurons, outputLayer.actType);
     }
 
+    // Layer i + 1 pushes its error terms down into layer i
     for (int i = layers.size() - 2; i >= 0; i--) {
-        Layer& curLayer = layers[i];
-        Layer& nextLayer = layers[i + 1];
+        NN_PROFILE_SCOPE(PROPAGATE, i + 1, LayerFlops(layers[i + 1], 1), LayerBytes(layers[i + 1], 1));
+        layers[i + 1].propagateError(ws.activations[i].data(), ws.deltas[i + 1].data(), ws.deltas[i].data());
+        ApplyDerivative(ws.activations[i].data(), ws.deltas[i].data(), layers[i].numNeurons, layers[i].actType);
+    }
 
-        for (int j = 0; j < curLayer.neurons.size(); j++) {
-            float errorSum = 0.0f;
+    // feedForward left the compacted inputs in ws.sparse; the weights are read and written back
+    if (layers[0].type == LayerType::DENSE && Layer::preferSparse(ws.sparse)) {
+        NN_PROFILE_SCOPE(UPDATE, 0, 2.0 * layers[0].numNeurons * ws.sparse.count, 8.0 * layers[0].numNeurons * ws.sparse.count);
+        layers[0].updateWeightsSparse(ws.sparse, ws.deltas[0].data(), learningRate);
+    }
+    else {
+        NN_PROFILE_SCOPE(UPDATE, 0, LayerFlops(layers[0], 1), 2.0 * LayerBytes(layers[0], 1));
+        layers[0].updateWeights(inputs, ws.deltas[0].data(), learningRate);
+    }
 
-            for (int k = 0; k < nextLayer.neurons.size(); k++) {
-                float weight = nextLayer.neurons[k].weights[j];
-                float delta = nextLayer.neurons[k].delta;
+    for (int i = 1; i < layers.size(); i++) {
+        NN_PROFILE_SCOPE(UPDATE, i, LayerFlops(layers[i], 1), 2.0 * LayerBytes(layers[i], 1));
+        layers[i].updateWeights(ws.activations[i - 1].data(), ws.deltas[i].data(), learningRate);
+    }
 
-                errorSum += weight * delta;
-            }
-            curLayer.neurons[j].delta = errorSum * curLayer.neurons[j].getActivationDerivative();
-        }
+}
+
+const float* Network::feedForwardBatch(const float* inputs, int batchSize, BatchWorkspace& ws) const {
+    return forwardBatchScaled(inputs, 1.0f, batchSize, ws);
+}
+
+void Network::backwardBatch(const float* inputs, const float* targets, int batchSize, BatchWorkspace& ws) const {
+    backwardBatchScaled(inputs, 1.0f, targets, batchSize, ws);
+}
+
+void Network::trainBatch(const float* inputs, const float* targets, int batchSize, float learningRate, BatchWorkspace& ws) {
+    trainBatchScaled(inputs, 1.0f, targets, batchSize, learningRate, ws);
+}
+
+void Network::computeGradients(const float* inputs, const float* targets, int batchSize, BatchWorkspace& ws, Gradients& grads) const {
+    backwardBatch(inputs, targets, batchSize, ws);
+
+    for (int i = 0; i < layers.size(); i++) {
+        NN_PROFILE_SCOPE(GRADIENTS, i, LayerFlops(layers[i], batchSize), LayerBytes(layers[i], batchSize) + 4.0 * layers[i].weightCount());
+        const float* inputsForThisLayer = (i == 0) ? inputs : ws.activations[i - 1].data();
+        layers[i].computeGradients(inputsForThisLayer, ws.deltas[i].data(), batchSize, grads.weights[i].data(), grads.biases[i].data());
+    }
+}
+
+const std::vector<float>& Network::feedForward(const unsigned char* pixels, Workspace& ws) const {
+    // Sparse images are compacted (and scaled) straight from the pixels, without widening
+    bool sparse = false;
+    if (layers[0].type == LayerType::DENSE) {
+        ws.sparse.compact(pixels, PIXEL_SCALE);
+        sparse = Layer::preferSparse(ws.sparse);
+    }
+    if (sparse) {
+        layers[0].feedForwardSparse(ws.sparse, ws.activations[0].data());
+    }
+    else {
+        WidenPixels(pixels, ws.pixels.size(), ws.pixels.data());
+        layers[0].feedForwardBatch(ws.pixels.data(), 1, ws.activations[0].data(), PIXEL_SCALE);
+    }
+
+    for (int i = 1; i < layers.size(); i++) {
+        layers[i].feedForward(ws.activations[i - 1].data(), ws.activations[i].data());
+    }
+    return ws.activations.back();
+}
+
+const float* Network::feedForwardBatch(const unsigned char* pixels, int batchSize, BatchWorkspace& ws) const {
+    WidenPixels(pixels, (size_t)batchSize * numInputs(), ws.pixels.data());
+    return forwardBatchScaled(ws.pixels.data(), PIXEL_SCALE, batchSize, ws);
+}
+
+void Network::trainBatch(const unsigned char* pixels, const float* targets, int batchSize, float learningRate, BatchWorkspace& ws) {
+    if (batchSize <= 0) return;
+    if (batchSize > ws.maxBatch) {
+        std::cout << "error: batch of " << batchSize << " does not fit a workspace of " << ws.maxBatch << std::endl;
+        return;
     }
+    WidenPixels(pixels, (size_t)batchSize * numInputs(), ws.pixels.data());
+    trainBatchScaled(ws.pixels.data(), PIXEL_SCALE, targets, batchSize, learningRate, ws);
+}
 
+const float* Network::forwardBatchScaled(const float* inputs, float inputScale, int batchSize, BatchWorkspace& ws) const {
+    const float* currentInputs = inputs;
     for (int i = 0; i < layers.size(); i++) {
-        std::vector<float> inputsForThisLayer = layerInputs[i];
+        NN_PROFILE_SCOPE(FORWARD, i, LayerFlops(layers[i], batchSize), LayerBytes(layers[i], batchSize));
+        layers[i].feedForwardBatch(currentInputs, batchSize, ws.activations[i].data(), (i == 0) ? inputScale : 1.0f);
+        currentInputs = ws.activations[i].data();
+    }
+    return currentInputs;
+}
 
-        for (int j = 0; j < layers[i].neurons.size(); j++) {
-            layers[i].neurons[j].updateWeights(inputsForThisLayer, learningRate);
+void Network::backwardBatchScaled(const float* inputs, float inputScale, const float* targets, int batchSize, BatchWorkspace& ws) const {
+    forwardBatchScaled(inputs, inputScale, batchSize, ws);
+
+    // 1. Output deltas, one row per sample
+    const Layer& outputLayer = layers.back();
+    {
+        NN_PROFILE_SCOPE(OUTPUT_DELTAS, (int)layers.size() - 1, 3.0 * outputLayer.numNeurons * batchSize, 12.0 * outputLayer.numNeurons * batchSize);
+        for (int n = 0; n < batchSize; n++) {
+            size_t row = (size_t)n * outputLayer.numNeurons;
+            OutputDeltas(&ws.activations.back()[row], &targets[row], &ws.deltas.back()[row], outputLayer.numNeurons, outputLayer.actType);
         }
     }
 
+    // 2. Push the error back through every layer (one GEMM per layer)
+    for (int i = layers.size() - 2; i >= 0; i--) {
+        NN_PROFILE_SCOPE(PROPAGATE, i + 1, LayerFlops(layers[i + 1], batchSize), LayerBytes(layers[i + 1], batchSize));
+        layers[i + 1].propagateErrorBatch(ws.activations[i].data(), ws.deltas[i + 1].data(), batchSize, ws.deltas[i].data());
+        ApplyDerivative(ws.activations[i].data(), ws.deltas[i].data(), batchSize * layers[i].numNeurons, layers[i].actType);
+    }
+}
+
+void Network::trainBatchScaled(const float* inputs, float inputScale, const float* targets, int batchSize, float learningRate, BatchWorkspace& ws) {
+    if (batchSize <= 0) return;
+    if (batchSize > ws.maxBatch) {
+        std::cout << "error: batch of " << batchSize << " does not fit a workspace of " << ws.maxBatch << std::endl;
+        return;
+    }
+    if (isReadOnly()) {
+        std::cout << "error: this network views a model file read-only, train a copy of it" << std::endl;
+        return;
+    }
+
+    backwardBatchScaled(inputs, inputScale, targets, batchSize, ws);
+
+    // 3. One averaged update per layer
+    for (int i = 0; i < layers.size(); i++) {
+        NN_PROFILE_SCOPE(UPDATE, i, LayerFlops(layers[i], batchSize), LayerBytes(layers[i], batchSize) + 4.0 * layers[i].weightCount());
+        const float* inputsForThisLayer = (i == 0) ? inputs : ws.activations[i - 1].data();
+        layers[i].updateWeightsBatch(inputsForThisLayer, ws.deltas[i].data(), batchSize, learningRate, (i == 0) ? inputScale : 1.0f);
+    }
+}
+
+void Network::fullFirstLayer(const float* inputs, IncrementalWorkspace& ws) const {
+    const Layer& first = layers.front();
+    if (inputs != ws.inputs.data()) std::copy(inputs, inputs + first.numInputs, ws.inputs.begin());
+
+    Sgemm(false, true, 1, first.numNeurons, first.numInputs,
+        1.0f, ws.inputs.data(), first.numInputs, first.weightData(), first.numInputs,
+        0.0f, ws.sums.data(), first.numNeurons);
+    const float* biases = first.biasData();
+    for (int j = 0; j < first.numNeurons; j++) ws.sums[j] += biases[j];
+
+    ws.valid = true;
+    ws.updatesSinceFull = 0;
+    ws.fullPasses++;
+}
+
+const std::vector<float>& Network::forwardFromSums(IncrementalWorkspace& ws) const {
+    std::vector<float>& firstOutputs = ws.ws.activations[0];
+    std::copy(ws.sums.begin(), ws.sums.end(), firstOutputs.begin());
+    ActivateRow(firstOutputs.data(), layers[0].numNeurons, layers[0].actType);
+
+    for (int i = 1; i < layers.size(); i++) {
+        layers[i].feedForward(ws.ws.activations[i - 1].data(), ws.ws.activations[i].data());
+    }
+    return ws.ws.activations.back();
+}
+
+const std::vector<float>& Network::feedForwardIncremental(const float* inputs, IncrementalWorkspace& ws) const {
+    const Layer& first = layers.front();
+    if (first.type != LayerType::DENSE) {
+        std::copy(inputs, inputs + first.numInputs, ws.inputs.begin());
+        ws.valid = true;
+        ws.fullPasses++;
+        return feedForward(inputs, ws.ws);
+    }
+
+    const int numNeurons = first.numNeurons;
+    const int maxChanged = first.numInputs / INCREMENTAL_MAX_SHARE;
+
+    // 1. Collect the changed inputs; a full pass if the cache is stale or too much moved
+    int changed = 0;
+    bool full = !ws.valid || ws.updatesSinceFull >= INCREMENTAL_REFRESH;
+    for (int i = 0; !full && i < first.numInputs; i++) {
+        if (inputs[i] == ws.inputs[i]) continue;
+        if (changed == maxChanged) full = true;
+        else ws.changed[changed++] = i;
+    }
+    if (full) {
+        fullFirstLayer(inputs, ws);
+        return forwardFromSums(ws);
+    }
+
+    // 2. sums += (new - old) * column i, for the changed inputs only
+    const SimdKernels& simd = Simd();
+    for (int k = 0; k < changed; k++) {
+        int i = ws.changed[k];
+        simd.axpy(inputs[i] - ws.inputs[i], &ws.columns[(size_t)i * numNeurons], ws.sums.data(), numNeurons);
+        ws.inputs[i] = inputs[i];
+    }
+    ws.updatesSinceFull += changed;
+    ws.partialPasses++;
+    return forwardFromSums(ws);
+}
+
+const std::vector<float>& Network::updateInputs(const int* indices, const float* values, int count, IncrementalWorkspace& ws) const {
+    const Layer& first = layers.front();
+    const int numNeurons = first.numNeurons;
+
+    if (first.type != LayerType::DENSE) {
+        if (!ws.valid) std::fill(ws.inputs.begin(), ws.inputs.end(), 0.0f);
+        for (int k = 0; k < count; k++) ws.inputs[indices[k]] = values[k];
+        ws.valid = true;
+        ws.fullPasses++;
+        return feedForward(ws.inputs.data(), ws.ws);
+    }
+
+    // No previous inputs to edit yet: start from all zeros
+    if (!ws.valid) {
+        std::fill(ws.inputs.begin(), ws.inputs.end(), 0.0f);
+        for (int k = 0; k < count; k++) ws.inputs[indices[k]] = values[k];
+        fullFirstLayer(ws.inputs.data(), ws);
+        return forwardFromSums(ws);
+    }
+
+    if (count > first.numInputs / INCREMENTAL_MAX_SHARE || ws.updatesSinceFull >= INCREMENTAL_REFRESH) {
+        for (int k = 0; k < count; k++) ws.inputs[indices[k]] = values[k];
+        fullFirstLayer(ws.inputs.data(), ws);
+        return forwardFromSums(ws);
+    }
+
+    const SimdKernels& simd = Simd();
+    for (int k = 0; k < count; k++) {
+        int i = indices[k];
+        float delta = values[k] - ws.inputs[i];
+        if (delta == 0.0f) continue;
+        simd.axpy(delta, &ws.columns[(size_t)i * numNeurons], ws.sums.data(), numNeurons);
+        ws.inputs[i] = values[k];
+    }
+    ws.updatesSinceFull += count;
+    ws.partialPasses++;
+    return forwardFromSums(ws);
+}
+
+void Network::refreshScratch() {
+    // layers is public and loaders replace it wholesale, so check the shape, not just the count
+    bool fits = scratch.activations.size() == layers.size() && scratch.pixels.size() == numInputs();
+    for (int i = 0; fits && i < layers.size(); i++) fits = scratch.activations[i].size() == layers[i].numNeurons;
+    if (!fits) scratch = Workspace(*this);
+}
+
+std::vector<float> Network::feedForward(const std::vector<float>& inputs) {
+    if (inputs.size() != numInputs()) {
+        std::cout << "error in inputs/weights size" << std::endl;
+        return std::vector<float>(numOutputs(), 0.0f);
+    }
+    refreshScratch();
+    return feedForward(inputs.data(), scratch);
+}
+
+void Network::backPropagate(const std::vector<float>& inputs, const std::vector<float>& targets, float learningRate) {
+    if (inputs.size() != numInputs() || targets.size() != numOutputs()) {
+        std::cout << "error in inputs/targets size" << std::endl;
+        return;
+    }
+    refreshScratch();
+    backPropagate(inputs.data(), targets.data(), learningRate, scratch);
 }
 
 void Network::saveNetwork(std::string filename) {
@@ -179,15 +804,17 @@ void Network::saveNetwork(std::string filename) {
         return;
     }
 
-    // Loop through every layer, every neuron
+    // Loop through every layer, every neuron (every filter of a CONV2D layer)
     for (Layer& layer : layers) {
-        for (Node& neuron : layer.neurons) {
+        const int rowLength = layer.biasCount() == 0 ? 0 : (int)(layer.weightCount() / layer.biasCount());
+        for (int j = 0; j < layer.biasCount(); j++) {
             // Write Bias
-            file << neuron.bias << "\n";
+            file << layer.biasData()[j] << "\n";
 
             // Write all Weights
-            for (float w : neuron.weights) {
-                file << w << "\n";
+            const float* row = &layer.weightData()[(size_t)j * rowLength];
+            for (int i = 0; i < rowLength; i++) {
+                file << row[i] << "\n";
             }
         }
     }
@@ -197,19 +824,25 @@ void Network::saveNetwork(std::string filename) {
 }
 
 bool Network::loadNetwork(std::string filename) {
+    if (isReadOnly()) {
+        std::cout << "error: this network views a model file read-only, load into a copy of it" << std::endl;
+        return false;
+    }
     std::ifstream file(filename);
     if (!file.is_open()) return false; // File doesn't exist yet
 
-    // IMPORTANT: This assumes the Network structure (784->30->10) 
+    // IMPORTANT: This assumes the Network structure (784->30->10)
     // is EXACTLY the same as when you saved it.
     for (Layer& layer : layers) {
-        for (Node& neuron : layer.neurons) {
+        const int rowLength = layer.biases.empty() ? 0 : (int)(layer.weights.size() / layer.biases.size());
+        for (int j = 0; j < layer.biases.size(); j++) {
             // Read Bias
-            file >> neuron.bias;
+            file >> layer.biases[j];
 
             // Read Weights
-            for (int i = 0; i < neuron.weights.size(); i++) {
-                file >> neuron.weights[i];
+            float* row = &layer.weights[(size_t)j * rowLength];
+            for (int i = 0; i < rowLength; i++) {
+                file >> row[i];
             }
         }
     }
@@ -217,4 +850,4 @@ bool Network::loadNetwork(std::string filename) {
     file.close();
     std::cout << "Network loaded from " << filename << "!" << std::endl;
     return true;
-}
\ No newline at end of file
+}
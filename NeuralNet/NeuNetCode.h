@@ -6,45 +6,301 @@ enum class ActivationType {
 	TANH,
 	RELU,
 	SIGMOID,
-	SOFTMAX
+	SOFTMAX,
+	LINEAR   // identity (pooling layers)
 };
 
+enum class LayerType {
+	DENSE,   // fully connected: numNeurons x numInputs weights, one bias per neuron
+	CONV2D,  // outChannels filters of channels x kernel x kernel weights, one bias per filter
+	MAXPOOL  // max over non-overlapping kernel x kernel windows, no parameters
+};
+
+// Shape of a CONV2D or MAXPOOL layer. Inputs and outputs are stored channel by channel and row by row,
+// so the dense layer after them just sees a flat vector of numNeurons values.
+struct ConvShape {
+	ConvShape() : channels(0), height(0), width(0), kernel(0), stride(1), padding(0), outChannels(0), outHeight(0), outWidth(0) {}
+
+	int channels, height, width;          // input
+	int kernel, stride, padding;          // MAXPOOL: stride = kernel, no padding
+	int outChannels, outHeight, outWidth; // output: (height + 2 * padding - kernel) / stride + 1 rows
+};
+
+class Layer;
+class Network;
+
+// Raw 8-bit pixels (0..255) are fed as-is and scaled by this inside the first layer's GEMMs,
+// so no normalized float copy of the image is ever made.
+const float PIXEL_SCALE = 1.0f / 255.0f;
+
+// --- SPARSE INPUTS ---
+// The nonzero entries of one input vector, in order. Images are mostly background, so a first layer fed
+// through this only touches the weight columns of the inked pixels. Sized once; compacting never allocates.
+class SparseInputs {
+
+public:
+	SparseInputs() : size(0), count(0) {}
+	SparseInputs(int size) : size(size), count(0), indices(size), values(size) {}
+
+	void compact(const float* inputs);
+	void compact(const unsigned char* pixels, float scale); // values are pixel * scale
+	// Gives up once the inputs are too dense for Layer::preferSparse, leaving an incomplete list behind
+	void compactIfSparse(const float* inputs);
+
+	float density() const { return size ? (float)count / size : 1.0f; }
+
+	int size;                 // length of the dense vector
+	int count;                // nonzeros found by the last compact
+	std::vector<int> indices;
+	std::vector<float> values;
+};
+
+// A Node is a lightweight view of one neuron inside a Layer.
+// The weights and bias live in the Layer's contiguous arrays, so creating a Node
+// is free and writing through it updates the Layer.
+// output_cache and delta belong to the view itself (the Network keeps its own in a Workspace).
+// A Node of a read-only layer (Layer::isView) refuses updateWeights.
 class Node {
 
 public:
-	Node(int numInputs, ActivationType type);
+	Node(Layer& layer, int index);
 
-	float feedForward(std::vector<float> inputs);
+	float feedForward(const float* inputs);
+	float feedForward(const std::vector<float>& inputs);
 
 	float getActivationDerivative();
 
-	void updateWeights(std::vector<float> inputs, float learningRate);
+	void updateWeights(const float* inputs, float learningRate);
+	void updateWeights(const std::vector<float>& inputs, float learningRate);
 
-	std::vector<float> weights;
-	float bias;
+	float* weights; // Row 'index' of the Layer's weight matrix (numInputs floats)
+	int numInputs;
+	float& bias;
 	float output_cache;
 	float delta;
 	ActivationType actType;
+	bool readOnly;
 
 };
 
 class Layer {
 
 public:
-	Layer(int numNeurons, int numInputs, ActivationType type);
-	std::vector<float> feedForward(std::vector<float> inputs);
-	std::vector<Node> neurons;
+	// randomize = false leaves every weight and bias at 0 (for loaders that fill them in anyway)
+	Layer(int numNeurons, int numInputs, ActivationType type, bool randomize = true);
+
+	// Copying a view copies the arrays it views into the copy's own vectors, so the copy can be trained
+	// and outlives the mapping. Moving keeps the view.
+	Layer(const Layer& other);
+	Layer& operator=(const Layer& other);
+	Layer(Layer&&) = default;
+	Layer& operator=(Layer&&) = default;
+
+	// A convolution over channels x height x width inputs (Conv.h has the kernels); weights are
+	// outChannels x (channels x kernel x kernel), randomize draws them He-uniform from the fan-in
+	static Layer Conv2D(int channels, int height, int width, int outChannels, int kernel, ActivationType type,
+		int stride = 1, int padding = 0, bool randomize = true);
+	// size x size max pooling of every channel; rows and columns past the last whole window are dropped
+	static Layer MaxPool(int channels, int height, int width, int size);
+
+	// outputs must hold numNeurons floats. Does not allocate.
+	void feedForward(const float* inputs, float* outputs) const;
+	std::vector<float> feedForward(const std::vector<float>& inputs) const;
+
+	// errors[i] = sum over j of weights[j][i] * deltas[j] (numInputs floats).
+	// inputs are the ones the forward pass saw: MAXPOOL sends each delta to its window's largest input,
+	// the other types ignore them.
+	void propagateError(const float* inputs, const float* deltas, float* errors) const;
+
+	// weights[j][i] += learningRate * deltas[j] * inputs[i]. The updates print an error and leave a view alone.
+	void updateWeights(const float* inputs, const float* deltas, float learningRate);
+
+	// Batched versions of the three above. Every matrix is row-major with one sample per row:
+	// inputs/errors are batchSize x numInputs, outputs/deltas are batchSize x numNeurons.
+	// inputScale multiplies every input on the fly (PIXEL_SCALE for raw pixels).
+	void feedForwardBatch(const float* inputs, int batchSize, float* outputs, float inputScale = 1.0f) const;
+	void propagateErrorBatch(const float* inputs, const float* deltas, int batchSize, float* errors) const;
+	// Applies the batch-averaged gradient in one step
+	void updateWeightsBatch(const float* inputs, const float* deltas, int batchSize, float learningRate, float inputScale = 1.0f);
+
+	// Summed (not averaged) gradient of a batch, written to weightGrads (numNeurons x numInputs)
+	// and biasGrads (numNeurons). Leaves the weights alone.
+	void computeGradients(const float* inputs, const float* deltas, int batchSize, float* weightGrads, float* biasGrads, float inputScale = 1.0f) const;
+
+	// Sparse-input versions of feedForward and updateWeights: only the weights of the nonzero inputs are read or written
+	// (DENSE layers only)
+	void feedForwardSparse(const SparseInputs& inputs, float* outputs) const;
+	void updateWeightsSparse(const SparseInputs& inputs, const float* deltas, float learningRate);
+	// Whether inputs this sparse are faster through the sparse versions on this CPU
+	static bool preferSparse(const SparseInputs& inputs);
+
+	Node neuron(int index);
+
+	// Multiply-adds of one sample's forward pass (comparisons for MAXPOOL)
+	double flopsPerSample() const;
+
+	LayerType type;
+	ConvShape shape; // CONV2D and MAXPOOL only
+	int numNeurons;  // outputs (outChannels x outHeight x outWidth for CONV2D and MAXPOOL)
+	int numInputs;
+	ActivationType actType;
+
+	// The parameters as every pass that only reads them sees them: weights / biases, or the external arrays
+	// this layer views (a mapped model file, ModelFile.h). A view's own vectors are empty, so it runs
+	// inference and computes gradients but can't be updated; a copy of it owns its parameters.
+	const float* weightData() const { return viewedWeights ? viewedWeights : weights.data(); }
+	const float* biasData() const { return viewedBiases ? viewedBiases : biases.data(); }
+	size_t weightCount() const; // from the shape, so the same for a view
+	size_t biasCount() const;
+	bool isView() const { return viewedWeights != nullptr; }
+	// Reads weightCount() / biasCount() floats from these arrays from now on (they must outlive the layer)
+	// and frees the layer's own
+	void viewParameters(const float* weights, const float* biases);
+
+	// Row-major weight matrix: neuron j's weights are weights[j * numInputs ... (j + 1) * numInputs - 1]
+	// (CONV2D: filter k's weights are weights[k * channels * kernel^2 ...], channel by channel, row by row)
+	std::vector<float> weights;
+	std::vector<float> biases;
+
+private:
+	// Shape and sizes from a CONV2D or MAXPOOL shape, parameters zeroed
+	Layer(LayerType type, const ConvShape& shape, ActivationType actType);
+
+	const float* viewedWeights;
+	const float* viewedBiases;
 
 };
 
+// --- WORKSPACE ---
+// Every buffer a forward/backward pass needs, sized once from the Network shape.
+// Passes that are given a Workspace never touch the heap.
+// One Workspace per thread: the Network itself holds no per-sample state.
+class Workspace {
+
+public:
+	Workspace() {}
+	Workspace(const Network& net);
+
+	std::vector<std::vector<float>> activations; // activations[i] = outputs of layers[i]
+	std::vector<std::vector<float>> deltas;      // deltas[i] = error terms of layers[i]
+	std::vector<float> pixels;                   // raw 8-bit inputs widened to float (numInputs)
+	SparseInputs sparse;                         // nonzero inputs of the last sample, for the first layer
+};
+
+// --- BATCH WORKSPACE ---
+// Same idea as Workspace, but every buffer holds up to maxBatch samples (one per row).
+class BatchWorkspace {
+
+public:
+	BatchWorkspace() : maxBatch(0) {}
+	BatchWorkspace(const Network& net, int maxBatch);
+
+	int maxBatch;
+	std::vector<std::vector<float>> activations; // activations[i] = maxBatch x layers[i].numNeurons
+	std::vector<std::vector<float>> deltas;      // deltas[i] = maxBatch x layers[i].numNeurons
+	std::vector<float> pixels;                   // maxBatch x numInputs raw 8-bit inputs widened to float
+};
+
+// --- GRADIENTS ---
+// One buffer per Layer parameter array, same shapes as the Network's weights and biases.
+class Gradients {
+
+public:
+	Gradients() {}
+	Gradients(const Network& net);
+
+	std::vector<std::vector<float>> weights; // weights[i] matches layers[i].weights
+	std::vector<std::vector<float>> biases;  // biases[i] matches layers[i].biases
+};
+
+// --- INCREMENTAL WORKSPACE ---
+// Caches the first layer's sums (before the activation) so inputs that changed in only a few places,
+// like the canvas after one brush stroke, can be re-scored by touching just the weights of those inputs.
+// Holds a copy of the first layer's weights, so build it after the weights are final and rebuild it if they change.
+// A network whose first layer is not DENSE runs a full pass every time.
+class IncrementalWorkspace {
+
+public:
+	IncrementalWorkspace() : valid(false), updatesSinceFull(0), fullPasses(0), partialPasses(0) {}
+	IncrementalWorkspace(const Network& net);
+
+	// Forces the next pass to recompute everything
+	void invalidate() { valid = false; }
+
+	Workspace ws;               // activations of every layer, as for feedForward
+	std::vector<float> inputs;  // inputs the cached sums belong to (numInputs)
+	std::vector<float> sums;    // first layer: bias + weights * inputs (numNeurons)
+	std::vector<float> columns; // first layer's weights transposed: input i's weights start at i * numNeurons
+	std::vector<int> changed;   // indices of the inputs that differ from the previous call
+	bool valid;
+	int updatesSinceFull;
+	long long fullPasses;       // counters for benchmarks and logging
+	long long partialPasses;
+};
+
 class Network {
 
 public:
+	Network() {}
 	Network(std::vector<int> layerNeurons, int outputs, int inputs);
-	void backPropagate(std::vector<float> inputs, std::vector<float> targets, float learningRate);
+	// Feature layers (CONV2D / MAXPOOL, in order) in front of RELU hidden layers and a SOFTMAX output;
+	// the first hidden layer takes the last feature layer's outputs
+	Network(std::vector<Layer> features, std::vector<int> layerNeurons, int outputs);
+
+	// Allocation-free versions: inputs holds numInputs() floats, targets numOutputs() floats.
+	const std::vector<float>& feedForward(const float* inputs, Workspace& ws) const;
+	void backPropagate(const float* inputs, const float* targets, float learningRate, Workspace& ws);
+
+	// Mini-batch versions: inputs is batchSize x numInputs(), targets batchSize x numOutputs(), row-major.
+	// batchSize may be anything up to ws.maxBatch. Returns the batchSize x numOutputs() outputs.
+	const float* feedForwardBatch(const float* inputs, int batchSize, BatchWorkspace& ws) const;
+	// One weight update per batch, using the gradient averaged over the batch
+	void trainBatch(const float* inputs, const float* targets, int batchSize, float learningRate, BatchWorkspace& ws);
+	// Forward + backward without touching the weights: leaves every layer's error terms in ws.deltas
+	void backwardBatch(const float* inputs, const float* targets, int batchSize, BatchWorkspace& ws) const;
+	// backwardBatch, then the summed gradient of every layer into grads
+	void computeGradients(const float* inputs, const float* targets, int batchSize, BatchWorkspace& ws, Gradients& grads) const;
+
+	// 8-bit pixel versions (0..255, e.g. straight from an MnistDataset); normalization happens in the first layer
+	const std::vector<float>& feedForward(const unsigned char* pixels, Workspace& ws) const;
+	const float* feedForwardBatch(const unsigned char* pixels, int batchSize, BatchWorkspace& ws) const;
+	void trainBatch(const unsigned char* pixels, const float* targets, int batchSize, float learningRate, BatchWorkspace& ws);
+
+	// Incremental versions, for inputs that change a little between calls (ws holds the previous call's inputs).
+	// Only the changed inputs' weights are applied to the cached first-layer sums; when too many inputs
+	// changed (e.g. the canvas centering moved the whole drawing) it falls back to a full pass.
+	const std::vector<float>& feedForwardIncremental(const float* inputs, IncrementalWorkspace& ws) const;
+	// Sparse edit of the previous inputs: inputs[indices[k]] = values[k] for every k < count
+	const std::vector<float>& updateInputs(const int* indices, const float* values, int count, IncrementalWorkspace& ws) const;
+
+	// Convenience versions, they run through the Network's own scratch Workspace
+	std::vector<float> feedForward(const std::vector<float>& inputs);
+	void backPropagate(const std::vector<float>& inputs, const std::vector<float>& targets, float learningRate);
+
 	void saveNetwork(std::string filename);
 	bool loadNetwork(std::string filename);
 
+	int numInputs() const;
+	int numOutputs() const;
+	// Every layer is DENSE (the int8, 16-bit, plan and fixed-size versions only take these)
+	bool isDense() const;
+	// Some layer views a mapped model file: the network runs, but every update refuses it (train a copy)
+	bool isReadOnly() const;
+
 	std::vector<Layer> layers;
-	std::vector<float> feedForward(std::vector<float> inputs);
-};
\ No newline at end of file
+
+private:
+	// Batch passes with the first layer's inputs scaled by inputScale
+	const float* forwardBatchScaled(const float* inputs, float inputScale, int batchSize, BatchWorkspace& ws) const;
+	void backwardBatchScaled(const float* inputs, float inputScale, const float* targets, int batchSize, BatchWorkspace& ws) const;
+	void trainBatchScaled(const float* inputs, float inputScale, const float* targets, int batchSize, float learningRate, BatchWorkspace& ws);
+
+	// Incremental passes: the first layer's sums from scratch, and everything after them
+	void fullFirstLayer(const float* inputs, IncrementalWorkspace& ws) const;
+	const std::vector<float>& forwardFromSums(IncrementalWorkspace& ws) const;
+
+	// Rebuilds scratch if it no longer matches the layers
+	void refreshScratch();
+
+	Workspace scratch;
+};
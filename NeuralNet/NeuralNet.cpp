@@ -2,66 +2,18 @@
 #include "framework.h"
 #include "NeuralNet.h"
 #include "NeuNetCode.h"
+#include "ModelFile.h"
 #include "MnistLoader.h"
+#include "Preprocess.h"
 #include <vector>
 #include <string>
 #include <sstream>
 #include <algorithm>
 #include <iomanip>
 
-// --- HELPER: CENTER THE IMAGE ---
-// This moves the drawing so its center of mass aligns with the grid center (14,14)
-void CenterGrid(float* inputGrid, float* outputGrid) {
-    // 1. Calculate Center of Mass
-    float sumX = 0.0f, sumY = 0.0f, totalWeight = 0.0f;
-
-    for (int y = 0; y < 28; y++) {
-        for (int x = 0; x < 28; x++) {
-            float val = inputGrid[y * 28 + x];
-            if (val > 0.0f) {
-                sumX += x * val;
-                sumY += y * val;
-                totalWeight += val;
-            }
-        }
-    }
-
-    // If grid is empty, just copy zeros
-    if (totalWeight == 0.0f) {
-        for (int i = 0; i < 784; i++) outputGrid[i] = 0.0f;
-        return;
-    }
-
-    // Current Center
-    float centerX = sumX / totalWeight;
-    float centerY = sumY / totalWeight;
-
-    // Target Center is (14, 14)
-    float shiftX = 14.0f - centerX;
-    float shiftY = 14.0f - centerY;
-
-    // 2. Shift Pixels
-    for (int i = 0; i < 784; i++) outputGrid[i] = 0.0f; // Clear output
-
-    for (int y = 0; y < 28; y++) {
-        for (int x = 0; x < 28; x++) {
-            float val = inputGrid[y * 28 + x];
-            if (val > 0.0f) {
-                // Apply shift
-                int newX = (int)(x + shiftX);
-                int newY = (int)(y + shiftY);
-
-                // Check bounds
-                if (newX >= 0 && newX < 28 && newY >= 0 && newY < 28) {
-                    outputGrid[newY * 28 + newX] = val;
-                }
-            }
-        }
-    }
-}
-
 // --- GLOBALS ---
 Network* myNet = nullptr;
+IncrementalWorkspace canvasState; // Remembers the last scored canvas, so a stroke only re-scores what it touched
 float drawingGrid[784]; // The 28x28 canvas (0.0 = Black, 1.0 = White)
 bool isDrawing = false;
 std::vector<float> currentOutputs;
@@ -111,10 +63,17 @@ void InitScene() {
     myNet = new Network(structure, 10, 784);
 
     // 2. Load the trained brain
-    // Make sure 'brain.txt' is in the same folder as the .exe (or project folder)
-    if (!myNet->loadNetwork("brain.txt")) {
-        MessageBox(NULL, L"Could not load 'brain.txt'! Did you run the trainer?", L"Brain Missing", MB_ICONWARNING);
+    // Make sure 'brain.nnm' or 'brain.txt' is in the same folder as the .exe (or project folder).
+    // The binary model wins; a text-only brain is converted once so the next start is fast.
+    if (!LoadModel("brain.nnm", *myNet)) {
+        if (ConvertTextModel("brain.txt", structure, 10, 784, "brain.nnm")) {
+            LoadModel("brain.nnm", *myNet);
+        }
+        else if (!myNet->loadNetwork("brain.txt")) {
+            MessageBox(NULL, L"Could not load 'brain.nnm' or 'brain.txt'! Did you run the trainer?", L"Brain Missing", MB_ICONWARNING);
+        }
     }
+    canvasState = IncrementalWorkspace(*myNet);
 
     ClearGrid();
 }
@@ -244,10 +203,9 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
                 CenterGrid(drawingGrid, centeredGrid);
 
                 // 2. Feed the centered version to the brain
-                std::vector<float> inputs;
-                for (int i = 0; i < 784; i++) inputs.push_back(centeredGrid[i]);
-
-                currentOutputs = myNet->feedForward(inputs);
+                // Usually only the few pixels under the brush changed. When the centering moves
+                // the whole drawing instead, feedForwardIncremental falls back to a full pass.
+                currentOutputs = myNet->feedForwardIncremental(centeredGrid, canvasState);
             }
             InvalidateRect(hWnd, NULL, FALSE);
         }
@@ -282,7 +240,9 @@ BOOL InitInstance(HINSTANCE hInstance, int nCmdShow) { hInst = hInstance; HWND h
 
 
 
-/* Old console layout for training */
+/* Old console layout for training. Superseded by NeuralNetTrain (headless, portable, multithreaded):
+   NeuralNetTrain --train-images Data\train-images.idx3-ubyte --train-labels Data\train-labels.idx1-ubyte
+                  --test-images Data\t10k-images.idx3-ubyte --test-labels Data\t10k-labels.idx1-ubyte --output brain.nnm */
 /*
 #include <iostream>
 #include <vector>
@@ -0,0 +1,214 @@
+#include "Optimizer.h"
+#include "Simd.h"
+#include "SimdTargets.h"
+#include "Profiler.h"
+#include <cmath>
+#include <iostream>
+
+// --- LEARNING RATE SCHEDULE ---
+static const float PI = 3.14159265358979f;
+
+LearningRateSchedule::LearningRateSchedule(float rate)
+    : type(ScheduleType::CONSTANT), rate(rate), warmupSteps(0), stepSize(1), gamma(1.0f), totalSteps(1), minRate(0.0f) {}
+
+LearningRateSchedule LearningRateSchedule::constant(float rate) {
+    return LearningRateSchedule(rate);
+}
+
+LearningRateSchedule LearningRateSchedule::step(float rate, int stepSize, float gamma) {
+    LearningRateSchedule schedule(rate);
+    schedule.type = ScheduleType::STEP;
+    schedule.stepSize = (stepSize > 0) ? stepSize : 1;
+    schedule.gamma = gamma;
+    return schedule;
+}
+
+LearningRateSchedule LearningRateSchedule::cosine(float rate, int totalSteps, float minRate) {
+    LearningRateSchedule schedule(rate);
+    schedule.type = ScheduleType::COSINE;
+    schedule.totalSteps = (totalSteps > 0) ? totalSteps : 1;
+    schedule.minRate = minRate;
+    return schedule;
+}
+
+LearningRateSchedule LearningRateSchedule::withWarmup(int steps) const {
+    LearningRateSchedule schedule = *this;
+    schedule.warmupSteps = (steps > 0) ? steps : 0;
+    return schedule;
+}
+
+float LearningRateSchedule::rateAt(int step) const {
+    // Warmup: step 0 already moves (rate / warmupSteps), the full rate is reached at step warmupSteps - 1
+    if (step < warmupSteps) return rate * (step + 1) / warmupSteps;
+    step -= warmupSteps;
+
+    if (type == ScheduleType::STEP) {
+        return rate * std::pow(gamma, (float)(step / stepSize));
+    }
+    if (type == ScheduleType::COSINE) {
+        if (step >= totalSteps) return minRate;
+        return minRate + 0.5f * (rate - minRate) * (1.0f + std::cos(PI * step / totalSteps));
+    }
+    return rate;
+}
+
+// --- UPDATE KERNELS ---
+struct UpdateParams {
+    float rate;
+    float gradScale;   // gradients are batch sums: 1 / batchSize
+    float momentum;
+    float beta1;
+    float beta2;
+    float rmsDecay;
+    float epsilon;
+    float weightDecay; // 0 for biases
+    float correction1; // 1 / (1 - beta1^t)
+    float correction2; // 1 / (1 - beta2^t)
+};
+
+// One pass over n parameters: w, g, s1 and s2 are each read once and written at most once.
+// TYPE is a template argument, so each rule compiles to its own branch-free loop.
+template <OptimizerType TYPE>
+static NN_FORCE_INLINE void UpdateBody(float* w, const float* g, float* s1, float* s2, int n, const UpdateParams& p) {
+    const float rate = p.rate, scale = p.gradScale, decay = p.weightDecay;
+    const float momentum = p.momentum, beta1 = p.beta1, beta2 = p.beta2, rho = p.rmsDecay, eps = p.epsilon;
+    const float c1 = p.correction1, c2 = p.correction2;
+
+    for (int i = 0; i < n; i++) {
+        float d = g[i] * scale;
+        if (TYPE != OptimizerType::ADAMW) d -= decay * w[i]; // L2 through the gradient
+
+        if (TYPE == OptimizerType::SGD) {
+            w[i] += rate * d;
+        }
+        else if (TYPE == OptimizerType::MOMENTUM || TYPE == OptimizerType::NESTEROV) {
+            float v = momentum * s1[i] + d;
+            s1[i] = v;
+            w[i] += (TYPE == OptimizerType::NESTEROV) ? rate * (d + momentum * v) : rate * v;
+        }
+        else if (TYPE == OptimizerType::ADAM || TYPE == OptimizerType::ADAMW) {
+            float m = beta1 * s1[i] + (1.0f - beta1) * d;
+            float v = beta2 * s2[i] + (1.0f - beta2) * d * d;
+            s1[i] = m;
+            s2[i] = v;
+            float update = (m * c1) / (std::sqrt(v * c2) + eps);
+            if (TYPE == OptimizerType::ADAMW) update -= decay * w[i];
+            w[i] += rate * update;
+        }
+        else { // RMSPROP
+            float v = rho * s1[i] + (1.0f - rho) * d * d;
+            s1[i] = v;
+            w[i] += rate * d / (std::sqrt(v) + eps);
+        }
+    }
+}
+
+template <OptimizerType TYPE>
+static void UpdateGeneric(float* w, const float* g, float* s1, float* s2, int n, const UpdateParams& p) { UpdateBody<TYPE>(w, g, s1, s2, n, p); }
+
+#ifdef NN_X86
+template <OptimizerType TYPE>
+static NN_TARGET_AVX2 void UpdateAvx2(float* w, const float* g, float* s1, float* s2, int n, const UpdateParams& p) { UpdateBody<TYPE>(w, g, s1, s2, n, p); }
+template <OptimizerType TYPE>
+static NN_TARGET_AVX512 void UpdateAvx512(float* w, const float* g, float* s1, float* s2, int n, const UpdateParams& p) { UpdateBody<TYPE>(w, g, s1, s2, n, p); }
+#endif
+
+typedef void (*UpdateFunction)(float* w, const float* g, float* s1, float* s2, int n, const UpdateParams& p);
+
+template <OptimizerType TYPE>
+static UpdateFunction KernelFor(SimdLevel level) {
+#ifdef NN_X86
+    if (level == SimdLevel::AVX512) return UpdateAvx512<TYPE>;
+    if (level == SimdLevel::AVX2) return UpdateAvx2<TYPE>;
+#endif
+    return UpdateGeneric<TYPE>;
+}
+
+static UpdateFunction PickKernel(OptimizerType type, SimdLevel level) {
+    switch (type) {
+    case OptimizerType::MOMENTUM: return KernelFor<OptimizerType::MOMENTUM>(level);
+    case OptimizerType::NESTEROV: return KernelFor<OptimizerType::NESTEROV>(level);
+    case OptimizerType::ADAM: return KernelFor<OptimizerType::ADAM>(level);
+    case OptimizerType::ADAMW: return KernelFor<OptimizerType::ADAMW>(level);
+    case OptimizerType::RMSPROP: return KernelFor<OptimizerType::RMSPROP>(level);
+    default: return KernelFor<OptimizerType::SGD>(level);
+    }
+}
+
+const char* OptimizerName(OptimizerType type) {
+    switch (type) {
+    case OptimizerType::MOMENTUM: return "momentum";
+    case OptimizerType::NESTEROV: return "nesterov";
+    case OptimizerType::ADAM: return "adam";
+    case OptimizerType::ADAMW: return "adamw";
+    case OptimizerType::RMSPROP: return "rmsprop";
+    default: return "sgd";
+    }
+}
+
+// --- OPTIMIZER ---
+Optimizer::Optimizer(const Network& net, const OptimizerSettings& settings, const LearningRateSchedule& schedule)
+    : settings(settings), schedule(schedule), kernel(PickKernel(settings.type, Simd().level)),
+      steps(0), rate(0.0f), correction1(1.0f), correction2(1.0f) {
+
+    // Plain SGD has no state; the others get zeroed buffers shaped like each layer's parameters
+    bool needsFirst = settings.type != OptimizerType::SGD;
+    bool needsSecond = settings.type == OptimizerType::ADAM || settings.type == OptimizerType::ADAMW;
+    for (const Layer& layer : net.layers) {
+        size_t params = layer.weightCount() + layer.biasCount();
+        first.push_back(std::vector<float>(needsFirst ? params : 0, 0.0f));
+        second.push_back(std::vector<float>(needsSecond ? params : 0, 0.0f));
+    }
+}
+
+void Optimizer::beginStep() {
+    rate = schedule.rateAt(steps);
+    steps++;
+    correction1 = 1.0f / (1.0f - std::pow(settings.beta1, (float)steps));
+    correction2 = 1.0f / (1.0f - std::pow(settings.beta2, (float)steps));
+}
+
+void Optimizer::updateRange(Network& net, int layer, bool biases, int begin, int end, const float* grads, float gradScale) {
+    Layer& target = net.layers[layer];
+    if (end <= begin || target.isView()) return; // step and the trainers report a read-only network
+
+    UpdateParams p;
+    p.rate = rate;
+    p.gradScale = gradScale;
+    p.momentum = settings.momentum;
+    p.beta1 = settings.beta1;
+    p.beta2 = settings.beta2;
+    p.rmsDecay = settings.rmsDecay;
+    p.epsilon = settings.epsilon;
+    p.weightDecay = biases ? 0.0f : settings.weightDecay;
+    p.correction1 = correction1;
+    p.correction2 = correction2;
+
+    // The state buffers hold the weights first, then the biases
+    size_t offset = (biases ? target.weights.size() : 0) + begin;
+    float* w = (biases ? target.biases.data() : target.weights.data()) + begin;
+    float* s1 = first[layer].empty() ? nullptr : first[layer].data() + offset;
+    float* s2 = second[layer].empty() ? nullptr : second[layer].data() + offset;
+    // Weight and gradient read, weight written, and every state buffer read and written
+    NN_PROFILE_SCOPE(OPTIMIZER, layer, 0, 4.0 * (end - begin) * (3 + (s1 ? 2 : 0) + (s2 ? 2 : 0)));
+    kernel(w, grads + begin, s1, s2, end - begin, p);
+}
+
+void Optimizer::step(Network& net, const Gradients& grads, int batchSize) {
+    if (batchSize <= 0) return;
+    if (first.size() != net.layers.size()) {
+        std::cout << "error: the optimizer was built for a network with " << first.size() << " layers" << std::endl;
+        return;
+    }
+    if (net.isReadOnly()) {
+        std::cout << "error: this network views a model file read-only, train a copy of it" << std::endl;
+        return;
+    }
+
+    beginStep();
+    float scale = 1.0f / batchSize;
+    for (int i = 0; i < net.layers.size(); i++) {
+        updateRange(net, i, false, 0, (int)net.layers[i].weights.size(), grads.weights[i].data(), scale);
+        updateRange(net, i, true, 0, (int)net.layers[i].biases.size(), grads.biases[i].data(), scale);
+    }
+}
@@ -0,0 +1,102 @@
+#pragma once
+#include <vector>
+#include "NeuNetCode.h"
+
+// --- LEARNING RATE SCHEDULE ---
+// The learning rate as a function of the optimizer step (one step per batch).
+//   LearningRateSchedule::cosine(0.001f, 10000).withWarmup(500)
+// ramps linearly from 0 to 0.001 over 500 steps, then decays along a half cosine to 0 at step 10000.
+enum class ScheduleType {
+	CONSTANT,
+	STEP,    // rate * gamma^(step / stepSize)
+	COSINE   // from rate down to minRate over totalSteps, then stays at minRate
+};
+
+class LearningRateSchedule {
+
+public:
+	LearningRateSchedule(float rate = 0.01f);
+
+	static LearningRateSchedule constant(float rate);
+	static LearningRateSchedule step(float rate, int stepSize, float gamma);
+	static LearningRateSchedule cosine(float rate, int totalSteps, float minRate = 0.0f);
+	// Linear ramp from 0 over the first warmupSteps steps (in front of any of the above)
+	LearningRateSchedule withWarmup(int warmupSteps) const;
+
+	float rateAt(int step) const;
+
+	ScheduleType type;
+	float rate;
+	int warmupSteps;
+	int stepSize;    // STEP
+	float gamma;     // STEP
+	int totalSteps;  // COSINE
+	float minRate;   // COSINE
+};
+
+// --- OPTIMIZER ---
+// Turns batch gradients into weight updates. Every rule keeps its state (velocity, moment estimates)
+// in one contiguous buffer per layer and per kind of state, laid out like the layer's parameters:
+// the weights (numNeurons x numInputs) followed by the biases. A step is a single fused pass per
+// parameter array that reads the gradient and the state once and writes the weight and the state once,
+// compiled for the widest instruction set the CPU runs (see Simd.h).
+//
+// Gradients follow the Network's convention: Network::computeGradients gives the summed descent
+// direction (weights += rate * gradient / batchSize is plain SGD).
+enum class OptimizerType {
+	SGD,
+	MOMENTUM, // heavy ball: v = momentum * v + g, w += rate * v
+	NESTEROV, // w += rate * (g + momentum * v), with v updated as above
+	ADAM,
+	ADAMW,    // Adam with the weight decay applied to the weights directly instead of through the gradient
+	RMSPROP
+};
+
+struct OptimizerSettings {
+	OptimizerSettings(OptimizerType type = OptimizerType::SGD)
+		: type(type), momentum(0.9f), beta1(0.9f), beta2(0.999f), rmsDecay(0.9f), epsilon(1e-8f), weightDecay(0.0f) {}
+
+	OptimizerType type;
+	float momentum;    // MOMENTUM, NESTEROV
+	float beta1;       // ADAM, ADAMW
+	float beta2;       // ADAM, ADAMW
+	float rmsDecay;    // RMSPROP
+	float epsilon;     // ADAM, ADAMW, RMSPROP
+	float weightDecay; // L2 on the weights (never the biases); decoupled for ADAMW
+};
+
+const char* OptimizerName(OptimizerType type);
+
+struct UpdateParams; // per-step constants handed to the update kernels (Optimizer.cpp)
+
+class Optimizer {
+
+public:
+	Optimizer() : kernel(nullptr), steps(0), rate(0.0f), correction1(1.0f), correction2(1.0f) {}
+	Optimizer(const Network& net, const OptimizerSettings& settings, const LearningRateSchedule& schedule);
+
+	// One update from a batch's summed gradient (e.g. from Network::computeGradients)
+	void step(Network& net, const Gradients& grads, int batchSize);
+
+	// The same step split up, for trainers that update slices of the parameters in parallel:
+	// beginStep once per batch, then updateRange over every [begin, end) of every parameter array.
+	void beginStep();
+	void updateRange(Network& net, int layer, bool biases, int begin, int end, const float* grads, float gradScale);
+
+	int stepCount() const { return steps; }
+	float currentRate() const { return rate; }
+
+	OptimizerSettings settings;
+	LearningRateSchedule schedule;
+
+private:
+	typedef void (*UpdateKernel)(float* w, const float* g, float* s1, float* s2, int n, const UpdateParams& p);
+
+	UpdateKernel kernel;
+	int steps;
+	float rate;               // learning rate of the current step
+	float correction1;        // Adam bias corrections of the current step
+	float correction2;
+	std::vector<std::vector<float>> first;  // first[i]: velocity / first moment of layer i
+	std::vector<std::vector<float>> second; // second[i]: second moment / squared-gradient average of layer i
+};
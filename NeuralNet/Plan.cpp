@@ -0,0 +1,217 @@
+#include "Plan.h"
+#include "Simd.h"
+#include "SimdTargets.h"
+#include <algorithm>
+#include <iostream>
+
+// Panels per block: enough independent accumulators to hide the FMA latency, few enough to stay in registers
+static const int MAX_PANELS_AVX512 = 8; // 8 zmm accumulators (of 32)
+static const int MAX_PANELS_NARROW = 4; // 4 x 2 ymm accumulators (of 16), the input loop is split in two
+
+// --- PACKING ---
+// Block b holds panels [b * maxPanels, ...); inside it, the weights of input i for every neuron of the block are contiguous
+static void PackLayer(const Layer& src, int panelWidth, int maxPanels, InferencePlan::PlanLayer& layer) {
+    int numPanels = (src.numNeurons + panelWidth - 1) / panelWidth;
+    layer.numInputs = src.numInputs;
+    layer.numNeurons = src.numNeurons;
+    layer.paddedNeurons = numPanels * panelWidth;
+    layer.actType = src.actType;
+    layer.packed.assign((size_t)layer.paddedNeurons * src.numInputs, 0.0f);
+    layer.biases.assign(layer.paddedNeurons, 0.0f);
+    std::copy(src.biasData(), src.biasData() + src.numNeurons, layer.biases.begin());
+
+    const float* weights = src.weightData();
+    float* out = layer.packed.data();
+    for (int p0 = 0; p0 < numPanels; p0 += maxPanels) {
+        int width = std::min(maxPanels, numPanels - p0) * panelWidth;
+        int firstNeuron = p0 * panelWidth;
+        for (int i = 0; i < src.numInputs; i++) {
+            for (int c = 0; c < width; c++) {
+                int neuron = firstNeuron + c;
+                *out++ = (neuron < src.numNeurons) ? weights[(size_t)neuron * src.numInputs + i] : 0.0f;
+            }
+        }
+    }
+}
+
+// --- SCALAR KERNEL (8-wide panels, left to the compiler's vectorizer) ---
+template <bool RELU>
+static void LayerScalar(const InferencePlan::PlanLayer& layer, const float* x, float* y) {
+    const int width = 8 * MAX_PANELS_NARROW;
+    const float* w = layer.packed.data();
+    for (int n0 = 0; n0 < layer.paddedNeurons; n0 += width) {
+        int cols = std::min(width, layer.paddedNeurons - n0);
+        float acc[width];
+        for (int c = 0; c < cols; c++) acc[c] = layer.biases[n0 + c];
+        for (int i = 0; i < layer.numInputs; i++) {
+            float xi = x[i];
+            for (int c = 0; c < cols; c++) acc[c] += xi * w[c];
+            w += cols;
+        }
+        for (int c = 0; c < cols; c++) y[n0 + c] = (RELU && acc[c] < 0.0f) ? 0.0f : acc[c];
+    }
+}
+
+#ifdef NN_X86
+
+// --- AVX2 KERNEL (8-wide panels) ---
+template <int PANELS, bool RELU>
+static inline NN_TARGET_AVX2 void BlockAvx2(const float* w, const float* bias, const float* x, int n, float* y) {
+    // Two accumulator sets (even / odd inputs) double the independent FMA chains
+    __m256 even[PANELS], odd[PANELS];
+    for (int p = 0; p < PANELS; p++) {
+        even[p] = _mm256_load_ps(bias + 8 * p);
+        odd[p] = _mm256_setzero_ps();
+    }
+
+    int i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m256 x0 = _mm256_broadcast_ss(&x[i]);
+        __m256 x1 = _mm256_broadcast_ss(&x[i + 1]);
+        for (int p = 0; p < PANELS; p++) {
+            even[p] = _mm256_fmadd_ps(x0, _mm256_load_ps(w + 8 * p), even[p]);
+            odd[p] = _mm256_fmadd_ps(x1, _mm256_load_ps(w + 8 * (PANELS + p)), odd[p]);
+        }
+        w += 16 * PANELS;
+    }
+    if (i < n) {
+        __m256 x0 = _mm256_broadcast_ss(&x[i]);
+        for (int p = 0; p < PANELS; p++) even[p] = _mm256_fmadd_ps(x0, _mm256_load_ps(w + 8 * p), even[p]);
+    }
+
+    for (int p = 0; p < PANELS; p++) {
+        __m256 sum = _mm256_add_ps(even[p], odd[p]);
+        if (RELU) sum = _mm256_max_ps(sum, _mm256_setzero_ps());
+        _mm256_store_ps(y + 8 * p, sum);
+    }
+}
+
+template <bool RELU>
+static NN_TARGET_AVX2 void LayerAvx2(const InferencePlan::PlanLayer& layer, const float* x, float* y) {
+    const float* w = layer.packed.data();
+    int numPanels = layer.paddedNeurons / 8;
+    for (int p0 = 0; p0 < numPanels; p0 += MAX_PANELS_NARROW) {
+        int panels = std::min(MAX_PANELS_NARROW, numPanels - p0);
+        const float* bias = &layer.biases[p0 * 8];
+        switch (panels) {
+        case 4: BlockAvx2<4, RELU>(w, bias, x, layer.numInputs, y + p0 * 8); break;
+        case 3: BlockAvx2<3, RELU>(w, bias, x, layer.numInputs, y + p0 * 8); break;
+        case 2: BlockAvx2<2, RELU>(w, bias, x, layer.numInputs, y + p0 * 8); break;
+        default: BlockAvx2<1, RELU>(w, bias, x, layer.numInputs, y + p0 * 8); break;
+        }
+        w += (size_t)panels * 8 * layer.numInputs;
+    }
+}
+
+// --- AVX-512 KERNEL (16-wide panels) ---
+template <int PANELS, bool RELU>
+static inline NN_TARGET_AVX512 void BlockAvx512(const float* w, const float* bias, const float* x, int n, float* y) {
+    __m512 acc[PANELS];
+    for (int p = 0; p < PANELS; p++) acc[p] = _mm512_load_ps(bias + 16 * p);
+
+    for (int i = 0; i < n; i++) {
+        __m512 xi = _mm512_set1_ps(x[i]);
+        for (int p = 0; p < PANELS; p++) acc[p] = _mm512_fmadd_ps(xi, _mm512_load_ps(w + 16 * p), acc[p]);
+        w += 16 * PANELS;
+    }
+
+    for (int p = 0; p < PANELS; p++) {
+        __m512 sum = acc[p];
+        if (RELU) sum = _mm512_max_ps(sum, _mm512_setzero_ps());
+        _mm512_store_ps(y + 16 * p, sum);
+    }
+}
+
+template <bool RELU>
+static NN_TARGET_AVX512 void LayerAvx512(const InferencePlan::PlanLayer& layer, const float* x, float* y) {
+    const float* w = layer.packed.data();
+    int numPanels = layer.paddedNeurons / 16;
+    for (int p0 = 0; p0 < numPanels; p0 += MAX_PANELS_AVX512) {
+        int panels = std::min(MAX_PANELS_AVX512, numPanels - p0);
+        const float* bias = &layer.biases[p0 * 16];
+        float* out = y + p0 * 16;
+        switch (panels) {
+        case 8: BlockAvx512<8, RELU>(w, bias, x, layer.numInputs, out); break;
+        case 7: BlockAvx512<7, RELU>(w, bias, x, layer.numInputs, out); break;
+        case 6: BlockAvx512<6, RELU>(w, bias, x, layer.numInputs, out); break;
+        case 5: BlockAvx512<5, RELU>(w, bias, x, layer.numInputs, out); break;
+        case 4: BlockAvx512<4, RELU>(w, bias, x, layer.numInputs, out); break;
+        case 3: BlockAvx512<3, RELU>(w, bias, x, layer.numInputs, out); break;
+        case 2: BlockAvx512<2, RELU>(w, bias, x, layer.numInputs, out); break;
+        default: BlockAvx512<1, RELU>(w, bias, x, layer.numInputs, out); break;
+        }
+        w += (size_t)panels * 16 * layer.numInputs;
+    }
+}
+
+#endif // NN_X86
+
+// --- COMPILE ---
+InferencePlan::InferencePlan(const Network& net) : InferencePlan(net, Simd().level) {}
+
+InferencePlan::InferencePlan(const Network& net, SimdLevel level) : panelWidth(0), kernels("none") {
+    if (!net.isDense()) {
+        std::cout << "error: an inference plan takes dense layers only, this network has convolution or pooling layers" << std::endl;
+        return;
+    }
+    if (SimdKernelsFor(level) == nullptr) level = SimdLevel::SCALAR;
+    int maxPanels = MAX_PANELS_NARROW;
+    panelWidth = 8;
+    kernels = "scalar";
+#ifdef NN_X86
+    if (level == SimdLevel::AVX512) {
+        panelWidth = 16;
+        maxPanels = MAX_PANELS_AVX512;
+        kernels = "avx512";
+    }
+    else if (level == SimdLevel::AVX2) {
+        kernels = "avx2";
+    }
+#endif
+
+    for (const Layer& src : net.layers) {
+        PlanLayer layer;
+        PackLayer(src, panelWidth, maxPanels, layer);
+
+        bool relu = src.actType == ActivationType::RELU;
+        layer.kernel = relu ? LayerScalar<true> : LayerScalar<false>;
+#ifdef NN_X86
+        if (level == SimdLevel::AVX512) layer.kernel = relu ? LayerAvx512<true> : LayerAvx512<false>;
+        else if (level == SimdLevel::AVX2) layer.kernel = relu ? LayerAvx2<true> : LayerAvx2<false>;
+#endif
+        layers.push_back(layer);
+    }
+}
+
+int InferencePlan::numInputs() const {
+    return layers.empty() ? 0 : layers.front().numInputs;
+}
+
+int InferencePlan::numOutputs() const {
+    return layers.empty() ? 0 : layers.back().numNeurons;
+}
+
+// --- RUN ---
+const float* InferencePlan::run(const float* inputs, PlanWorkspace& ws) const {
+    const SimdKernels& simd = Simd();
+    const float* x = inputs;
+
+    for (int i = 0; i < layers.size(); i++) {
+        const PlanLayer& layer = layers[i];
+        float* y = ws.outputs[i].data();
+        layer.kernel(layer, x, y);
+
+        // ReLU is already done inside the kernel; the others need the whole row
+        if (layer.actType == ActivationType::SOFTMAX) simd.softmax(y, layer.numNeurons);
+        else if (layer.actType == ActivationType::SIGMOID) simd.sigmoid(y, layer.numNeurons);
+        else if (layer.actType == ActivationType::TANH) simd.tanh(y, layer.numNeurons);
+        x = y;
+    }
+    return x;
+}
+
+PlanWorkspace::PlanWorkspace(const InferencePlan& plan) {
+    for (const InferencePlan::PlanLayer& layer : plan.layers) {
+        outputs.push_back(AlignedFloats(layer.paddedNeurons, 0.0f));
+    }
+}
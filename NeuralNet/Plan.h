@@ -0,0 +1,66 @@
+#pragma once
+#include <vector>
+#include "NeuNetCode.h"
+#include "AlignedAllocator.h"
+#include "Simd.h"
+
+typedef std::vector<float, AlignedAllocator<float>> AlignedFloats;
+
+// --- INFERENCE PLAN ---
+// A Network compiled for one-sample-at-a-time inference, where latency matters more than throughput
+// (the canvas re-scores on every mouse move).
+//
+// Compiling does everything that doesn't depend on the input once:
+//   - weights are repacked for the kernel: neurons in panels of one vector register each (16 on AVX-512,
+//     8 otherwise), a few panels per block, and inside a block all weights of input i are contiguous,
+//     so the inner loop is one broadcast of x[i] plus one FMA per panel, reading a single stream
+//   - the bias is the accumulators' starting value and ReLU is applied in registers before the store
+//   - each layer gets its kernel (SIMD level x fused activation) as a function pointer: no actType
+//     branches inside the loops
+// Plans are read-only once built; each thread passes its own PlanWorkspace.
+// Dense layers only: a Network with CONV2D or MAXPOOL layers gives an empty plan (numInputs() == 0).
+class PlanWorkspace;
+
+class InferencePlan {
+
+public:
+	struct PlanLayer;
+	typedef void (*LayerKernel)(const PlanLayer& layer, const float* inputs, float* outputs);
+
+	struct PlanLayer {
+		int numInputs;
+		int numNeurons;
+		int paddedNeurons;     // rounded up to whole panels; outputs has room for this many
+		ActivationType actType;
+		LayerKernel kernel;
+		AlignedFloats packed;  // per block: numInputs x (block panels x panel width)
+		AlignedFloats biases;  // paddedNeurons, zero padded
+	};
+
+	InferencePlan() : panelWidth(0), kernels("none") {}
+	explicit InferencePlan(const Network& net);
+	// Kernels of one specific SIMD level (falls back to scalar if this CPU can't run it)
+	InferencePlan(const Network& net, SimdLevel level);
+
+	// Output of the last layer (numOutputs() floats). Does not allocate.
+	const float* run(const float* inputs, PlanWorkspace& ws) const;
+
+	int numInputs() const;
+	int numOutputs() const;
+	const char* kernelName() const { return kernels; }
+
+	std::vector<PlanLayer> layers;
+
+private:
+	int panelWidth;
+	const char* kernels;
+};
+
+class PlanWorkspace {
+
+public:
+	PlanWorkspace() {}
+	PlanWorkspace(const InferencePlan& plan);
+
+	std::vector<AlignedFloats> outputs; // outputs[i] = paddedNeurons of layers[i]
+};
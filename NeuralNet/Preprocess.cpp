@@ -0,0 +1,463 @@
+#include "Preprocess.h"
+#include "SimdTargets.h"
+#include <cmath>
+#include <algorithm>
+
+// Pre-smoothed elastic fields per Augmenter (random flips and axis swaps make 8 distortions of each).
+// Smoothing a fresh field per image would cost more than the training step it feeds.
+static const int FIELD_BANK = 32;
+static const unsigned int FIELD_SEED = 20030101u;
+
+// --- MOMENTS ---
+// sums[0] = total weight, sums[1] = sum of x * weight, sums[2] = sum of y * weight (weight = max(pixel, 0))
+typedef void (*MomentsKernel)(const float* image, int width, int height, float* sums);
+
+static void MomentsScalar(const float* image, int width, int height, float* sums) {
+    float total = 0.0f, sumX = 0.0f, sumY = 0.0f;
+    for (int y = 0; y < height; y++) {
+        const float* row = image + (size_t)y * width;
+        float rowTotal = 0.0f;
+        for (int x = 0; x < width; x++) {
+            float v = std::max(row[x], 0.0f);
+            rowTotal += v;
+            sumX += x * v;
+        }
+        total += rowTotal;
+        sumY += y * rowTotal;
+    }
+    sums[0] = total;
+    sums[1] = sumX;
+    sums[2] = sumY;
+}
+
+#ifdef NN_X86
+
+static inline NN_TARGET_AVX2 float HorizontalSumAvx2(__m256 v) {
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+    return _mm_cvtss_f32(s);
+}
+
+// Lanes [0, remaining) of a maskload / maskstore
+static inline NN_TARGET_AVX2 __m256i TailMaskAvx2(int remaining) {
+    return _mm256_cmpgt_epi32(_mm256_set1_epi32(remaining), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+}
+
+static NN_TARGET_AVX2 void MomentsAvx2(const float* image, int width, int height, float* sums) {
+    const __m256 zero = _mm256_setzero_ps();
+    __m256 total = zero, sumX = zero, sumY = zero;
+    for (int y = 0; y < height; y++) {
+        const float* row = image + (size_t)y * width;
+        const __m256 ys = _mm256_set1_ps((float)y);
+        __m256 xs = _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7);
+        for (int x = 0; x < width; x += 8) {
+            __m256 v = (x + 8 <= width) ? _mm256_loadu_ps(row + x) : _mm256_maskload_ps(row + x, TailMaskAvx2(width - x));
+            v = _mm256_max_ps(v, zero);
+            total = _mm256_add_ps(total, v);
+            sumX = _mm256_fmadd_ps(v, xs, sumX);
+            sumY = _mm256_fmadd_ps(v, ys, sumY);
+            xs = _mm256_add_ps(xs, _mm256_set1_ps(8.0f));
+        }
+    }
+    sums[0] = HorizontalSumAvx2(total);
+    sums[1] = HorizontalSumAvx2(sumX);
+    sums[2] = HorizontalSumAvx2(sumY);
+}
+
+static NN_TARGET_AVX512 void MomentsAvx512(const float* image, int width, int height, float* sums) {
+    const __m512 zero = _mm512_setzero_ps();
+    __m512 total = zero, sumX = zero, sumY = zero;
+    for (int y = 0; y < height; y++) {
+        const float* row = image + (size_t)y * width;
+        const __m512 ys = _mm512_set1_ps((float)y);
+        __m512 xs = _mm512_setr_ps(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+        for (int x = 0; x < width; x += 16) {
+            __mmask16 mask = (x + 16 <= width) ? (__mmask16)0xFFFF : (__mmask16)((1u << (width - x)) - 1);
+            __m512 v = _mm512_max_ps(_mm512_maskz_loadu_ps(mask, row + x), zero);
+            total = _mm512_add_ps(total, v);
+            sumX = _mm512_fmadd_ps(v, xs, sumX);
+            sumY = _mm512_fmadd_ps(v, ys, sumY);
+            xs = _mm512_add_ps(xs, _mm512_set1_ps(16.0f));
+        }
+    }
+    sums[0] = _mm512_reduce_add_ps(total);
+    sums[1] = _mm512_reduce_add_ps(sumX);
+    sums[2] = _mm512_reduce_add_ps(sumY);
+}
+
+#endif // NN_X86
+
+static MomentsKernel MomentsFor(SimdLevel level) {
+#ifdef NN_X86
+    if (level == SimdLevel::AVX512) return MomentsAvx512;
+    if (level == SimdLevel::AVX2) return MomentsAvx2;
+#endif
+    return MomentsScalar;
+}
+
+// --- ELEMENTWISE ---
+// Plain loops, compiled once per target so each gets that target's vector width
+static NN_FORCE_INLINE void NormalizeBody(const unsigned char* pixels, int count, float scale, float offset, float* output) {
+    for (int i = 0; i < count; i++) output[i] = pixels[i] * scale + offset;
+}
+
+static NN_FORCE_INLINE void CopyPositiveBody(const float* src, int count, float* dst) {
+    for (int i = 0; i < count; i++) dst[i] = std::max(src[i], 0.0f);
+}
+
+typedef void (*NormalizeKernel)(const unsigned char* pixels, int count, float scale, float offset, float* output);
+typedef void (*CopyPositiveKernel)(const float* src, int count, float* dst);
+
+static void NormalizeGeneric(const unsigned char* pixels, int count, float scale, float offset, float* output) {
+    NormalizeBody(pixels, count, scale, offset, output);
+}
+static void CopyPositiveGeneric(const float* src, int count, float* dst) { CopyPositiveBody(src, count, dst); }
+
+#ifdef NN_X86
+static NN_TARGET_AVX2 void NormalizeAvx2(const unsigned char* pixels, int count, float scale, float offset, float* output) {
+    NormalizeBody(pixels, count, scale, offset, output);
+}
+static NN_TARGET_AVX2 void CopyPositiveAvx2(const float* src, int count, float* dst) { CopyPositiveBody(src, count, dst); }
+static NN_TARGET_AVX512 void NormalizeAvx512(const unsigned char* pixels, int count, float scale, float offset, float* output) {
+    NormalizeBody(pixels, count, scale, offset, output);
+}
+static NN_TARGET_AVX512 void CopyPositiveAvx512(const float* src, int count, float* dst) { CopyPositiveBody(src, count, dst); }
+#endif
+
+static NormalizeKernel NormalizeFor(SimdLevel level) {
+#ifdef NN_X86
+    if (level == SimdLevel::AVX512) return NormalizeAvx512;
+    if (level == SimdLevel::AVX2) return NormalizeAvx2;
+#endif
+    return NormalizeGeneric;
+}
+
+static CopyPositiveKernel CopyPositiveFor(SimdLevel level) {
+#ifdef NN_X86
+    if (level == SimdLevel::AVX512) return CopyPositiveAvx512;
+    if (level == SimdLevel::AVX2) return CopyPositiveAvx2;
+#endif
+    return CopyPositiveGeneric;
+}
+
+// --- CENTERING ---
+static bool CenterOfMassAt(SimdLevel level, const float* image, int width, int height, float& x, float& y) {
+    float sums[3];
+    MomentsFor(level)(image, width, height, sums);
+    if (!(sums[0] > 0.0f)) return false;
+    x = sums[1] / sums[0];
+    y = sums[2] / sums[0];
+    return true;
+}
+
+// Whole-pixel move that puts (x, y) on the pixel nearest the image center
+static void CenteringShift(float x, float y, int width, int height, int& shiftX, int& shiftY) {
+    shiftX = (int)std::floor(width * 0.5f - x + 0.5f);
+    shiftY = (int)std::floor(height * 0.5f - y + 0.5f);
+}
+
+static void CenterImageAt(SimdLevel level, const float* input, float* output, int width, int height) {
+    std::fill(output, output + (size_t)width * height, 0.0f);
+    float cx, cy;
+    if (!CenterOfMassAt(level, input, width, height, cx, cy)) return;
+
+    int shiftX, shiftY;
+    CenteringShift(cx, cy, width, height, shiftX, shiftY);
+    const int firstX = std::max(0, shiftX), endX = std::min(width, width + shiftX);
+    if (firstX >= endX) return;
+
+    CopyPositiveKernel copy = CopyPositiveFor(level);
+    for (int y = std::max(0, shiftY); y < std::min(height, height + shiftY); y++) {
+        copy(input + (size_t)(y - shiftY) * width + firstX - shiftX, endX - firstX, output + (size_t)y * width + firstX);
+    }
+}
+
+bool CenterOfMass(const float* image, int width, int height, float& x, float& y) {
+    return CenterOfMassAt(Simd().level, image, width, height, x, y);
+}
+
+void CenterImage(const float* input, float* output, int width, int height) {
+    CenterImageAt(Simd().level, input, output, width, height);
+}
+
+void NormalizePixels(const unsigned char* pixels, int count, float scale, float offset, float* output) {
+    NormalizeFor(Simd().level)(pixels, count, scale, offset, output);
+}
+
+void CenterGrid(float* inputGrid, float* outputGrid) {
+    CenterImage(inputGrid, outputGrid, 28, 28);
+}
+
+// --- WARP ---
+// output(x, y) = bilinear sample of the source at (ax * x + bx * y + cx + dx(x, y), ay * x + by * y + cy + dy(x, y)),
+// then * scale + offset. The source has a one-pixel zero border, and coordinates are clamped into it,
+// so a sample past the edge reads background without a bounds test per pixel.
+struct WarpParams {
+    const float* source; // (width + 2) x (height + 2)
+    int width;
+    int height;
+    float ax, bx, cx;
+    float ay, by, cy;
+    const float* dx; // width x height, or nullptr for none
+    const float* dy;
+    float scale;
+    float offset;
+};
+
+typedef void (*WarpKernel)(const WarpParams& p, float* output);
+
+static void WarpScalar(const WarpParams& p, float* output) {
+    const int paddedWidth = p.width + 2;
+    for (int y = 0; y < p.height; y++) {
+        for (int x = 0; x < p.width; x++) {
+            size_t i = (size_t)y * p.width + x;
+            float sx = p.ax * x + (p.bx * y + p.cx);
+            float sy = p.ay * x + (p.by * y + p.cy);
+            if (p.dx) {
+                sx += p.dx[i];
+                sy += p.dy[i];
+            }
+            sx = std::min(std::max(sx, -1.0f), (float)p.width);
+            sy = std::min(std::max(sy, -1.0f), (float)p.height);
+            float x0 = std::min(std::floor(sx), (float)(p.width - 1));
+            float y0 = std::min(std::floor(sy), (float)(p.height - 1));
+            float fx = sx - x0, fy = sy - y0;
+
+            const float* s = p.source + (size_t)((int)y0 + 1) * paddedWidth + (int)x0 + 1;
+            float top = s[0] + fx * (s[1] - s[0]);
+            float bottom = s[paddedWidth] + fx * (s[paddedWidth + 1] - s[paddedWidth]);
+            output[i] = (top + fy * (bottom - top)) * p.scale + p.offset;
+        }
+    }
+}
+
+#ifdef NN_X86
+
+static NN_TARGET_AVX2 void WarpAvx2(const WarpParams& p, float* output) {
+    const int paddedWidth = p.width + 2;
+    const __m256 low = _mm256_set1_ps(-1.0f);
+    const __m256 highX = _mm256_set1_ps((float)p.width), highY = _mm256_set1_ps((float)p.height);
+    const __m256 lastX = _mm256_set1_ps((float)(p.width - 1)), lastY = _mm256_set1_ps((float)(p.height - 1));
+    const __m256i stride = _mm256_set1_epi32(paddedWidth);
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256 ax = _mm256_set1_ps(p.ax), ay = _mm256_set1_ps(p.ay);
+    const __m256 scale = _mm256_set1_ps(p.scale), offset = _mm256_set1_ps(p.offset);
+
+    for (int y = 0; y < p.height; y++) {
+        const __m256 rowX = _mm256_set1_ps(p.bx * y + p.cx), rowY = _mm256_set1_ps(p.by * y + p.cy);
+        __m256 xs = _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7);
+        for (int x = 0; x < p.width; x += 8) {
+            const size_t i = (size_t)y * p.width + x;
+            const bool full = x + 8 <= p.width;
+            const __m256i mask = TailMaskAvx2(p.width - x);
+            __m256 sx = _mm256_fmadd_ps(ax, xs, rowX);
+            __m256 sy = _mm256_fmadd_ps(ay, xs, rowY);
+            if (p.dx) {
+                sx = _mm256_add_ps(sx, full ? _mm256_loadu_ps(p.dx + i) : _mm256_maskload_ps(p.dx + i, mask));
+                sy = _mm256_add_ps(sy, full ? _mm256_loadu_ps(p.dy + i) : _mm256_maskload_ps(p.dy + i, mask));
+            }
+            sx = _mm256_min_ps(_mm256_max_ps(sx, low), highX);
+            sy = _mm256_min_ps(_mm256_max_ps(sy, low), highY);
+            __m256 x0 = _mm256_min_ps(_mm256_floor_ps(sx), lastX);
+            __m256 y0 = _mm256_min_ps(_mm256_floor_ps(sy), lastY);
+            __m256 fx = _mm256_sub_ps(sx, x0), fy = _mm256_sub_ps(sy, y0);
+
+            // Every lane's coordinates are clamped, so even the lanes past the row end gather inside the source
+            __m256i index = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_add_epi32(_mm256_cvttps_epi32(y0), one), stride),
+                _mm256_add_epi32(_mm256_cvttps_epi32(x0), one));
+            __m256 s00 = _mm256_i32gather_ps(p.source, index, 4);
+            __m256 s01 = _mm256_i32gather_ps(p.source + 1, index, 4);
+            __m256 s10 = _mm256_i32gather_ps(p.source + paddedWidth, index, 4);
+            __m256 s11 = _mm256_i32gather_ps(p.source + paddedWidth + 1, index, 4);
+            __m256 top = _mm256_fmadd_ps(fx, _mm256_sub_ps(s01, s00), s00);
+            __m256 bottom = _mm256_fmadd_ps(fx, _mm256_sub_ps(s11, s10), s10);
+            __m256 v = _mm256_fmadd_ps(_mm256_fmadd_ps(fy, _mm256_sub_ps(bottom, top), top), scale, offset);
+
+            if (full) _mm256_storeu_ps(output + i, v);
+            else _mm256_maskstore_ps(output + i, mask, v);
+            xs = _mm256_add_ps(xs, _mm256_set1_ps(8.0f));
+        }
+    }
+}
+
+static NN_TARGET_AVX512 void WarpAvx512(const WarpParams& p, float* output) {
+    const int paddedWidth = p.width + 2;
+    const __m512 low = _mm512_set1_ps(-1.0f);
+    const __m512 highX = _mm512_set1_ps((float)p.width), highY = _mm512_set1_ps((float)p.height);
+    const __m512 lastX = _mm512_set1_ps((float)(p.width - 1)), lastY = _mm512_set1_ps((float)(p.height - 1));
+    const __m512i stride = _mm512_set1_epi32(paddedWidth);
+    const __m512i one = _mm512_set1_epi32(1);
+    const __m512 ax = _mm512_set1_ps(p.ax), ay = _mm512_set1_ps(p.ay);
+    const __m512 scale = _mm512_set1_ps(p.scale), offset = _mm512_set1_ps(p.offset);
+
+    for (int y = 0; y < p.height; y++) {
+        const __m512 rowX = _mm512_set1_ps(p.bx * y + p.cx), rowY = _mm512_set1_ps(p.by * y + p.cy);
+        __m512 xs = _mm512_setr_ps(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+        for (int x = 0; x < p.width; x += 16) {
+            const size_t i = (size_t)y * p.width + x;
+            const __mmask16 mask = (x + 16 <= p.width) ? (__mmask16)0xFFFF : (__mmask16)((1u << (p.width - x)) - 1);
+            __m512 sx = _mm512_fmadd_ps(ax, xs, rowX);
+            __m512 sy = _mm512_fmadd_ps(ay, xs, rowY);
+            if (p.dx) {
+                sx = _mm512_add_ps(sx, _mm512_maskz_loadu_ps(mask, p.dx + i));
+                sy = _mm512_add_ps(sy, _mm512_maskz_loadu_ps(mask, p.dy + i));
+            }
+            sx = _mm512_min_ps(_mm512_max_ps(sx, low), highX);
+            sy = _mm512_min_ps(_mm512_max_ps(sy, low), highY);
+            __m512 x0 = _mm512_min_ps(_mm512_roundscale_ps(sx, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC), lastX);
+            __m512 y0 = _mm512_min_ps(_mm512_roundscale_ps(sy, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC), lastY);
+            __m512 fx = _mm512_sub_ps(sx, x0), fy = _mm512_sub_ps(sy, y0);
+
+            __m512i index = _mm512_add_epi32(_mm512_mullo_epi32(_mm512_add_epi32(_mm512_cvttps_epi32(y0), one), stride),
+                _mm512_add_epi32(_mm512_cvttps_epi32(x0), one));
+            __m512 s00 = _mm512_mask_i32gather_ps(_mm512_setzero_ps(), mask, index, p.source, 4);
+            __m512 s01 = _mm512_mask_i32gather_ps(_mm512_setzero_ps(), mask, index, p.source + 1, 4);
+            __m512 s10 = _mm512_mask_i32gather_ps(_mm512_setzero_ps(), mask, index, p.source + paddedWidth, 4);
+            __m512 s11 = _mm512_mask_i32gather_ps(_mm512_setzero_ps(), mask, index, p.source + paddedWidth + 1, 4);
+            __m512 top = _mm512_fmadd_ps(fx, _mm512_sub_ps(s01, s00), s00);
+            __m512 bottom = _mm512_fmadd_ps(fx, _mm512_sub_ps(s11, s10), s10);
+            __m512 v = _mm512_fmadd_ps(_mm512_fmadd_ps(fy, _mm512_sub_ps(bottom, top), top), scale, offset);
+
+            _mm512_mask_storeu_ps(output + i, mask, v);
+            xs = _mm512_add_ps(xs, _mm512_set1_ps(16.0f));
+        }
+    }
+}
+
+#endif // NN_X86
+
+static WarpKernel WarpFor(SimdLevel level) {
+#ifdef NN_X86
+    if (level == SimdLevel::AVX512) return WarpAvx512;
+    if (level == SimdLevel::AVX2) return WarpAvx2;
+#endif
+    return WarpScalar;
+}
+
+// --- AUGMENTER ---
+Augmenter::Augmenter(const AugmentSettings& settings, int width, int height)
+    : Augmenter(settings, width, height, Simd().level) {}
+
+Augmenter::Augmenter(const AugmentSettings& settings, int width, int height, SimdLevel level)
+    : config(settings), width(width), height(height), level(SimdKernelsFor(level) ? level : SimdLevel::SCALAR) {
+    const size_t pixels = (size_t)width * height;
+    source.assign((size_t)(width + 2) * (height + 2), 0.0f);
+    unpadded.resize(pixels);
+    if (config.elasticAlpha > 0.0f) {
+        dx.resize(pixels);
+        dy.resize(pixels);
+        buildFieldBank();
+    }
+}
+
+// Simard's fields: uniform noise in [-1, 1] per pixel and axis, smoothed by a Gaussian of elasticSigma
+// (zero past the edges), then scaled by elasticAlpha when used
+void Augmenter::buildFieldBank() {
+    const size_t pixels = (size_t)width * height;
+    const int radius = std::max(1, (int)std::ceil(3.0f * config.elasticSigma));
+    std::vector<float> kernel(2 * radius + 1);
+    float total = 0.0f;
+    for (int k = -radius; k <= radius; k++) {
+        kernel[k + radius] = std::exp(-0.5f * k * k / (config.elasticSigma * config.elasticSigma));
+        total += kernel[k + radius];
+    }
+    for (float& k : kernel) k /= total;
+
+    std::mt19937 rng(FIELD_SEED); // the same bank in every Augmenter, so results don't depend on the thread
+    std::uniform_real_distribution<float> noise(-1.0f, 1.0f);
+    std::vector<float> raw(pixels), rows(pixels);
+    fieldBank.resize(FIELD_BANK * 2 * pixels);
+
+    for (int f = 0; f < 2 * FIELD_BANK; f++) {
+        for (float& v : raw) v = noise(rng);
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                float sum = 0.0f;
+                for (int k = std::max(-radius, -x); k <= std::min(radius, width - 1 - x); k++) sum += kernel[k + radius] * raw[(size_t)y * width + x + k];
+                rows[(size_t)y * width + x] = sum;
+            }
+        }
+        float* field = &fieldBank[f * pixels];
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                float sum = 0.0f;
+                for (int k = std::max(-radius, -y); k <= std::min(radius, height - 1 - y); k++) sum += kernel[k + radius] * rows[(size_t)(y + k) * width + x];
+                field[(size_t)y * width + x] = sum;
+            }
+        }
+    }
+}
+
+void Augmenter::apply(const unsigned char* pixels, float* output, std::mt19937& rng) {
+    const int pixelCount = width * height;
+
+    // 1. No randomness: center (or not) and normalize, exactly as CenterImage / NormalizePixels would
+    if (!config.randomized()) {
+        if (!config.center) {
+            NormalizeFor(level)(pixels, pixelCount, config.scale, config.offset, output);
+            return;
+        }
+        NormalizeFor(level)(pixels, pixelCount, config.scale, 0.0f, unpadded.data());
+        CenterImageAt(level, unpadded.data(), output, width, height);
+        if (config.offset != 0.0f) for (int i = 0; i < pixelCount; i++) output[i] += config.offset;
+        return;
+    }
+
+    // 2. The source image, unscaled, inside its zero border
+    NormalizeKernel widen = NormalizeFor(level);
+    for (int y = 0; y < height; y++) widen(pixels + (size_t)y * width, width, 1.0f, 0.0f, &source[(size_t)(y + 1) * (width + 2) + 1]);
+
+    int shiftX = 0, shiftY = 0;
+    float comX, comY;
+    if (config.center && CenterOfMassAt(level, source.data(), width + 2, height + 2, comX, comY)) {
+        CenteringShift(comX - 1.0f, comY - 1.0f, width, height, shiftX, shiftY);
+    }
+
+    // 3. The random map: output pixel d samples M^-1 (d - c - shift) + c - centering, M = zoom x rotation
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    const float moveX = config.maxShift * unit(rng), moveY = config.maxShift * unit(rng);
+    const float angle = config.maxRotation * unit(rng) * 3.14159265f / 180.0f;
+    const float zoom = 1.0f + config.maxScale * unit(rng);
+    const float c = std::cos(angle) / zoom, s = std::sin(angle) / zoom;
+    const float centerX = width * 0.5f, centerY = height * 0.5f;
+
+    WarpParams p;
+    p.source = source.data();
+    p.width = width;
+    p.height = height;
+    p.ax = c;
+    p.bx = s;
+    p.cx = centerX - shiftX - (c * (centerX + moveX) + s * (centerY + moveY));
+    p.ay = -s;
+    p.by = c;
+    p.cy = centerY - shiftY - (-s * (centerX + moveX) + c * (centerY + moveY));
+    p.dx = nullptr;
+    p.dy = nullptr;
+    p.scale = config.scale;
+    p.offset = config.offset;
+
+    // 4. A banked displacement field, each axis flipped at random and the two axes swapped at random
+    if (config.elasticAlpha > 0.0f) {
+        unsigned int pick = rng();
+        const float* fields = &fieldBank[(size_t)(pick % FIELD_BANK) * 2 * pixelCount];
+        const bool swap = (pick >> 8) & 1;
+        const float alphaX = ((pick >> 9) & 1) ? -config.elasticAlpha : config.elasticAlpha;
+        const float alphaY = ((pick >> 10) & 1) ? -config.elasticAlpha : config.elasticAlpha;
+        const float* fieldX = swap ? fields + pixelCount : fields;
+        const float* fieldY = swap ? fields : fields + pixelCount;
+        for (int i = 0; i < pixelCount; i++) {
+            dx[i] = alphaX * fieldX[i];
+            dy[i] = alphaY * fieldY[i];
+        }
+        p.dx = dx.data();
+        p.dy = dy.data();
+    }
+
+    WarpFor(level)(p, output);
+}
+
+void Augmenter::applyBatch(const unsigned char* pixels, int count, float* output, std::mt19937& rng) {
+    const size_t pixelCount = (size_t)width * height;
+    for (int n = 0; n < count; n++) apply(pixels + n * pixelCount, output + n * pixelCount, rng);
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include <vector>
+#include <random>
+#include "Simd.h"
+
+// --- CANVAS PREPROCESSING ---
+// Turns what the user drew into what the network was trained on (28x28 floats, 0.0 = black).
+
+// Moves the drawing so its center of mass sits on the grid center (14,14), by whole pixels (CenterImage).
+// Both grids are 784 floats; pixels shifted off the grid are dropped.
+void CenterGrid(float* inputGrid, float* outputGrid);
+
+// --- IMAGE PREPROCESSING ---
+// Single-channel float images, row by row, 0 = background. The inner loops are vectorized (AVX2 / AVX-512,
+// picked like Simd()), so the same code serves the GUI, the scorer and the training pipeline.
+
+// Center of mass of the positive pixels (the others weigh nothing); false for an image with none
+bool CenterOfMass(const float* image, int width, int height, float& x, float& y);
+
+// Moves the image by whole pixels so its center of mass lands on the pixel nearest (width / 2, height / 2).
+// A whole-pixel move is exact (no resampling), so a stroke added to the input only changes those pixels of
+// the output unless the rounded center itself moves. Pixels <= 0 become 0; pixels shifted off are dropped.
+void CenterImage(const float* input, float* output, int width, int height);
+
+// output = pixels * scale + offset, widened to float (PIXEL_SCALE, 0 gives the network's usual inputs)
+void NormalizePixels(const unsigned char* pixels, int count, float scale, float offset, float* output);
+
+// --- AUGMENTATION ---
+// Random distortions of training images, all resampled in one bilinear pass:
+//   shift, rotation and scale:  a random affine map around the image center (sub-pixel, never truncated)
+//   elastic distortion:         a smooth random displacement field (Simard et al. 2003), taken from a bank
+//                               of fields smoothed once up front, flipped and swapped at random
+//   centering:                  the rounded center-of-mass shift of CenterImage, folded into the same map
+// The output is normalized as NormalizePixels does. Everything random comes from the caller's generator,
+// so the same seed gives the same images whatever thread runs them.
+struct AugmentSettings {
+	AugmentSettings()
+		: center(false), maxShift(0.0f), maxRotation(0.0f), maxScale(0.0f), elasticAlpha(0.0f), elasticSigma(4.0f),
+		  scale(1.0f / 255.0f), offset(0.0f) {}
+
+	bool center;        // center of mass onto the image center first, as CenterGrid does for the canvas
+	float maxShift;     // pixels, uniform in [-maxShift, maxShift] on each axis
+	float maxRotation;  // degrees, uniform in [-maxRotation, maxRotation]
+	float maxScale;     // zoom uniform in [1 - maxScale, 1 + maxScale]
+	float elasticAlpha; // displacement field strength in pixels (Simard's alpha; 0 = off)
+	float elasticSigma; // smoothing of the displacement field in pixels
+	float scale;        // output = pixel * scale + offset
+	float offset;
+
+	// Whether anything random happens (otherwise an image only gets centered and normalized)
+	bool randomized() const { return maxShift > 0.0f || maxRotation > 0.0f || maxScale > 0.0f || elasticAlpha > 0.0f; }
+};
+
+// One thread's augmentation state: the settings, scratch images and the elastic field bank (no allocation
+// after construction). Not thread-safe; give every thread its own.
+class Augmenter {
+
+public:
+	Augmenter(const AugmentSettings& settings, int width, int height);
+	// Kernels of one specific SIMD level (falls back to scalar if this CPU can't run it)
+	Augmenter(const AugmentSettings& settings, int width, int height, SimdLevel level);
+
+	// pixels (width x height bytes) -> output (width x height floats)
+	void apply(const unsigned char* pixels, float* output, std::mt19937& rng);
+	// The same for count images stored back to back
+	void applyBatch(const unsigned char* pixels, int count, float* output, std::mt19937& rng);
+
+	const AugmentSettings& settings() const { return config; }
+	SimdLevel simdLevel() const { return level; }
+
+private:
+	void buildFieldBank();
+
+	AugmentSettings config;
+	int width;
+	int height;
+	SimdLevel level;
+
+	std::vector<float> source;     // (width + 2) x (height + 2): the image with a zero border to sample from
+	std::vector<float> unpadded;   // width x height: the scaled image before CenterImage
+	std::vector<float> fieldBank;  // FIELD_BANK fields of width x height dx values then width x height dy values
+	std::vector<float> dx;         // this image's displacement field
+	std::vector<float> dy;
+};
@@ -0,0 +1,400 @@
+#include "Profiler.h"
+#include <iostream>
+#include <iomanip>
+
+const char* ProfilePhaseName(ProfilePhase phase) {
+    switch (phase) {
+    case ProfilePhase::FORWARD: return "forward";
+    case ProfilePhase::OUTPUT_DELTAS: return "output_deltas";
+    case ProfilePhase::PROPAGATE: return "propagate";
+    case ProfilePhase::UPDATE: return "update";
+    case ProfilePhase::GRADIENTS: return "gradients";
+    case ProfilePhase::REDUCE: return "reduce";
+    case ProfilePhase::OPTIMIZER: return "optimizer";
+    default: return "?";
+    }
+}
+
+// --- REPORT ---
+double ProfileReport::totalSeconds() const {
+    double total = 0.0;
+    for (const ProfileEntry& e : entries) total += e.seconds;
+    return total;
+}
+
+void ProfileReport::print(std::ostream& out) const {
+    double total = totalSeconds();
+    out << "  " << std::left << std::setw(14) << "phase" << std::right << std::setw(6) << "layer" << std::setw(12) << "calls"
+        << std::setw(9) << "share" << std::setw(12) << "us/call" << std::setw(10) << "GFLOP/s" << std::setw(9) << "GB/s" << "\n";
+    out << std::fixed;
+    for (const ProfileEntry& e : entries) {
+        out << "  " << std::left << std::setw(14) << ProfilePhaseName(e.phase) << std::right << std::setw(6) << e.layer
+            << std::setw(12) << e.calls << std::setprecision(1) << std::setw(8) << (total > 0.0 ? 100.0 * e.seconds / total : 0.0) << "%"
+            << std::setprecision(3) << std::setw(12) << 1e6 * e.seconds / e.calls;
+        if (e.flops > 0.0 && e.seconds > 0.0) out << std::setprecision(2) << std::setw(10) << e.flops / e.seconds * 1e-9;
+        else out << std::setw(10) << "-";
+        if (e.bytes > 0.0 && e.seconds > 0.0) out << std::setprecision(2) << std::setw(9) << e.bytes / e.seconds * 1e-9;
+        else out << std::setw(9) << "-";
+        out << "\n";
+    }
+    out << std::setprecision(3) << "  " << total << " s in scopes, " << seconds << " s wall, " << threads << " threads\n";
+    if (hardware.available) {
+        out << "  " << hardware.cycles << " cycles, " << hardware.instructions << " instructions (IPC "
+            << std::setprecision(2) << (hardware.cycles ? (double)hardware.instructions / hardware.cycles : 0.0) << "), "
+            << hardware.cacheMisses << " LLC misses, " << hardware.branchMisses << " branch misses\n";
+    }
+    out << std::defaultfloat;
+}
+
+void ProfileReport::writeJson(std::ostream& out) const {
+    out << std::setprecision(9) << "{\"seconds\":" << seconds << ",\"scope_seconds\":" << totalSeconds() << ",\"threads\":" << threads
+        << ",\"entries\":[";
+    for (size_t i = 0; i < entries.size(); i++) {
+        const ProfileEntry& e = entries[i];
+        out << (i ? "," : "") << "{\"phase\":\"" << ProfilePhaseName(e.phase) << "\",\"layer\":" << e.layer << ",\"calls\":" << e.calls
+            << ",\"seconds\":" << e.seconds << ",\"flops\":" << e.flops << ",\"bytes\":" << e.bytes << "}";
+    }
+    out << "]";
+    if (hardware.available) {
+        out << ",\"hardware\":{\"cycles\":" << hardware.cycles << ",\"instructions\":" << hardware.instructions
+            << ",\"cache_misses\":" << hardware.cacheMisses << ",\"branch_misses\":" << hardware.branchMisses << "}";
+    }
+    out << "}\n" << std::defaultfloat;
+}
+
+#ifdef NEURALNET_PROFILE
+
+#include "SimdTargets.h"
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <fstream>
+#include <cstring>
+#if defined(NN_X86) && !defined(_MSC_VER)
+#include <x86intrin.h>
+#endif
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+// --- TICKS ---
+// rdtsc is ~20 cycles and, on every CPU of the last decade, runs at a constant rate whatever the clock
+// speed. Elsewhere the ticks are steady_clock nanoseconds.
+static unsigned long long Ticks() {
+#ifdef NN_X86
+    return __rdtsc();
+#else
+    return (unsigned long long)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// Measured once against steady_clock (20 ms), the first time a report needs it
+static double TicksPerSecond() {
+    static double rate = 0.0;
+    if (rate == 0.0) {
+#ifdef NN_X86
+        auto start = std::chrono::steady_clock::now();
+        unsigned long long first = Ticks();
+        double elapsed = 0.0;
+        while (elapsed < 0.02) elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        rate = (Ticks() - first) / elapsed;
+#else
+        rate = 1e9;
+#endif
+    }
+    return rate;
+}
+
+// --- PER-THREAD COUNTERS ---
+// Only the owning thread writes its counters, so an update is a plain load + store (no locked add).
+// They are atomics so report() can read them from another thread without a data race.
+typedef std::atomic<unsigned long long> Counter;
+
+static void Add(Counter& counter, unsigned long long value) {
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+struct TraceEvent {
+    unsigned char phase;
+    unsigned char layer;
+    unsigned long long start;
+    unsigned long long end;
+};
+
+enum { HW_CYCLES, HW_INSTRUCTIONS, HW_CACHE_MISSES, HW_BRANCH_MISSES, HW_COUNT };
+
+struct ThreadProfile {
+    ThreadProfile(int index) : index(index), tid(0), eventCount(0) {
+        for (int p = 0; p < (int)ProfilePhase::COUNT; p++) {
+            for (int l = 0; l < PROFILE_MAX_LAYERS; l++) {
+                calls[p][l].store(0);
+                ticks[p][l].store(0);
+                flops[p][l].store(0);
+                bytes[p][l].store(0);
+            }
+        }
+        for (int c = 0; c < HW_COUNT; c++) hardware[c] = -1;
+    }
+
+    int index; // trace thread id: 0 for the first thread that recorded, then 1, 2, ...
+    long tid;  // kernel thread id (Linux), for perf_event_open
+    Counter calls[(int)ProfilePhase::COUNT][PROFILE_MAX_LAYERS];
+    Counter ticks[(int)ProfilePhase::COUNT][PROFILE_MAX_LAYERS];
+    Counter flops[(int)ProfilePhase::COUNT][PROFILE_MAX_LAYERS];
+    Counter bytes[(int)ProfilePhase::COUNT][PROFILE_MAX_LAYERS];
+
+    std::vector<TraceEvent> events; // capacity set by startTrace()
+    std::atomic<int> eventCount;
+    int hardware[HW_COUNT];         // perf event file descriptors, -1 when not open
+};
+
+// Every thread that ever recorded. Profiles are never freed: a pool thread that exits leaves its
+// counters behind (a few KB), which keeps report() free of any thread-exit bookkeeping.
+struct Registry {
+    Registry() : tracing(false), traceCapacity(0), hardwareEnabled(false),
+        resetTime(std::chrono::steady_clock::now()), traceStart(0) {}
+
+    std::mutex mutex;
+    std::vector<ThreadProfile*> threads;
+    std::atomic<bool> tracing;
+    int traceCapacity;
+    bool hardwareEnabled;
+    std::chrono::steady_clock::time_point resetTime;
+    unsigned long long traceStart;
+};
+
+static Registry& GetRegistry() {
+    static Registry registry;
+    return registry;
+}
+
+#if defined(__linux__)
+static int OpenHardwareCounter(long tid, unsigned long long config) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = config;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, (pid_t)tid, -1, -1, 0);
+}
+
+// Opens what it can; a counter the CPU or the kernel refuses stays -1
+static bool OpenHardwareCounters(ThreadProfile& profile) {
+    const unsigned long long configs[HW_COUNT] = { PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES };
+    bool any = false;
+    for (int c = 0; c < HW_COUNT; c++) {
+        if (profile.hardware[c] < 0) profile.hardware[c] = OpenHardwareCounter(profile.tid, configs[c]);
+        any = any || profile.hardware[c] >= 0;
+    }
+    return any;
+}
+#endif
+
+// Called with the registry locked
+static void PrepareTrace(ThreadProfile& profile, const Registry& registry) {
+    if (registry.tracing.load() && (int)profile.events.size() < registry.traceCapacity) profile.events.resize(registry.traceCapacity);
+}
+
+static ThreadProfile& CurrentThread() {
+    static thread_local ThreadProfile* current = nullptr;
+    if (current) return *current;
+
+    Registry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    current = new ThreadProfile((int)registry.threads.size());
+#if defined(__linux__)
+    current->tid = (long)syscall(SYS_gettid);
+    if (registry.hardwareEnabled) OpenHardwareCounters(*current);
+#endif
+    PrepareTrace(*current, registry);
+    registry.threads.push_back(current);
+    return *current;
+}
+
+// --- PROFILER ---
+bool Profiler::compiledIn() { return true; }
+
+unsigned long long Profiler::now() { return Ticks(); }
+
+void Profiler::record(ProfilePhase phase, int layer, unsigned long long start, unsigned long long end, double flops, double bytes) {
+    ThreadProfile& profile = CurrentThread();
+    int p = (int)phase;
+    int l = (layer < PROFILE_MAX_LAYERS) ? layer : PROFILE_MAX_LAYERS - 1;
+    Add(profile.calls[p][l], 1);
+    Add(profile.ticks[p][l], end - start);
+    Add(profile.flops[p][l], (unsigned long long)flops);
+    Add(profile.bytes[p][l], (unsigned long long)bytes);
+
+    if (GetRegistry().tracing.load(std::memory_order_relaxed)) {
+        int n = profile.eventCount.load(std::memory_order_relaxed);
+        if (n < (int)profile.events.size()) {
+            TraceEvent& e = profile.events[n];
+            e.phase = (unsigned char)p;
+            e.layer = (unsigned char)l;
+            e.start = start;
+            e.end = end;
+            profile.eventCount.store(n + 1, std::memory_order_release);
+        }
+    }
+}
+
+void Profiler::reset() {
+    Registry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    for (ThreadProfile* profile : registry.threads) {
+        for (int p = 0; p < (int)ProfilePhase::COUNT; p++) {
+            for (int l = 0; l < PROFILE_MAX_LAYERS; l++) {
+                profile->calls[p][l].store(0, std::memory_order_relaxed);
+                profile->ticks[p][l].store(0, std::memory_order_relaxed);
+                profile->flops[p][l].store(0, std::memory_order_relaxed);
+                profile->bytes[p][l].store(0, std::memory_order_relaxed);
+            }
+        }
+#if defined(__linux__)
+        for (int c = 0; c < HW_COUNT; c++) {
+            if (profile->hardware[c] >= 0) ioctl(profile->hardware[c], PERF_EVENT_IOC_RESET, 0);
+        }
+#endif
+    }
+    registry.resetTime = std::chrono::steady_clock::now();
+}
+
+ProfileReport Profiler::report() {
+    Registry& registry = GetRegistry();
+    double tickSeconds = 1.0 / TicksPerSecond();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    ProfileReport report;
+    report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - registry.resetTime).count();
+
+    for (int p = 0; p < (int)ProfilePhase::COUNT; p++) {
+        for (int l = 0; l < PROFILE_MAX_LAYERS; l++) {
+            ProfileEntry e = { (ProfilePhase)p, l, 0, 0.0, 0.0, 0.0 };
+            for (ThreadProfile* profile : registry.threads) {
+                e.calls += profile->calls[p][l].load(std::memory_order_relaxed);
+                e.seconds += profile->ticks[p][l].load(std::memory_order_relaxed) * tickSeconds;
+                e.flops += (double)profile->flops[p][l].load(std::memory_order_relaxed);
+                e.bytes += (double)profile->bytes[p][l].load(std::memory_order_relaxed);
+            }
+            if (e.calls) report.entries.push_back(e);
+        }
+    }
+
+    for (ThreadProfile* profile : registry.threads) {
+        bool active = false;
+        for (int p = 0; p < (int)ProfilePhase::COUNT && !active; p++) {
+            for (int l = 0; l < PROFILE_MAX_LAYERS && !active; l++) active = profile->calls[p][l].load(std::memory_order_relaxed) != 0;
+        }
+        if (active) report.threads++;
+
+#if defined(__linux__)
+        unsigned long long* totals[HW_COUNT] = { &report.hardware.cycles, &report.hardware.instructions,
+            &report.hardware.cacheMisses, &report.hardware.branchMisses };
+        for (int c = 0; c < HW_COUNT; c++) {
+            unsigned long long value = 0;
+            if (profile->hardware[c] >= 0 && read(profile->hardware[c], &value, sizeof(value)) == (ssize_t)sizeof(value)) {
+                *totals[c] += value;
+                report.hardware.available = true;
+            }
+        }
+#endif
+    }
+    return report;
+}
+
+bool Profiler::enableHardwareCounters() {
+#if defined(__linux__)
+    CurrentThread(); // the calling thread counts too
+    Registry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.hardwareEnabled = true;
+    bool any = false;
+    for (ThreadProfile* profile : registry.threads) any = OpenHardwareCounters(*profile) || any;
+    if (!any) {
+        std::cout << "error: perf_event_open failed (" << std::strerror(errno)
+            << "); check /proc/sys/kernel/perf_event_paranoid" << std::endl;
+    }
+    return any;
+#else
+    std::cout << "error: hardware counters need Linux (perf_event_open)" << std::endl;
+    return false;
+#endif
+}
+
+void Profiler::startTrace(int maxEventsPerThread) {
+    Registry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.traceCapacity = (maxEventsPerThread > 0) ? maxEventsPerThread : 1;
+    registry.traceStart = Ticks();
+    registry.tracing.store(true);
+    for (ThreadProfile* profile : registry.threads) {
+        profile->eventCount.store(0);
+        PrepareTrace(*profile, registry);
+    }
+}
+
+void Profiler::stopTrace() {
+    GetRegistry().tracing.store(false);
+}
+
+bool Profiler::writeChromeTrace(const std::string& filename) {
+    std::ofstream out(filename);
+    if (!out.is_open()) {
+        std::cout << "error: cannot write " << filename << std::endl;
+        return false;
+    }
+
+    Registry& registry = GetRegistry();
+    double microsPerTick = 1e6 / TicksPerSecond();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    // Complete ("X") events: one per scope, on one row per thread
+    out << std::fixed << std::setprecision(3) << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first = true;
+    for (ThreadProfile* profile : registry.threads) {
+        int count = profile->eventCount.load(std::memory_order_acquire);
+        for (int i = 0; i < count; i++) {
+            const TraceEvent& e = profile->events[i];
+            if (e.start < registry.traceStart) continue;
+            out << (first ? "\n" : ",\n") << "{\"name\":\"" << ProfilePhaseName((ProfilePhase)e.phase) << " " << (int)e.layer
+                << "\",\"cat\":\"" << ProfilePhaseName((ProfilePhase)e.phase) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << profile->index
+                << ",\"ts\":" << (e.start - registry.traceStart) * microsPerTick << ",\"dur\":" << (e.end - e.start) * microsPerTick
+                << ",\"args\":{\"layer\":" << (int)e.layer << "}}";
+            first = false;
+        }
+    }
+    out << "\n]}\n";
+    return true;
+}
+
+#else
+
+// --- COMPILED OUT ---
+bool Profiler::compiledIn() { return false; }
+unsigned long long Profiler::now() { return 0; }
+void Profiler::record(ProfilePhase, int, unsigned long long, unsigned long long, double, double) {}
+void Profiler::reset() {}
+ProfileReport Profiler::report() { return ProfileReport(); }
+
+bool Profiler::enableHardwareCounters() {
+    std::cout << "error: built without NEURALNET_PROFILE" << std::endl;
+    return false;
+}
+
+void Profiler::startTrace(int) {}
+void Profiler::stopTrace() {}
+
+bool Profiler::writeChromeTrace(const std::string&) {
+    std::cout << "error: built without NEURALNET_PROFILE" << std::endl;
+    return false;
+}
+
+#endif
@@ -0,0 +1,133 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <ostream>
+
+// --- PROFILER ---
+// Where the time of a training or inference pass goes, per phase and per layer.
+//
+// The hot paths are marked with NN_PROFILE_SCOPE(phase, layer, flops, bytes): a scoped timer that adds
+// its elapsed time (TSC on x86, steady_clock elsewhere), one call, and the FLOPs and bytes the code in
+// the scope does to the counters of (phase, layer). Counters are per thread, so timing never takes a
+// lock or bounces a cache line; report() sums the threads.
+//
+// Built without NEURALNET_PROFILE (the default) every NN_PROFILE_* macro expands to nothing: no timer,
+// no counter, not even the arguments are evaluated. The Profiler functions still exist and report nothing,
+// so callers need no #ifdefs. Configure with -DNEURALNET_PROFILE=ON (CMake) or define NEURALNET_PROFILE
+// to build it in.
+//
+// Per epoch:   Profiler::reset(); ...train...; Profiler::report().print(std::cout);
+// Optional extras, both off until asked for:
+//   - hardware counters (cycles, instructions, cache and branch misses) via perf_event_open on Linux,
+//     per thread, read at report() time: enableHardwareCounters()
+//   - a timeline of every scope, written in Chrome's trace format (chrome://tracing, Perfetto): startTrace()
+//
+// reset(), report() and writeChromeTrace() read other threads' counters without stopping them:
+// call them between passes (e.g. between epochs), while no other thread is inside a scope.
+
+enum class ProfilePhase {
+	FORWARD,       // a layer's weighted sums and activation
+	OUTPUT_DELTAS, // error terms of the output layer
+	PROPAGATE,     // error terms pushed back through a layer (into the layer below)
+	UPDATE,        // weights and biases changed in place (per-sample SGD, batched SGD)
+	GRADIENTS,     // a layer's summed batch gradient (no update)
+	REDUCE,        // per-thread gradients summed together
+	OPTIMIZER,     // optimizer step on a slice of the parameters
+	COUNT
+};
+
+const char* ProfilePhaseName(ProfilePhase phase);
+
+const int PROFILE_MAX_LAYERS = 16; // deeper layers share the last slot
+
+// --- REPORT ---
+struct ProfileEntry {
+	ProfilePhase phase;
+	int layer;
+	unsigned long long calls;
+	double seconds;
+	double flops;
+	double bytes;
+};
+
+struct HardwareCounters {
+	HardwareCounters() : available(false), cycles(0), instructions(0), cacheMisses(0), branchMisses(0) {}
+
+	bool available;
+	unsigned long long cycles;
+	unsigned long long instructions;
+	unsigned long long cacheMisses;  // last-level cache misses
+	unsigned long long branchMisses;
+};
+
+struct ProfileReport {
+	ProfileReport() : seconds(0.0), threads(0) {}
+
+	double seconds;                    // wall time since the last reset()
+	int threads;                       // threads that recorded anything
+	std::vector<ProfileEntry> entries; // only (phase, layer) pairs that were hit, summed over threads
+	HardwareCounters hardware;
+
+	double totalSeconds() const;       // time inside all scopes, summed over threads
+
+	// A table: per entry, share of the total, calls, time per call, GFLOP/s and GB/s
+	void print(std::ostream& out) const;
+	// One JSON object on a single line (fits a JSON-lines log, one line per epoch)
+	void writeJson(std::ostream& out) const;
+};
+
+// --- PROFILER ---
+class Profiler {
+
+public:
+	// Whether this build has the instrumentation (NEURALNET_PROFILE)
+	static bool compiledIn();
+
+	static void reset();
+	static ProfileReport report();
+
+	// Opens the counters for every thread seen so far and every thread that records later.
+	// Prints why and returns false when the kernel does not allow it (or off Linux, or compiled out).
+	static bool enableHardwareCounters();
+
+	// Records every scope as a timeline event, up to maxEventsPerThread per thread, until stopTrace()
+	static void startTrace(int maxEventsPerThread = 1 << 20);
+	static void stopTrace();
+	static bool writeChromeTrace(const std::string& filename);
+
+	// Used by NN_PROFILE_SCOPE; the time is in ticks (see Ticks in Profiler.cpp)
+	static unsigned long long now();
+	static void record(ProfilePhase phase, int layer, unsigned long long start, unsigned long long end, double flops, double bytes);
+};
+
+#ifdef NEURALNET_PROFILE
+
+class ProfileScope {
+
+public:
+	ProfileScope(ProfilePhase phase, int layer, double flops, double bytes)
+		: phase(phase), layer(layer), flops(flops), bytes(bytes), start(Profiler::now()) {}
+	~ProfileScope() { Profiler::record(phase, layer, start, Profiler::now(), flops, bytes); }
+
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+	ProfilePhase phase;
+	int layer;
+	double flops;
+	double bytes;
+	unsigned long long start;
+};
+
+#define NN_PROFILE_CONCAT2(a, b) a##b
+#define NN_PROFILE_CONCAT(a, b) NN_PROFILE_CONCAT2(a, b)
+// Times the rest of the enclosing block
+#define NN_PROFILE_SCOPE(phase, layer, flops, bytes) \
+	ProfileScope NN_PROFILE_CONCAT(profileScope, __LINE__)(ProfilePhase::phase, (layer), (double)(flops), (double)(bytes))
+
+#else
+
+#define NN_PROFILE_SCOPE(phase, layer, flops, bytes) ((void)0)
+
+#endif
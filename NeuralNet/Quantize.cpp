@@ -0,0 +1,171 @@
+#include "Quantize.h"
+#include "Simd.h"
+#include <cmath>
+#include <iostream>
+
+static const int QUANT_MAX = 127;
+
+static int PadInputs(int numInputs) {
+    return (numInputs + INT8_K_ALIGN - 1) / INT8_K_ALIGN * INT8_K_ALIGN;
+}
+
+// Real value -> 0..127 step of 'scale'
+static inline unsigned char QuantizeActivation(float value, float invScale) {
+    // Branch-free so the loops over a whole layer vectorize
+    float q = value * invScale + 0.5f;
+    q = q < 0.0f ? 0.0f : q;
+    q = q > (float)QUANT_MAX ? (float)QUANT_MAX : q;
+    return (unsigned char)(int)q;
+}
+
+QuantizedWorkspace::QuantizedWorkspace(const QuantizedNetwork& net) {
+    int widest = 0;
+    for (const QuantizedLayer& layer : net.layers) {
+        inputs.push_back(std::vector<unsigned char>(layer.paddedInputs, 0));
+        if (layer.numNeurons > widest) widest = layer.numNeurons;
+    }
+    sums.assign(widest, 0);
+    outputs.assign(net.numOutputs(), 0.0f);
+}
+
+int QuantizedNetwork::numInputs() const {
+    return layers.empty() ? 0 : layers.front().numInputs;
+}
+
+int QuantizedNetwork::numOutputs() const {
+    return layers.empty() ? 0 : layers.back().numNeurons;
+}
+
+size_t QuantizedNetwork::modelBytes() const {
+    size_t bytes = 0;
+    for (const QuantizedLayer& layer : layers) {
+        bytes += (size_t)layer.numNeurons * layer.numInputs;            // int8 weights (without padding)
+        bytes += (layer.sumScales.size() + layer.biases.size()) * sizeof(float);
+    }
+    return bytes;
+}
+
+bool QuantizedNetwork::build(const Network& net, const float* calibrationInputs, int calibrationCount) {
+    if (net.layers.empty() || calibrationCount <= 0) {
+        std::cout << "error: quantization needs a network and at least one calibration sample" << std::endl;
+        return false;
+    }
+    if (!net.isDense()) {
+        std::cout << "error: int8 quantization takes dense layers only, this network has convolution or pooling layers" << std::endl;
+        return false;
+    }
+    for (int i = 0; i + 1 < net.layers.size(); i++) {
+        ActivationType type = net.layers[i].actType;
+        if (type != ActivationType::RELU && type != ActivationType::SIGMOID) {
+            std::cout << "error: hidden layer " << i << " can go negative, int8 inputs must be >= 0 (use RELU or SIGMOID)" << std::endl;
+            return false;
+        }
+    }
+
+    // 1. Calibration: the largest input each layer sees on the sample data
+    std::vector<float> maxInput(net.layers.size(), 0.0f);
+    const int chunk = 256;
+    BatchWorkspace bws(net, chunk);
+    for (int n = 0; n < calibrationCount; n += chunk) {
+        int count = (calibrationCount - n < chunk) ? calibrationCount - n : chunk;
+        const float* batch = &calibrationInputs[(size_t)n * net.numInputs()];
+
+        for (size_t i = 0; i < (size_t)count * net.numInputs(); i++) {
+            if (batch[i] < 0.0f) {
+                std::cout << "error: calibration input " << batch[i] << " is negative, int8 inputs must be >= 0" << std::endl;
+                return false;
+            }
+            if (batch[i] > maxInput[0]) maxInput[0] = batch[i];
+        }
+
+        net.feedForwardBatch(batch, count, bws);
+        for (int i = 0; i + 1 < net.layers.size(); i++) {
+            const std::vector<float>& act = bws.activations[i];
+            for (size_t k = 0; k < (size_t)count * net.layers[i].numNeurons; k++) {
+                if (act[k] > maxInput[i + 1]) maxInput[i + 1] = act[k];
+            }
+        }
+    }
+
+    // 2. Per-row int8 weights
+    std::vector<QuantizedLayer> quantized;
+    for (int i = 0; i < net.layers.size(); i++) {
+        const Layer& src = net.layers[i];
+        QuantizedLayer layer;
+        layer.numNeurons = src.numNeurons;
+        layer.numInputs = src.numInputs;
+        layer.paddedInputs = PadInputs(src.numInputs);
+        layer.actType = src.actType;
+        layer.inputScale = (maxInput[i] > 0.0f ? maxInput[i] : 1.0f) / QUANT_MAX;
+        layer.weights.assign((size_t)layer.numNeurons * layer.paddedInputs, 0);
+        layer.sumScales.resize(layer.numNeurons);
+        layer.biases.assign(src.biasData(), src.biasData() + src.numNeurons);
+
+        for (int j = 0; j < src.numNeurons; j++) {
+            const float* row = &src.weightData()[(size_t)j * src.numInputs];
+            float largest = 0.0f;
+            for (int k = 0; k < src.numInputs; k++) largest = std::fmax(largest, std::fabs(row[k]));
+            float weightScale = (largest > 0.0f ? largest : 1.0f) / QUANT_MAX;
+
+            signed char* q = &layer.weights[(size_t)j * layer.paddedInputs];
+            for (int k = 0; k < src.numInputs; k++) q[k] = (signed char)std::lround(row[k] / weightScale);
+            layer.sumScales[j] = weightScale * layer.inputScale;
+        }
+        quantized.push_back(layer);
+    }
+    layers.swap(quantized);
+
+    // 3. Raw pixels go straight to quantized inputs through a table
+    float invScale = 1.0f / layers[0].inputScale;
+    for (int p = 0; p < 256; p++) pixelTable[p] = QuantizeActivation(p * PIXEL_SCALE, invScale);
+    return true;
+}
+
+const std::vector<float>& QuantizedNetwork::feedForward(const float* inputs, QuantizedWorkspace& ws) const {
+    const QuantizedLayer& first = layers.front();
+    float invScale = 1.0f / first.inputScale;
+    unsigned char* q = ws.inputs[0].data();
+    for (int k = 0; k < first.numInputs; k++) q[k] = QuantizeActivation(inputs[k], invScale);
+
+    runLayers(ws);
+    return ws.outputs;
+}
+
+const std::vector<float>& QuantizedNetwork::feedForward(const unsigned char* pixels, QuantizedWorkspace& ws) const {
+    unsigned char* q = ws.inputs[0].data();
+    for (int k = 0; k < layers.front().numInputs; k++) q[k] = pixelTable[pixels[k]];
+
+    runLayers(ws);
+    return ws.outputs;
+}
+
+void QuantizedNetwork::runLayers(QuantizedWorkspace& ws) const {
+    const SimdKernels& simd = Simd();
+
+    for (int i = 0; i < layers.size(); i++) {
+        const QuantizedLayer& layer = layers[i];
+        int* sums = ws.sums.data();
+        simd.gemvU8S8(ws.inputs[i].data(), layer.weights.data(), layer.paddedInputs, layer.numNeurons, sums);
+
+        if (i + 1 < layers.size()) {
+            // Hidden layer: dequantize + bias + activation + requantize for the next layer, in one pass
+            unsigned char* next = ws.inputs[i + 1].data();
+            float invScale = 1.0f / layers[i + 1].inputScale;
+            for (int j = 0; j < layer.numNeurons; j++) {
+                float value = sums[j] * layer.sumScales[j] + layer.biases[j];
+                if (layer.actType == ActivationType::SIGMOID) value = 1.0f / (1.0f + std::exp(-value));
+                next[j] = QuantizeActivation(value, invScale); // also the ReLU: negatives clamp to 0
+            }
+        }
+        else {
+            // Output layer: stays in float
+            float* out = ws.outputs.data();
+            for (int j = 0; j < layer.numNeurons; j++) out[j] = sums[j] * layer.sumScales[j] + layer.biases[j];
+
+            if (layer.actType == ActivationType::TANH) simd.tanh(out, layer.numNeurons);
+            else if (layer.actType == ActivationType::RELU) simd.relu(out, layer.numNeurons);
+            else if (layer.actType == ActivationType::SIGMOID) simd.sigmoid(out, layer.numNeurons);
+            else if (layer.actType == ActivationType::SOFTMAX) simd.softmax(out, layer.numNeurons);
+        }
+    }
+}
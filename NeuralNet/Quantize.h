@@ -0,0 +1,69 @@
+#pragma once
+#include <vector>
+#include "NeuNetCode.h"
+
+// --- INT8 INFERENCE ---
+// Post-training quantization of a trained Network, for inference only.
+//
+//   weights:     int8, symmetric, one scale per row (neuron): w = weightScale[j] * q
+//   activations: 0..127, one scale per layer input, calibrated as the largest value seen on sample data
+//                (7 bits rather than 8, so the AVX2 pmaddubsw pair sums can't saturate)
+//   sums:        int32, then one multiply-add per neuron back to float, fused with bias + activation
+//                + requantization for the next layer
+//
+// Every layer's inputs must be non-negative, so hidden layers can be RELU or SIGMOID (not TANH)
+// and the network inputs must be >= 0 (pixels are). The output layer runs its activation in float.
+class QuantizedLayer {
+
+public:
+	int numNeurons;
+	int numInputs;
+	int paddedInputs;      // numInputs rounded up to INT8_K_ALIGN, padding weights are 0
+	ActivationType actType;
+	float inputScale;      // real value of one step of this layer's quantized inputs
+
+	std::vector<signed char> weights; // numNeurons x paddedInputs, row-major
+	std::vector<float> sumScales;     // weightScale[j] * inputScale: int32 sum -> real pre-activation
+	std::vector<float> biases;
+};
+
+class QuantizedNetwork;
+
+// Per-thread buffers for QuantizedNetwork::feedForward (allocated once)
+class QuantizedWorkspace {
+
+public:
+	QuantizedWorkspace() {}
+	QuantizedWorkspace(const QuantizedNetwork& net);
+
+	std::vector<std::vector<unsigned char>> inputs; // inputs[i] = quantized inputs of layers[i] (padded)
+	std::vector<int> sums;
+	std::vector<float> outputs;
+};
+
+class QuantizedNetwork {
+
+public:
+	QuantizedNetwork() : pixelTable() {}
+
+	// Quantizes net, calibrating activation ranges on calibrationCount samples
+	// (calibrationCount x net.numInputs() floats, row-major). Prints why and returns false if it can't.
+	bool build(const Network& net, const float* calibrationInputs, int calibrationCount);
+
+	// Output probabilities (numOutputs() floats). Does not allocate.
+	const std::vector<float>& feedForward(const float* inputs, QuantizedWorkspace& ws) const;
+	const std::vector<float>& feedForward(const unsigned char* pixels, QuantizedWorkspace& ws) const;
+
+	int numInputs() const;
+	int numOutputs() const;
+
+	// Bytes of weights, scales and biases (the fp32 equivalent is 4 bytes per weight and bias)
+	size_t modelBytes() const;
+
+	std::vector<QuantizedLayer> layers;
+
+private:
+	void runLayers(QuantizedWorkspace& ws) const;
+
+	unsigned char pixelTable[256]; // 8-bit pixel -> quantized first-layer input
+};
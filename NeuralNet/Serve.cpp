@@ -0,0 +1,696 @@
+#include "Serve.h"
+#include "Preprocess.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef int SocketLength;
+#else
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+typedef socklen_t SocketLength;
+#endif
+
+// --- SOCKETS ---
+#ifdef _WIN32
+
+typedef SOCKET NativeSocket;
+static const NativeSocket NO_SOCKET = INVALID_SOCKET;
+
+static bool StartSockets() {
+    static bool started = [] {
+        WSADATA data;
+        return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+    }();
+    if (!started) std::cout << "error: WSAStartup failed" << std::endl;
+    return started;
+}
+
+static void CloseNative(NativeSocket s) { closesocket(s); }
+static bool Interrupted() { return false; }
+static int PollNative(pollfd* fds, int timeoutMillis) { return WSAPoll(fds, 1, timeoutMillis); }
+static const int SEND_FLAGS = 0;
+static const int SHUTDOWN_BOTH = SD_BOTH;
+
+#else
+
+typedef int NativeSocket;
+static const NativeSocket NO_SOCKET = -1;
+
+static bool StartSockets() { return true; }
+static void CloseNative(NativeSocket s) { ::close(s); }
+static bool Interrupted() { return errno == EINTR; }
+static int PollNative(pollfd* fds, int timeoutMillis) { return poll(fds, 1, timeoutMillis); }
+#ifdef MSG_NOSIGNAL
+static const int SEND_FLAGS = MSG_NOSIGNAL; // a write to a closed peer fails instead of raising SIGPIPE
+#else
+static const int SEND_FLAGS = 0;
+#endif
+static const int SHUTDOWN_BOTH = SHUT_RDWR;
+
+#endif
+
+static NativeSocket Native(long long handle) { return handle == -1 ? NO_SOCKET : (NativeSocket)handle; }
+static long long Handle(NativeSocket s) { return s == NO_SOCKET ? -1 : (long long)s; }
+
+// Per-socket options: no Nagle delay (a response is one small write that should leave at once), and no
+// SIGPIPE where MSG_NOSIGNAL doesn't exist. Both fail harmlessly on Unix domain sockets.
+static void ConfigureSocket(NativeSocket s) {
+    int on = 1;
+    setsockopt(s, IPPROTO_TCP, TCP_NODELAY, (const char*)&on, sizeof(on));
+#ifdef SO_NOSIGPIPE
+    setsockopt(s, SOL_SOCKET, SO_NOSIGPIPE, (const char*)&on, sizeof(on));
+#endif
+}
+
+static std::string Describe(const ServeAddress& address) {
+    return address.socketPath.empty() ? "127.0.0.1:" + std::to_string(address.port) : address.socketPath;
+}
+
+Socket::Socket(Socket&& other) : handle(other.handle), boundPath(std::move(other.boundPath)) {
+    other.handle = -1;
+    other.boundPath.clear();
+}
+
+Socket& Socket::operator=(Socket&& other) {
+    if (this != &other) {
+        close();
+        handle = other.handle;
+        boundPath = std::move(other.boundPath);
+        other.handle = -1;
+        other.boundPath.clear();
+    }
+    return *this;
+}
+
+bool Socket::connect(const ServeAddress& address) {
+    close();
+    if (!StartSockets()) return false;
+
+    NativeSocket s = NO_SOCKET;
+    bool connected = false;
+    if (!address.socketPath.empty()) {
+#ifdef _WIN32
+        std::cout << "error: Unix domain sockets are not supported here, use a TCP port" << std::endl;
+        return false;
+#else
+        sockaddr_un addr = {};
+        addr.sun_family = AF_UNIX;
+        if (address.socketPath.size() >= sizeof(addr.sun_path)) {
+            std::cout << "error: socket path too long: " << address.socketPath << std::endl;
+            return false;
+        }
+        std::strcpy(addr.sun_path, address.socketPath.c_str());
+        s = socket(AF_UNIX, SOCK_STREAM, 0);
+        connected = s != NO_SOCKET && ::connect(s, (const sockaddr*)&addr, sizeof(addr)) == 0;
+#endif
+    }
+    else {
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons((unsigned short)address.port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        s = socket(AF_INET, SOCK_STREAM, 0);
+        connected = s != NO_SOCKET && ::connect(s, (const sockaddr*)&addr, sizeof(addr)) == 0;
+    }
+
+    if (!connected) {
+        std::cout << "error: cannot connect to " << Describe(address) << std::endl;
+        if (s != NO_SOCKET) CloseNative(s);
+        return false;
+    }
+    ConfigureSocket(s);
+    handle = Handle(s);
+    return true;
+}
+
+bool Socket::listen(const ServeAddress& address, int backlog) {
+    close();
+    if (!StartSockets()) return false;
+
+    NativeSocket s = NO_SOCKET;
+    bool bound = false;
+    if (!address.socketPath.empty()) {
+#ifdef _WIN32
+        std::cout << "error: Unix domain sockets are not supported here, use a TCP port" << std::endl;
+        return false;
+#else
+        sockaddr_un addr = {};
+        addr.sun_family = AF_UNIX;
+        if (address.socketPath.size() >= sizeof(addr.sun_path)) {
+            std::cout << "error: socket path too long: " << address.socketPath << std::endl;
+            return false;
+        }
+        std::strcpy(addr.sun_path, address.socketPath.c_str());
+
+        // A socket file left behind by a server that didn't exit cleanly would make bind fail; anything
+        // else at that path is left alone
+        struct stat info;
+        if (stat(address.socketPath.c_str(), &info) == 0) {
+            if (!S_ISSOCK(info.st_mode)) {
+                std::cout << "error: " << address.socketPath << " exists and is not a socket" << std::endl;
+                return false;
+            }
+            unlink(address.socketPath.c_str());
+        }
+
+        s = socket(AF_UNIX, SOCK_STREAM, 0);
+        bound = s != NO_SOCKET && bind(s, (const sockaddr*)&addr, sizeof(addr)) == 0;
+        if (bound) boundPath = address.socketPath;
+#endif
+    }
+    else {
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons((unsigned short)address.port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        s = socket(AF_INET, SOCK_STREAM, 0);
+#ifndef _WIN32
+        // Restarting right after a stop shouldn't wait out TIME_WAIT (on Windows this option would let
+        // another process take the port instead)
+        if (s != NO_SOCKET) {
+            int on = 1;
+            setsockopt(s, SOL_SOCKET, SO_REUSEADDR, (const char*)&on, sizeof(on));
+        }
+#endif
+        bound = s != NO_SOCKET && bind(s, (const sockaddr*)&addr, sizeof(addr)) == 0;
+    }
+
+    handle = Handle(s);
+    if (!bound || ::listen(s, backlog) != 0) {
+        std::cout << "error: cannot listen on " << Describe(address) << std::endl;
+        close();
+        return false;
+    }
+    return true;
+}
+
+Socket Socket::accept() const {
+    Socket connection;
+    NativeSocket s;
+    do {
+        s = ::accept(Native(handle), nullptr, nullptr);
+    } while (s == NO_SOCKET && Interrupted());
+    if (s != NO_SOCKET) {
+        ConfigureSocket(s);
+        connection.handle = Handle(s);
+    }
+    return connection;
+}
+
+bool Socket::waitReadable(int timeoutMillis) const {
+    pollfd fd = {};
+    fd.fd = Native(handle);
+    fd.events = POLLIN;
+    return PollNative(&fd, timeoutMillis) > 0;
+}
+
+bool Socket::readFull(void* data, size_t bytes) const {
+    char* at = (char*)data;
+    while (bytes > 0) {
+        int chunk = (int)std::min(bytes, (size_t)1 << 30);
+        int got = (int)recv(Native(handle), at, chunk, 0);
+        if (got <= 0) {
+            if (got < 0 && Interrupted()) continue;
+            return false;
+        }
+        at += got;
+        bytes -= got;
+    }
+    return true;
+}
+
+bool Socket::writeFull(const void* data, size_t bytes) const {
+    const char* at = (const char*)data;
+    while (bytes > 0) {
+        int chunk = (int)std::min(bytes, (size_t)1 << 30);
+        int sent = (int)send(Native(handle), at, chunk, SEND_FLAGS);
+        if (sent <= 0) {
+            if (sent < 0 && Interrupted()) continue;
+            return false;
+        }
+        at += sent;
+        bytes -= sent;
+    }
+    return true;
+}
+
+void Socket::shutdown() const {
+    if (handle != -1) ::shutdown(Native(handle), SHUTDOWN_BOTH);
+}
+
+void Socket::close() {
+    if (handle != -1) {
+        CloseNative(Native(handle));
+        handle = -1;
+    }
+#ifndef _WIN32
+    if (!boundPath.empty()) unlink(boundPath.c_str());
+#endif
+    boundPath.clear();
+}
+
+int Socket::localPort() const {
+    sockaddr_storage addr = {};
+    SocketLength length = sizeof(addr);
+    if (handle == -1 || getsockname(Native(handle), (sockaddr*)&addr, &length) != 0 || addr.ss_family != AF_INET) return 0;
+    return ntohs(((const sockaddr_in*)&addr)->sin_port);
+}
+
+// --- LATENCY HISTOGRAM ---
+// Bucket 0 holds everything under 1 us; bucket 1 + 4e + s holds [2^e (1 + s/4), 2^e (1 + (s+1)/4))
+static const int SUB_BUCKETS = 4;
+static const int OCTAVES = 32;
+static const int HISTOGRAM_BUCKETS = 1 + OCTAVES * SUB_BUCKETS;
+
+static int BucketOf(double micros) {
+    if (!(micros >= 1.0)) return 0;
+    int exponent;
+    double fraction = std::frexp(micros, &exponent); // micros = fraction * 2^exponent, fraction in [0.5, 1)
+    int octave = exponent - 1;
+    int sub = (int)((fraction * 2.0 - 1.0) * SUB_BUCKETS);
+    return std::min(1 + octave * SUB_BUCKETS + sub, HISTOGRAM_BUCKETS - 1);
+}
+
+static double BucketUpperEdge(int bucket) {
+    if (bucket == 0) return 1.0;
+    int octave = (bucket - 1) / SUB_BUCKETS;
+    int sub = (bucket - 1) % SUB_BUCKETS;
+    return std::ldexp(1.0 + (sub + 1.0) / SUB_BUCKETS, octave);
+}
+
+LatencyHistogram::LatencyHistogram() : buckets(HISTOGRAM_BUCKETS, 0), total(0), sum(0.0), largest(0.0) {}
+
+void LatencyHistogram::record(double micros) {
+    buckets[BucketOf(micros)]++;
+    total++;
+    sum += micros;
+    largest = std::max(largest, micros);
+}
+
+void LatencyHistogram::add(const LatencyHistogram& other) {
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++) buckets[i] += other.buckets[i];
+    total += other.total;
+    sum += other.sum;
+    largest = std::max(largest, other.largest);
+}
+
+double LatencyHistogram::percentile(double q) const {
+    if (total == 0) return 0.0;
+    long long rank = std::max(1LL, (long long)std::ceil(q * total));
+    long long seen = 0;
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        seen += buckets[i];
+        if (seen >= rank) return std::min(BucketUpperEdge(i), largest);
+    }
+    return largest;
+}
+
+void LatencyHistogram::print(std::ostream& out) const {
+    std::ios::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+    out << std::fixed << std::setprecision(1)
+        << total << " x, mean " << mean() << " us, p50 " << percentile(0.5) << ", p90 " << percentile(0.9)
+        << ", p99 " << percentile(0.99) << ", p99.9 " << percentile(0.999) << ", max " << max() << " us";
+    out.flags(flags);
+    out.precision(precision);
+}
+
+void LatencyHistogram::writeJson(std::ostream& out) const {
+    out << "{\"count\":" << total << ",\"mean_us\":" << mean() << ",\"p50_us\":" << percentile(0.5)
+        << ",\"p90_us\":" << percentile(0.9) << ",\"p99_us\":" << percentile(0.99) << ",\"p999_us\":" << percentile(0.999)
+        << ",\"max_us\":" << max() << ",\"buckets\":[";
+    bool first = true;
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        if (buckets[i] > 0) {
+            out << (first ? "" : ",") << "[" << BucketUpperEdge(i) << "," << buckets[i] << "]";
+            first = false;
+        }
+    }
+    out << "]}";
+}
+
+// --- INFERENCE SERVER ---
+void ServeStats::print(std::ostream& out) const {
+    std::ios::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+    out << std::fixed << std::setprecision(1)
+        << requests << " requests in " << seconds << " s (" << requestsPerSecond() << "/s), " << errors << " bad, "
+        << connections << " connections, model generation " << generation << std::endl
+        << "batches:     " << batches << ", mean size " << std::setprecision(2) << meanBatch() << std::endl
+        << "queue wait:  ";
+    queueMicros.print(out);
+    out << std::endl << "latency:     ";
+    latencyMicros.print(out);
+    out << std::endl;
+    out.flags(flags);
+    out.precision(precision);
+}
+
+void ServeStats::writeJson(std::ostream& out) const {
+    out << "{\"seconds\":" << seconds << ",\"requests\":" << requests << ",\"errors\":" << errors
+        << ",\"batches\":" << batches << ",\"connections\":" << connections << ",\"generation\":" << generation
+        << ",\"requests_per_second\":" << requestsPerSecond() << ",\"mean_batch\":" << meanBatch() << ",\"batch_sizes\":[";
+    bool first = true;
+    for (size_t n = 0; n < batchSizes.size(); n++) {
+        if (batchSizes[n] > 0) {
+            out << (first ? "" : ",") << "[" << n << "," << batchSizes[n] << "]";
+            first = false;
+        }
+    }
+    out << "],\"queue_us\":";
+    queueMicros.writeJson(out);
+    out << ",\"latency_us\":";
+    latencyMicros.writeJson(out);
+    out << "}";
+}
+
+struct InferenceServer::Connection {
+    Connection() : finished(false) {}
+
+    Socket socket;
+    std::mutex writeMutex;        // one response frame at a time, from the reader or any worker
+    std::atomic<bool> finished;   // its reader has returned and can be joined
+};
+
+static double Micros(std::chrono::steady_clock::duration d) {
+    return std::chrono::duration<double, std::micro>(d).count();
+}
+
+static void AppendFrame(std::vector<unsigned char>& frame, unsigned int id, ServeStatus status, const void* payload, unsigned int bytes) {
+    ServeResponseHeader header = { SERVE_RESPONSE_MAGIC, id, (unsigned int)status, bytes };
+    size_t at = frame.size();
+    frame.resize(at + sizeof(header) + bytes);
+    std::memcpy(&frame[at], &header, sizeof(header));
+    if (bytes > 0) std::memcpy(&frame[at + sizeof(header)], payload, bytes);
+}
+
+InferenceServer::InferenceServer(ModelSlot& models, const ServeSettings& settings)
+    : models(models), settings(settings), numInputs(0), numOutputs(0), stopping(false) {
+    this->settings.threads = std::max(1, settings.threads);
+    this->settings.maxBatch = std::max(1, settings.maxBatch);
+    this->settings.maxDelayMicros = std::max(0, settings.maxDelayMicros);
+}
+
+InferenceServer::~InferenceServer() {
+    stop();
+}
+
+bool InferenceServer::start(const ServeAddress& address) {
+    stop();
+    std::shared_ptr<const ReadOnlyModel> model = models.current();
+    if (!model || model->network().layers.empty()) {
+        std::cout << "error: no model to serve" << std::endl;
+        return false;
+    }
+    numInputs = model->network().numInputs();
+    numOutputs = model->network().numOutputs();
+    if (!listener.listen(address)) return false;
+
+    stopping = false;
+    started = std::chrono::steady_clock::now();
+    {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        totals = ServeStats();
+        totals.batchSizes.assign(settings.maxBatch + 1, 0);
+    }
+    for (int t = 0; t < settings.threads; t++) workers.emplace_back(&InferenceServer::workerLoop, this);
+    acceptor = std::thread(&InferenceServer::acceptLoop, this);
+    return true;
+}
+
+void InferenceServer::stop() {
+    if (!acceptor.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        stopping = true;
+    }
+    queueChanged.notify_all();
+    acceptor.join();
+
+    // No new readers from here on; waking the blocked ones ends them
+    std::vector<std::thread> finishing;
+    {
+        std::lock_guard<std::mutex> lock(connectionMutex);
+        for (const std::shared_ptr<Connection>& connection : connections) connection->socket.shutdown();
+        finishing.swap(readers);
+        connections.clear();
+    }
+    for (std::thread& reader : finishing) reader.join();
+    for (std::thread& worker : workers) worker.join();
+    workers.clear();
+    queue.clear();
+    listener.close();
+}
+
+ServeStats InferenceServer::stats() const {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    ServeStats copy = totals;
+    copy.generation = models.generation();
+    copy.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    return copy;
+}
+
+// Joins the readers whose connection has ended (connectionMutex held)
+void InferenceServer::reapReaders() {
+    for (size_t i = connections.size(); i-- > 0;) {
+        if (!connections[i]->finished) continue;
+        readers[i].join();
+        readers.erase(readers.begin() + i);
+        connections.erase(connections.begin() + i);
+    }
+}
+
+void InferenceServer::acceptLoop() {
+    while (!stopping) {
+        // Polled so stop() needn't rely on shutdown() waking accept, which not every platform does for
+        // a listening socket; a waiting connection still returns at once. A quiet poll joins the readers
+        // of closed connections, so they don't wait for the next connection or stop().
+        if (!listener.waitReadable(100)) {
+            std::lock_guard<std::mutex> lock(connectionMutex);
+            reapReaders();
+            continue;
+        }
+        Socket socket = listener.accept();
+        if (!socket.isOpen()) continue;
+
+        std::lock_guard<std::mutex> lock(connectionMutex);
+        if (stopping) return;
+        reapReaders();
+        std::shared_ptr<Connection> connection = std::make_shared<Connection>();
+        connection->socket = std::move(socket);
+        connections.push_back(connection);
+        readers.emplace_back(&InferenceServer::readLoop, this, connection);
+
+        std::lock_guard<std::mutex> statsLock(statsMutex);
+        totals.connections++;
+    }
+}
+
+void InferenceServer::readLoop(std::shared_ptr<Connection> connection) {
+    ServeRequestHeader header;
+    std::vector<unsigned char> payload;
+    std::vector<unsigned char> frame;
+
+    while (connection->socket.readFull(&header, sizeof(header))) {
+        if (header.magic != SERVE_REQUEST_MAGIC || header.bytes > SERVE_MAX_PAYLOAD) break;
+        payload.resize(header.bytes);
+        if (header.bytes > 0 && !connection->socket.readFull(payload.data(), header.bytes)) break;
+
+        Request request;
+        request.connection = connection;
+        request.id = header.id;
+        request.arrived = std::chrono::steady_clock::now();
+        if (header.type == (unsigned int)ServeRequestType::PIXELS && header.bytes == (unsigned int)numInputs) {
+            request.inputs.resize(numInputs);
+            NormalizePixels(payload.data(), numInputs, PIXEL_SCALE, 0.0f, request.inputs.data());
+        }
+        else if (header.type == (unsigned int)ServeRequestType::FLOATS && header.bytes == numInputs * sizeof(float)) {
+            request.inputs.resize(numInputs);
+            std::memcpy(request.inputs.data(), payload.data(), header.bytes);
+        }
+        else {
+            // Answered here on the reader: statistics, or the status of a request no batch could run
+            frame.clear();
+            if (header.type == (unsigned int)ServeRequestType::STATS && header.bytes == 0) {
+                std::ostringstream json;
+                stats().writeJson(json);
+                std::string text = json.str();
+                AppendFrame(frame, header.id, ServeStatus::OK, text.data(), (unsigned int)text.size());
+            }
+            else {
+                AppendFrame(frame, header.id, ServeStatus::BAD_REQUEST, nullptr, 0);
+                std::lock_guard<std::mutex> lock(statsMutex);
+                totals.errors++;
+            }
+            std::lock_guard<std::mutex> lock(connection->writeMutex);
+            if (!connection->socket.writeFull(frame.data(), frame.size())) break;
+            continue;
+        }
+
+        // Wake a worker when the queue starts a new budget or fills a batch; in between, the worker already
+        // waiting on the oldest request's deadline picks these up with it
+        bool wake;
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            if (stopping) break;
+            queue.push_back(std::move(request));
+            wake = queue.size() == 1 || queue.size() >= (size_t)settings.maxBatch;
+        }
+        if (wake) queueChanged.notify_one();
+    }
+
+    connection->socket.shutdown();
+    connection->finished = true;
+}
+
+// Whether ws was built for a network of this shape (a reload may change the hidden layers)
+static bool WorkspaceFits(const BatchWorkspace& ws, const Network& net) {
+    if (ws.activations.size() != net.layers.size()) return false;
+    for (size_t i = 0; i < net.layers.size(); i++) {
+        if (ws.activations[i].size() != (size_t)ws.maxBatch * net.layers[i].numNeurons) return false;
+    }
+    return true;
+}
+
+void InferenceServer::workerLoop() {
+    typedef std::chrono::steady_clock Clock;
+    const std::chrono::microseconds budget(settings.maxDelayMicros);
+
+    BatchWorkspace ws;
+    std::vector<float> inputs((size_t)settings.maxBatch * numInputs);
+    std::vector<Request> batch;
+    batch.reserve(settings.maxBatch);
+    std::vector<double> latencies(settings.maxBatch);
+    std::vector<bool> written(settings.maxBatch);
+    std::vector<unsigned char> frames;
+
+    std::unique_lock<std::mutex> lock(queueMutex);
+    while (true) {
+        while (!stopping && queue.empty()) queueChanged.wait(lock);
+        // Until the batch is full or the oldest request's budget runs out. The oldest can change while
+        // waiting (another worker took it), so the deadline is read again every time around.
+        while (!stopping && !queue.empty() && queue.size() < (size_t)settings.maxBatch) {
+            Clock::time_point deadline = queue.front().arrived + budget;
+            if (Clock::now() >= deadline) break;
+            queueChanged.wait_until(lock, deadline);
+        }
+        if (stopping) return;
+        if (queue.empty()) continue;
+
+        int count = (int)std::min(queue.size(), (size_t)settings.maxBatch);
+        for (int i = 0; i < count; i++) {
+            batch.push_back(std::move(queue.front()));
+            queue.pop_front();
+        }
+        bool more = !queue.empty();
+        lock.unlock();
+        if (more) queueChanged.notify_one(); // the rest start their budget with another worker
+
+        Clock::time_point taken = Clock::now();
+        for (int i = 0; i < count; i++) std::memcpy(&inputs[(size_t)i * numInputs], batch[i].inputs.data(), numInputs * sizeof(float));
+        // This batch's snapshot: it keeps its model (and mapping) alive to the end, even if a reload
+        // publishes another one meanwhile
+        std::shared_ptr<const ReadOnlyModel> model = models.current();
+        const Network& net = model->network();
+        if (!WorkspaceFits(ws, net)) ws = BatchWorkspace(net, settings.maxBatch);
+        const float* outputs = net.feedForwardBatch(inputs.data(), count, ws);
+
+        // Counted before any response goes out, so a client's STATS sent after its answer includes it
+        {
+            std::lock_guard<std::mutex> statsLock(statsMutex);
+            totals.requests += count;
+            totals.batches++;
+            totals.batchSizes[count]++;
+            for (int i = 0; i < count; i++) totals.queueMicros.record(Micros(taken - batch[i].arrived));
+        }
+
+        // One write per connection: its responses in this batch go out back to back
+        std::fill(written.begin(), written.end(), false);
+        for (int i = 0; i < count; i++) {
+            if (written[i]) continue;
+            Connection* connection = batch[i].connection.get();
+            frames.clear();
+            for (int j = i; j < count; j++) {
+                if (written[j] || batch[j].connection.get() != connection) continue;
+                AppendFrame(frames, batch[j].id, ServeStatus::OK, outputs + (size_t)j * numOutputs, numOutputs * sizeof(float));
+            }
+            {
+                std::lock_guard<std::mutex> writeLock(connection->writeMutex);
+                connection->socket.writeFull(frames.data(), frames.size());
+            }
+            Clock::time_point done = Clock::now();
+            for (int j = i; j < count; j++) {
+                if (!written[j] && batch[j].connection.get() == connection) {
+                    latencies[j] = Micros(done - batch[j].arrived);
+                    written[j] = true;
+                }
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> statsLock(statsMutex);
+            for (int i = 0; i < count; i++) totals.latencyMicros.record(latencies[i]);
+        }
+
+        batch.clear();
+        lock.lock();
+    }
+}
+
+// --- CLIENT ---
+bool ServeClient::connect(const ServeAddress& address) {
+    return socket.connect(address);
+}
+
+bool ServeClient::send(unsigned int id, ServeRequestType type, const void* payload, unsigned int bytes) {
+    ServeRequestHeader header = { SERVE_REQUEST_MAGIC, id, (unsigned int)type, bytes };
+    buffer.resize(sizeof(header) + bytes);
+    std::memcpy(buffer.data(), &header, sizeof(header));
+    if (bytes > 0) std::memcpy(buffer.data() + sizeof(header), payload, bytes);
+    return socket.writeFull(buffer.data(), buffer.size());
+}
+
+bool ServeClient::receive(ServeResponseHeader& header, std::vector<unsigned char>& payload) {
+    if (!socket.readFull(&header, sizeof(header)) || header.magic != SERVE_RESPONSE_MAGIC || header.bytes > SERVE_MAX_PAYLOAD) return false;
+    payload.resize(header.bytes);
+    return header.bytes == 0 || socket.readFull(payload.data(), header.bytes);
+}
+
+bool ServeClient::predict(const unsigned char* pixels, int numInputs, std::vector<float>& outputs) {
+    unsigned int id = nextId++;
+    ServeResponseHeader header;
+    if (!send(id, ServeRequestType::PIXELS, pixels, numInputs) || !receive(header, buffer) || header.id != id
+        || header.status != (unsigned int)ServeStatus::OK) {
+        return false;
+    }
+    outputs.resize(header.bytes / sizeof(float));
+    std::memcpy(outputs.data(), buffer.data(), outputs.size() * sizeof(float));
+    return true;
+}
+
+bool ServeClient::stats(std::string& json) {
+    unsigned int id = nextId++;
+    ServeResponseHeader header;
+    if (!send(id, ServeRequestType::STATS, nullptr, 0) || !receive(header, buffer) || header.id != id
+        || header.status != (unsigned int)ServeStatus::OK) {
+        return false;
+    }
+    json.assign(buffer.begin(), buffer.end());
+    return true;
+}
@@ -0,0 +1,239 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <ostream>
+#include "NeuNetCode.h"
+#include "ModelFile.h"
+
+// --- SERVE PROTOCOL ---
+// Length-prefixed binary frames over a stream socket (a Unix domain socket, or TCP on 127.0.0.1), in host
+// byte order: the server is for processes on the same machine.
+//
+//   request:   ServeRequestHeader, then 'bytes' of payload
+//                PIXELS  numInputs 8-bit pixels (scaled by PIXEL_SCALE, as the scoring tools do)
+//                FLOATS  numInputs floats
+//                STATS   no payload; the response is the server's ServeStats as one JSON object
+//   response:  ServeResponseHeader, then 'bytes' of payload: numOutputs floats (the output layer's
+//              probabilities), the JSON text, or nothing for an error status
+// A client may send many requests before reading a response. Responses carry the request's id and can
+// come back in any order; a malformed header (wrong magic, payload over SERVE_MAX_PAYLOAD) closes the connection.
+enum class ServeRequestType : unsigned int { PIXELS = 1, FLOATS = 2, STATS = 3 };
+enum class ServeStatus : unsigned int { OK = 0, BAD_REQUEST = 1 };
+
+const unsigned int SERVE_REQUEST_MAGIC = 0x51524E4E;  // "NNRQ"
+const unsigned int SERVE_RESPONSE_MAGIC = 0x53524E4E; // "NNRS"
+const unsigned int SERVE_MAX_PAYLOAD = 1u << 24;
+
+struct ServeRequestHeader {
+	unsigned int magic;
+	unsigned int id;
+	unsigned int type;  // ServeRequestType
+	unsigned int bytes; // payload size
+};
+
+struct ServeResponseHeader {
+	unsigned int magic;
+	unsigned int id;
+	unsigned int status; // ServeStatus
+	unsigned int bytes;  // payload size
+};
+
+// --- SOCKETS ---
+// Where a server listens or a client connects
+struct ServeAddress {
+	ServeAddress() : port(0) {}
+
+	std::string socketPath; // non-empty: a Unix domain socket (not on Windows)
+	int port;               // otherwise TCP on 127.0.0.1; listening on 0 picks a free port
+};
+
+// A blocking stream socket, closed on destruction. Failures print why, except reads and writes
+// (a peer going away is normal there).
+class Socket {
+
+public:
+	Socket() : handle(-1) {}
+	~Socket() { close(); }
+
+	Socket(Socket&& other);
+	Socket& operator=(Socket&& other);
+	Socket(const Socket&) = delete;
+	Socket& operator=(const Socket&) = delete;
+
+	bool connect(const ServeAddress& address);
+	bool listen(const ServeAddress& address, int backlog = 64);
+	// The next connection (a closed Socket on an error)
+	Socket accept() const;
+	// Whether a connection or data arrives within timeoutMillis
+	bool waitReadable(int timeoutMillis) const;
+
+	// false at end of stream or on an error
+	bool readFull(void* data, size_t bytes) const;
+	bool writeFull(const void* data, size_t bytes) const;
+
+	// Ends both directions of a connection, waking a thread blocked in readFull on it
+	void shutdown() const;
+	void close();
+
+	bool isOpen() const { return handle != -1; }
+	int localPort() const; // TCP port this socket is bound to
+
+private:
+	long long handle;       // int fd, or SOCKET on Windows
+	std::string boundPath;  // Unix socket file this listening socket created (removed on close)
+};
+
+// --- LATENCY HISTOGRAM ---
+// Counts of microsecond values in log-spaced buckets, 4 per power of two (neighbouring bucket edges are
+// 19% apart) from 1 us up to about 70 minutes. Percentiles read back as the upper edge of their bucket.
+class LatencyHistogram {
+
+public:
+	LatencyHistogram();
+
+	void record(double micros);
+	void add(const LatencyHistogram& other);
+
+	long long count() const { return total; }
+	double mean() const { return total ? sum / total : 0.0; }
+	double max() const { return largest; }
+	double percentile(double q) const;
+
+	// count, mean, p50, p90, p99, p99.9 and max on one line
+	void print(std::ostream& out) const;
+	// The same as a JSON object, plus the non-empty buckets as [upper edge, count] pairs
+	void writeJson(std::ostream& out) const;
+
+private:
+	std::vector<long long> buckets;
+	long long total;
+	double sum;
+	double largest;
+};
+
+// --- INFERENCE SERVER ---
+struct ServeSettings {
+	ServeSettings() : threads(1), maxBatch(64), maxDelayMicros(500) {}
+
+	int threads;        // workers, each running whole batches through its own BatchWorkspace
+	int maxBatch;       // requests per forward pass at most
+	int maxDelayMicros; // latency budget: how long the oldest queued request may wait for its batch to fill
+};
+
+struct ServeStats {
+	ServeStats() : seconds(0.0), requests(0), errors(0), batches(0), connections(0), generation(0) {}
+
+	double seconds;        // since the server started
+	long long requests;    // answered with probabilities
+	long long errors;      // answered BAD_REQUEST
+	long long batches;     // forward passes
+	long long connections; // accepted so far
+	long long generation;  // models published to the server's ModelSlot (> 1 after a hot reload)
+	LatencyHistogram queueMicros;   // request read -> taken into a batch
+	LatencyHistogram latencyMicros; // request read -> response written (recorded just after the write, so it can trail requests)
+	std::vector<long long> batchSizes; // batchSizes[n] = forward passes over n requests
+
+	double requestsPerSecond() const { return seconds > 0.0 ? requests / seconds : 0.0; }
+	double meanBatch() const { return batches ? (double)requests / batches : 0.0; }
+
+	void print(std::ostream& out) const;
+	void writeJson(std::ostream& out) const;
+};
+
+// Answers PIXELS / FLOATS requests with the network's outputs, coalescing requests that arrive close
+// together into one feedForwardBatch.
+//
+// One thread accepts connections and one reads each connection, appending its requests to a shared queue.
+// A free worker takes the queue's oldest requests once maxBatch of them are waiting or the oldest has waited
+// maxDelayMicros, whichever comes first, runs them as one batch and writes every response itself. So a lone
+// request waits at most the budget, and under load the batches fill up and the budget is never reached.
+//
+// The model comes from a ModelSlot, which must outlive the server. Each batch runs on the slot's current
+// model, taken when the batch starts, so a reload (ModelSlot::reload) takes effect from the next batch on
+// without holding up the one in flight.
+class InferenceServer {
+
+public:
+	InferenceServer(ModelSlot& models, const ServeSettings& settings);
+	~InferenceServer();
+
+	InferenceServer(const InferenceServer&) = delete;
+	InferenceServer& operator=(const InferenceServer&) = delete;
+
+	// Listens and starts the threads. Prints why and returns false if the address can't be bound
+	// or the slot is empty.
+	bool start(const ServeAddress& address);
+	// Closes every connection and joins the threads; queued requests are dropped
+	void stop();
+
+	int boundPort() const { return listener.localPort(); }
+	ServeStats stats() const;
+
+private:
+	struct Connection;
+	struct Request {
+		std::shared_ptr<Connection> connection;
+		unsigned int id;
+		std::chrono::steady_clock::time_point arrived; // when its last byte was read
+		std::vector<float> inputs;                     // numInputs, already scaled
+	};
+
+	void acceptLoop();
+	void readLoop(std::shared_ptr<Connection> connection);
+	void workerLoop();
+	void reapReaders();
+
+	ModelSlot& models;
+	ServeSettings settings;
+	int numInputs;  // of the model at start(); reloads keep them (ModelSlot::reload)
+	int numOutputs;
+	Socket listener;
+	std::chrono::steady_clock::time_point started;
+
+	std::thread acceptor;
+	std::vector<std::thread> workers;
+	std::mutex connectionMutex;
+	std::vector<std::shared_ptr<Connection>> connections;
+	std::vector<std::thread> readers; // readers[i] reads connections[i]
+
+	std::mutex queueMutex;
+	std::condition_variable queueChanged;
+	std::deque<Request> queue;
+	std::atomic<bool> stopping;
+
+	mutable std::mutex statsMutex;
+	ServeStats totals;
+};
+
+// --- CLIENT ---
+// One blocking connection to an InferenceServer, for one thread at a time
+class ServeClient {
+
+public:
+	ServeClient() : nextId(0) {}
+
+	bool connect(const ServeAddress& address);
+	void close() { socket.close(); }
+
+	// Sends one request without waiting for the response
+	bool send(unsigned int id, ServeRequestType type, const void* payload, unsigned int bytes);
+	// Waits for the next response; payload gets its header.bytes bytes
+	bool receive(ServeResponseHeader& header, std::vector<unsigned char>& payload);
+
+	// One PIXELS request and its response: outputs gets the probabilities. false on an error status too.
+	bool predict(const unsigned char* pixels, int numInputs, std::vector<float>& outputs);
+	// The server's statistics as JSON
+	bool stats(std::string& json);
+
+private:
+	Socket socket;
+	unsigned int nextId;
+	std::vector<unsigned char> buffer;
+};
@@ -0,0 +1,1293 @@
+// getenv() is fine here, we only read one optional setting
+#define _CRT_SECURE_NO_WARNINGS
+#include "Simd.h"
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+
+#include "SimdTargets.h"
+#if defined(NN_X86) && !defined(_MSC_VER)
+#include <cpuid.h>
+#endif
+
+// --- EXP CONSTANTS (Cephes expf) ---
+static const float EXP_HI = 88.3762626647949f;
+static const float EXP_LO = -87.3365447505531f;
+static const float LOG2E = 1.44269504088896341f;
+static const float LN2_HI = 0.693359375f;
+static const float LN2_LO = -2.12194440e-4f;
+static const float EXP_P0 = 1.9875691500E-4f;
+static const float EXP_P1 = 1.3981999507E-3f;
+static const float EXP_P2 = 8.3334519073E-3f;
+static const float EXP_P3 = 4.1665795894E-2f;
+static const float EXP_P4 = 1.6666665459E-1f;
+static const float EXP_P5 = 5.0000001201E-1f;
+static const float TANH_CLAMP = 9.0f; // tanh(9) == 1.0f in single precision
+
+// --- SPARSE CROSSOVER ---
+// Input density below which a first layer fed through dotSparse beats the dense GEMV,
+// measured with NeuralNetBench's [Sparse] section on a 784 -> 100 layer
+static const float SCALAR_SPARSE_DENSITY = 0.6f;
+static const float SSE2_SPARSE_DENSITY = 0.15f;
+static const float AVX2_SPARSE_DENSITY = 0.15f;
+static const float AVX512_SPARSE_DENSITY = 0.12f;
+
+// Scalar copy of the vector exp, used for loop tails so every element sees the same math
+static float ExpApprox(float x) {
+    if (x > EXP_HI) x = EXP_HI;
+    if (x < EXP_LO) x = EXP_LO;
+
+    float fx = std::floor(x * LOG2E + 0.5f);
+    x -= fx * LN2_HI;
+    x -= fx * LN2_LO;
+
+    float y = EXP_P0;
+    y = y * x + EXP_P1;
+    y = y * x + EXP_P2;
+    y = y * x + EXP_P3;
+    y = y * x + EXP_P4;
+    y = y * x + EXP_P5;
+    y = y * x * x + x + 1.0f;
+
+    int32_t bits = ((int32_t)fx + 127) << 23;
+    float scale;
+    memcpy(&scale, &bits, sizeof(scale));
+    return y * scale;
+}
+
+static float SigmoidApprox(float x) {
+    return 1.0f / (1.0f + ExpApprox(-x));
+}
+
+static float TanhApprox(float x) {
+    float ax = std::fabs(x);
+    if (ax > TANH_CLAMP) ax = TANH_CLAMP;
+    float t = 1.0f - 2.0f / (ExpApprox(2.0f * ax) + 1.0f);
+    return (x < 0.0f) ? -t : t;
+}
+
+// =====================================================================
+// --- SCALAR (reference) ---
+// =====================================================================
+
+static float DotScalar(const float* a, const float* b, int n) {
+    float sum = 0.0f;
+    for (int i = 0; i < n; i++) sum += a[i] * b[i];
+    return sum;
+}
+
+static void AxpyScalar(float alpha, const float* x, float* y, int n) {
+    for (int i = 0; i < n; i++) y[i] += alpha * x[i];
+}
+
+static void ReluScalar(float* x, int n) {
+    for (int i = 0; i < n; i++) x[i] = (x[i] > 0) ? x[i] : 0.0f;
+}
+
+static void SigmoidScalar(float* x, int n) {
+    for (int i = 0; i < n; i++) x[i] = 1.0f / (1.0f + std::exp(-x[i]));
+}
+
+static void TanhScalar(float* x, int n) {
+    for (int i = 0; i < n; i++) x[i] = std::tanh(x[i]);
+}
+
+static void SoftmaxScalar(float* x, int n) {
+    if (n <= 0) return;
+    float maxVal = x[0];
+    for (int i = 1; i < n; i++) if (x[i] > maxVal) maxVal = x[i];
+
+    float sumExp = 0.0f;
+    for (int i = 0; i < n; i++) {
+        x[i] = std::exp(x[i] - maxVal);
+        sumExp += x[i];
+    }
+    for (int i = 0; i < n; i++) x[i] /= sumExp;
+}
+
+// Plain C++ 4x16 tile; the fixed sizes let the compiler vectorize it for whatever the build targets
+static void GemmKernelScalar(int kc, const float* a, const float* b, float alpha, float* C, int ldc, int rows, int cols) {
+    const int MR = 4, NR = 16;
+    float acc[MR][NR] = {};
+
+    for (int k = 0; k < kc; k++) {
+        for (int r = 0; r < MR; r++) {
+            float av = a[r];
+            for (int c = 0; c < NR; c++) acc[r][c] += av * b[c];
+        }
+        a += MR;
+        b += NR;
+    }
+
+    for (int r = 0; r < rows; r++) {
+        float* c = &C[(size_t)r * ldc];
+        for (int j = 0; j < cols; j++) c[j] += alpha * acc[r][j];
+    }
+}
+
+static void GemvU8S8Scalar(const unsigned char* x, const signed char* w, int k, int rows, int* sums) {
+    for (int r = 0; r < rows; r++) {
+        const signed char* row = &w[(size_t)r * k];
+        int sum = 0;
+        for (int i = 0; i < k; i++) sum += (int)x[i] * (int)row[i];
+        sums[r] = sum;
+    }
+}
+
+static int CompactNonzeroScalar(const float* x, int n, int limit, int* indices, float* values) {
+    // Branch-free inside a chunk: always write, only advance past nonzeros
+    int count = 0;
+    for (int i0 = 0; i0 < n && count <= limit; i0 += 64) {
+        int end = (n - i0 < 64) ? n : i0 + 64;
+        for (int i = i0; i < end; i++) {
+            indices[count] = i;
+            values[count] = x[i];
+            count += x[i] != 0.0f;
+        }
+    }
+    return count;
+}
+
+static float DotSparseScalar(const float* w, const int* indices, const float* values, int count) {
+    float s0 = 0.0f, s1 = 0.0f, s2 = 0.0f, s3 = 0.0f;
+    int k = 0;
+    for (; k + 4 <= count; k += 4) {
+        s0 += w[indices[k]] * values[k];
+        s1 += w[indices[k + 1]] * values[k + 1];
+        s2 += w[indices[k + 2]] * values[k + 2];
+        s3 += w[indices[k + 3]] * values[k + 3];
+    }
+    for (; k < count; k++) s0 += w[indices[k]] * values[k];
+    return (s0 + s1) + (s2 + s3);
+}
+
+static const SimdKernels SCALAR_KERNELS = {
+    SimdLevel::SCALAR, "scalar",
+    DotScalar, AxpyScalar,
+    ReluScalar, SigmoidScalar, TanhScalar, SoftmaxScalar,
+    4, 16, GemmKernelScalar,
+    GemvU8S8Scalar,
+    CompactNonzeroScalar, DotSparseScalar, SCALAR_SPARSE_DENSITY
+};
+
+// --- HALF PRECISION (scalar) ---
+// Round-to-nearest-even conversions, the reference the vector sets are checked against
+static inline unsigned int FloatBits(float f) {
+    unsigned int u;
+    memcpy(&u, &f, sizeof(u));
+    return u;
+}
+
+static inline float BitsFloat(unsigned int u) {
+    float f;
+    memcpy(&f, &u, sizeof(f));
+    return f;
+}
+
+struct Bf16Bits {
+    static inline unsigned short fromFloat(float f) {
+        unsigned int u = FloatBits(f);
+        if ((u & 0x7FFFFFFFu) > 0x7F800000u) return (unsigned short)((u >> 16) | 0x40u); // NaN stays a NaN
+        u += 0x7FFFu + ((u >> 16) & 1u);
+        return (unsigned short)(u >> 16);
+    }
+    static inline float toFloat(unsigned short h) {
+        return BitsFloat((unsigned int)h << 16);
+    }
+};
+
+// After F. Giesen's float_to_half_fast3_rtne / half_to_float
+struct Fp16Bits {
+    static inline unsigned short fromFloat(float f) {
+        unsigned int u = FloatBits(f);
+        unsigned int sign = (u >> 16) & 0x8000u;
+        u &= 0x7FFFFFFFu;
+
+        unsigned int h;
+        if (u >= 0x47800000u) {
+            h = (u > 0x7F800000u) ? 0x7E00u : 0x7C00u;       // 65536 and up: inf (NaN stays a NaN)
+        }
+        else if (u < 0x38800000u) {
+            h = FloatBits(BitsFloat(u) + 0.5f) - FloatBits(0.5f); // below 2^-14: the fp32 add rounds the subnormal
+        }
+        else {
+            u += 0xC8000FFFu + ((u >> 13) & 1u);               // exponent rebiased 127 -> 15, plus rounding
+            h = u >> 13;
+        }
+        return (unsigned short)(h | sign);
+    }
+    static inline float toFloat(unsigned short h) {
+        unsigned int u = ((unsigned int)h & 0x7FFFu) << 13;
+        unsigned int exponent = u & 0x0F800000u;
+        u += 0x38000000u;                                      // exponent rebiased 15 -> 127
+        if (exponent == 0x0F800000u) u += 0x38000000u;         // inf / NaN
+        else if (exponent == 0) u = FloatBits(BitsFloat(u + 0x00800000u) - BitsFloat(0x38800000u)); // zero / subnormal
+        return BitsFloat(u | (((unsigned int)h & 0x8000u) << 16));
+    }
+};
+
+template <class Half>
+static void GemvHalfScalar(const unsigned short* w, const unsigned short* x, int k, int rows, float* sums) {
+    for (int r = 0; r < rows; r++) {
+        const unsigned short* row = &w[(size_t)r * k];
+        float sum = 0.0f;
+        for (int i = 0; i < k; i++) sum += Half::toFloat(row[i]) * Half::toFloat(x[i]);
+        sums[r] = sum;
+    }
+}
+
+template <class Half>
+static void AxpyHalfScalar(float alpha, const unsigned short* x, float* y, int n) {
+    for (int i = 0; i < n; i++) y[i] += alpha * Half::toFloat(x[i]);
+}
+
+template <class Half>
+static void AxpyMasterScalar(float alpha, const unsigned short* x, float* master, unsigned short* half, int n) {
+    for (int i = 0; i < n; i++) {
+        master[i] += alpha * Half::toFloat(x[i]);
+        half[i] = Half::fromFloat(master[i]);
+    }
+}
+
+template <class Half>
+static void FromFloatScalar(const float* x, unsigned short* out, int n) {
+    for (int i = 0; i < n; i++) out[i] = Half::fromFloat(x[i]);
+}
+
+template <class Half>
+static void ToFloatScalar(const unsigned short* x, float* out, int n) {
+    for (int i = 0; i < n; i++) out[i] = Half::toFloat(x[i]);
+}
+
+static const HalfKernels BF16_SCALAR_KERNELS = {
+    HalfType::BF16, "bf16 scalar",
+    GemvHalfScalar<Bf16Bits>, AxpyHalfScalar<Bf16Bits>, AxpyMasterScalar<Bf16Bits>,
+    FromFloatScalar<Bf16Bits>, ToFloatScalar<Bf16Bits>
+};
+
+static const HalfKernels FP16_SCALAR_KERNELS = {
+    HalfType::FP16, "fp16 scalar",
+    GemvHalfScalar<Fp16Bits>, AxpyHalfScalar<Fp16Bits>, AxpyMasterScalar<Fp16Bits>,
+    FromFloatScalar<Fp16Bits>, ToFloatScalar<Fp16Bits>
+};
+
+#ifdef NN_X86
+
+// =====================================================================
+// --- SSE2 ---
+// =====================================================================
+
+static inline NN_TARGET_SSE2 float HorizontalSum4(__m128 v) {
+    __m128 shuf = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1));
+    __m128 sums = _mm_add_ps(v, shuf);
+    shuf = _mm_movehl_ps(shuf, sums);
+    sums = _mm_add_ss(sums, shuf);
+    return _mm_cvtss_f32(sums);
+}
+
+static inline NN_TARGET_SSE2 __m128 Exp4(__m128 x) {
+    x = _mm_min_ps(x, _mm_set1_ps(EXP_HI));
+    x = _mm_max_ps(x, _mm_set1_ps(EXP_LO));
+
+    // floor() without SSE4.1: truncate, then step down where that rounded up
+    __m128 fx = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(LOG2E)), _mm_set1_ps(0.5f));
+    __m128 tx = _mm_cvtepi32_ps(_mm_cvttps_epi32(fx));
+    fx = _mm_sub_ps(tx, _mm_and_ps(_mm_cmpgt_ps(tx, fx), _mm_set1_ps(1.0f)));
+
+    x = _mm_sub_ps(x, _mm_mul_ps(fx, _mm_set1_ps(LN2_HI)));
+    x = _mm_sub_ps(x, _mm_mul_ps(fx, _mm_set1_ps(LN2_LO)));
+
+    __m128 y = _mm_set1_ps(EXP_P0);
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(EXP_P1));
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(EXP_P2));
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(EXP_P3));
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(EXP_P4));
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(EXP_P5));
+    y = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(y, x), x), _mm_add_ps(x, _mm_set1_ps(1.0f)));
+
+    __m128i bits = _mm_slli_epi32(_mm_add_epi32(_mm_cvttps_epi32(fx), _mm_set1_epi32(127)), 23);
+    return _mm_mul_ps(y, _mm_castsi128_ps(bits));
+}
+
+static NN_TARGET_SSE2 float DotSse2(const float* a, const float* b, int n) {
+    __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+    float sum = HorizontalSum4(_mm_add_ps(acc0, acc1));
+    for (; i < n; i++) sum += a[i] * b[i];
+    return sum;
+}
+
+static NN_TARGET_SSE2 void AxpySse2(float alpha, const float* x, float* y, int n) {
+    __m128 va = _mm_set1_ps(alpha);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(y + i), _mm_mul_ps(va, _mm_loadu_ps(x + i))));
+    }
+    for (; i < n; i++) y[i] += alpha * x[i];
+}
+
+static NN_TARGET_SSE2 void ReluSse2(float* x, int n) {
+    __m128 zero = _mm_setzero_ps();
+    int i = 0;
+    for (; i + 4 <= n; i += 4) _mm_storeu_ps(x + i, _mm_max_ps(_mm_loadu_ps(x + i), zero));
+    for (; i < n; i++) x[i] = (x[i] > 0) ? x[i] : 0.0f;
+}
+
+static NN_TARGET_SSE2 void SigmoidSse2(float* x, int n) {
+    __m128 one = _mm_set1_ps(1.0f);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 e = Exp4(_mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(x + i)));
+        _mm_storeu_ps(x + i, _mm_div_ps(one, _mm_add_ps(one, e)));
+    }
+    for (; i < n; i++) x[i] = SigmoidApprox(x[i]);
+}
+
+static NN_TARGET_SSE2 void TanhSse2(float* x, int n) {
+    __m128 one = _mm_set1_ps(1.0f), two = _mm_set1_ps(2.0f);
+    __m128 signMask = _mm_set1_ps(-0.0f);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 v = _mm_loadu_ps(x + i);
+        __m128 sign = _mm_and_ps(v, signMask);
+        __m128 ax = _mm_min_ps(_mm_andnot_ps(signMask, v), _mm_set1_ps(TANH_CLAMP));
+        __m128 t = _mm_sub_ps(one, _mm_div_ps(two, _mm_add_ps(Exp4(_mm_mul_ps(two, ax)), one)));
+        _mm_storeu_ps(x + i, _mm_or_ps(t, sign));
+    }
+    for (; i < n; i++) x[i] = TanhApprox(x[i]);
+}
+
+static NN_TARGET_SSE2 void SoftmaxSse2(float* x, int n) {
+    if (n <= 0) return;
+    float maxVal = x[0];
+    for (int i = 1; i < n; i++) if (x[i] > maxVal) maxVal = x[i];
+
+    __m128 vmax = _mm_set1_ps(maxVal);
+    __m128 vsum = _mm_setzero_ps();
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 e = Exp4(_mm_sub_ps(_mm_loadu_ps(x + i), vmax));
+        _mm_storeu_ps(x + i, e);
+        vsum = _mm_add_ps(vsum, e);
+    }
+    float sumExp = HorizontalSum4(vsum);
+    for (; i < n; i++) {
+        x[i] = ExpApprox(x[i] - maxVal);
+        sumExp += x[i];
+    }
+
+    __m128 inv = _mm_set1_ps(1.0f / sumExp);
+    for (i = 0; i + 4 <= n; i += 4) _mm_storeu_ps(x + i, _mm_mul_ps(_mm_loadu_ps(x + i), inv));
+    for (; i < n; i++) x[i] *= 1.0f / sumExp;
+}
+
+// 4x8 tile: 8 accumulators, small enough for the 8 XMM registers of 32-bit builds
+static NN_TARGET_SSE2 void GemmKernelSse2(int kc, const float* a, const float* b, float alpha, float* C, int ldc, int rows, int cols) {
+    const int MR = 4, NR = 8;
+    __m128 c00 = _mm_setzero_ps(), c01 = _mm_setzero_ps();
+    __m128 c10 = _mm_setzero_ps(), c11 = _mm_setzero_ps();
+    __m128 c20 = _mm_setzero_ps(), c21 = _mm_setzero_ps();
+    __m128 c30 = _mm_setzero_ps(), c31 = _mm_setzero_ps();
+
+    for (int k = 0; k < kc; k++) {
+        __m128 b0 = _mm_loadu_ps(b), b1 = _mm_loadu_ps(b + 4);
+        __m128 av;
+        av = _mm_set1_ps(a[0]); c00 = _mm_add_ps(c00, _mm_mul_ps(av, b0)); c01 = _mm_add_ps(c01, _mm_mul_ps(av, b1));
+        av = _mm_set1_ps(a[1]); c10 = _mm_add_ps(c10, _mm_mul_ps(av, b0)); c11 = _mm_add_ps(c11, _mm_mul_ps(av, b1));
+        av = _mm_set1_ps(a[2]); c20 = _mm_add_ps(c20, _mm_mul_ps(av, b0)); c21 = _mm_add_ps(c21, _mm_mul_ps(av, b1));
+        av = _mm_set1_ps(a[3]); c30 = _mm_add_ps(c30, _mm_mul_ps(av, b0)); c31 = _mm_add_ps(c31, _mm_mul_ps(av, b1));
+        a += MR;
+        b += NR;
+    }
+
+    float acc[MR][NR];
+    _mm_storeu_ps(acc[0], c00); _mm_storeu_ps(acc[0] + 4, c01);
+    _mm_storeu_ps(acc[1], c10); _mm_storeu_ps(acc[1] + 4, c11);
+    _mm_storeu_ps(acc[2], c20); _mm_storeu_ps(acc[2] + 4, c21);
+    _mm_storeu_ps(acc[3], c30); _mm_storeu_ps(acc[3] + 4, c31);
+
+    for (int r = 0; r < rows; r++) {
+        float* c = &C[(size_t)r * ldc];
+        for (int j = 0; j < cols; j++) c[j] += alpha * acc[r][j];
+    }
+}
+
+static const SimdKernels SSE2_KERNELS = {
+    SimdLevel::SSE2, "sse2",
+    DotSse2, AxpySse2,
+    ReluSse2, SigmoidSse2, TanhSse2, SoftmaxSse2,
+    4, 8, GemmKernelSse2,
+    GemvU8S8Scalar, // pmaddubsw needs SSSE3
+    CompactNonzeroScalar, DotSparseScalar, SSE2_SPARSE_DENSITY // no gather before AVX2
+};
+
+// =====================================================================
+// --- AVX2 + FMA ---
+// =====================================================================
+
+static inline NN_TARGET_AVX2 float HorizontalSum8(__m256 v) {
+    __m128 lo = _mm256_castps256_ps128(v);
+    __m128 hi = _mm256_extractf128_ps(v, 1);
+    lo = _mm_add_ps(lo, hi);
+    __m128 shuf = _mm_movehdup_ps(lo);
+    __m128 sums = _mm_add_ps(lo, shuf);
+    shuf = _mm_movehl_ps(shuf, sums);
+    return _mm_cvtss_f32(_mm_add_ss(sums, shuf));
+}
+
+static inline NN_TARGET_AVX2 __m256 Exp8(__m256 x) {
+    x = _mm256_min_ps(x, _mm256_set1_ps(EXP_HI));
+    x = _mm256_max_ps(x, _mm256_set1_ps(EXP_LO));
+
+    __m256 fx = _mm256_floor_ps(_mm256_fmadd_ps(x, _mm256_set1_ps(LOG2E), _mm256_set1_ps(0.5f)));
+    x = _mm256_fnmadd_ps(fx, _mm256_set1_ps(LN2_HI), x);
+    x = _mm256_fnmadd_ps(fx, _mm256_set1_ps(LN2_LO), x);
+
+    __m256 y = _mm256_set1_ps(EXP_P0);
+    y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(EXP_P1));
+    y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(EXP_P2));
+    y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(EXP_P3));
+    y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(EXP_P4));
+    y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(EXP_P5));
+    y = _mm256_fmadd_ps(_mm256_mul_ps(y, x), x, _mm256_add_ps(x, _mm256_set1_ps(1.0f)));
+
+    __m256i bits = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(fx), _mm256_set1_epi32(127)), 23);
+    return _mm256_mul_ps(y, _mm256_castsi256_ps(bits));
+}
+
+static NN_TARGET_AVX2 float DotAvx2(const float* a, const float* b, int n) {
+    __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+    __m256 acc2 = _mm256_setzero_ps(), acc3 = _mm256_setzero_ps();
+    int i = 0;
+    for (; i + 32 <= n; i += 32) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), acc1);
+        acc2 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 16), _mm256_loadu_ps(b + i + 16), acc2);
+        acc3 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 24), _mm256_loadu_ps(b + i + 24), acc3);
+    }
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+    }
+    float sum = HorizontalSum8(_mm256_add_ps(_mm256_add_ps(acc0, acc1), _mm256_add_ps(acc2, acc3)));
+    for (; i < n; i++) sum += a[i] * b[i];
+    return sum;
+}
+
+static NN_TARGET_AVX2 void AxpyAvx2(float alpha, const float* x, float* y, int n) {
+    __m256 va = _mm256_set1_ps(alpha);
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        _mm256_storeu_ps(y + i, _mm256_fmadd_ps(va, _mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i)));
+        _mm256_storeu_ps(y + i + 8, _mm256_fmadd_ps(va, _mm256_loadu_ps(x + i + 8), _mm256_loadu_ps(y + i + 8)));
+    }
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(y + i, _mm256_fmadd_ps(va, _mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i)));
+    }
+    for (; i < n; i++) y[i] += alpha * x[i];
+}
+
+static NN_TARGET_AVX2 void ReluAvx2(float* x, int n) {
+    __m256 zero = _mm256_setzero_ps();
+    int i = 0;
+    for (; i + 8 <= n; i += 8) _mm256_storeu_ps(x + i, _mm256_max_ps(_mm256_loadu_ps(x + i), zero));
+    for (; i < n; i++) x[i] = (x[i] > 0) ? x[i] : 0.0f;
+}
+
+static NN_TARGET_AVX2 void SigmoidAvx2(float* x, int n) {
+    __m256 one = _mm256_set1_ps(1.0f);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 e = Exp8(_mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(x + i)));
+        _mm256_storeu_ps(x + i, _mm256_div_ps(one, _mm256_add_ps(one, e)));
+    }
+    for (; i < n; i++) x[i] = SigmoidApprox(x[i]);
+}
+
+static NN_TARGET_AVX2 void TanhAvx2(float* x, int n) {
+    __m256 one = _mm256_set1_ps(1.0f), two = _mm256_set1_ps(2.0f);
+    __m256 signMask = _mm256_set1_ps(-0.0f);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 v = _mm256_loadu_ps(x + i);
+        __m256 sign = _mm256_and_ps(v, signMask);
+        __m256 ax = _mm256_min_ps(_mm256_andnot_ps(signMask, v), _mm256_set1_ps(TANH_CLAMP));
+        __m256 t = _mm256_sub_ps(one, _mm256_div_ps(two, _mm256_add_ps(Exp8(_mm256_mul_ps(two, ax)), one)));
+        _mm256_storeu_ps(x + i, _mm256_or_ps(t, sign));
+    }
+    for (; i < n; i++) x[i] = TanhApprox(x[i]);
+}
+
+static NN_TARGET_AVX2 void SoftmaxAvx2(float* x, int n) {
+    if (n <= 0) return;
+    float maxVal = x[0];
+    for (int i = 1; i < n; i++) if (x[i] > maxVal) maxVal = x[i];
+
+    __m256 vmax = _mm256_set1_ps(maxVal);
+    __m256 vsum = _mm256_setzero_ps();
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 e = Exp8(_mm256_sub_ps(_mm256_loadu_ps(x + i), vmax));
+        _mm256_storeu_ps(x + i, e);
+        vsum = _mm256_add_ps(vsum, e);
+    }
+    float sumExp = HorizontalSum8(vsum);
+    for (; i < n; i++) {
+        x[i] = ExpApprox(x[i] - maxVal);
+        sumExp += x[i];
+    }
+
+    float invSum = 1.0f / sumExp;
+    __m256 inv = _mm256_set1_ps(invSum);
+    for (i = 0; i + 8 <= n; i += 8) _mm256_storeu_ps(x + i, _mm256_mul_ps(_mm256_loadu_ps(x + i), inv));
+    for (; i < n; i++) x[i] *= invSum;
+}
+
+// 6x16 tile: 12 YMM accumulators + 2 B vectors + 1 broadcast = 15 of the 16 registers
+static NN_TARGET_AVX2 void GemmKernelAvx2(int kc, const float* a, const float* b, float alpha, float* C, int ldc, int rows, int cols) {
+    const int MR = 6, NR = 16;
+    __m256 c[MR][2];
+    for (int r = 0; r < MR; r++) c[r][0] = c[r][1] = _mm256_setzero_ps();
+
+    for (int k = 0; k < kc; k++) {
+        __m256 b0 = _mm256_loadu_ps(b), b1 = _mm256_loadu_ps(b + 8);
+        for (int r = 0; r < MR; r++) {
+            __m256 av = _mm256_broadcast_ss(a + r);
+            c[r][0] = _mm256_fmadd_ps(av, b0, c[r][0]);
+            c[r][1] = _mm256_fmadd_ps(av, b1, c[r][1]);
+        }
+        a += MR;
+        b += NR;
+    }
+
+    __m256 va = _mm256_set1_ps(alpha);
+    if (rows == MR && cols == NR) {
+        for (int r = 0; r < MR; r++) {
+            float* cr = &C[(size_t)r * ldc];
+            _mm256_storeu_ps(cr, _mm256_fmadd_ps(va, c[r][0], _mm256_loadu_ps(cr)));
+            _mm256_storeu_ps(cr + 8, _mm256_fmadd_ps(va, c[r][1], _mm256_loadu_ps(cr + 8)));
+        }
+        return;
+    }
+
+    // Edge tile: spill and copy only the valid part
+    float acc[MR][NR];
+    for (int r = 0; r < MR; r++) {
+        _mm256_storeu_ps(acc[r], c[r][0]);
+        _mm256_storeu_ps(acc[r] + 8, c[r][1]);
+    }
+    for (int r = 0; r < rows; r++) {
+        float* cr = &C[(size_t)r * ldc];
+        for (int j = 0; j < cols; j++) cr[j] += alpha * acc[r][j];
+    }
+}
+
+static inline NN_TARGET_AVX2 int HorizontalSum8i(__m256i v) {
+    __m128i s = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(1, 0, 3, 2)));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(s);
+}
+
+// pmaddubsw: 32 u8 x s8 products -> 16 int16 pair sums (no saturation with x <= 127), pmaddwd widens to int32
+static inline NN_TARGET_AVX2 __m256i DotStepU8S8(__m256i acc, __m256i x, const signed char* w, __m256i ones) {
+    __m256i pairs = _mm256_maddubs_epi16(x, _mm256_loadu_si256((const __m256i*)w));
+    return _mm256_add_epi32(acc, _mm256_madd_epi16(pairs, ones));
+}
+
+static NN_TARGET_AVX2 void GemvU8S8Avx2(const unsigned char* x, const signed char* w, int k, int rows, int* sums) {
+    const __m256i ones = _mm256_set1_epi16(1);
+    int r = 0;
+
+    // Four rows at a time share every load of x
+    for (; r + 4 <= rows; r += 4) {
+        const signed char* w0 = &w[(size_t)r * k];
+        __m256i acc0 = _mm256_setzero_si256(), acc1 = _mm256_setzero_si256();
+        __m256i acc2 = _mm256_setzero_si256(), acc3 = _mm256_setzero_si256();
+        for (int i = 0; i < k; i += 32) {
+            __m256i xv = _mm256_loadu_si256((const __m256i*)&x[i]);
+            acc0 = DotStepU8S8(acc0, xv, w0 + i, ones);
+            acc1 = DotStepU8S8(acc1, xv, w0 + k + i, ones);
+            acc2 = DotStepU8S8(acc2, xv, w0 + 2 * (size_t)k + i, ones);
+            acc3 = DotStepU8S8(acc3, xv, w0 + 3 * (size_t)k + i, ones);
+        }
+        sums[r] = HorizontalSum8i(acc0);
+        sums[r + 1] = HorizontalSum8i(acc1);
+        sums[r + 2] = HorizontalSum8i(acc2);
+        sums[r + 3] = HorizontalSum8i(acc3);
+    }
+    for (; r < rows; r++) {
+        __m256i acc = _mm256_setzero_si256();
+        for (int i = 0; i < k; i += 32) acc = DotStepU8S8(acc, _mm256_loadu_si256((const __m256i*)&x[i]), &w[(size_t)r * k + i], ones);
+        sums[r] = HorizontalSum8i(acc);
+    }
+}
+
+static NN_TARGET_AVX2 float DotSparseAvx2(const float* w, const int* indices, const float* values, int count) {
+    __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+    int k = 0;
+    for (; k + 16 <= count; k += 16) {
+        __m256 w0 = _mm256_i32gather_ps(w, _mm256_loadu_si256((const __m256i*)&indices[k]), 4);
+        __m256 w1 = _mm256_i32gather_ps(w, _mm256_loadu_si256((const __m256i*)&indices[k + 8]), 4);
+        acc0 = _mm256_fmadd_ps(w0, _mm256_loadu_ps(&values[k]), acc0);
+        acc1 = _mm256_fmadd_ps(w1, _mm256_loadu_ps(&values[k + 8]), acc1);
+    }
+    for (; k + 8 <= count; k += 8) {
+        __m256 w0 = _mm256_i32gather_ps(w, _mm256_loadu_si256((const __m256i*)&indices[k]), 4);
+        acc0 = _mm256_fmadd_ps(w0, _mm256_loadu_ps(&values[k]), acc0);
+    }
+    float sum = HorizontalSum8(_mm256_add_ps(acc0, acc1));
+    for (; k < count; k++) sum += w[indices[k]] * values[k];
+    return sum;
+}
+
+static const SimdKernels AVX2_KERNELS = {
+    SimdLevel::AVX2, "avx2+fma",
+    DotAvx2, AxpyAvx2,
+    ReluAvx2, SigmoidAvx2, TanhAvx2, SoftmaxAvx2,
+    6, 16, GemmKernelAvx2,
+    GemvU8S8Avx2,
+    CompactNonzeroScalar, DotSparseAvx2, AVX2_SPARSE_DENSITY
+};
+
+// --- HALF PRECISION (AVX2 + F16C) ---
+// Eight values per step, widened to fp32 for the FMAs. F16C converts fp16 in hardware; bf16 only needs
+// a 16-bit shift to widen, and is rounded with the same integer trick as Bf16Bits (NaN payloads aside).
+struct Bf16Avx2 : Bf16Bits {
+    static inline NN_TARGET_F16C __m256 load8(const unsigned short* p) {
+        __m256i bits = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)p));
+        return _mm256_castsi256_ps(_mm256_slli_epi32(bits, 16));
+    }
+    static inline NN_TARGET_F16C void store8(unsigned short* p, __m256 v) {
+        __m256i u = _mm256_castps_si256(v);
+        __m256i odd = _mm256_and_si256(_mm256_srli_epi32(u, 16), _mm256_set1_epi32(1));
+        __m256i rounded = _mm256_srli_epi32(_mm256_add_epi32(u, _mm256_add_epi32(odd, _mm256_set1_epi32(0x7FFF))), 16);
+        _mm_storeu_si128((__m128i*)p, _mm_packus_epi32(_mm256_castsi256_si128(rounded), _mm256_extracti128_si256(rounded, 1)));
+    }
+};
+
+struct Fp16F16c : Fp16Bits {
+    static inline NN_TARGET_F16C __m256 load8(const unsigned short* p) {
+        return _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)p));
+    }
+    static inline NN_TARGET_F16C void store8(unsigned short* p, __m256 v) {
+        _mm_storeu_si128((__m128i*)p, _mm256_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT));
+    }
+};
+
+// Four rows share each load of x
+template <class Half>
+static NN_TARGET_F16C void GemvHalfAvx2(const unsigned short* w, const unsigned short* x, int k, int rows, float* sums) {
+    int r = 0;
+    for (; r + 4 <= rows; r += 4) {
+        const unsigned short* w0 = &w[(size_t)r * k];
+        const unsigned short* w1 = w0 + k;
+        const unsigned short* w2 = w1 + k;
+        const unsigned short* w3 = w2 + k;
+        __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+        __m256 acc2 = _mm256_setzero_ps(), acc3 = _mm256_setzero_ps();
+        int i = 0;
+        for (; i + 8 <= k; i += 8) {
+            __m256 xv = Half::load8(x + i);
+            acc0 = _mm256_fmadd_ps(Half::load8(w0 + i), xv, acc0);
+            acc1 = _mm256_fmadd_ps(Half::load8(w1 + i), xv, acc1);
+            acc2 = _mm256_fmadd_ps(Half::load8(w2 + i), xv, acc2);
+            acc3 = _mm256_fmadd_ps(Half::load8(w3 + i), xv, acc3);
+        }
+        float s0 = HorizontalSum8(acc0), s1 = HorizontalSum8(acc1);
+        float s2 = HorizontalSum8(acc2), s3 = HorizontalSum8(acc3);
+        for (; i < k; i++) {
+            float xi = Half::toFloat(x[i]);
+            s0 += Half::toFloat(w0[i]) * xi;
+            s1 += Half::toFloat(w1[i]) * xi;
+            s2 += Half::toFloat(w2[i]) * xi;
+            s3 += Half::toFloat(w3[i]) * xi;
+        }
+        sums[r] = s0;
+        sums[r + 1] = s1;
+        sums[r + 2] = s2;
+        sums[r + 3] = s3;
+    }
+    for (; r < rows; r++) {
+        const unsigned short* row = &w[(size_t)r * k];
+        __m256 acc = _mm256_setzero_ps();
+        int i = 0;
+        for (; i + 8 <= k; i += 8) acc = _mm256_fmadd_ps(Half::load8(row + i), Half::load8(x + i), acc);
+        float sum = HorizontalSum8(acc);
+        for (; i < k; i++) sum += Half::toFloat(row[i]) * Half::toFloat(x[i]);
+        sums[r] = sum;
+    }
+}
+
+template <class Half>
+static NN_TARGET_F16C void AxpyHalfAvx2(float alpha, const unsigned short* x, float* y, int n) {
+    __m256 va = _mm256_set1_ps(alpha);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(y + i, _mm256_fmadd_ps(va, Half::load8(x + i), _mm256_loadu_ps(y + i)));
+    }
+    for (; i < n; i++) y[i] += alpha * Half::toFloat(x[i]);
+}
+
+template <class Half>
+static NN_TARGET_F16C void AxpyMasterAvx2(float alpha, const unsigned short* x, float* master, unsigned short* half, int n) {
+    __m256 va = _mm256_set1_ps(alpha);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 m = _mm256_fmadd_ps(va, Half::load8(x + i), _mm256_loadu_ps(master + i));
+        _mm256_storeu_ps(master + i, m);
+        Half::store8(half + i, m);
+    }
+    for (; i < n; i++) {
+        master[i] += alpha * Half::toFloat(x[i]);
+        half[i] = Half::fromFloat(master[i]);
+    }
+}
+
+template <class Half>
+static NN_TARGET_F16C void FromFloatAvx2(const float* x, unsigned short* out, int n) {
+    int i = 0;
+    for (; i + 8 <= n; i += 8) Half::store8(out + i, _mm256_loadu_ps(x + i));
+    for (; i < n; i++) out[i] = Half::fromFloat(x[i]);
+}
+
+template <class Half>
+static NN_TARGET_F16C void ToFloatAvx2(const unsigned short* x, float* out, int n) {
+    int i = 0;
+    for (; i + 8 <= n; i += 8) _mm256_storeu_ps(out + i, Half::load8(x + i));
+    for (; i < n; i++) out[i] = Half::toFloat(x[i]);
+}
+
+static const HalfKernels BF16_AVX2_KERNELS = {
+    HalfType::BF16, "bf16 avx2",
+    GemvHalfAvx2<Bf16Avx2>, AxpyHalfAvx2<Bf16Avx2>, AxpyMasterAvx2<Bf16Avx2>,
+    FromFloatAvx2<Bf16Avx2>, ToFloatAvx2<Bf16Avx2>
+};
+
+static const HalfKernels FP16_F16C_KERNELS = {
+    HalfType::FP16, "fp16 f16c",
+    GemvHalfAvx2<Fp16F16c>, AxpyHalfAvx2<Fp16F16c>, AxpyMasterAvx2<Fp16F16c>,
+    FromFloatAvx2<Fp16F16c>, ToFloatAvx2<Fp16F16c>
+};
+
+// =====================================================================
+// --- AVX-512F ---
+// Tails use masked loads/stores instead of scalar loops.
+// =====================================================================
+
+static inline NN_TARGET_AVX512 __mmask16 TailMask(int count) {
+    return (__mmask16)((1u << count) - 1u);
+}
+
+static inline NN_TARGET_AVX512 __m512 Exp16(__m512 x) {
+    x = _mm512_min_ps(x, _mm512_set1_ps(EXP_HI));
+    x = _mm512_max_ps(x, _mm512_set1_ps(EXP_LO));
+
+    __m512 fx = _mm512_roundscale_ps(_mm512_fmadd_ps(x, _mm512_set1_ps(LOG2E), _mm512_set1_ps(0.5f)), _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+    x = _mm512_fnmadd_ps(fx, _mm512_set1_ps(LN2_HI), x);
+    x = _mm512_fnmadd_ps(fx, _mm512_set1_ps(LN2_LO), x);
+
+    __m512 y = _mm512_set1_ps(EXP_P0);
+    y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(EXP_P1));
+    y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(EXP_P2));
+    y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(EXP_P3));
+    y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(EXP_P4));
+    y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(EXP_P5));
+    y = _mm512_fmadd_ps(_mm512_mul_ps(y, x), x, _mm512_add_ps(x, _mm512_set1_ps(1.0f)));
+
+    // y * 2^fx
+    return _mm512_scalef_ps(y, fx);
+}
+
+static NN_TARGET_AVX512 float DotAvx512(const float* a, const float* b, int n) {
+    __m512 acc0 = _mm512_setzero_ps(), acc1 = _mm512_setzero_ps();
+    int i = 0;
+    for (; i + 32 <= n; i += 32) {
+        acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), acc0);
+        acc1 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i + 16), _mm512_loadu_ps(b + i + 16), acc1);
+    }
+    for (; i + 16 <= n; i += 16) {
+        acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), acc0);
+    }
+    if (i < n) {
+        __mmask16 m = TailMask(n - i);
+        acc1 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(m, a + i), _mm512_maskz_loadu_ps(m, b + i), acc1);
+    }
+    return _mm512_reduce_add_ps(_mm512_add_ps(acc0, acc1));
+}
+
+static NN_TARGET_AVX512 void AxpyAvx512(float alpha, const float* x, float* y, int n) {
+    __m512 va = _mm512_set1_ps(alpha);
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        _mm512_storeu_ps(y + i, _mm512_fmadd_ps(va, _mm512_loadu_ps(x + i), _mm512_loadu_ps(y + i)));
+    }
+    if (i < n) {
+        __mmask16 m = TailMask(n - i);
+        _mm512_mask_storeu_ps(y + i, m, _mm512_fmadd_ps(va, _mm512_maskz_loadu_ps(m, x + i), _mm512_maskz_loadu_ps(m, y + i)));
+    }
+}
+
+static NN_TARGET_AVX512 void ReluAvx512(float* x, int n) {
+    __m512 zero = _mm512_setzero_ps();
+    for (int i = 0; i < n; i += 16) {
+        __mmask16 m = (n - i >= 16) ? (__mmask16)0xFFFF : TailMask(n - i);
+        _mm512_mask_storeu_ps(x + i, m, _mm512_max_ps(_mm512_maskz_loadu_ps(m, x + i), zero));
+    }
+}
+
+static NN_TARGET_AVX512 void SigmoidAvx512(float* x, int n) {
+    __m512 one = _mm512_set1_ps(1.0f);
+    for (int i = 0; i < n; i += 16) {
+        __mmask16 m = (n - i >= 16) ? (__mmask16)0xFFFF : TailMask(n - i);
+        __m512 e = Exp16(_mm512_sub_ps(_mm512_setzero_ps(), _mm512_maskz_loadu_ps(m, x + i)));
+        _mm512_mask_storeu_ps(x + i, m, _mm512_div_ps(one, _mm512_add_ps(one, e)));
+    }
+}
+
+static NN_TARGET_AVX512 void TanhAvx512(float* x, int n) {
+    __m512 one = _mm512_set1_ps(1.0f), two = _mm512_set1_ps(2.0f);
+    for (int i = 0; i < n; i += 16) {
+        __mmask16 m = (n - i >= 16) ? (__mmask16)0xFFFF : TailMask(n - i);
+        __m512 v = _mm512_maskz_loadu_ps(m, x + i);
+        __m512 ax = _mm512_min_ps(_mm512_abs_ps(v), _mm512_set1_ps(TANH_CLAMP));
+        __m512 t = _mm512_sub_ps(one, _mm512_div_ps(two, _mm512_add_ps(Exp16(_mm512_mul_ps(two, ax)), one)));
+        // Put the sign of v back on t
+        __m512i signBits = _mm512_and_si512(_mm512_castps_si512(v), _mm512_set1_epi32((int)0x80000000u));
+        t = _mm512_castsi512_ps(_mm512_or_si512(_mm512_castps_si512(t), signBits));
+        _mm512_mask_storeu_ps(x + i, m, t);
+    }
+}
+
+static NN_TARGET_AVX512 void SoftmaxAvx512(float* x, int n) {
+    if (n <= 0) return;
+    __m512 vmax = _mm512_set1_ps(x[0]);
+    for (int i = 0; i < n; i += 16) {
+        __mmask16 m = (n - i >= 16) ? (__mmask16)0xFFFF : TailMask(n - i);
+        vmax = _mm512_mask_max_ps(vmax, m, vmax, _mm512_maskz_loadu_ps(m, x + i));
+    }
+    __m512 vm = _mm512_set1_ps(_mm512_reduce_max_ps(vmax));
+
+    __m512 vsum = _mm512_setzero_ps();
+    for (int i = 0; i < n; i += 16) {
+        __mmask16 m = (n - i >= 16) ? (__mmask16)0xFFFF : TailMask(n - i);
+        __m512 e = Exp16(_mm512_sub_ps(_mm512_maskz_loadu_ps(m, x + i), vm));
+        _mm512_mask_storeu_ps(x + i, m, e);
+        vsum = _mm512_mask_add_ps(vsum, m, vsum, e);
+    }
+
+    __m512 inv = _mm512_set1_ps(1.0f / _mm512_reduce_add_ps(vsum));
+    for (int i = 0; i < n; i += 16) {
+        __mmask16 m = (n - i >= 16) ? (__mmask16)0xFFFF : TailMask(n - i);
+        _mm512_mask_storeu_ps(x + i, m, _mm512_mul_ps(_mm512_maskz_loadu_ps(m, x + i), inv));
+    }
+}
+
+// 8x32 tile: 16 ZMM accumulators + 2 B vectors + 1 broadcast, well inside the 32 registers
+static NN_TARGET_AVX512 void GemmKernelAvx512(int kc, const float* a, const float* b, float alpha, float* C, int ldc, int rows, int cols) {
+    const int MR = 8, NR = 32;
+    __m512 c[MR][2];
+    for (int r = 0; r < MR; r++) c[r][0] = c[r][1] = _mm512_setzero_ps();
+
+    for (int k = 0; k < kc; k++) {
+        __m512 b0 = _mm512_loadu_ps(b), b1 = _mm512_loadu_ps(b + 16);
+        for (int r = 0; r < MR; r++) {
+            __m512 av = _mm512_set1_ps(a[r]);
+            c[r][0] = _mm512_fmadd_ps(av, b0, c[r][0]);
+            c[r][1] = _mm512_fmadd_ps(av, b1, c[r][1]);
+        }
+        a += MR;
+        b += NR;
+    }
+
+    // Masked stores cover partial tiles without a spill
+    __m512 va = _mm512_set1_ps(alpha);
+    __mmask16 m0 = (cols >= 16) ? (__mmask16)0xFFFF : TailMask(cols);
+    __mmask16 m1 = (cols >= 32) ? (__mmask16)0xFFFF : (cols > 16 ? TailMask(cols - 16) : (__mmask16)0);
+    for (int r = 0; r < rows; r++) {
+        float* cr = &C[(size_t)r * ldc];
+        _mm512_mask_storeu_ps(cr, m0, _mm512_fmadd_ps(va, c[r][0], _mm512_maskz_loadu_ps(m0, cr)));
+        if (m1) _mm512_mask_storeu_ps(cr + 16, m1, _mm512_fmadd_ps(va, c[r][1], _mm512_maskz_loadu_ps(m1, cr + 16)));
+    }
+}
+
+static inline int PopCount16(unsigned int v) {
+    v = v - ((v >> 1) & 0x5555u);
+    v = (v & 0x3333u) + ((v >> 2) & 0x3333u);
+    v = (v + (v >> 4)) & 0x0F0Fu;
+    return (int)((v + (v >> 8)) & 0x1Fu);
+}
+
+// vcompressps packs the nonzero lanes (and their indices) together, 16 inputs per step
+static NN_TARGET_AVX512 int CompactNonzeroAvx512(const float* x, int n, int limit, int* indices, float* values) {
+    const __m512i step = _mm512_set1_epi32(16);
+    __m512i index = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    int count = 0;
+    for (int i = 0; i < n && count <= limit; i += 16) {
+        __mmask16 tail = TailMask(n - i < 16 ? n - i : 16);
+        __m512 v = _mm512_maskz_loadu_ps(tail, &x[i]);
+        __mmask16 nonzero = _mm512_mask_cmp_ps_mask(tail, v, _mm512_setzero_ps(), _CMP_NEQ_UQ);
+        _mm512_mask_compressstoreu_ps(&values[count], nonzero, v);
+        _mm512_mask_compressstoreu_epi32(&indices[count], nonzero, index);
+        count += PopCount16(nonzero);
+        index = _mm512_add_epi32(index, step);
+    }
+    return count;
+}
+
+static NN_TARGET_AVX512 float DotSparseAvx512(const float* w, const int* indices, const float* values, int count) {
+    __m512 acc0 = _mm512_setzero_ps(), acc1 = _mm512_setzero_ps();
+    int k = 0;
+    for (; k + 32 <= count; k += 32) {
+        __m512 w0 = _mm512_i32gather_ps(_mm512_loadu_si512(&indices[k]), w, 4);
+        __m512 w1 = _mm512_i32gather_ps(_mm512_loadu_si512(&indices[k + 16]), w, 4);
+        acc0 = _mm512_fmadd_ps(w0, _mm512_loadu_ps(&values[k]), acc0);
+        acc1 = _mm512_fmadd_ps(w1, _mm512_loadu_ps(&values[k + 16]), acc1);
+    }
+    for (; k < count; k += 16) {
+        __mmask16 tail = TailMask(count - k);
+        __m512i idx = _mm512_maskz_loadu_epi32(tail, &indices[k]);
+        __m512 wv = _mm512_mask_i32gather_ps(_mm512_setzero_ps(), tail, idx, w, 4);
+        acc0 = _mm512_fmadd_ps(wv, _mm512_maskz_loadu_ps(tail, &values[k]), acc0);
+    }
+    return _mm512_reduce_add_ps(_mm512_add_ps(acc0, acc1));
+}
+
+// VNNI: vpdpbusd does u8 x s8 -> four products summed straight into each int32 lane
+static NN_TARGET_AVX512VNNI void GemvU8S8Vnni(const unsigned char* x, const signed char* w, int k, int rows, int* sums) {
+    int r = 0;
+
+    for (; r + 4 <= rows; r += 4) {
+        const signed char* w0 = &w[(size_t)r * k];
+        __m512i acc0 = _mm512_setzero_si512(), acc1 = _mm512_setzero_si512();
+        __m512i acc2 = _mm512_setzero_si512(), acc3 = _mm512_setzero_si512();
+        for (int i = 0; i < k; i += 64) {
+            __m512i xv = _mm512_loadu_si512(&x[i]);
+            acc0 = _mm512_dpbusd_epi32(acc0, xv, _mm512_loadu_si512(w0 + i));
+            acc1 = _mm512_dpbusd_epi32(acc1, xv, _mm512_loadu_si512(w0 + k + i));
+            acc2 = _mm512_dpbusd_epi32(acc2, xv, _mm512_loadu_si512(w0 + 2 * (size_t)k + i));
+            acc3 = _mm512_dpbusd_epi32(acc3, xv, _mm512_loadu_si512(w0 + 3 * (size_t)k + i));
+        }
+        sums[r] = _mm512_reduce_add_epi32(acc0);
+        sums[r + 1] = _mm512_reduce_add_epi32(acc1);
+        sums[r + 2] = _mm512_reduce_add_epi32(acc2);
+        sums[r + 3] = _mm512_reduce_add_epi32(acc3);
+    }
+    for (; r < rows; r++) {
+        __m512i acc = _mm512_setzero_si512();
+        for (int i = 0; i < k; i += 64) acc = _mm512_dpbusd_epi32(acc, _mm512_loadu_si512(&x[i]), _mm512_loadu_si512(&w[(size_t)r * k + i]));
+        sums[r] = _mm512_reduce_add_epi32(acc);
+    }
+}
+
+// AVX-512F without VNNI (e.g. Skylake-X) keeps the AVX2 int8 kernel
+static const SimdKernels AVX512_KERNELS = {
+    SimdLevel::AVX512, "avx512f",
+    DotAvx512, AxpyAvx512,
+    ReluAvx512, SigmoidAvx512, TanhAvx512, SoftmaxAvx512,
+    8, 32, GemmKernelAvx512,
+    GemvU8S8Avx2,
+    CompactNonzeroAvx512, DotSparseAvx512, AVX512_SPARSE_DENSITY
+};
+
+static const SimdKernels AVX512_VNNI_KERNELS = {
+    SimdLevel::AVX512, "avx512f+vnni",
+    DotAvx512, AxpyAvx512,
+    ReluAvx512, SigmoidAvx512, TanhAvx512, SoftmaxAvx512,
+    8, 32, GemmKernelAvx512,
+    GemvU8S8Vnni,
+    CompactNonzeroAvx512, DotSparseAvx512, AVX512_SPARSE_DENSITY
+};
+
+// --- HALF PRECISION (AVX-512 BF16) ---
+// vdpbf16ps multiplies pairs of bf16 and adds both products into an fp32 lane: the dot product never
+// widens its inputs. vcvtneps2bf16 rounds to nearest even like Bf16Bits, but flushes fp32 subnormals to 0.
+// __m512bh is its own vector type to GCC/Clang and an alias of __m512i to MSVC; memcpy converts for both.
+static inline NN_TARGET_AVX512BF16 __m512bh AsBf16x32(__m512i v) {
+    __m512bh r;
+    memcpy(&r, &v, sizeof(r));
+    return r;
+}
+
+static inline NN_TARGET_AVX512BF16 __m512 WidenBf16x16(__m256i bits) {
+    return _mm512_castsi512_ps(_mm512_slli_epi32(_mm512_cvtepu16_epi32(bits), 16));
+}
+
+static inline NN_TARGET_AVX512BF16 __m256i RoundBf16x16(__m512 v) {
+    __m256bh h = _mm512_cvtneps_pbh(v);
+    __m256i bits;
+    memcpy(&bits, &h, sizeof(bits));
+    return bits;
+}
+
+static inline NN_TARGET_AVX512BF16 __mmask32 TailMask32(int count) {
+    return (__mmask32)((1ull << count) - 1ull);
+}
+
+static NN_TARGET_AVX512BF16 void GemvBf16Avx512(const unsigned short* w, const unsigned short* x, int k, int rows, float* sums) {
+    int r = 0;
+    for (; r + 4 <= rows; r += 4) {
+        const unsigned short* w0 = &w[(size_t)r * k];
+        const unsigned short* w1 = w0 + k;
+        const unsigned short* w2 = w1 + k;
+        const unsigned short* w3 = w2 + k;
+        __m512 acc0 = _mm512_setzero_ps(), acc1 = _mm512_setzero_ps();
+        __m512 acc2 = _mm512_setzero_ps(), acc3 = _mm512_setzero_ps();
+        int i = 0;
+        for (; i + 32 <= k; i += 32) {
+            __m512bh xv = AsBf16x32(_mm512_loadu_si512(x + i));
+            acc0 = _mm512_dpbf16_ps(acc0, AsBf16x32(_mm512_loadu_si512(w0 + i)), xv);
+            acc1 = _mm512_dpbf16_ps(acc1, AsBf16x32(_mm512_loadu_si512(w1 + i)), xv);
+            acc2 = _mm512_dpbf16_ps(acc2, AsBf16x32(_mm512_loadu_si512(w2 + i)), xv);
+            acc3 = _mm512_dpbf16_ps(acc3, AsBf16x32(_mm512_loadu_si512(w3 + i)), xv);
+        }
+        if (i < k) {
+            __mmask32 m = TailMask32(k - i);
+            __m512bh xv = AsBf16x32(_mm512_maskz_loadu_epi16(m, x + i));
+            acc0 = _mm512_dpbf16_ps(acc0, AsBf16x32(_mm512_maskz_loadu_epi16(m, w0 + i)), xv);
+            acc1 = _mm512_dpbf16_ps(acc1, AsBf16x32(_mm512_maskz_loadu_epi16(m, w1 + i)), xv);
+            acc2 = _mm512_dpbf16_ps(acc2, AsBf16x32(_mm512_maskz_loadu_epi16(m, w2 + i)), xv);
+            acc3 = _mm512_dpbf16_ps(acc3, AsBf16x32(_mm512_maskz_loadu_epi16(m, w3 + i)), xv);
+        }
+        sums[r] = _mm512_reduce_add_ps(acc0);
+        sums[r + 1] = _mm512_reduce_add_ps(acc1);
+        sums[r + 2] = _mm512_reduce_add_ps(acc2);
+        sums[r + 3] = _mm512_reduce_add_ps(acc3);
+    }
+    for (; r < rows; r++) {
+        const unsigned short* row = &w[(size_t)r * k];
+        __m512 acc = _mm512_setzero_ps();
+        int i = 0;
+        for (; i + 32 <= k; i += 32) {
+            acc = _mm512_dpbf16_ps(acc, AsBf16x32(_mm512_loadu_si512(row + i)), AsBf16x32(_mm512_loadu_si512(x + i)));
+        }
+        if (i < k) {
+            __mmask32 m = TailMask32(k - i);
+            acc = _mm512_dpbf16_ps(acc, AsBf16x32(_mm512_maskz_loadu_epi16(m, row + i)), AsBf16x32(_mm512_maskz_loadu_epi16(m, x + i)));
+        }
+        sums[r] = _mm512_reduce_add_ps(acc);
+    }
+}
+
+static NN_TARGET_AVX512BF16 void AxpyBf16Avx512(float alpha, const unsigned short* x, float* y, int n) {
+    __m512 va = _mm512_set1_ps(alpha);
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512 xv = WidenBf16x16(_mm256_loadu_si256((const __m256i*)(x + i)));
+        _mm512_storeu_ps(y + i, _mm512_fmadd_ps(va, xv, _mm512_loadu_ps(y + i)));
+    }
+    if (i < n) {
+        __mmask16 m = TailMask(n - i);
+        __m512 xv = WidenBf16x16(_mm256_maskz_loadu_epi16(m, x + i));
+        _mm512_mask_storeu_ps(y + i, m, _mm512_fmadd_ps(va, xv, _mm512_maskz_loadu_ps(m, y + i)));
+    }
+}
+
+static NN_TARGET_AVX512BF16 void AxpyMasterBf16Avx512(float alpha, const unsigned short* x, float* master, unsigned short* half, int n) {
+    __m512 va = _mm512_set1_ps(alpha);
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512 xv = WidenBf16x16(_mm256_loadu_si256((const __m256i*)(x + i)));
+        __m512 m = _mm512_fmadd_ps(va, xv, _mm512_loadu_ps(master + i));
+        _mm512_storeu_ps(master + i, m);
+        _mm256_storeu_si256((__m256i*)(half + i), RoundBf16x16(m));
+    }
+    if (i < n) {
+        __mmask16 mask = TailMask(n - i);
+        __m512 xv = WidenBf16x16(_mm256_maskz_loadu_epi16(mask, x + i));
+        __m512 m = _mm512_fmadd_ps(va, xv, _mm512_maskz_loadu_ps(mask, master + i));
+        _mm512_mask_storeu_ps(master + i, mask, m);
+        _mm256_mask_storeu_epi16(half + i, mask, RoundBf16x16(m));
+    }
+}
+
+static NN_TARGET_AVX512BF16 void FromFloatBf16Avx512(const float* x, unsigned short* out, int n) {
+    int i = 0;
+    for (; i + 16 <= n; i += 16) _mm256_storeu_si256((__m256i*)(out + i), RoundBf16x16(_mm512_loadu_ps(x + i)));
+    if (i < n) {
+        __mmask16 m = TailMask(n - i);
+        _mm256_mask_storeu_epi16(out + i, m, RoundBf16x16(_mm512_maskz_loadu_ps(m, x + i)));
+    }
+}
+
+static NN_TARGET_AVX512BF16 void ToFloatBf16Avx512(const unsigned short* x, float* out, int n) {
+    int i = 0;
+    for (; i + 16 <= n; i += 16) _mm512_storeu_ps(out + i, WidenBf16x16(_mm256_loadu_si256((const __m256i*)(x + i))));
+    if (i < n) {
+        __mmask16 m = TailMask(n - i);
+        _mm512_mask_storeu_ps(out + i, m, WidenBf16x16(_mm256_maskz_loadu_epi16(m, x + i)));
+    }
+}
+
+// fp16 stays on the F16C set at this level: F16C already converts in hardware, and a 512-bit vcvtph2ps
+// would still leave the FMAs to do the work vdpbf16ps does for bf16
+static const HalfKernels BF16_AVX512_KERNELS = {
+    HalfType::BF16, "bf16 avx512bf16",
+    GemvBf16Avx512, AxpyBf16Avx512, AxpyMasterBf16Avx512,
+    FromFloatBf16Avx512, ToFloatBf16Avx512
+};
+
+// --- CPU DETECTION ---
+static void Cpuid(int leaf, int subleaf, unsigned int regs[4]) {
+#if defined(_MSC_VER)
+    int r[4];
+    __cpuidex(r, leaf, subleaf);
+    for (int i = 0; i < 4; i++) regs[i] = (unsigned int)r[i];
+#else
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+static unsigned long long Xgetbv() {
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    unsigned int lo, hi;
+    __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    return ((unsigned long long)hi << 32) | lo;
+#endif
+}
+
+SimdLevel DetectSimdLevel() {
+    unsigned int regs[4];
+    Cpuid(0, 0, regs);
+    unsigned int maxLeaf = regs[0];
+
+    Cpuid(1, 0, regs);
+    bool sse2 = (regs[3] >> 26) & 1;
+    bool fma = (regs[2] >> 12) & 1;
+    bool osxsave = (regs[2] >> 27) & 1;
+    bool avx = (regs[2] >> 28) & 1;
+    if (!sse2) return SimdLevel::SCALAR;
+    if (!osxsave || !avx) return SimdLevel::SSE2;
+
+    // The OS must save the wider registers on context switch
+    unsigned long long xcr0 = Xgetbv();
+    bool ymmSaved = (xcr0 & 0x6) == 0x6;
+    bool zmmSaved = (xcr0 & 0xE6) == 0xE6;
+    if (!ymmSaved || maxLeaf < 7) return SimdLevel::SSE2;
+
+    Cpuid(7, 0, regs);
+    bool avx2 = (regs[1] >> 5) & 1;
+    bool avx512f = (regs[1] >> 16) & 1;
+
+    if (avx512f && avx2 && fma && zmmSaved) return SimdLevel::AVX512;
+    if (avx2 && fma) return SimdLevel::AVX2;
+    return SimdLevel::SSE2;
+}
+
+// AVX-512BW + AVX512_VNNI, on top of what DetectSimdLevel() checked for AVX512
+static bool DetectVnni() {
+    unsigned int regs[4];
+    Cpuid(0, 0, regs);
+    if (regs[0] < 7) return false;
+
+    Cpuid(7, 0, regs);
+    bool avx512bw = (regs[1] >> 30) & 1;
+    bool vnni = (regs[2] >> 11) & 1;
+    return avx512bw && vnni;
+}
+
+// F16C (vcvtph2ps / vcvtps2ph). Every AVX2 CPU so far has it, but it is a CPUID bit of its own
+static bool DetectF16c() {
+    unsigned int regs[4];
+    Cpuid(1, 0, regs);
+    return (regs[2] >> 29) & 1;
+}
+
+// AVX512_BF16, plus AVX-512BW + VL for the 16-bit masked loads, on top of what DetectSimdLevel() checked for AVX512
+static bool DetectAvx512Bf16() {
+    unsigned int regs[4];
+    Cpuid(0, 0, regs);
+    if (regs[0] < 7) return false;
+
+    Cpuid(7, 0, regs);
+    unsigned int maxSubleaf = regs[0];
+    bool avx512bw = (regs[1] >> 30) & 1;
+    bool avx512vl = (regs[1] >> 31) & 1;
+    if (maxSubleaf < 1 || !avx512bw || !avx512vl) return false;
+
+    Cpuid(7, 1, regs);
+    return (regs[0] >> 5) & 1;
+}
+
+#else // !NN_X86
+
+SimdLevel DetectSimdLevel() {
+    return SimdLevel::SCALAR;
+}
+
+#endif // NN_X86
+
+const char* SimdLevelName(SimdLevel level) {
+    switch (level) {
+    case SimdLevel::SSE2: return "sse2";
+    case SimdLevel::AVX2: return "avx2";
+    case SimdLevel::AVX512: return "avx512";
+    default: return "scalar";
+    }
+}
+
+const SimdKernels* SimdKernelsFor(SimdLevel level) {
+    static const SimdLevel best = DetectSimdLevel();
+    if ((int)level > (int)best) return nullptr;
+
+    switch (level) {
+#ifdef NN_X86
+    case SimdLevel::SSE2: return &SSE2_KERNELS;
+    case SimdLevel::AVX2: return &AVX2_KERNELS;
+    case SimdLevel::AVX512: {
+        static const bool vnni = DetectVnni();
+        return vnni ? &AVX512_VNNI_KERNELS : &AVX512_KERNELS;
+    }
+#endif
+    default: return &SCALAR_KERNELS;
+    }
+}
+
+static const SimdKernels& PickKernels() {
+    SimdLevel level = DetectSimdLevel();
+
+    // Optional override, for comparing paths on one machine
+    const char* forced = getenv("NEURALNET_SIMD");
+    if (forced) {
+        const SimdLevel levels[] = { SimdLevel::SCALAR, SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::AVX512 };
+        for (SimdLevel l : levels) {
+            if (strcmp(forced, SimdLevelName(l)) == 0 && (int)l < (int)level) level = l;
+        }
+    }
+
+    return *SimdKernelsFor(level);
+}
+
+const SimdKernels& Simd() {
+    static const SimdKernels& kernels = PickKernels();
+    return kernels;
+}
+
+const char* HalfTypeName(HalfType type) {
+    return type == HalfType::FP16 ? "fp16" : "bf16";
+}
+
+const HalfKernels* SimdHalfFor(HalfType type, SimdLevel level) {
+    static const SimdLevel best = DetectSimdLevel();
+    if ((int)level > (int)best) return nullptr;
+    bool bf16 = type == HalfType::BF16;
+
+#ifdef NN_X86
+    static const bool f16c = DetectF16c();
+    static const bool avx512bf16 = DetectAvx512Bf16();
+    if (level == SimdLevel::AVX512 && bf16 && avx512bf16) return &BF16_AVX512_KERNELS;
+    if ((level == SimdLevel::AVX2 || level == SimdLevel::AVX512) && f16c) return bf16 ? &BF16_AVX2_KERNELS : &FP16_F16C_KERNELS;
+#endif
+    return bf16 ? &BF16_SCALAR_KERNELS : &FP16_SCALAR_KERNELS;
+}
+
+const HalfKernels& SimdHalf(HalfType type) {
+    return *SimdHalfFor(type, Simd().level);
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+// --- SIMD KERNELS ---
+// Hand-vectorized versions of the hot inner loops, one set per instruction set.
+// The best set the CPU supports is picked at runtime (CPUID), so one binary runs
+// everywhere and still uses AVX2 / AVX-512 where they exist.
+//
+// exp() is a degree-5 polynomial after range reduction (Cephes style) in the vector sets:
+//   exp:      max relative error < 3e-7 on [-87, 88]
+//   sigmoid:  max absolute error < 2e-7
+//   tanh:     max absolute error < 3e-7
+//   softmax:  max absolute error < 2e-7 per output
+// The SCALAR set uses the C library functions and is the reference the others are checked against.
+
+enum class SimdLevel {
+	SCALAR,
+	SSE2,
+	AVX2,   // AVX2 + FMA
+	AVX512  // AVX-512F (int8 kernels also use AVX-512BW + VNNI when present)
+};
+
+struct SimdKernels {
+	SimdLevel level;
+	const char* name;
+
+	float (*dot)(const float* a, const float* b, int n);
+	void (*axpy)(float alpha, const float* x, float* y, int n); // y += alpha * x
+
+	// In-place activations over n floats
+	void (*relu)(float* x, int n);
+	void (*sigmoid)(float* x, int n);
+	void (*tanh)(float* x, int n);
+	void (*softmax)(float* x, int n); // subtracts the max first, so large inputs can't overflow
+
+	// Sgemm micro-kernel on packed slivers (see Gemm.cpp):
+	// C[rows x cols] += alpha * A (gemmMR x kc) * B (kc x gemmNR), rows <= gemmMR, cols <= gemmNR
+	int gemmMR;
+	int gemmNR;
+	void (*gemmKernel)(int kc, const float* a, const float* b, float alpha, float* C, int ldc, int rows, int cols);
+
+	// Int8 matrix-vector product (see Quantize.cpp): sums[r] = sum over i of x[i] * w[r * k + i]
+	// for r < rows. k must be a multiple of INT8_K_ALIGN and every x[i] must be 0..127,
+	// so the pairwise int16 sums of pmaddubsw can never saturate.
+	void (*gemvU8S8)(const unsigned char* x, const signed char* w, int k, int rows, int* sums);
+
+	// Sparse inputs (see SparseInputs in NeuNetCode.h).
+	// compactNonzero writes the index and value of every nonzero x[i], in order, and returns how many.
+	// It may stop early once more than limit were found (the result is then > limit but incomplete).
+	// dotSparse returns the sum over k < count of w[indices[k]] * values[k].
+	int (*compactNonzero)(const float* x, int n, int limit, int* indices, float* values);
+	float (*dotSparse)(const float* w, const int* indices, const float* values, int count);
+	// Below this share of nonzero inputs the sparse first-layer path beats the dense one (measured per level)
+	float sparseMaxDensity;
+};
+
+const int INT8_K_ALIGN = 64;
+
+// Highest level both the CPU and the OS (saved register state) support
+SimdLevel DetectSimdLevel();
+
+const char* SimdLevelName(SimdLevel level);
+
+// The kernels every hot loop uses. Picked once, on first call.
+// Set NEURALNET_SIMD=scalar|sse2|avx2|avx512 to force a lower level.
+const SimdKernels& Simd();
+
+// Kernels for one specific level, or nullptr if this CPU can't run them
+const SimdKernels* SimdKernelsFor(SimdLevel level);
+
+// --- HALF PRECISION ---
+// 16-bit storage formats (see MixedPrecision.h). Values are kept as their raw bits in unsigned short;
+// every product is formed and summed in fp32.
+enum class HalfType {
+	BF16, // bfloat16: fp32's 8-bit exponent, 7-bit mantissa. Same range as fp32, ~2-3 significant digits
+	FP16  // IEEE half: 5-bit exponent, 10-bit mantissa. Largest value 65504, ~3 significant digits
+};
+
+const char* HalfTypeName(HalfType type);
+
+struct HalfKernels {
+	HalfType type;
+	const char* name;
+
+	// sums[r] = sum over i of w[r * k + i] * x[i], for r < rows
+	void (*gemv)(const unsigned short* w, const unsigned short* x, int k, int rows, float* sums);
+	void (*axpy)(float alpha, const unsigned short* x, float* y, int n); // y += alpha * x, y in fp32
+	// Master-weight update: master += alpha * x in fp32, then half = master rounded (one pass over both)
+	void (*axpyMaster)(float alpha, const unsigned short* x, float* master, unsigned short* half, int n);
+	void (*fromFloat)(const float* x, unsigned short* out, int n); // round to nearest even
+	void (*toFloat)(const unsigned short* x, float* out, int n);
+};
+
+// Kernels for 16-bit values of the given type at the level Simd() runs at:
+// AVX-512 BF16 (vdpbf16ps) and F16C conversions where the CPU has them, integer bit tricks otherwise
+const HalfKernels& SimdHalf(HalfType type);
+
+// Kernels for one specific level (the scalar ones below AVX2), or nullptr if this CPU can't run that level
+const HalfKernels* SimdHalfFor(HalfType type, SimdLevel level);
@@ -0,0 +1,33 @@
+#pragma once
+
+// --- SIMD TARGETS ---
+// Shared by the files that hold vectorized kernels (Simd.cpp, Plan.cpp, FixedNetwork.h).
+// It pulls in every intrinsic header, so keep it out of the general-purpose headers.
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define NN_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// MSVC lets any function use any intrinsic; GCC/Clang need the target spelled out per function
+#if defined(_MSC_VER) && !defined(__clang__)
+#define NN_TARGET_SSE2
+#define NN_TARGET_AVX2
+#define NN_TARGET_AVX512
+#define NN_TARGET_AVX512VNNI
+#define NN_TARGET_F16C
+#define NN_TARGET_AVX512BF16
+#define NN_FORCE_INLINE __forceinline
+#else
+#define NN_TARGET_SSE2 __attribute__((target("sse2")))
+#define NN_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define NN_TARGET_AVX512 __attribute__((target("avx512f,avx2,fma")))
+#define NN_TARGET_AVX512VNNI __attribute__((target("avx512f,avx512bw,avx512vnni,avx2,fma")))
+#define NN_TARGET_F16C __attribute__((target("avx2,fma,f16c")))
+#define NN_TARGET_AVX512BF16 __attribute__((target("avx512f,avx512bw,avx512vl,avx512bf16,avx2,fma")))
+// A generic function forced into a targeted one is compiled (and vectorized) for that target
+#define NN_FORCE_INLINE inline __attribute__((always_inline))
+#endif
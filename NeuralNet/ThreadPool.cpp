@@ -0,0 +1,65 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(int numThreads)
+    : numThreads(numThreads < 1 ? 1 : numThreads), currentTask(nullptr),
+      generation(0), pending(0), stopping(false) {
+
+    for (int i = 1; i < this->numThreads; i++) {
+        threads.push_back(std::thread(&ThreadPool::workerLoop, this, i));
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& t : threads) t.join();
+}
+
+int ThreadPool::defaultThreadCount() {
+    unsigned int n = std::thread::hardware_concurrency();
+    return n == 0 ? 1 : (int)n;
+}
+
+void ThreadPool::run(const std::function<void(int)>& task) {
+    if (numThreads > 1) {
+        std::lock_guard<std::mutex> lock(mutex);
+        currentTask = &task;
+        pending = numThreads - 1;
+        generation++;
+    }
+    wake.notify_all();
+
+    task(0);
+
+    if (numThreads > 1) {
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this] { return pending == 0; });
+        currentTask = nullptr;
+    }
+}
+
+void ThreadPool::workerLoop(int index) {
+    long long seen = 0;
+
+    while (true) {
+        const std::function<void(int)>* task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping) return;
+            seen = generation;
+            task = currentTask;
+        }
+
+        (*task)(index);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending--;
+        }
+        done.notify_one();
+    }
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+// --- THREAD POOL ---
+// A fixed set of workers that all run the same task together, fork-join style:
+// run(task) calls task(0) ... task(size() - 1) in parallel and returns when every call is done.
+// The calling thread does task(0) itself, so a pool of 1 never starts a thread.
+class ThreadPool {
+
+public:
+	ThreadPool(int numThreads);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	void run(const std::function<void(int)>& task);
+	int size() const { return numThreads; }
+
+	// std::thread::hardware_concurrency(), but never 0
+	static int defaultThreadCount();
+
+private:
+	void workerLoop(int index);
+
+	int numThreads;
+	std::vector<std::thread> threads;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable done;
+	const std::function<void(int)>* currentTask;
+	long long generation; // bumped by every run()
+	int pending;          // workers still busy with the current generation
+	bool stopping;
+};
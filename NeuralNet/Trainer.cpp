@@ -0,0 +1,213 @@
+#include "Trainer.h"
+#include "Simd.h"
+#include "Profiler.h"
+#include <cmath>
+#include <iostream>
+
+// Worker 'index' of 'parts' gets [begin, end) out of count items
+static void SliceRange(int count, int parts, int index, int& begin, int& end) {
+    int base = count / parts;
+    int extra = count % parts;
+    begin = index * base + (index < extra ? index : extra);
+    end = begin + base + (index < extra ? 1 : 0);
+}
+
+void AccumulateStats(const float* outputs, const float* targets, int batchSize, int numOutputs, ActivationType outputType, TrainingStats& stats) {
+    for (int n = 0; n < batchSize; n++) {
+        const float* out = &outputs[(size_t)n * numOutputs];
+        const float* target = &targets[(size_t)n * numOutputs];
+
+        int predicted = 0, expected = 0;
+        double loss = 0.0;
+        for (int k = 0; k < numOutputs; k++) {
+            if (out[k] > out[predicted]) predicted = k;
+            if (target[k] > target[expected]) expected = k;
+
+            if (outputType == ActivationType::SOFTMAX) {
+                if (target[k] != 0.0f) loss -= target[k] * std::log(out[k] > 1e-12f ? out[k] : 1e-12f);
+            }
+            else {
+                float error = target[k] - out[k];
+                loss += 0.5 * error * error;
+            }
+        }
+        if (predicted == expected) stats.correct++;
+        stats.loss += loss;
+    }
+    stats.samples += batchSize;
+}
+
+ParallelTrainer::ParallelTrainer(Network& net, int numThreads, int maxBatch)
+    : net(net), maxBatch(maxBatch), pool(numThreads) {
+
+    int perThread = (maxBatch + pool.size() - 1) / pool.size();
+    for (int t = 0; t < pool.size(); t++) {
+        workspaces.push_back(BatchWorkspace(net, perThread));
+        gradients.push_back(Gradients(net));
+    }
+    threadStats.resize(pool.size());
+}
+
+int ParallelTrainer::computeGradients(const float* inputs, const float* targets, int batchSize) {
+    if (batchSize <= 0) return 0;
+    if (batchSize > maxBatch) {
+        std::cout << "error: batch of " << batchSize << " is larger than the trainer's " << maxBatch << std::endl;
+        return 0;
+    }
+    if (net.isReadOnly()) {
+        std::cout << "error: this network views a model file read-only, train a copy of it" << std::endl;
+        return 0;
+    }
+
+    // Small batches use fewer threads rather than handing anyone an empty slice
+    int activeThreads = batchSize < pool.size() ? batchSize : pool.size();
+    int numIn = net.numInputs();
+    int numOut = net.numOutputs();
+
+    pool.run([&](int t) {
+        if (t >= activeThreads) return;
+
+        int begin, end;
+        SliceRange(batchSize, activeThreads, t, begin, end);
+        net.computeGradients(&inputs[(size_t)begin * numIn], &targets[(size_t)begin * numOut],
+            end - begin, workspaces[t], gradients[t]);
+
+        // The forward half of the backward pass left this slice's outputs in the workspace
+        AccumulateStats(workspaces[t].activations.back().data(), &targets[(size_t)begin * numOut],
+            end - begin, numOut, net.layers.back().actType, threadStats[t]);
+    });
+    return activeThreads;
+}
+
+TrainingStats ParallelTrainer::stats() const {
+    TrainingStats total;
+    for (const TrainingStats& s : threadStats) total.add(s);
+    return total;
+}
+
+void ParallelTrainer::resetStats() {
+    for (TrainingStats& s : threadStats) s = TrainingStats();
+}
+
+TrainingStats ParallelTrainer::evaluate(const float* inputs, const float* targets, int numSamples) {
+    std::vector<TrainingStats> partial(pool.size());
+    if (numSamples <= 0 || net.layers.empty()) return TrainingStats();
+    int numIn = net.numInputs();
+    int numOut = net.numOutputs();
+
+    // Every thread scores its own contiguous share, a workspace-full at a time
+    pool.run([&](int t) {
+        int begin, end;
+        SliceRange(numSamples, pool.size(), t, begin, end);
+        BatchWorkspace& ws = workspaces[t];
+        for (int n = begin; n < end; n += ws.maxBatch) {
+            int count = (end - n < ws.maxBatch) ? end - n : ws.maxBatch;
+            const float* outputs = net.feedForwardBatch(&inputs[(size_t)n * numIn], count, ws);
+            AccumulateStats(outputs, &targets[(size_t)n * numOut], count, numOut, net.layers.back().actType, partial[t]);
+        }
+    });
+
+    TrainingStats total;
+    for (const TrainingStats& s : partial) total.add(s);
+    return total;
+}
+
+void ParallelTrainer::trainBatch(const float* inputs, const float* targets, int batchSize, float learningRate) {
+    // 1. Gradient of every thread's slice of the batch
+    int activeThreads = computeGradients(inputs, targets, batchSize);
+    if (activeThreads == 0) return;
+    float step = learningRate / batchSize;
+
+    pool.run([&](int t) {
+        // 2. Sum the slices and update this thread's share of the weights
+        if (t < activeThreads) reduceAndApply(t, activeThreads, step);
+    });
+}
+
+void ParallelTrainer::trainBatch(const float* inputs, const float* targets, int batchSize, Optimizer& optimizer) {
+    int activeThreads = computeGradients(inputs, targets, batchSize);
+    if (activeThreads == 0) return;
+
+    optimizer.beginStep();
+    pool.run([&](int t) {
+        if (t < activeThreads) reduceAndOptimize(t, activeThreads, batchSize, optimizer);
+    });
+}
+
+void ParallelTrainer::reduceAndApply(int thread, int activeThreads, float step) {
+    const SimdKernels& simd = Simd();
+
+    for (int i = 0; i < net.layers.size(); i++) {
+        Layer& layer = net.layers[i];
+
+        int begin, end;
+        SliceRange((int)layer.weightCount(), activeThreads, thread, begin, end);
+        NN_PROFILE_SCOPE(UPDATE, i, 2.0 * activeThreads * (end - begin), 4.0 * (activeThreads + 2) * (end - begin));
+        for (int t = 0; t < activeThreads; t++) {
+            simd.axpy(step, gradients[t].weights[i].data() + begin, layer.weights.data() + begin, end - begin);
+        }
+
+        SliceRange((int)layer.biasCount(), activeThreads, thread, begin, end);
+        for (int t = 0; t < activeThreads; t++) {
+            simd.axpy(step, gradients[t].biases[i].data() + begin, layer.biases.data() + begin, end - begin);
+        }
+    }
+}
+
+void ParallelTrainer::reduceAndOptimize(int thread, int activeThreads, int batchSize, Optimizer& optimizer) {
+    const SimdKernels& simd = Simd();
+    float scale = 1.0f / batchSize;
+
+    // The update rules aren't linear, so each range is summed into thread 0's buffer first
+    for (int i = 0; i < net.layers.size(); i++) {
+        Layer& layer = net.layers[i];
+
+        int begin, end;
+        SliceRange((int)layer.weightCount(), activeThreads, thread, begin, end);
+        float* sum = gradients[0].weights[i].data();
+        {
+            NN_PROFILE_SCOPE(REDUCE, i, (activeThreads - 1.0) * (end - begin), 12.0 * (activeThreads - 1.0) * (end - begin));
+            for (int t = 1; t < activeThreads; t++) simd.axpy(1.0f, gradients[t].weights[i].data() + begin, sum + begin, end - begin);
+        }
+        optimizer.updateRange(net, i, false, begin, end, sum, scale);
+
+        SliceRange((int)layer.biasCount(), activeThreads, thread, begin, end);
+        sum = gradients[0].biases[i].data();
+        for (int t = 1; t < activeThreads; t++) simd.axpy(1.0f, gradients[t].biases[i].data() + begin, sum + begin, end - begin);
+        optimizer.updateRange(net, i, true, begin, end, sum, scale);
+    }
+}
+
+// Samples are handed out this many at a time, so the shared counter is not a hot spot
+static const int HOGWILD_CHUNK = 16;
+
+HogwildTrainer::HogwildTrainer(Network& net, int numThreads)
+    : net(net), pool(numThreads), nextSample(0) {
+
+    for (int t = 0; t < pool.size(); t++) workspaces.push_back(Workspace(net));
+}
+
+void HogwildTrainer::trainEpoch(const float* inputs, const float* targets, int numSamples, float learningRate, const int* order) {
+    if (net.isReadOnly()) {
+        std::cout << "error: this network views a model file read-only, train a copy of it" << std::endl;
+        return;
+    }
+    int numIn = net.numInputs();
+    int numOut = net.numOutputs();
+    nextSample.store(0);
+
+    pool.run([&](int t) {
+        Workspace& ws = workspaces[t];
+        while (true) {
+            // Relaxed is enough: the counter only hands out indices, it orders nothing else
+            int begin = nextSample.fetch_add(HOGWILD_CHUNK, std::memory_order_relaxed);
+            if (begin >= numSamples) break;
+            int end = (begin + HOGWILD_CHUNK < numSamples) ? begin + HOGWILD_CHUNK : numSamples;
+
+            for (int n = begin; n < end; n++) {
+                size_t sample = order ? (size_t)order[n] : (size_t)n;
+                net.backPropagate(&inputs[sample * numIn], &targets[sample * numOut], learningRate, ws);
+            }
+        }
+    });
+}
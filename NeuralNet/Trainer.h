@@ -0,0 +1,97 @@
+#pragma once
+#include <vector>
+#include <atomic>
+#include "NeuNetCode.h"
+#include "ThreadPool.h"
+#include "Optimizer.h"
+
+// --- TRAINING STATS ---
+// Loss and accuracy over a run of samples. A sample counts as correct when its largest output is
+// at the position of its largest target. The loss is cross-entropy for softmax outputs and half the
+// squared error otherwise, matching the output deltas the backward pass uses.
+struct TrainingStats {
+	TrainingStats() : samples(0), correct(0), loss(0.0) {}
+
+	long long samples;
+	long long correct;
+	double loss; // summed over the samples
+
+	float accuracy() const { return samples ? (float)((double)correct / samples) : 0.0f; }
+	float meanLoss() const { return samples ? (float)(loss / samples) : 0.0f; }
+	void add(const TrainingStats& other) {
+		samples += other.samples;
+		correct += other.correct;
+		loss += other.loss;
+	}
+};
+
+// Adds batchSize samples (outputs and targets are batchSize x numOutputs) to stats
+void AccumulateStats(const float* outputs, const float* targets, int batchSize, int numOutputs, ActivationType outputType, TrainingStats& stats);
+
+// --- PARALLEL TRAINER ---
+// Synchronous data-parallel mini-batch training.
+// Every batch is cut into one slice per thread; each thread runs forward + backward on its slice
+// with its own BatchWorkspace and Gradients, so the passes share nothing but the (read-only) weights.
+// The per-thread gradients are then reduced and applied in parallel as well: each thread owns a
+// fixed range of every parameter array, sums that range across all threads and updates it.
+// No locks or atomics on the weights, and the result is the same batch-averaged step trainBatch takes.
+class ParallelTrainer {
+
+public:
+	// maxBatch is the largest batch trainBatch will be given
+	ParallelTrainer(Network& net, int numThreads, int maxBatch);
+
+	void trainBatch(const float* inputs, const float* targets, int batchSize, float learningRate);
+	// Same, with the update rule and learning rate of optimizer (one optimizer step per batch)
+	void trainBatch(const float* inputs, const float* targets, int batchSize, Optimizer& optimizer);
+
+	// Loss and accuracy of every sample trained on since the last resetStats(), read off the output
+	// activations the backward pass leaves in the workspaces: no extra forward pass. Each sample is
+	// scored with the weights of the step it took part in, as they were BEFORE that step.
+	TrainingStats stats() const;
+	void resetStats();
+
+	// Loss and accuracy of the current weights on a whole dataset (forward passes only, on every thread)
+	TrainingStats evaluate(const float* inputs, const float* targets, int numSamples);
+
+	int numThreads() const { return pool.size(); }
+
+private:
+	// Per-thread gradients of the batch; returns the number of threads that got a slice (0 if none)
+	int computeGradients(const float* inputs, const float* targets, int batchSize);
+	void reduceAndApply(int thread, int activeThreads, float step);
+	void reduceAndOptimize(int thread, int activeThreads, int batchSize, Optimizer& optimizer);
+
+	Network& net;
+	int maxBatch;
+	ThreadPool pool;
+	std::vector<BatchWorkspace> workspaces; // one per thread
+	std::vector<Gradients> gradients;       // one per thread
+	std::vector<TrainingStats> threadStats; // one per thread
+};
+
+// --- HOGWILD TRAINER ---
+// Asynchronous lock-free SGD (Hogwild). Every thread pulls samples from a shared counter and runs the
+// ordinary per-sample Network::backPropagate on the shared weights, with no locks and no barrier.
+// Threads can read a weight another thread is writing, and two updates can land on the same weight
+// with one of them lost. Those races are deliberate: each float store is a single aligned write (never torn
+// on x86/x64), and for MNIST-like inputs most updates touch few of the same weights at the same time, so
+// the lost work is small noise on top of SGD. The result is NOT deterministic and not equal to any
+// sequential order. Use ParallelTrainer when reproducible steps matter.
+class HogwildTrainer {
+
+public:
+	HogwildTrainer(Network& net, int numThreads);
+
+	// One pass over numSamples samples (inputs numSamples x numInputs(), targets numSamples x numOutputs()).
+	// order, if given, is the visiting order (numSamples indices), e.g. a per-epoch shuffle.
+	void trainEpoch(const float* inputs, const float* targets, int numSamples, float learningRate, const int* order = nullptr);
+
+	int numThreads() const { return pool.size(); }
+
+private:
+	Network& net;
+	ThreadPool pool;
+	std::vector<Workspace> workspaces; // one per thread
+	std::atomic<int> nextSample;
+};
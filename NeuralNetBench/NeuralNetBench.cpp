@@ -0,0 +1,2871 @@
+// NeuralNetBench.cpp : Console micro-benchmarks for the NeuNetCode library.
+// Everything runs on synthetic data, so the MNIST files are not needed.
+
+#include "NeuNetCode.h"
+#include "Conv.h"
+#include "Gemm.h"
+#include "Simd.h"
+#include "Trainer.h"
+#include "MnistDataset.h"
+#include "DataStream.h"
+#include "ModelFile.h"
+#include "Quantize.h"
+#include "MixedPrecision.h"
+#include "Plan.h"
+#include "FixedNetwork.h"
+#include "Optimizer.h"
+#include "Profiler.h"
+#include "MnistLoader.h"
+#include "Preprocess.h"
+#include "Serve.h"
+#include <vector>
+#include <cstdlib>
+#include <cmath>
+#include <chrono>
+#include <atomic>
+#include <new>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <fstream>
+#include <cstdio>
+#include <memory>
+#include <thread>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <unistd.h>
+#endif
+
+// --- HELPER: TIMER ---
+static double SecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// --- HELPER: ALLOCATION COUNTER ---
+// Every global new in this program bumps the counter, so a section can check
+// that a code path never touches the heap.
+static std::atomic<long long> g_allocations(0);
+
+// Every operator here is kept out of line. Inlined at -O3, GCC sees malloc() behind new and free()
+// behind delete at the same call site and warns about a mismatch (-Wmismatched-new-delete).
+#ifdef _MSC_VER
+#define BENCH_NOINLINE __declspec(noinline)
+#else
+#define BENCH_NOINLINE __attribute__((noinline))
+#endif
+BENCH_NOINLINE void* operator new(size_t size) {
+    g_allocations++;
+    void* p = malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+BENCH_NOINLINE void* operator new[](size_t size) {
+    return operator new(size);
+}
+BENCH_NOINLINE void operator delete(void* p) noexcept { free(p); }
+BENCH_NOINLINE void operator delete[](void* p) noexcept { free(p); }
+BENCH_NOINLINE void operator delete(void* p, size_t) noexcept { free(p); }
+BENCH_NOINLINE void operator delete[](void* p, size_t) noexcept { free(p); }
+
+// Results are written here so the optimizer can't throw the benchmarked work away
+static volatile float g_sink = 0.0f;
+
+// --- HELPER: RESIDENT MEMORY ---
+static double ResidentMB() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0.0;
+    return counters.WorkingSetSize / (1024.0 * 1024.0);
+#else
+    long pages = 0, resident = 0;
+    FILE* f = fopen("/proc/self/statm", "r");
+    if (!f) return 0.0;
+    if (fscanf(f, "%ld %ld", &pages, &resident) != 2) resident = 0;
+    fclose(f);
+    return resident * (double)sysconf(_SC_PAGESIZE) / (1024.0 * 1024.0);
+#endif
+}
+
+// --- HELPER: FAKE IMAGES ---
+static std::vector<std::vector<float>> MakeInputs(int count, int size) {
+    std::vector<std::vector<float>> inputs(count, std::vector<float>(size));
+    for (auto& img : inputs) {
+        for (float& px : img) px = (float)rand() / RAND_MAX;
+    }
+    return inputs;
+}
+
+// --- LEGACY LAYOUT ---
+// The old storage: every neuron owns its own heap-allocated weights vector.
+// Kept here only so the layout benchmark has a "before" to compare against.
+namespace legacy {
+
+struct Node {
+    std::vector<float> weights;
+    float bias = 0.1f;
+    float output_cache = 0.0f;
+    float delta = 0.0f;
+};
+
+struct Layer {
+    std::vector<Node> neurons;
+    bool softmax = false;
+};
+
+struct Network {
+    std::vector<Layer> layers;
+
+    Network(const std::vector<int>& hidden, int outputs, int inputs) {
+        int prev = inputs;
+        for (size_t l = 0; l <= hidden.size(); l++) {
+            int count = (l < hidden.size()) ? hidden[l] : outputs;
+            Layer layer;
+            layer.softmax = (l == hidden.size());
+            for (int n = 0; n < count; n++) {
+                Node node;
+                for (int i = 0; i < prev; i++) node.weights.push_back(((float)rand() / RAND_MAX) * 0.2f - 0.1f);
+                layer.neurons.push_back(node);
+            }
+            layers.push_back(layer);
+            prev = count;
+        }
+    }
+
+    std::vector<float> feedForward(std::vector<float> inputs) {
+        for (Layer& layer : layers) forwardLayer(layer, inputs);
+        return inputs;
+    }
+
+    void backPropagate(std::vector<float> inputs, std::vector<float> targets, float learningRate) {
+        // Forward once, remembering every layer's inputs
+        std::vector<std::vector<float>> layerInputs;
+        std::vector<float> current = inputs;
+        layerInputs.push_back(current);
+        for (Layer& layer : layers) {
+            forwardLayer(layer, current);
+            layerInputs.push_back(current);
+        }
+
+        Layer& out = layers.back();
+        for (size_t i = 0; i < out.neurons.size(); i++) out.neurons[i].delta = targets[i] - out.neurons[i].output_cache;
+
+        for (int l = (int)layers.size() - 2; l >= 0; l--) {
+            Layer& cur = layers[l];
+            Layer& next = layers[l + 1];
+            for (size_t j = 0; j < cur.neurons.size(); j++) {
+                float errorSum = 0.0f;
+                for (size_t k = 0; k < next.neurons.size(); k++) errorSum += next.neurons[k].weights[j] * next.neurons[k].delta;
+                cur.neurons[j].delta = errorSum * (cur.neurons[j].output_cache > 0 ? 1.0f : 0.0f);
+            }
+        }
+
+        for (size_t l = 0; l < layers.size(); l++) {
+            std::vector<float> in = layerInputs[l];
+            for (Node& n : layers[l].neurons) {
+                for (size_t i = 0; i < n.weights.size(); i++) n.weights[i] += learningRate * (n.delta * in[i]);
+                n.bias += learningRate * n.delta;
+            }
+        }
+    }
+
+    static void forwardLayer(Layer& layer, std::vector<float>& inputs) {
+        std::vector<float> outputs;
+        for (Node& n : layer.neurons) {
+            float sum = n.bias;
+            for (size_t i = 0; i < n.weights.size(); i++) sum += inputs[i] * n.weights[i];
+            n.output_cache = layer.softmax ? sum : (sum > 0 ? sum : 0.0f);
+            outputs.push_back(n.output_cache);
+        }
+        if (layer.softmax) {
+            float sumExp = 0.0f;
+            for (float& o : outputs) { o = exp(o); sumExp += o; }
+            for (size_t i = 0; i < outputs.size(); i++) layer.neurons[i].output_cache = outputs[i] /= sumExp;
+        }
+        inputs = outputs;
+    }
+};
+
+} // namespace legacy
+
+// --- BENCH: WEIGHT LAYOUT (per-Node vectors vs contiguous Layer matrix) ---
+template <typename Net>
+static void TimeNetwork(const char* label, Net& net, const std::vector<std::vector<float>>& inputs, int passes) {
+    std::vector<float> targets(10, 0.0f);
+    targets[3] = 1.0f;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int p = 0; p < passes; p++) {
+        for (const auto& img : inputs) g_sink = net.feedForward(img)[0];
+    }
+    double fwd = SecondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    for (int p = 0; p < passes; p++) {
+        for (const auto& img : inputs) net.backPropagate(img, targets, 0.001f);
+    }
+    double bwd = SecondsSince(start);
+
+    double samples = (double)passes * inputs.size();
+    std::cout << "   " << std::left << std::setw(12) << label << std::right
+        << " forward: " << std::setw(10) << (int)(samples / fwd) << " samples/s"
+        << " | train step: " << std::setw(10) << (int)(samples / bwd) << " samples/s\n";
+}
+
+// Runs a Network through a caller-owned Workspace (the allocation-free path)
+struct WorkspaceNetwork {
+    Network& net;
+    Workspace ws;
+
+    WorkspaceNetwork(Network& n) : net(n), ws(n) {}
+    const std::vector<float>& feedForward(const std::vector<float>& inputs) { return net.feedForward(inputs.data(), ws); }
+    void backPropagate(const std::vector<float>& inputs, const std::vector<float>& targets, float learningRate) {
+        net.backPropagate(inputs.data(), targets.data(), learningRate, ws);
+    }
+};
+
+static void BenchLayout() {
+    std::cout << "\n[Layout] per-Node vectors vs contiguous Layer storage\n";
+
+    const int hiddenSizes[] = { 100, 300, 1000 };
+    for (int hidden : hiddenSizes) {
+        std::cout << " 784 -> " << hidden << " -> 10\n";
+        std::vector<std::vector<float>> inputs = MakeInputs(256, 784);
+        int passes = (hidden >= 1000) ? 2 : 8;
+
+        legacy::Network before({ hidden }, 10, 784);
+        TimeNetwork("legacy", before, inputs, passes);
+
+        Network after({ hidden }, 10, 784);
+        TimeNetwork("contiguous", after, inputs, passes);
+
+        WorkspaceNetwork withWorkspace(after);
+        TimeNetwork("workspace", withWorkspace, inputs, passes);
+    }
+}
+
+// --- BENCH: MINI-BATCH TRAINING vs PER-SAMPLE SGD ---
+static void BenchBatch() {
+    std::cout << "\n[Batch] training throughput, 784 -> 100 -> 10\n";
+
+    const int numSamples = 2048;
+    std::vector<float> inputs((size_t)numSamples * 784);
+    std::vector<float> targets((size_t)numSamples * 10, 0.0f);
+    for (float& px : inputs) px = (float)rand() / RAND_MAX;
+    for (int n = 0; n < numSamples; n++) targets[(size_t)n * 10 + rand() % 10] = 1.0f;
+
+    // Baseline: the per-sample path
+    {
+        Network net({ 100 }, 10, 784);
+        Workspace ws(net);
+        auto start = std::chrono::steady_clock::now();
+        for (int n = 0; n < numSamples; n++) {
+            net.backPropagate(&inputs[(size_t)n * 784], &targets[(size_t)n * 10], 0.01f, ws);
+        }
+        double secs = SecondsSince(start);
+        std::cout << "   per-sample      " << std::setw(10) << (int)(numSamples / secs) << " samples/s\n";
+    }
+
+    const int batchSizes[] = { 1, 8, 32, 64, 128, 256 };
+    for (int batchSize : batchSizes) {
+        Network net({ 100 }, 10, 784);
+        BatchWorkspace ws(net, batchSize);
+        auto start = std::chrono::steady_clock::now();
+        for (int n = 0; n + batchSize <= numSamples; n += batchSize) {
+            net.trainBatch(&inputs[(size_t)n * 784], &targets[(size_t)n * 10], batchSize, 0.01f * batchSize, ws);
+        }
+        double secs = SecondsSince(start);
+        std::cout << "   batch " << std::left << std::setw(9) << batchSize << std::right
+            << " " << std::setw(10) << (int)((numSamples / batchSize) * batchSize / secs) << " samples/s\n";
+    }
+}
+
+// --- BENCH: SGEMM vs NAIVE TRIPLE LOOP ---
+// C (M x N) = A (M x K) * B^T, with B stored N x K like a Layer's weight matrix
+static void NaiveGemm(int M, int N, int K, const float* A, const float* B, float* C) {
+    for (int i = 0; i < M; i++) {
+        for (int j = 0; j < N; j++) {
+            float sum = 0.0f;
+            for (int k = 0; k < K; k++) sum += A[(size_t)i * K + k] * B[(size_t)j * K + k];
+            C[(size_t)i * N + j] = sum;
+        }
+    }
+}
+
+static void BenchGemm() {
+    std::cout << "\n[Sgemm] blocked kernel vs naive loop (batch x inputs -> outputs)\n";
+
+    struct Shape { int M, N, K; };
+    const Shape shapes[] = {
+        { 256, 100, 784 },  // first layer forward, 784x100
+        { 256, 10, 100 },   // output layer forward, 100x10
+        { 256, 1000, 784 }, // wide hidden layer
+        { 256, 1000, 1000 },
+    };
+
+    for (const Shape& sh : shapes) {
+        std::vector<float> A((size_t)sh.M * sh.K), B((size_t)sh.N * sh.K);
+        std::vector<float> C1((size_t)sh.M * sh.N), C2((size_t)sh.M * sh.N);
+        for (float& v : A) v = (float)rand() / RAND_MAX - 0.5f;
+        for (float& v : B) v = (float)rand() / RAND_MAX - 0.5f;
+
+        double flops = 2.0 * sh.M * sh.N * sh.K;
+        int reps = (int)(2e9 / flops) + 1;
+
+        auto start = std::chrono::steady_clock::now();
+        for (int r = 0; r < reps; r++) NaiveGemm(sh.M, sh.N, sh.K, A.data(), B.data(), C1.data());
+        double naive = SecondsSince(start) / reps;
+
+        start = std::chrono::steady_clock::now();
+        for (int r = 0; r < reps; r++) Sgemm(false, true, sh.M, sh.N, sh.K, 1.0f, A.data(), sh.K, B.data(), sh.K, 0.0f, C2.data(), sh.N);
+        double blocked = SecondsSince(start) / reps;
+
+        float maxErr = 0.0f;
+        for (size_t i = 0; i < C1.size(); i++) maxErr = std::max(maxErr, std::fabs(C1[i] - C2[i]));
+
+        std::cout << "   " << std::setw(4) << sh.M << " x " << std::setw(4) << sh.K << " -> " << std::setw(4) << sh.N
+            << "   naive: " << std::fixed << std::setprecision(2) << std::setw(7) << flops / naive * 1e-9 << " GFLOP/s"
+            << "   sgemm: " << std::setw(7) << flops / blocked * 1e-9 << " GFLOP/s"
+            << "   max |diff|: " << std::scientific << std::setprecision(1) << maxErr << std::defaultfloat << "\n";
+    }
+}
+
+// --- CHECK + BENCH: EVERY SIMD LEVEL AGAINST THE SCALAR REFERENCE ---
+static float MaxAbsDiff(const std::vector<float>& a, const std::vector<float>& b) {
+    float maxErr = 0.0f;
+    for (size_t i = 0; i < a.size(); i++) maxErr = std::max(maxErr, std::fabs(a[i] - b[i]));
+    return maxErr;
+}
+
+static bool CheckSimd() {
+    std::cout << "\n[Simd] detected: " << SimdLevelName(DetectSimdLevel()) << ", in use: " << Simd().name << "\n";
+
+    const SimdKernels& ref = *SimdKernelsFor(SimdLevel::SCALAR);
+    const SimdLevel levels[] = { SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::AVX512 };
+    bool ok = true;
+
+    // Odd length so every kernel runs its tail code too
+    const int n = 789;
+    std::vector<float> x(n), y(n);
+    for (int i = 0; i < n; i++) {
+        x[i] = ((float)rand() / RAND_MAX - 0.5f) * 20.0f;
+        y[i] = (float)rand() / RAND_MAX - 0.5f;
+    }
+
+    for (SimdLevel level : levels) {
+        const SimdKernels* k = SimdKernelsFor(level);
+        if (!k) {
+            std::cout << "   " << std::left << std::setw(9) << SimdLevelName(level) << std::right << " not supported by this CPU\n";
+            continue;
+        }
+
+        // Dot: compare relative to the magnitude of the sum of |products|
+        float scaleSum = 0.0f;
+        for (int i = 0; i < n; i++) scaleSum += std::fabs(x[i] * y[i]);
+        float dotErr = std::fabs(k->dot(x.data(), y.data(), n) - ref.dot(x.data(), y.data(), n)) / scaleSum;
+
+        std::vector<float> a1 = y, a2 = y;
+        ref.axpy(0.37f, x.data(), a1.data(), n);
+        k->axpy(0.37f, x.data(), a2.data(), n);
+        float axpyErr = MaxAbsDiff(a1, a2);
+
+        float actErr[4];
+        void (*SimdKernels::* acts[4])(float*, int) = { &SimdKernels::relu, &SimdKernels::sigmoid, &SimdKernels::tanh, &SimdKernels::softmax };
+        for (int f = 0; f < 4; f++) {
+            std::vector<float> r1 = x, r2 = x;
+            (ref.*acts[f])(r1.data(), n);
+            (k->*acts[f])(r2.data(), n);
+            actErr[f] = MaxAbsDiff(r1, r2);
+        }
+
+        // Micro-kernel on one packed tile (kc = 37) against a plain loop
+        int mr = k->gemmMR, nr = k->gemmNR, kc = 37;
+        std::vector<float> pa((size_t)mr * kc), pb((size_t)kc * nr), c1((size_t)mr * nr, 1.0f), c2 = c1;
+        for (float& v : pa) v = (float)rand() / RAND_MAX - 0.5f;
+        for (float& v : pb) v = (float)rand() / RAND_MAX - 0.5f;
+        for (int r = 0; r < mr; r++)
+            for (int c = 0; c < nr; c++)
+                for (int kk = 0; kk < kc; kk++) c1[(size_t)r * nr + c] += 0.5f * pa[(size_t)kk * mr + r] * pb[(size_t)kk * nr + c];
+        k->gemmKernel(kc, pa.data(), pb.data(), 0.5f, c2.data(), nr, mr, nr);
+        float gemmErr = MaxAbsDiff(c1, c2);
+
+        bool pass = dotErr < 1e-5f && axpyErr < 1e-5f && actErr[0] == 0.0f && actErr[1] < 2e-7f
+            && actErr[2] < 3e-7f && actErr[3] < 2e-7f && gemmErr < 1e-5f;
+        ok = ok && pass;
+
+        std::cout << "   " << std::left << std::setw(9) << k->name << std::right << std::scientific << std::setprecision(1)
+            << " dot " << dotErr << "  axpy " << axpyErr << "  relu " << actErr[0] << "  sigmoid " << actErr[1]
+            << "  tanh " << actErr[2] << "  softmax " << actErr[3] << "  gemm " << gemmErr
+            << std::defaultfloat << (pass ? "  (OK)\n" : "  (FAILED)\n");
+    }
+
+    // Throughput per level on a 784-wide row
+    std::vector<float> row(784), w(784);
+    for (int i = 0; i < 784; i++) { row[i] = (float)rand() / RAND_MAX; w[i] = (float)rand() / RAND_MAX - 0.5f; }
+    const SimdLevel all[] = { SimdLevel::SCALAR, SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::AVX512 };
+    for (SimdLevel level : all) {
+        const SimdKernels* k = SimdKernelsFor(level);
+        if (!k) continue;
+        const int reps = 200000;
+
+        auto start = std::chrono::steady_clock::now();
+        for (int r = 0; r < reps; r++) g_sink = k->dot(row.data(), w.data(), 784);
+        double dotNs = SecondsSince(start) / reps * 1e9;
+
+        std::vector<float> buf = row;
+        start = std::chrono::steady_clock::now();
+        for (int r = 0; r < reps / 10; r++) { buf[r % 784] = -1.0f; k->sigmoid(buf.data(), 784); }
+        double sigNs = SecondsSince(start) / (reps / 10) * 1e9;
+
+        std::cout << "   " << std::left << std::setw(9) << k->name << std::right << std::fixed << std::setprecision(1)
+            << " dot(784): " << std::setw(7) << dotNs << " ns   sigmoid(784): " << std::setw(7) << sigNs << " ns\n" << std::defaultfloat;
+    }
+
+    return ok;
+}
+
+// --- CHECK: STEADY-STATE PASSES MUST NOT ALLOCATE ---
+static bool CheckAllocations() {
+    std::cout << "\n[Allocations] forward + backward through a Workspace\n";
+
+    Network net({ 100, 50 }, 10, 784);
+    Workspace ws(net);
+    std::vector<std::vector<float>> inputs = MakeInputs(64, 784);
+    std::vector<float> targets(10, 0.0f);
+    targets[7] = 1.0f;
+
+    // One pass first: a thread's first pass may set up per-thread state (the profiler's counters)
+    net.backPropagate(inputs[0].data(), targets.data(), 0.01f, ws);
+    long long before = g_allocations;
+    for (const auto& img : inputs) {
+        g_sink = net.feedForward(img.data(), ws)[0];
+        net.backPropagate(img.data(), targets.data(), 0.01f, ws);
+    }
+    long long count = g_allocations - before;
+
+    std::cout << "   " << count << " heap allocations over " << inputs.size() << " samples"
+        << (count == 0 ? "  (OK)\n" : "  (FAILED)\n");
+    return count == 0;
+}
+
+// --- CHECK + BENCH: DATA-PARALLEL TRAINING ACROSS THREADS ---
+static void MakeBatchData(int numSamples, std::vector<float>& inputs, std::vector<float>& targets) {
+    inputs.assign((size_t)numSamples * 784, 0.0f);
+    targets.assign((size_t)numSamples * 10, 0.0f);
+    for (float& px : inputs) px = (float)rand() / RAND_MAX;
+    for (int n = 0; n < numSamples; n++) targets[(size_t)n * 10 + rand() % 10] = 1.0f;
+}
+
+static float MaxWeightDiff(const Network& a, const Network& b) {
+    float worst = 0.0f;
+    for (int i = 0; i < a.layers.size(); i++) {
+        worst = std::max(worst, MaxAbsDiff(a.layers[i].weights, b.layers[i].weights));
+        worst = std::max(worst, MaxAbsDiff(a.layers[i].biases, b.layers[i].biases));
+    }
+    return worst;
+}
+
+// The parallel step must be the same step trainBatch takes (up to float summation order)
+static bool CheckParallel() {
+    std::cout << "\n[Parallel] ParallelTrainer vs single-threaded trainBatch\n";
+
+    const int batchSize = 64;
+    std::vector<float> inputs, targets;
+    MakeBatchData(batchSize * 4, inputs, targets);
+
+    bool ok = true;
+    const int threadCounts[] = { 1, 3, 4 };
+    for (int threads : threadCounts) {
+        srand(99);
+        Network reference({ 100, 50 }, 10, 784);
+        srand(99);
+        Network parallel({ 100, 50 }, 10, 784);
+
+        BatchWorkspace ws(reference, batchSize);
+        ParallelTrainer trainer(parallel, threads, batchSize);
+        for (int n = 0; n < 4; n++) {
+            reference.trainBatch(&inputs[(size_t)n * batchSize * 784], &targets[(size_t)n * batchSize * 10], batchSize, 0.5f, ws);
+            trainer.trainBatch(&inputs[(size_t)n * batchSize * 784], &targets[(size_t)n * batchSize * 10], batchSize, 0.5f);
+        }
+
+        float diff = MaxWeightDiff(reference, parallel);
+        bool pass = diff < 1e-5f;
+        ok = ok && pass;
+        std::cout << "   " << threads << " threads: max weight difference " << diff << (pass ? "  (OK)\n" : "  (FAILED)\n");
+    }
+    return ok;
+}
+
+static void BenchThreads() {
+    std::cout << "\n[Threads] data-parallel training, 784 -> 256 -> 10, batch 256 ("
+        << ThreadPool::defaultThreadCount() << " hardware threads)\n";
+
+    const int numSamples = 4096;
+    const int batchSize = 256;
+    std::vector<float> inputs, targets;
+    MakeBatchData(numSamples, inputs, targets);
+
+    double baseline = 0.0;
+    const int threadCounts[] = { 1, 2, 4, 8, 16 };
+    for (int threads : threadCounts) {
+        Network net({ 256 }, 10, 784);
+        ParallelTrainer trainer(net, threads, batchSize);
+        trainer.trainBatch(inputs.data(), targets.data(), batchSize, 0.01f); // warm-up
+
+        auto start = std::chrono::steady_clock::now();
+        for (int n = 0; n + batchSize <= numSamples; n += batchSize) {
+            trainer.trainBatch(&inputs[(size_t)n * 784], &targets[(size_t)n * 10], batchSize, 0.01f);
+        }
+        double rate = numSamples / SecondsSince(start);
+        if (threads == 1) baseline = rate;
+
+        std::cout << "   " << std::setw(2) << threads << " threads " << std::setw(10) << (int)rate << " samples/s  "
+            << std::fixed << std::setprecision(2) << rate / baseline << "x\n" << std::defaultfloat;
+    }
+}
+
+// --- BENCH: HOGWILD ASYNC SGD vs SINGLE-THREADED SGD ---
+// Learnable synthetic digits: 10 sparse random prototypes (~20% of pixels lit, like MNIST strokes),
+// every sample is one of them with pixels dropped, a fainter second prototype blended in and noise added.
+static void MakeLearnableData(int numSamples, std::vector<float>& inputs, std::vector<float>& targets) {
+    static std::vector<float> prototypes;
+    if (prototypes.empty()) {
+        prototypes.assign(10 * 784, 0.0f);
+        for (float& px : prototypes) px = (rand() % 5 == 0) ? 1.0f : 0.0f;
+    }
+
+    inputs.assign((size_t)numSamples * 784, 0.0f);
+    targets.assign((size_t)numSamples * 10, 0.0f);
+    for (int n = 0; n < numSamples; n++) {
+        int label = rand() % 10;
+        int distractor = rand() % 10;
+        targets[(size_t)n * 10 + label] = 1.0f;
+        for (int i = 0; i < 784; i++) {
+            float px = prototypes[label * 784 + i];
+            if (rand() % 2 == 0) px = 0.0f;
+            if (rand() % 3 == 0) px = std::max(px, 0.8f * prototypes[distractor * 784 + i]);
+            if (rand() % 20 == 0) px = (float)rand() / RAND_MAX;
+            inputs[(size_t)n * 784 + i] = px;
+        }
+    }
+}
+
+// Test accuracy, and mean cross-entropy in 'loss'
+static float Evaluate(const Network& net, const std::vector<float>& inputs, const std::vector<float>& targets, float& loss) {
+    int numSamples = (int)(targets.size() / 10);
+    BatchWorkspace ws(net, 256);
+    int correct = 0;
+    double totalLoss = 0.0;
+    for (int n = 0; n < numSamples; n += 256) {
+        int count = std::min(256, numSamples - n);
+        const float* outputs = net.feedForwardBatch(&inputs[(size_t)n * 784], count, ws);
+        for (int s = 0; s < count; s++) {
+            const float* out = &outputs[s * 10];
+            const float* target = &targets[(size_t)(n + s) * 10];
+            int label = (int)(std::max_element(target, target + 10) - target);
+            if (std::max_element(out, out + 10) - out == label) correct++;
+            totalLoss -= std::log(std::max(out[label], 1e-12f));
+        }
+    }
+    loss = (float)(totalLoss / numSamples);
+    return (float)correct / numSamples;
+}
+
+static void BenchHogwild() {
+    std::cout << "\n[Hogwild] async lock-free SGD vs single-threaded SGD, 784 -> 100 -> 10, lr 0.002\n";
+
+    const int epochs = 3;
+    const float learningRate = 0.002f;
+    std::cout << "   test accuracy / loss after each of " << epochs << " epochs\n";
+    std::vector<float> trainIn, trainOut, testIn, testOut;
+    MakeLearnableData(8000, trainIn, trainOut);
+    MakeLearnableData(2000, testIn, testOut);
+    const int numSamples = 8000;
+
+    // Baseline: the plain per-sample loop
+    {
+        srand(7);
+        Network net({ 100 }, 10, 784);
+        Workspace ws(net);
+        std::cout << "   single-thread";
+        double secs = 0.0;
+        for (int e = 0; e < epochs; e++) {
+            auto start = std::chrono::steady_clock::now();
+            for (int n = 0; n < numSamples; n++) {
+                net.backPropagate(&trainIn[(size_t)n * 784], &trainOut[(size_t)n * 10], learningRate, ws);
+            }
+            secs += SecondsSince(start);
+            float loss;
+            float acc = Evaluate(net, testIn, testOut, loss);
+            std::cout << std::fixed << std::setprecision(3) << "  " << acc << " / " << std::setprecision(4) << loss;
+        }
+        std::cout << std::defaultfloat << "  | " << std::setw(8) << (int)(epochs * numSamples / secs) << " samples/s\n";
+    }
+
+    const int threadCounts[] = { 1, 2, 4, 8 };
+    for (int threads : threadCounts) {
+        srand(7);
+        Network net({ 100 }, 10, 784);
+        HogwildTrainer trainer(net, threads);
+        std::cout << "   hogwild x" << std::left << std::setw(4) << threads << std::right;
+        double secs = 0.0;
+        for (int e = 0; e < epochs; e++) {
+            auto start = std::chrono::steady_clock::now();
+            trainer.trainEpoch(trainIn.data(), trainOut.data(), numSamples, learningRate);
+            secs += SecondsSince(start);
+            float loss;
+            float acc = Evaluate(net, testIn, testOut, loss);
+            std::cout << std::fixed << std::setprecision(3) << "  " << acc << " / " << std::setprecision(4) << loss;
+        }
+        std::cout << std::defaultfloat << "  | " << std::setw(8) << (int)(epochs * numSamples / secs) << " samples/s\n";
+    }
+}
+
+// --- CHECK + BENCH: MEMORY-MAPPED IDX LOADER vs LoadMnistData ---
+static void WriteBigEndian(std::ofstream& out, unsigned int v) {
+    unsigned char b[4] = { (unsigned char)(v >> 24), (unsigned char)(v >> 16), (unsigned char)(v >> 8), (unsigned char)v };
+    out.write((const char*)b, 4);
+}
+
+// A synthetic MNIST-sized pair of IDX files
+static void WriteIdxFiles(const char* imageFile, const char* labelFile, int count) {
+    std::ofstream images(imageFile, std::ios::binary);
+    WriteBigEndian(images, 0x00000803);
+    WriteBigEndian(images, count);
+    WriteBigEndian(images, 28);
+    WriteBigEndian(images, 28);
+    std::vector<unsigned char> pixels(784);
+    for (int n = 0; n < count; n++) {
+        for (unsigned char& px : pixels) px = (rand() % 5 == 0) ? (unsigned char)(rand() % 256) : 0;
+        images.write((const char*)pixels.data(), pixels.size());
+    }
+
+    std::ofstream labels(labelFile, std::ios::binary);
+    WriteBigEndian(labels, 0x00000801);
+    WriteBigEndian(labels, count);
+    for (int n = 0; n < count; n++) labels.put((char)(rand() % 10));
+}
+
+static bool CheckMnistLoader() {
+    std::cout << "\n[Loader] 60000 synthetic 28x28 images: mmap IDX views vs LoadMnistData\n";
+
+    const char* imageFile = "bench-images.idx3-ubyte";
+    const char* labelFile = "bench-labels.idx1-ubyte";
+    const char* badFile = "bench-bad.idx1-ubyte";
+    WriteIdxFiles(imageFile, labelFile, 60000);
+    bool ok = true;
+
+    // 1. Memory-mapped: header checks only, pages come in as they are touched
+    MnistDataset dataset;
+    double before = ResidentMB();
+    auto start = std::chrono::steady_clock::now();
+    bool loaded = dataset.load(imageFile, labelFile);
+    double loadSecs = SecondsSince(start);
+    double afterMap = ResidentMB();
+
+    long long sum = 0;
+    for (int i = 0; i < dataset.size(); i++) {
+        const unsigned char* img = dataset.image(i);
+        for (int p = 0; p < dataset.imageSize(); p++) sum += img[p];
+    }
+    g_sink = (float)sum;
+    double afterTouch = ResidentMB();
+    ok = loaded && dataset.size() == 60000 && dataset.imageSize() == 784;
+
+    std::cout << std::fixed << std::setprecision(1)
+        << "   mmap           load " << std::setw(8) << loadSecs * 1000.0 << " ms | RSS +" << std::setw(6) << afterMap - before
+        << " MB after load, +" << std::setw(6) << afterTouch - before << " MB after reading every pixel\n";
+
+    // 2. The original loader: one-byte reads, one vector per image, floats
+    before = ResidentMB();
+    start = std::chrono::steady_clock::now();
+    std::vector<MnistImage> legacy = LoadMnistData(imageFile, labelFile);
+    loadSecs = SecondsSince(start);
+    std::cout << "   LoadMnistData  load " << std::setw(8) << loadSecs * 1000.0 << " ms | RSS +" << std::setw(6) << ResidentMB() - before
+        << " MB\n" << std::defaultfloat;
+
+    // 3. Same images, same labels, and the fused normalization matches the float path
+    for (int i = 0; ok && i < (int)legacy.size(); i += 997) {
+        ok = legacy[i].label == dataset.label(i);
+        for (int p = 0; ok && p < 784; p++) ok = legacy[i].pixels[p] == (float)dataset.image(i)[p] / 255.0f;
+    }
+
+    Network net({ 100 }, 10, 784);
+    Workspace ws(net), wsPixels(net);
+    float worst = 0.0f;
+    for (int i = 0; i < 64; i++) {
+        std::vector<float> fromFloats = net.feedForward(legacy[i].pixels.data(), ws);
+        worst = std::max(worst, MaxAbsDiff(fromFloats, net.feedForward(dataset.image(i), wsPixels)));
+    }
+    BatchWorkspace bws(net, 64), bwsPixels(net, 64);
+    std::vector<float> floats((size_t)64 * 784);
+    for (int i = 0; i < 64; i++) std::copy(legacy[i].pixels.begin(), legacy[i].pixels.end(), &floats[(size_t)i * 784]);
+    const float* batchFloats = net.feedForwardBatch(floats.data(), 64, bws);
+    const float* batchPixels = net.feedForwardBatch(dataset.image(0), 64, bwsPixels);
+    for (int i = 0; i < 64 * 10; i++) worst = std::max(worst, std::fabs(batchFloats[i] - batchPixels[i]));
+    ok = ok && worst < 1e-5f;
+    std::cout << "   pixels vs floats max output difference " << worst << "\n";
+
+    // 4. Malformed files are refused
+    {
+        std::ofstream bad(badFile, std::ios::binary);
+        WriteBigEndian(bad, 0x00000801);
+        WriteBigEndian(bad, 59999);
+    }
+    MnistDataset rejected;
+    std::cout << "   expected refusals:\n   ";
+    bool refused = !rejected.load(imageFile, badFile);
+    std::cout << "   ";
+    refused = !rejected.load(labelFile, labelFile) && refused;
+    ok = ok && refused;
+
+    std::remove(imageFile);
+    std::remove(labelFile);
+    std::remove(badFile);
+    std::cout << (ok ? "   (OK)\n" : "   (FAILED)\n");
+    return ok;
+}
+
+// --- CHECK + BENCH: STREAMED, SHUFFLED, PREFETCHED BATCHES ---
+static bool CheckBatchStream() {
+    std::cout << "\n[Stream] IDX file -> shuffled batches of 128 on a background thread, training 784 -> 100 -> 10\n";
+
+    const char* imageFile = "bench-stream-images.idx3-ubyte";
+    const char* labelFile = "bench-stream-labels.idx1-ubyte";
+    const int numImages = 20000;
+    WriteIdxFiles(imageFile, labelFile, numImages);
+    bool ok = true;
+
+    // Reference totals straight from the file
+    long long expectedPixels = 0;
+    std::vector<int> expectedLabels(10, 0);
+    {
+        MnistDataset dataset;
+        ok = dataset.load(imageFile, labelFile);
+        for (int i = 0; ok && i < dataset.size(); i++) {
+            for (int p = 0; p < 784; p++) expectedPixels += dataset.image(i)[p];
+            expectedLabels[dataset.label(i)]++;
+        }
+    }
+
+    double before = ResidentMB();
+    IdxFileSource source;
+    ok = source.open(imageFile, labelFile) && ok;
+    BatchStream stream(source, 128, 10, 512, 8, 3);
+    Network net({ 100 }, 10, 784);
+    BatchWorkspace ws(net, 128);
+
+    for (int epoch = 0; ok && epoch < 2; epoch++) {
+        long long pixels = 0;
+        std::vector<int> labels(10, 0);
+        int samples = 0;
+
+        stream.startEpoch(epoch + 1);
+        double stalledBefore = stream.stallSeconds();
+        auto start = std::chrono::steady_clock::now();
+        while (const Batch* batch = stream.next()) {
+            net.trainBatch(batch->pixels.data(), batch->targets.data(), batch->count, 0.01f * batch->count, ws);
+            for (int n = 0; n < batch->count; n++) {
+                labels[batch->labels[n]]++;
+                for (int p = 0; p < 784; p++) pixels += batch->pixels[(size_t)n * 784 + p];
+            }
+            samples += batch->count;
+        }
+        double secs = SecondsSince(start);
+
+        // Every record exactly once (same multiset of labels and same pixel total)
+        bool complete = !stream.failed() && samples == numImages && labels == expectedLabels && pixels == expectedPixels;
+        ok = ok && complete;
+        std::cout << "   epoch " << epoch + 1 << ": " << samples << " samples, " << std::setw(8) << (int)(samples / secs) << " samples/s, stalled "
+            << std::fixed << std::setprecision(2) << (stream.stallSeconds() - stalledBefore) * 1000.0 << " ms of "
+            << secs * 1000.0 << " ms" << std::defaultfloat << (complete ? "  (every record once)\n" : "  (FAILED)\n");
+    }
+
+    // Abandoning an epoch half way and starting another must not lose or duplicate anything
+    stream.startEpoch(100);
+    for (int i = 0; i < 5; i++) stream.next();
+    stream.startEpoch(101);
+    int samples = 0;
+    while (const Batch* batch = stream.next()) samples += batch->count;
+    ok = ok && samples == numImages;
+
+    std::cout << std::fixed << std::setprecision(1) << "   RSS +" << ResidentMB() - before << " MB while streaming a "
+        << numImages * 784 / (1024.0 * 1024.0) << " MB file (buffer 8 x 512 records + 4 batches)" << std::defaultfloat
+        << (ok ? "  (OK)\n" : "  (FAILED)\n");
+
+    std::remove(imageFile);
+    std::remove(labelFile);
+    return ok;
+}
+
+// --- CHECK + BENCH: BINARY MODEL FILES vs TEXT ---
+static long long FileBytes(const char* filename) {
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    return file.is_open() ? (long long)file.tellg() : -1;
+}
+
+static bool SameNetwork(const Network& a, const Network& b) {
+    if (a.layers.size() != b.layers.size()) return false;
+    for (int i = 0; i < a.layers.size(); i++) {
+        if (a.layers[i].numNeurons != b.layers[i].numNeurons || a.layers[i].numInputs != b.layers[i].numInputs
+            || a.layers[i].actType != b.layers[i].actType
+            || a.layers[i].weights != b.layers[i].weights || a.layers[i].biases != b.layers[i].biases) return false;
+    }
+    return true;
+}
+
+static bool CheckModelFile() {
+    std::cout << "\n[Model] binary .nnm vs text brain format, 784 -> 100 -> 10\n";
+
+    const char* textFile = "bench-brain.txt";
+    const char* modelFile = "bench-brain.nnm";
+    const char* otherFile = "bench-other.nnm";
+    bool ok = true;
+
+    // 1. brain.txt -> .nnm, and both load to the same weights (the text round trip is lossy, so compare loaded vs loaded)
+    Network original({ 100 }, 10, 784);
+    original.saveNetwork(textFile);
+    ok = ConvertTextModel(textFile, { 100 }, 10, 784, modelFile);
+
+    Network fromText({ 100 }, 10, 784);
+    auto start = std::chrono::steady_clock::now();
+    fromText.loadNetwork(textFile);
+    double textSecs = SecondsSince(start);
+
+    Network fromModel;
+    start = std::chrono::steady_clock::now();
+    ok = LoadModel(modelFile, fromModel) && ok;
+    double modelSecs = SecondsSince(start);
+    ok = ok && SameNetwork(fromText, fromModel);
+
+    std::cout << std::fixed << std::setprecision(3)
+        << "   text    " << std::setw(8) << FileBytes(textFile) << " bytes, load " << std::setw(8) << textSecs * 1000.0 << " ms\n"
+        << "   binary  " << std::setw(8) << FileBytes(modelFile) << " bytes, load " << std::setw(8) << modelSecs * 1000.0 << " ms  ("
+        << std::setprecision(0) << textSecs / modelSecs << "x faster)\n" << std::defaultfloat;
+
+    // 2. The file alone rebuilds any shape: exact round trip of a deeper net with mixed activations
+    Network mixed({ 64, 32 }, 10, 784);
+    mixed.layers[0].actType = ActivationType::TANH;
+    mixed.layers[1].actType = ActivationType::SIGMOID;
+    ok = SaveModel(mixed, otherFile) && ok;
+    Network rebuilt({ 100 }, 10, 784);
+    ok = LoadModel(otherFile, rebuilt) && SameNetwork(mixed, rebuilt) && ok;
+    std::vector<float> image(784, 0.5f);
+    ok = ok && MaxAbsDiff(mixed.feedForward(image), rebuilt.feedForward(image)) == 0.0f;
+
+    // 3. Damaged files are refused, and leave the network alone
+    std::cout << "   expected refusals:\n";
+    std::vector<char> bytes;
+    {
+        std::ifstream in(modelFile, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    struct Damage { size_t offset; char value; size_t truncate; };
+    const Damage damages[] = {
+        { 0, 'X', 0 },                 // magic
+        { 8, 9, 0 },                   // version
+        { 48, 101, 0 },                // first layer size (caught by the checksum)
+        { bytes.size() - 3, 1, 0 },    // one weight byte
+        { 0, 0, bytes.size() - 4 },    // truncated
+    };
+    for (const Damage& damage : damages) {
+        std::vector<char> broken = bytes;
+        if (damage.truncate) broken.resize(damage.truncate);
+        else broken[damage.offset] ^= damage.value;
+        {
+            std::ofstream out(otherFile, std::ios::binary);
+            out.write(broken.data(), broken.size());
+        }
+        std::cout << "   ";
+        ok = !LoadModel(otherFile, rebuilt) && ok;
+    }
+    ok = ok && SameNetwork(mixed, rebuilt);
+    std::cout << "   ";
+    ok = !ConvertTextModel(textFile, { 50 }, 10, 784, otherFile) && ok;
+
+    std::remove(textFile);
+    std::remove(modelFile);
+    std::remove(otherFile);
+    std::cout << (ok ? "   (OK)\n" : "   (FAILED)\n");
+    return ok;
+}
+
+// --- CHECK + BENCH: INT8 QUANTIZED INFERENCE vs FP32 ---
+static bool CheckQuantized() {
+    std::cout << "\n[Int8] post-training quantization, 784 -> 100 -> 10\n";
+    bool ok = true;
+
+    // 1. Every int8 kernel gives exactly the scalar sums
+    {
+        const int k = 832, rows = 103;
+        std::vector<unsigned char> x(k);
+        std::vector<signed char> w((size_t)k * rows);
+        for (unsigned char& v : x) v = (unsigned char)(rand() % 128);
+        for (signed char& v : w) v = (signed char)(rand() % 255 - 127);
+        std::vector<int> reference(rows), sums(rows);
+        SimdKernelsFor(SimdLevel::SCALAR)->gemvU8S8(x.data(), w.data(), k, rows, reference.data());
+
+        const SimdLevel levels[] = { SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::AVX512 };
+        for (SimdLevel level : levels) {
+            const SimdKernels* kernels = SimdKernelsFor(level);
+            if (!kernels) continue;
+            kernels->gemvU8S8(x.data(), w.data(), k, rows, sums.data());
+            bool same = sums == reference;
+            ok = ok && same;
+            std::cout << "   int8 kernel " << std::left << std::setw(14) << kernels->name << std::right << (same ? " exact" : " MISMATCH") << "\n";
+        }
+    }
+
+    // 2. Train in fp32, quantize with 1000 calibration samples, compare on held-out data
+    std::vector<float> trainIn, trainOut, testIn, testOut;
+    MakeLearnableData(8000, trainIn, trainOut);
+    MakeLearnableData(2000, testIn, testOut);
+    Network net({ 100 }, 10, 784);
+    BatchWorkspace bws(net, 32);
+    for (int epoch = 0; epoch < 2; epoch++) {
+        for (int n = 0; n < 8000; n += 32) net.trainBatch(&trainIn[(size_t)n * 784], &trainOut[(size_t)n * 10], 32, 0.002f * 32, bws);
+    }
+
+    QuantizedNetwork qnet;
+    ok = qnet.build(net, trainIn.data(), 1000) && ok;
+    QuantizedWorkspace qws(qnet);
+    Workspace ws(net);
+
+    const int numTest = 2000;
+    int correct32 = 0, correct8 = 0, agree = 0;
+    float worstProb = 0.0f;
+    for (int n = 0; n < numTest; n++) {
+        const float* target = &testOut[(size_t)n * 10];
+        int label = (int)(std::max_element(target, target + 10) - target);
+        const std::vector<float>& out32 = net.feedForward(&testIn[(size_t)n * 784], ws);
+        const std::vector<float>& out8 = qnet.feedForward(&testIn[(size_t)n * 784], qws);
+        int pred32 = (int)(std::max_element(out32.begin(), out32.end()) - out32.begin());
+        int pred8 = (int)(std::max_element(out8.begin(), out8.end()) - out8.begin());
+        correct32 += pred32 == label;
+        correct8 += pred8 == label;
+        agree += pred32 == pred8;
+        worstProb = std::max(worstProb, MaxAbsDiff(out32, out8));
+    }
+    float acc32 = (float)correct32 / numTest, acc8 = (float)correct8 / numTest;
+    ok = ok && acc32 - acc8 < 0.01f;
+    std::cout << std::fixed << std::setprecision(4)
+        << "   accuracy fp32 " << acc32 << " | int8 " << acc8 << " | delta " << acc8 - acc32
+        << " | top-1 agreement " << (float)agree / numTest << " | max prob diff " << worstProb << "\n";
+
+    // 3. Single-sample latency and size
+    std::vector<unsigned char> pixels((size_t)numTest * 784);
+    for (size_t i = 0; i < pixels.size(); i++) pixels[i] = (unsigned char)std::lround(testIn[i] * 255.0f);
+
+    const int reps = 5;
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < reps; r++) {
+        for (int n = 0; n < numTest; n++) g_sink = net.feedForward(&testIn[(size_t)n * 784], ws)[0];
+    }
+    double us32 = SecondsSince(start) * 1e6 / (reps * numTest);
+    start = std::chrono::steady_clock::now();
+    for (int r = 0; r < reps; r++) {
+        for (int n = 0; n < numTest; n++) g_sink = qnet.feedForward(&testIn[(size_t)n * 784], qws)[0];
+    }
+    double us8 = SecondsSince(start) * 1e6 / (reps * numTest);
+    start = std::chrono::steady_clock::now();
+    for (int r = 0; r < reps; r++) {
+        for (int n = 0; n < numTest; n++) g_sink = qnet.feedForward(&pixels[(size_t)n * 784], qws)[0];
+    }
+    double us8Pixels = SecondsSince(start) * 1e6 / (reps * numTest);
+
+    size_t bytes32 = 0;
+    for (const Layer& layer : net.layers) bytes32 += (layer.weights.size() + layer.biases.size()) * sizeof(float);
+    std::cout << std::setprecision(2)
+        << "   latency  fp32 " << us32 << " us | int8 " << us8 << " us (" << us32 / us8 << "x) | int8 from pixels " << us8Pixels << " us ("
+        << us32 / us8Pixels << "x) [" << Simd().name << "]\n"
+        << "   size     fp32 " << bytes32 << " bytes | int8 " << qnet.modelBytes() << " bytes (" << (double)bytes32 / qnet.modelBytes() << "x smaller)"
+        << std::defaultfloat << (ok ? "  (OK)\n" : "  (FAILED)\n");
+    return ok;
+}
+
+// --- CHECK: INFERENCE PLAN ---
+// Per-call latency percentiles (microseconds) of fn over every sample
+template <class Fn>
+static void LatencyPercentiles(Fn fn, int numSamples, int reps, double& mean, double& p50, double& p99) {
+    std::vector<double> times;
+    times.reserve((size_t)numSamples * reps);
+    for (int r = 0; r < reps; r++) {
+        for (int n = 0; n < numSamples; n++) {
+            auto start = std::chrono::steady_clock::now();
+            fn(n);
+            times.push_back(SecondsSince(start) * 1e6);
+        }
+    }
+    double sum = 0.0;
+    for (double t : times) sum += t;
+    mean = sum / times.size();
+    std::sort(times.begin(), times.end());
+    p50 = times[times.size() / 2];
+    p99 = times[times.size() * 99 / 100];
+}
+
+static bool CheckPlan() {
+    std::cout << "\n[Plan] precompiled single-sample inference\n";
+    bool ok = true;
+
+    // 1. Every kernel set matches Network::feedForward, including odd sizes and the non-ReLU activations
+    Network net({ 100 }, 10, 784);
+    Network odd({ 37, 19 }, 3, 61);
+    odd.layers[0].actType = ActivationType::SIGMOID;
+    odd.layers[1].actType = ActivationType::TANH;
+    std::vector<std::vector<float>> inputs = MakeInputs(200, 784);
+
+    const SimdLevel levels[] = { SimdLevel::SCALAR, SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::AVX512 };
+    for (SimdLevel level : levels) {
+        if (!SimdKernelsFor(level)) continue;
+        float worst = 0.0f;
+        const Network* nets[] = { &net, &odd };
+        for (const Network* model : nets) {
+            InferencePlan plan(*model, level);
+            PlanWorkspace pws(plan);
+            Workspace ws(*model);
+            for (const std::vector<float>& x : inputs) {
+                const std::vector<float>& expected = model->feedForward(x.data(), ws);
+                const float* out = plan.run(x.data(), pws);
+                for (int j = 0; j < plan.numOutputs(); j++) worst = std::max(worst, std::fabs(out[j] - expected[j]));
+            }
+        }
+        bool pass = worst < 1e-5f;
+        ok = ok && pass;
+        InferencePlan plan(net, level);
+        std::cout << "   " << std::left << std::setw(8) << SimdLevelName(level) << std::right << " kernels " << std::setw(7) << plan.kernelName()
+            << " max diff " << worst << (pass ? "" : "  MISMATCH") << "\n";
+    }
+
+    // 2. Latency, 784 -> 100 -> 10, one sample per call (the canvas case)
+    InferencePlan plan(net);
+    PlanWorkspace pws(plan);
+    Workspace ws(net);
+    QuantizedNetwork qnet;
+    std::vector<float> calib;
+    for (int n = 0; n < 100; n++) calib.insert(calib.end(), inputs[n].begin(), inputs[n].end());
+    ok = qnet.build(net, calib.data(), 100) && ok;
+    QuantizedWorkspace qws(qnet);
+
+    long long before = g_allocations;
+    for (const std::vector<float>& x : inputs) g_sink = plan.run(x.data(), pws)[0];
+    bool noAlloc = g_allocations == before;
+    ok = ok && noAlloc;
+
+    const int numSamples = (int)inputs.size(), reps = 50;
+    double mean[3], p50[3], p99[3];
+    LatencyPercentiles([&](int n) { g_sink = net.feedForward(inputs[n].data(), ws)[0]; }, numSamples, reps, mean[0], p50[0], p99[0]);
+    LatencyPercentiles([&](int n) { g_sink = qnet.feedForward(inputs[n].data(), qws)[0]; }, numSamples, reps, mean[1], p50[1], p99[1]);
+    LatencyPercentiles([&](int n) { g_sink = plan.run(inputs[n].data(), pws)[0]; }, numSamples, reps, mean[2], p50[2], p99[2]);
+
+    const char* names[] = { "Network::feedForward", "QuantizedNetwork (int8)", "InferencePlan" };
+    std::cout << std::fixed << std::setprecision(2);
+    for (int i = 0; i < 3; i++) {
+        std::cout << "   " << std::left << std::setw(24) << names[i] << std::right << " mean " << std::setw(6) << mean[i]
+            << " us | p50 " << std::setw(6) << p50[i] << " us | p99 " << std::setw(6) << p99[i] << " us\n";
+    }
+    std::cout << "   plan speedup " << mean[0] / mean[2] << "x, allocations per run " << (noAlloc ? "0" : "> 0")
+        << " [" << plan.kernelName() << "]" << std::defaultfloat << (ok ? "  (OK)\n" : "  (FAILED)\n");
+    return ok;
+}
+
+// --- CHECK: FIXED-TOPOLOGY NETWORK ---
+// Largest output difference between a FixedNetwork and the Network it was copied from
+template <class Fixed>
+static float FixedMaxDiff(const Fixed& fixedNet, const Network& net, const std::vector<std::vector<float>>& inputs) {
+    Workspace ws(net);
+    float out[Fixed::numOutputs];
+    float worst = 0.0f;
+    for (const std::vector<float>& x : inputs) {
+        const std::vector<float>& expected = net.feedForward(x.data(), ws);
+        fixedNet.feedForward(x.data(), out);
+        for (int j = 0; j < Fixed::numOutputs; j++) worst = std::max(worst, std::fabs(out[j] - expected[j]));
+    }
+    return worst;
+}
+
+static bool CheckFixedNetwork() {
+    std::cout << "\n[Fixed] compile-time topology, 784 -> 100 -> 10\n";
+    bool ok = true;
+    const char* modelFile = "bench_fixed.nnm";
+
+    // 1. Same outputs as the Network it came from, also for odd sizes and the other activations
+    Network net({ 100 }, 10, 784);
+    std::unique_ptr<MnistNetwork> fixedNet(new MnistNetwork);
+    ok = fixedNet->copyFrom(net) && ok;
+    std::vector<std::vector<float>> inputs = MakeInputs(200, 784);
+    float worst = FixedMaxDiff(*fixedNet, net, inputs);
+
+    typedef FixedNetwork<61, Dense<37, ActivationType::SIGMOID>, Dense<19, ActivationType::TANH>, Dense<3, ActivationType::SOFTMAX>> OddNetwork;
+    Network odd({ 37, 19 }, 3, 61);
+    odd.layers[0].actType = ActivationType::SIGMOID;
+    odd.layers[1].actType = ActivationType::TANH;
+    std::unique_ptr<OddNetwork> fixedOdd(new OddNetwork);
+    ok = fixedOdd->copyFrom(odd) && ok;
+    worst = std::max(worst, FixedMaxDiff(*fixedOdd, odd, MakeInputs(200, 61)));
+    ok = ok && worst < 1e-5f;
+    std::cout << "   outputs vs Network    max diff " << worst << "\n";
+
+    // 2. Model files: the dynamic Network's file loads into the fixed type and back, a wrong shape is refused
+    Network roundTrip;
+    ok = SaveModel(net, modelFile) && ok;
+    std::unique_ptr<MnistNetwork> loaded(new MnistNetwork);
+    ok = loaded->load(modelFile) && ok;
+    ok = loaded->save(modelFile) && LoadModel(modelFile, roundTrip) && ok;
+    ok = ok && SameNetwork(net, roundTrip);
+    ok = SaveModel(odd, modelFile) && !loaded->load(modelFile) && ok;
+    ok = ok && MnistNetwork::hiddenLayers() == std::vector<int>({ 100 });
+    std::remove(modelFile);
+    std::cout << "   model file round trip " << (ok ? "identical" : "MISMATCH") << "\n";
+
+    // 3. Latency against the dynamic Network and the runtime-compiled InferencePlan
+    Workspace ws(net);
+    InferencePlan plan(net);
+    PlanWorkspace pws(plan);
+    float out[MnistNetwork::numOutputs];
+    const int numSamples = (int)inputs.size(), reps = 50;
+    double mean[3], p50[3], p99[3];
+    LatencyPercentiles([&](int n) { g_sink = net.feedForward(inputs[n].data(), ws)[0]; }, numSamples, reps, mean[0], p50[0], p99[0]);
+    LatencyPercentiles([&](int n) { fixedNet->feedForward(inputs[n].data(), out); g_sink = out[0]; }, numSamples, reps, mean[1], p50[1], p99[1]);
+    LatencyPercentiles([&](int n) { g_sink = plan.run(inputs[n].data(), pws)[0]; }, numSamples, reps, mean[2], p50[2], p99[2]);
+
+    const char* names[] = { "Network::feedForward", "MnistNetwork (fixed)", "InferencePlan" };
+    std::cout << std::fixed << std::setprecision(2);
+    for (int i = 0; i < 3; i++) {
+        std::cout << "   " << std::left << std::setw(24) << names[i] << std::right << " mean " << std::setw(6) << mean[i]
+            << " us | p50 " << std::setw(6) << p50[i] << " us | p99 " << std::setw(6) << p99[i] << " us\n";
+    }
+    std::cout << "   fixed vs dynamic speedup " << mean[0] / mean[1] << "x" << std::defaultfloat << (ok ? "  (OK)\n" : "  (FAILED)\n");
+    return ok;
+}
+
+// --- CHECK: INCREMENTAL INFERENCE ---
+// The canvas of the GUI: brush strokes of one white pixel plus four gray neighbours (as PaintGrid draws them),
+// re-centered with CenterGrid before every pass.
+static void PaintCanvas(float* grid, int gx, int gy) {
+    if (gx < 0 || gx >= 28 || gy < 0 || gy >= 28) return;
+    grid[gy * 28 + gx] = 1.0f;
+    const int neighbors[4][2] = { {0,1}, {0,-1}, {1,0}, {-1,0} };
+    for (auto& n : neighbors) {
+        int nx = gx + n[0], ny = gy + n[1];
+        if (nx >= 0 && nx < 28 && ny >= 0 && ny < 28 && grid[ny * 28 + nx] < 0.5f) grid[ny * 28 + nx] = 0.5f;
+    }
+}
+
+// Centered canvases of a few strokes, one per mouse-move event
+static std::vector<std::vector<float>> MakeCanvasEvents(int strokes, int stepsPerStroke) {
+    std::vector<std::vector<float>> events;
+    std::vector<float> grid(784, 0.0f), centered(784);
+    for (int s = 0; s < strokes; s++) {
+        std::fill(grid.begin(), grid.end(), 0.0f);
+        float x = 8.0f + rand() % 12, y = 4.0f + rand() % 6;
+        float dx = (rand() % 100 - 50) / 100.0f, dy = 0.6f;
+        for (int step = 0; step < stepsPerStroke; step++) {
+            PaintCanvas(grid.data(), (int)x, (int)y);
+            CenterGrid(grid.data(), centered.data());
+            events.push_back(centered);
+            x += dx + (rand() % 100 - 50) / 200.0f;
+            y += dy * ((step / 20) % 2 ? -1.0f : 1.0f);
+            x = std::min(std::max(x, 2.0f), 25.0f);
+            y = std::min(std::max(y, 2.0f), 25.0f);
+        }
+    }
+    return events;
+}
+
+static bool CheckIncremental() {
+    std::cout << "\n[Incremental] canvas re-scoring, 784 -> 100 -> 10\n";
+    bool ok = true;
+
+    Network net({ 100 }, 10, 784);
+    Workspace ws(net);
+    std::vector<std::vector<float>> events = MakeCanvasEvents(20, 60);
+    const int numEvents = (int)events.size();
+
+    // 1. Same outputs as a full pass on every event
+    IncrementalWorkspace iws(net);
+    float worst = 0.0f;
+    for (const std::vector<float>& canvas : events) {
+        const std::vector<float>& expected = net.feedForward(canvas.data(), ws);
+        worst = std::max(worst, MaxAbsDiff(expected, net.feedForwardIncremental(canvas.data(), iws)));
+    }
+    double partialShare = (double)iws.partialPasses / (iws.partialPasses + iws.fullPasses);
+
+    // Sparse edits through updateInputs
+    IncrementalWorkspace sparse(net);
+    std::vector<float> image(784, 0.0f);
+    for (int e = 0; e < 500; e++) {
+        int indices[5];
+        float values[5];
+        for (int k = 0; k < 5; k++) {
+            indices[k] = rand() % 784;
+            values[k] = (rand() % 3) * 0.5f;
+        }
+        net.updateInputs(indices, values, 5, sparse);
+        for (int k = 0; k < 5; k++) image[indices[k]] = values[k];
+    }
+    worst = std::max(worst, MaxAbsDiff(net.feedForward(image.data(), ws), sparse.ws.activations.back()));
+    ok = ok && worst < 1e-5f;
+    std::cout << "   outputs vs full pass  max diff " << worst << " | " << std::setprecision(3) << partialShare * 100.0
+        << "% of " << numEvents << " canvas events incremental" << std::defaultfloat << "\n";
+
+    // 2. Per-event latency, including the diff against the previous canvas
+    long long before = g_allocations;
+    for (const std::vector<float>& canvas : events) g_sink = net.feedForwardIncremental(canvas.data(), iws)[0];
+    bool noAlloc = g_allocations == before;
+    ok = ok && noAlloc;
+
+    const int reps = 20;
+    double mean[2], p50[2], p99[2];
+    LatencyPercentiles([&](int n) { g_sink = net.feedForward(events[n].data(), ws)[0]; }, numEvents, reps, mean[0], p50[0], p99[0]);
+    LatencyPercentiles([&](int n) { g_sink = net.feedForwardIncremental(events[n].data(), iws)[0]; }, numEvents, reps, mean[1], p50[1], p99[1]);
+
+    const char* names[] = { "full feedForward", "feedForwardIncremental" };
+    std::cout << std::fixed << std::setprecision(2);
+    for (int i = 0; i < 2; i++) {
+        std::cout << "   " << std::left << std::setw(24) << names[i] << std::right << " mean " << std::setw(6) << mean[i]
+            << " us | p50 " << std::setw(6) << p50[i] << " us | p99 " << std::setw(6) << p99[i] << " us\n";
+    }
+    std::cout << "   per-event speedup " << mean[0] / mean[1] << "x, allocations per event " << (noAlloc ? "0" : "> 0")
+        << std::defaultfloat << (ok ? "  (OK)\n" : "  (FAILED)\n");
+    return ok;
+}
+
+// --- CHECK: SPARSE FIRST LAYER ---
+// Images with roughly the given share of nonzero pixels
+static std::vector<std::vector<float>> MakeSparseInputs(int count, int size, float density) {
+    std::vector<std::vector<float>> inputs(count, std::vector<float>(size, 0.0f));
+    for (auto& img : inputs) {
+        for (float& px : img) {
+            if ((float)rand() / RAND_MAX < density) px = 0.1f + 0.9f * rand() / RAND_MAX;
+        }
+    }
+    return inputs;
+}
+
+// Real MNIST test images if they are around, otherwise canvas strokes
+static std::vector<std::vector<float>> LoadSparseImages(int count, const char*& source) {
+    const char* files[][2] = {
+        { "Data/t10k-images.idx3-ubyte", "Data/t10k-labels.idx1-ubyte" },
+        { "../NeuralNet/Data/t10k-images.idx3-ubyte", "../NeuralNet/Data/t10k-labels.idx1-ubyte" },
+        { "NeuralNet/Data/t10k-images.idx3-ubyte", "NeuralNet/Data/t10k-labels.idx1-ubyte" }
+    };
+    for (auto& f : files) {
+        if (FileBytes(f[0]) <= 0) continue;
+        MnistDataset dataset;
+        if (!dataset.load(f[0], f[1]) || dataset.imageSize() != 784) continue;
+        std::vector<std::vector<float>> images;
+        for (int n = 0; n < count && n < dataset.size(); n++) {
+            const unsigned char* px = dataset.image(n);
+            std::vector<float> img(784);
+            for (int i = 0; i < 784; i++) img[i] = px[i] * PIXEL_SCALE;
+            images.push_back(img);
+        }
+        source = "MNIST t10k";
+        return images;
+    }
+    source = "canvas strokes (no MNIST images found)";
+    std::vector<std::vector<float>> events = MakeCanvasEvents(count / 40 + 1, 40);
+    events.resize(count);
+    return events;
+}
+
+static bool CheckSparse() {
+    std::cout << "\n[Sparse] sparse-input first layer, 784 -> 100\n";
+    bool ok = true;
+    const int K = 784, N = 100;
+
+    // 1. Every kernel set compacts exactly and matches the dense dot product
+    Layer layer(N, K, ActivationType::RELU);
+    std::vector<std::vector<float>> sweepInputs = MakeSparseInputs(1, K, 0.2f);
+    const SimdLevel levels[] = { SimdLevel::SCALAR, SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::AVX512 };
+    std::vector<int> indices(K), refIndices(K);
+    std::vector<float> values(K), refValues(K);
+    const float* x = sweepInputs[0].data();
+    int refCount = SimdKernelsFor(SimdLevel::SCALAR)->compactNonzero(x, K, K, refIndices.data(), refValues.data());
+    for (SimdLevel level : levels) {
+        const SimdKernels* kernels = SimdKernelsFor(level);
+        if (!kernels) continue;
+        int count = kernels->compactNonzero(x, K, K, indices.data(), values.data());
+        bool same = count == refCount && std::equal(indices.begin(), indices.begin() + count, refIndices.begin())
+            && std::equal(values.begin(), values.begin() + count, refValues.begin());
+        float worst = 0.0f;
+        for (int j = 0; j < N; j++) {
+            const float* row = &layer.weights[(size_t)j * K];
+            worst = std::max(worst, std::fabs(kernels->dotSparse(row, indices.data(), values.data(), count) - SimdKernelsFor(SimdLevel::SCALAR)->dot(row, x, K)));
+        }
+        bool pass = same && worst < 1e-4f;
+        ok = ok && pass;
+        std::cout << "   " << std::left << std::setw(14) << kernels->name << std::right << " compact " << (same ? "exact" : "MISMATCH")
+            << ", dot max diff " << worst << "\n";
+    }
+
+    // 2. Dense vs sparse per density, with each level's own kernels (compaction included)
+    std::vector<float> out(N);
+    const float densities[] = { 0.05f, 0.1f, 0.2f, 0.3f, 0.5f, 0.75f };
+    std::cout << "   us per sample     density:";
+    for (float d : densities) std::cout << std::setw(8) << d;
+    std::cout << "   crossover (table)\n" << std::fixed << std::setprecision(2);
+    for (SimdLevel level : levels) {
+        const SimdKernels* kernels = SimdKernelsFor(level);
+        if (!kernels) continue;
+        std::cout << "   " << std::left << std::setw(14) << kernels->name << std::right << " dense/sparse";
+        float crossover = 1.0f;
+        for (float d : densities) {
+            std::vector<std::vector<float>> inputs = MakeSparseInputs(64, K, d);
+            const int reps = 20;
+            auto start = std::chrono::steady_clock::now();
+            for (int r = 0; r < reps; r++) {
+                for (const std::vector<float>& in : inputs) {
+                    for (int j = 0; j < N; j++) out[j] = kernels->dot(&layer.weights[(size_t)j * K], in.data(), K);
+                    g_sink = out[0];
+                }
+            }
+            double dense = SecondsSince(start) * 1e6 / (reps * inputs.size());
+            start = std::chrono::steady_clock::now();
+            for (int r = 0; r < reps; r++) {
+                for (const std::vector<float>& in : inputs) {
+                    int count = kernels->compactNonzero(in.data(), K, K, indices.data(), values.data());
+                    for (int j = 0; j < N; j++) out[j] = kernels->dotSparse(&layer.weights[(size_t)j * K], indices.data(), values.data(), count);
+                    g_sink = out[0];
+                }
+            }
+            double sparse = SecondsSince(start) * 1e6 / (reps * inputs.size());
+            if (sparse >= dense && crossover == 1.0f) crossover = d;
+            std::cout << " " << std::setw(4) << dense << "/" << std::setw(4) << sparse;
+        }
+        std::cout << "   ~" << crossover << " (" << kernels->sparseMaxDensity << ")\n";
+    }
+    std::cout << std::defaultfloat;
+
+    // 3. Real images: the whole forward pass and one SGD step, automatic switch vs always dense
+    const char* source = nullptr;
+    std::vector<std::vector<float>> images = LoadSparseImages(2000, source);
+    double nonzeros = 0.0;
+    for (const std::vector<float>& img : images) nonzeros += std::count_if(img.begin(), img.end(), [](float v) { return v != 0.0f; });
+    double density = nonzeros / ((double)images.size() * K);
+
+    Network net({ N }, 10, K);
+    Workspace ws(net);
+    std::vector<float> target(10, 0.0f);
+    target[3] = 1.0f;
+
+    Network sparseNet = net, denseNet = net;
+    for (int n = 0; n < 200; n++) {
+        sparseNet.backPropagate(images[n].data(), target.data(), 0.01f, ws);
+        // The dense reference: same math, first layer through the dense calls
+        const std::vector<float>& a0 = ws.activations[0];
+        denseNet.layers[0].feedForward(images[n].data(), ws.activations[0].data());
+        denseNet.layers[1].feedForward(a0.data(), ws.activations[1].data());
+        for (int j = 0; j < 10; j++) ws.deltas[1][j] = target[j] - ws.activations[1][j];
+        denseNet.layers[1].propagateError(ws.activations[0].data(), ws.deltas[1].data(), ws.deltas[0].data());
+        for (int j = 0; j < N; j++) ws.deltas[0][j] *= (a0[j] > 0.0f) ? 1.0f : 0.0f;
+        denseNet.layers[0].updateWeights(images[n].data(), ws.deltas[0].data(), 0.01f);
+        denseNet.layers[1].updateWeights(a0.data(), ws.deltas[1].data(), 0.01f);
+    }
+    float trainDiff = MaxWeightDiff(sparseNet, denseNet);
+    ok = ok && trainDiff < 1e-4f;
+
+    const int reps = 5;
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < reps; r++) {
+        for (const std::vector<float>& img : images) {
+            net.layers[0].feedForward(img.data(), ws.activations[0].data());
+            g_sink = ws.activations[0][0];
+        }
+    }
+    double denseForward = SecondsSince(start) * 1e6 / (reps * images.size());
+    start = std::chrono::steady_clock::now();
+    for (int r = 0; r < reps; r++) {
+        for (const std::vector<float>& img : images) {
+            ws.sparse.compact(img.data());
+            net.layers[0].feedForwardSparse(ws.sparse, ws.activations[0].data());
+            g_sink = ws.activations[0][0];
+        }
+    }
+    double sparseForward = SecondsSince(start) * 1e6 / (reps * images.size());
+
+    // Weight step with ReLU-like deltas (about half the neurons off)
+    std::vector<float> deltas(N);
+    for (float& d : deltas) d = (rand() % 2) ? ((float)rand() / RAND_MAX - 0.5f) * 1e-3f : 0.0f;
+    start = std::chrono::steady_clock::now();
+    for (int r = 0; r < reps; r++) {
+        for (const std::vector<float>& img : images) net.layers[0].updateWeights(img.data(), deltas.data(), 0.01f);
+    }
+    double denseUpdate = SecondsSince(start) * 1e6 / (reps * images.size());
+    start = std::chrono::steady_clock::now();
+    for (int r = 0; r < reps; r++) {
+        for (const std::vector<float>& img : images) {
+            ws.sparse.compact(img.data());
+            net.layers[0].updateWeightsSparse(ws.sparse, deltas.data(), 0.01f);
+        }
+    }
+    double sparseUpdate = SecondsSince(start) * 1e6 / (reps * images.size());
+
+    std::cout << "   " << source << ": density " << std::setprecision(3) << density * 100.0 << "%, auto path "
+        << (density < Simd().sparseMaxDensity ? "sparse" : "dense") << " [" << Simd().name << "]\n" << std::fixed << std::setprecision(2)
+        << "   first layer forward dense " << denseForward << " us | sparse " << sparseForward << " us (" << denseForward / sparseForward << "x)\n"
+        << "   first layer update  dense " << denseUpdate << " us | sparse " << sparseUpdate << " us (" << denseUpdate / sparseUpdate << "x)\n"
+        << "   SGD steps vs dense  max weight diff " << std::defaultfloat << trainDiff << (ok ? "  (OK)\n" : "  (FAILED)\n");
+    return ok;
+}
+
+// --- CHECK: OPTIMIZERS ---
+// Straightforward per-element version of every rule, to check the fused kernels against
+struct ReferenceOptimizer {
+    OptimizerSettings settings;
+    std::vector<std::vector<float>> m, v; // per parameter array: weights of layer i at 2i, biases at 2i + 1
+    int t = 0;
+
+    void step(Network& net, const Gradients& grads, int batchSize, float rate) {
+        t++;
+        if (m.empty()) {
+            for (const Layer& layer : net.layers) {
+                m.push_back(std::vector<float>(layer.weights.size(), 0.0f));
+                m.push_back(std::vector<float>(layer.biases.size(), 0.0f));
+            }
+            v = m;
+        }
+        for (int i = 0; i < (int)net.layers.size(); i++) {
+            for (int kind = 0; kind < 2; kind++) {
+                std::vector<float>& w = kind ? net.layers[i].biases : net.layers[i].weights;
+                const std::vector<float>& g = kind ? grads.biases[i] : grads.weights[i];
+                float decay = kind ? 0.0f : settings.weightDecay;
+                for (size_t k = 0; k < w.size(); k++) {
+                    float d = g[k] / batchSize;
+                    float& m1 = m[2 * i + kind][k];
+                    float& m2 = v[2 * i + kind][k];
+                    if (settings.type != OptimizerType::ADAMW) d -= decay * w[k];
+                    switch (settings.type) {
+                    case OptimizerType::SGD: w[k] += rate * d; break;
+                    case OptimizerType::MOMENTUM: m1 = settings.momentum * m1 + d; w[k] += rate * m1; break;
+                    case OptimizerType::NESTEROV: m1 = settings.momentum * m1 + d; w[k] += rate * (d + settings.momentum * m1); break;
+                    case OptimizerType::RMSPROP:
+                        m1 = settings.rmsDecay * m1 + (1.0f - settings.rmsDecay) * d * d;
+                        w[k] += rate * d / (std::sqrt(m1) + settings.epsilon);
+                        break;
+                    default: {
+                        m1 = settings.beta1 * m1 + (1.0f - settings.beta1) * d;
+                        m2 = settings.beta2 * m2 + (1.0f - settings.beta2) * d * d;
+                        float mHat = m1 / (1.0f - std::pow(settings.beta1, (float)t));
+                        float vHat = m2 / (1.0f - std::pow(settings.beta2, (float)t));
+                        float update = mHat / (std::sqrt(vHat) + settings.epsilon);
+                        if (settings.type == OptimizerType::ADAMW) update -= decay * w[k];
+                        w[k] += rate * update;
+                    }
+                    }
+                }
+            }
+        }
+    }
+};
+
+static bool CheckOptimizers() {
+    std::cout << "\n[Optimizers] fused update rules and time to target loss, 784 -> 100 -> 10\n";
+    bool ok = true;
+    const OptimizerType types[] = { OptimizerType::SGD, OptimizerType::MOMENTUM, OptimizerType::NESTEROV,
+        OptimizerType::ADAM, OptimizerType::ADAMW, OptimizerType::RMSPROP };
+
+    // 1. Schedules
+    LearningRateSchedule warm = LearningRateSchedule::cosine(1.0f, 100, 0.1f).withWarmup(10);
+    LearningRateSchedule stepped = LearningRateSchedule::step(1.0f, 10, 0.5f);
+    bool schedulesOk = std::fabs(warm.rateAt(0) - 0.1f) < 1e-6f && std::fabs(warm.rateAt(9) - 1.0f) < 1e-6f
+        && std::fabs(warm.rateAt(10) - 1.0f) < 1e-6f && std::fabs(warm.rateAt(60) - 0.55f) < 1e-5f && warm.rateAt(500) == 0.1f
+        && stepped.rateAt(9) == 1.0f && stepped.rateAt(10) == 0.5f && stepped.rateAt(25) == 0.25f;
+    ok = ok && schedulesOk;
+
+    // 2. Fused kernels and the parallel trainer's sliced update vs the reference, 5 steps with weight decay
+    std::vector<float> inputs, targets;
+    MakeBatchData(64, inputs, targets);
+    std::cout << "   schedules " << (schedulesOk ? "ok" : "WRONG") << " | max weight diff vs reference after 5 steps:";
+    for (OptimizerType type : types) {
+        OptimizerSettings settings(type);
+        settings.weightDecay = 1e-3f;
+        Network fused({ 32 }, 10, 784), sliced = fused, reference = fused;
+        Optimizer optimizer(fused, settings, LearningRateSchedule::constant(0.01f));
+        Optimizer slicedOptimizer(sliced, settings, LearningRateSchedule::constant(0.01f));
+        ParallelTrainer trainer(sliced, 3, 64);
+        ReferenceOptimizer check;
+        check.settings = settings;
+        BatchWorkspace bws(fused, 64);
+        Gradients grads(fused);
+        for (int s = 0; s < 5; s++) {
+            fused.computeGradients(inputs.data(), targets.data(), 64, bws, grads);
+            optimizer.step(fused, grads, 64);
+            reference.computeGradients(inputs.data(), targets.data(), 64, bws, grads);
+            check.step(reference, grads, 64, 0.01f);
+            trainer.trainBatch(inputs.data(), targets.data(), 64, slicedOptimizer);
+        }
+        float worst = std::max(MaxWeightDiff(fused, reference), MaxWeightDiff(sliced, reference));
+        bool pass = worst < 1e-4f;
+        ok = ok && pass;
+        std::cout << " " << OptimizerName(type) << " " << worst << (pass ? "" : " MISMATCH");
+    }
+    std::cout << "\n";
+
+    // 3. Cost of one fused step over all 79,510 parameters
+    {
+        Network net({ 100 }, 10, 784);
+        Gradients grads(net);
+        for (auto& g : grads.weights) for (float& x : g) x = 0.01f;
+        std::cout << "   us per step [" << Simd().name << "]:";
+        for (OptimizerType type : types) {
+            Optimizer optimizer(net, OptimizerSettings(type), LearningRateSchedule::constant(1e-6f));
+            const int reps = 200;
+            auto start = std::chrono::steady_clock::now();
+            for (int r = 0; r < reps; r++) optimizer.step(net, grads, 32);
+            std::cout << " " << OptimizerName(type) << " " << std::fixed << std::setprecision(1) << SecondsSince(start) * 1e6 / reps << std::defaultfloat;
+        }
+        std::cout << "\n";
+    }
+
+    // 4. Time to target test loss, batch 32, vs the current Network::trainBatch SGD.
+    // The test set is scored every 50 steps; only the training time counts.
+    std::vector<float> trainIn, trainOut, testIn, testOut;
+    MakeLearnableData(8000, trainIn, trainOut);
+    MakeLearnableData(2000, testIn, testOut);
+    const int numSamples = 8000, batch = 32, maxEpochs = 8, stepsPerEpoch = numSamples / batch, evalEvery = 50;
+    const float targetLoss = 0.02f;
+    struct Run { const char* name; OptimizerType type; LearningRateSchedule schedule; };
+    const Run runs[] = {
+        { "trainBatch (sgd)", OptimizerType::SGD, LearningRateSchedule::constant(0.05f) },
+        { "momentum", OptimizerType::MOMENTUM, LearningRateSchedule::constant(0.05f) },
+        { "nesterov", OptimizerType::NESTEROV, LearningRateSchedule::constant(0.05f) },
+        { "adam", OptimizerType::ADAM, LearningRateSchedule::constant(0.001f) },
+        { "adamw, warmup+cosine", OptimizerType::ADAMW, LearningRateSchedule::cosine(0.002f, maxEpochs * stepsPerEpoch).withWarmup(50) },
+        { "rmsprop", OptimizerType::RMSPROP, LearningRateSchedule::constant(0.0005f) }
+    };
+    std::cout << "   to test loss " << targetLoss << " (" << maxEpochs << " epochs max, batch " << batch << "):\n";
+    double baselineSeconds = 0.0;
+    for (int r = 0; r < 6; r++) {
+        const Run& run = runs[r];
+        srand(11);
+        Network net({ 100 }, 10, 784);
+        BatchWorkspace bws(net, batch);
+        Gradients grads(net);
+        OptimizerSettings settings(run.type);
+        if (run.type == OptimizerType::ADAMW) settings.weightDecay = 0.01f;
+        Optimizer optimizer(net, settings, run.schedule);
+
+        double seconds = 0.0;
+        int reached = 0;
+        float acc = 0.0f, loss = 0.0f;
+        for (int step = 0; step < maxEpochs * stepsPerEpoch && !reached; step++) {
+            int n = (step % stepsPerEpoch) * batch;
+            const float* in = &trainIn[(size_t)n * 784];
+            const float* out = &trainOut[(size_t)n * 10];
+            auto start = std::chrono::steady_clock::now();
+            if (r == 0) net.trainBatch(in, out, batch, run.schedule.rate, bws);
+            else {
+                net.computeGradients(in, out, batch, bws, grads);
+                optimizer.step(net, grads, batch);
+            }
+            seconds += SecondsSince(start);
+            if ((step + 1) % evalEvery == 0) {
+                acc = Evaluate(net, testIn, testOut, loss);
+                if (loss <= targetLoss) reached = step + 1;
+            }
+        }
+        if (r == 0) baselineSeconds = reached ? seconds : 0.0;
+        std::cout << "   " << std::left << std::setw(22) << run.name << std::right << std::fixed;
+        if (reached) {
+            std::cout << " step " << std::setw(4) << reached << " (epoch " << std::setprecision(1) << (float)reached / stepsPerEpoch
+                << ") | " << std::setprecision(3) << seconds << " s";
+            if (baselineSeconds > 0.0 && r > 0) std::cout << " | " << std::setprecision(2) << baselineSeconds / seconds << "x sgd";
+        }
+        else {
+            std::cout << " not reached in " << maxEpochs << " epochs, loss " << std::setprecision(4) << loss;
+        }
+        std::cout << " | test accuracy " << std::setprecision(3) << acc << std::defaultfloat << "\n";
+    }
+    std::cout << (ok ? "   (OK)\n" : "   (FAILED)\n");
+    return ok;
+}
+
+// --- CHECK: TRAINING STATS FROM THE BACKWARD PASS ---
+// ParallelTrainer scores every sample off the outputs its backward pass computed. That must match
+// a separate forward pass with the pre-step weights, and cost far less than one.
+static bool CheckTrainingStats() {
+    std::cout << "\n[TrainingStats] loss / accuracy read off backprop vs an extra forward pass, 784 -> 100 -> 10\n";
+
+    const int batchSize = 64, numBatches = 8;
+    std::vector<float> inputs, targets;
+    MakeLearnableData(batchSize * numBatches, inputs, targets);
+
+    bool ok = true;
+    const int threadCounts[] = { 1, 3 };
+    for (int threads : threadCounts) {
+        srand(7);
+        Network net({ 100 }, 10, 784);
+        ParallelTrainer trainer(net, threads, batchSize);
+        BatchWorkspace ws(net, batchSize);
+
+        TrainingStats expected;
+        for (int b = 0; b < numBatches; b++) {
+            const float* in = &inputs[(size_t)b * batchSize * 784];
+            const float* tgt = &targets[(size_t)b * batchSize * 10];
+            AccumulateStats(net.feedForwardBatch(in, batchSize, ws), tgt, batchSize, 10, ActivationType::SOFTMAX, expected);
+            trainer.trainBatch(in, tgt, batchSize, 0.05f);
+        }
+        TrainingStats got = trainer.stats();
+        bool pass = got.samples == expected.samples && got.correct == expected.correct
+            && std::fabs(got.loss - expected.loss) <= 1e-4 * std::fabs(expected.loss);
+
+        // evaluate() against a single-threaded pass over the same weights
+        TrainingStats single;
+        for (int b = 0; b < numBatches; b++) {
+            AccumulateStats(net.feedForwardBatch(&inputs[(size_t)b * batchSize * 784], batchSize, ws),
+                &targets[(size_t)b * batchSize * 10], batchSize, 10, ActivationType::SOFTMAX, single);
+        }
+        TrainingStats evaluated = trainer.evaluate(inputs.data(), targets.data(), batchSize * numBatches);
+        pass = pass && evaluated.samples == single.samples && evaluated.correct == single.correct
+            && std::fabs(evaluated.loss - single.loss) <= 1e-4 * std::fabs(single.loss);
+
+        ok = ok && pass;
+        std::cout << "   " << threads << " threads: " << got.correct << "/" << got.samples << " correct, loss "
+            << std::fixed << std::setprecision(4) << got.meanLoss() << " (forward pass: " << expected.correct << ", "
+            << expected.meanLoss() << "), test " << evaluated.correct << "/" << evaluated.samples << std::defaultfloat
+            << (pass ? "  (OK)\n" : "  (FAILED)\n");
+    }
+
+    // Cost: stats come free with the step; the legacy trainer paid a whole extra forward pass
+    srand(7);
+    Network net({ 100 }, 10, 784);
+    ParallelTrainer trainer(net, 1, batchSize);
+    BatchWorkspace ws(net, batchSize);
+    const int reps = 20;
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < reps; r++) {
+        for (int b = 0; b < numBatches; b++) {
+            trainer.trainBatch(&inputs[(size_t)b * batchSize * 784], &targets[(size_t)b * batchSize * 10], batchSize, 0.01f);
+        }
+    }
+    double statsRate = reps * numBatches * batchSize / SecondsSince(start);
+
+    TrainingStats extra;
+    start = std::chrono::steady_clock::now();
+    for (int r = 0; r < reps; r++) {
+        for (int b = 0; b < numBatches; b++) {
+            const float* in = &inputs[(size_t)b * batchSize * 784];
+            const float* tgt = &targets[(size_t)b * batchSize * 10];
+            trainer.trainBatch(in, tgt, batchSize, 0.01f);
+            AccumulateStats(net.feedForwardBatch(in, batchSize, ws), tgt, batchSize, 10, ActivationType::SOFTMAX, extra);
+        }
+    }
+    double extraRate = reps * numBatches * batchSize / SecondsSince(start);
+    std::cout << "   training with backprop stats " << (int)statsRate << " samples/s, with an extra forward pass "
+        << (int)extraRate << " samples/s (" << std::fixed << std::setprecision(2) << statsRate / extraRate << "x)\n"
+        << std::defaultfloat;
+    return ok;
+}
+
+// --- CHECK: MIXED PRECISION ---
+// Test accuracy of a network run one sample at a time; works for Network and MixedPrecisionNetwork alike
+template <class Net, class Ws>
+static float SampleAccuracy(const Net& net, Ws& ws, const std::vector<float>& inputs, const std::vector<float>& targets) {
+    int numSamples = (int)(targets.size() / 10), correct = 0;
+    for (int n = 0; n < numSamples; n++) {
+        const std::vector<float>& out = net.feedForward(&inputs[(size_t)n * 784], ws);
+        const float* target = &targets[(size_t)n * 10];
+        correct += std::max_element(out.begin(), out.end()) - out.begin() == std::max_element(target, target + 10) - target;
+    }
+    return (float)correct / numSamples;
+}
+
+static bool CheckMixedPrecision() {
+    std::cout << "\n[Mixed] bf16 / fp16 weights and activations, fp32 accumulation and master weights\n";
+    bool ok = true;
+    const HalfType types[] = { HalfType::BF16, HalfType::FP16 };
+
+    // 1. Every kernel set against the scalar one: conversions bit-exact, the half copy is exactly the
+    //    rounded master, sums within fp32 rounding
+    {
+        const int k = 803, rows = 103;
+        std::vector<float> wf((size_t)k * rows), xf(k);
+        for (float& v : wf) v = (float)rand() / RAND_MAX * 2.0f - 1.0f;
+        for (float& v : xf) v = (float)rand() / RAND_MAX;
+
+        for (HalfType type : types) {
+            const HalfKernels* scalar = SimdHalfFor(type, SimdLevel::SCALAR);
+            std::vector<unsigned short> wRef(wf.size()), xRef(k);
+            scalar->fromFloat(wf.data(), wRef.data(), (int)wf.size());
+            scalar->fromFloat(xf.data(), xRef.data(), k);
+            std::vector<float> sumsRef(rows), sums(rows);
+            scalar->gemv(wRef.data(), xRef.data(), k, rows, sumsRef.data());
+
+            const HalfKernels* tested = scalar;
+            const SimdLevel levels[] = { SimdLevel::AVX2, SimdLevel::AVX512 };
+            for (SimdLevel level : levels) {
+                const HalfKernels* kernels = SimdHalfFor(type, level);
+                if (!kernels || kernels == scalar || kernels == tested) continue;
+                tested = kernels;
+
+                std::vector<unsigned short> w(wf.size()), x(k);
+                kernels->fromFloat(wf.data(), w.data(), (int)wf.size());
+                kernels->fromFloat(xf.data(), x.data(), k);
+                std::vector<float> back(wf.size()), backRef(wf.size());
+                kernels->toFloat(w.data(), back.data(), (int)w.size());
+                scalar->toFloat(wRef.data(), backRef.data(), (int)wRef.size());
+                bool exact = w == wRef && x == xRef && back == backRef;
+
+                kernels->gemv(w.data(), x.data(), k, rows, sums.data());
+                float sumDiff = MaxAbsDiff(sums, sumsRef);
+
+                // One master update of a row: the master moves like the scalar one, the half copy is its rounding
+                std::vector<float> master(wf.begin(), wf.begin() + k), masterRef = master;
+                std::vector<unsigned short> half(k), halfOfMaster(k), halfRef(k);
+                kernels->axpyMaster(0.01f, x.data(), master.data(), half.data(), k);
+                scalar->axpyMaster(0.01f, x.data(), masterRef.data(), halfRef.data(), k);
+                scalar->fromFloat(master.data(), halfOfMaster.data(), k);
+                float masterDiff = MaxAbsDiff(master, masterRef);
+                bool pass = exact && half == halfOfMaster && sumDiff < 1e-4f && masterDiff < 1e-6f;
+                ok = ok && pass;
+
+                std::cout << "   " << std::left << std::setw(16) << kernels->name << std::right
+                    << (exact ? "conversions exact" : "conversions MISMATCH") << ", gemv max diff " << std::setprecision(2) << sumDiff
+                    << ", master update max diff " << masterDiff << std::setprecision(6) << (pass ? "  (OK)\n" : "  (FAILED)\n");
+            }
+        }
+    }
+
+    // 2. Accuracy parity: the same initial network trained by per-sample SGD in fp32, bf16 and fp16
+    std::vector<float> trainIn, trainOut, testIn, testOut;
+    MakeLearnableData(6000, trainIn, trainOut);
+    MakeLearnableData(2000, testIn, testOut);
+    Network net({ 100 }, 10, 784);
+    Network fp32 = net;
+    MixedPrecisionNetwork bf16(net, HalfType::BF16), fp16(net, HalfType::FP16);
+    Workspace ws(fp32);
+    MixedWorkspace bws(bf16), fws(fp16);
+    for (int epoch = 0; epoch < 2; epoch++) {
+        for (int n = 0; n < 6000; n++) {
+            const float* in = &trainIn[(size_t)n * 784];
+            const float* tgt = &trainOut[(size_t)n * 10];
+            fp32.backPropagate(in, tgt, 0.002f, ws);
+            bf16.backPropagate(in, tgt, 0.002f, bws);
+            fp16.backPropagate(in, tgt, 0.002f, fws);
+        }
+    }
+    float acc32 = SampleAccuracy(fp32, ws, testIn, testOut);
+    float accBf16 = SampleAccuracy(bf16, bws, testIn, testOut);
+    float accFp16 = SampleAccuracy(fp16, fws, testIn, testOut);
+    bool parity = std::fabs(accBf16 - acc32) < 0.01f && std::fabs(accFp16 - acc32) < 0.01f;
+
+    // The fp32-trained weights served from 16 bits
+    MixedPrecisionNetwork served(fp32, HalfType::BF16);
+    MixedWorkspace sws(served);
+    int agree = 0;
+    float worstProb = 0.0f;
+    for (int n = 0; n < 2000; n++) {
+        const std::vector<float>& out32 = fp32.feedForward(&testIn[(size_t)n * 784], ws);
+        const std::vector<float>& out16 = served.feedForward(&testIn[(size_t)n * 784], sws);
+        agree += std::max_element(out32.begin(), out32.end()) - out32.begin() == std::max_element(out16.begin(), out16.end()) - out16.begin();
+        worstProb = std::max(worstProb, MaxAbsDiff(out32, out16));
+    }
+    parity = parity && agree >= 1980;
+    ok = ok && parity;
+    std::cout << std::fixed << std::setprecision(4)
+        << "   trained 784 -> 100 -> 10: test accuracy fp32 " << acc32 << " | bf16 " << accBf16 << " | fp16 " << accFp16 << "\n"
+        << "   fp32 weights served as bf16: top-1 agreement " << agree / 2000.0f << " | max prob diff " << worstProb
+        << std::defaultfloat << (parity ? "  (OK)\n" : "  (FAILED)\n");
+
+    // A network with convolution layers is refused: the empty one answers nothing and trains nothing
+    {
+        std::vector<Layer> features = { Layer::Conv2D(1, 8, 8, 2, 3, ActivationType::RELU), Layer::MaxPool(2, 6, 6, 2) };
+        Network conv(features, { 8 }, 10);
+        std::cout << "   ";
+        MixedPrecisionNetwork refused(conv, HalfType::BF16);
+        MixedWorkspace rws(refused);
+        std::vector<float> in(64, 0.5f), tgt(10, 0.1f);
+        std::vector<unsigned char> pixels(64, 128);
+        bool empty = refused.numInputs() == 0 && refused.feedForward(in.data(), rws).empty()
+            && refused.feedForward(pixels.data(), rws).empty();
+        refused.backPropagate(in.data(), tgt.data(), 0.01f, rws);
+        ok = ok && empty;
+        std::cout << "   conv network: empty mixed network, feedForward gives no outputs" << (empty ? "  (OK)\n" : "  (FAILED)\n");
+    }
+
+    // 3. Throughput on dense inputs (the fp32 path would go sparse on mostly-zero ones)
+    const int numSamples = 500;
+    std::vector<float> dense((size_t)numSamples * 784);
+    for (float& v : dense) v = 0.5f + 0.5f * (float)rand() / RAND_MAX;
+    const int hiddenSizes[] = { 100, 1000 };
+    std::cout << "   us per sample, dense inputs [" << SimdHalf(HalfType::BF16).name << ", " << SimdHalf(HalfType::FP16).name << "]\n";
+    for (int hidden : hiddenSizes) {
+        Network base({ hidden }, 10, 784);
+        Network f32 = base;
+        Workspace ws32(f32);
+        double forward[3], train[3];
+        for (int variant = 0; variant < 3; variant++) {
+            MixedPrecisionNetwork mixed(base, variant == 1 ? HalfType::BF16 : HalfType::FP16);
+            MixedWorkspace mws(mixed);
+            const int reps = hidden >= 1000 ? 2 : 10;
+
+            auto start = std::chrono::steady_clock::now();
+            for (int r = 0; r < reps; r++) {
+                for (int n = 0; n < numSamples; n++) {
+                    const float* in = &dense[(size_t)n * 784];
+                    g_sink = variant == 0 ? f32.feedForward(in, ws32)[0] : mixed.feedForward(in, mws)[0];
+                }
+            }
+            forward[variant] = SecondsSince(start) * 1e6 / (reps * numSamples);
+
+            start = std::chrono::steady_clock::now();
+            for (int r = 0; r < reps; r++) {
+                for (int n = 0; n < numSamples; n++) {
+                    const float* in = &dense[(size_t)n * 784];
+                    const float* tgt = &testOut[(size_t)n * 10];
+                    if (variant == 0) f32.backPropagate(in, tgt, 0.0005f, ws32);
+                    else mixed.backPropagate(in, tgt, 0.0005f, mws);
+                }
+            }
+            train[variant] = SecondsSince(start) * 1e6 / (reps * numSamples);
+        }
+
+        MixedPrecisionNetwork sized(base, HalfType::BF16);
+        size_t bytes32 = 0;
+        for (const Layer& layer : base.layers) bytes32 += (layer.weights.size() + layer.biases.size()) * sizeof(float);
+        std::cout << std::fixed << std::setprecision(2)
+            << "   784 -> " << std::setw(4) << hidden << " -> 10  forward fp32 " << std::setw(6) << forward[0]
+            << " | bf16 " << std::setw(6) << forward[1] << " (" << forward[0] / forward[1] << "x) | fp16 " << std::setw(6) << forward[2]
+            << " (" << forward[0] / forward[2] << "x)\n"
+            << "                      train   fp32 " << std::setw(6) << train[0] << " | bf16 " << std::setw(6) << train[1]
+            << " (" << train[0] / train[1] << "x) | fp16 " << std::setw(6) << train[2] << " (" << train[0] / train[2] << "x)"
+            << " | weights " << bytes32 / 1024 << " -> " << sized.weightBytes() / 1024 << " KB\n" << std::defaultfloat;
+    }
+    return ok;
+}
+
+// --- CHECK: PROFILER ---
+// Every scope on the per-sample path is counted once per sample with the expected FLOPs,
+// and the cost of one scope stays small next to the work it times.
+static bool CheckProfiler() {
+    std::cout << "\n[Profiler] per-phase / per-layer counters, 784 -> 100 -> 10\n";
+    if (!Profiler::compiledIn()) {
+        bool ok = Profiler::report().entries.empty();
+        std::cout << "   compiled out (configure with -DNEURALNET_PROFILE=ON to build it in), report empty"
+            << (ok ? "  (OK)\n" : "  (FAILED)\n");
+        return ok;
+    }
+
+    const int numSamples = 500;
+    std::vector<float> inputs, targets;
+    MakeLearnableData(numSamples, inputs, targets);
+    std::vector<float> dense((size_t)numSamples * 784);
+    for (size_t i = 0; i < dense.size(); i++) dense[i] = 0.5f + 0.5f * (float)rand() / RAND_MAX; // keeps the dense path
+
+    Network net({ 100 }, 10, 784);
+    Workspace ws(net);
+    Profiler::reset();
+    for (int n = 0; n < numSamples; n++) net.backPropagate(&dense[(size_t)n * 784], &targets[(size_t)n * 10], 0.001f, ws);
+    ProfileReport report = Profiler::report();
+
+    // forward, propagate and update of every layer, plus the output deltas
+    bool ok = true;
+    int found = 0;
+    for (const ProfileEntry& e : report.entries) {
+        bool expected = (e.phase == ProfilePhase::FORWARD || e.phase == ProfilePhase::UPDATE)
+            || (e.phase == ProfilePhase::PROPAGATE && e.layer == 1) || (e.phase == ProfilePhase::OUTPUT_DELTAS && e.layer == 1);
+        if (!expected || e.calls != (unsigned long long)numSamples) ok = false;
+        if (e.phase == ProfilePhase::FORWARD && e.layer == 0 && e.flops != 2.0 * 78400 * numSamples) ok = false;
+        found++;
+    }
+    ok = ok && found == 6;
+    std::cout << "   " << found << " phase/layer entries, " << numSamples << " calls each"
+        << (ok ? "  (OK)\n" : "  (FAILED)\n");
+
+    // Cost of an empty scope (two timestamps and four counter updates)
+    const int reps = 200000;
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < reps; r++) {
+        NN_PROFILE_SCOPE(REDUCE, 15, 0, 0);
+    }
+    double scopeNs = SecondsSince(start) / reps * 1e9;
+    report.print(std::cout);
+    std::cout << "   one scope costs " << std::fixed << std::setprecision(1) << scopeNs << " ns; a sample's "
+        << found << " scopes are " << std::setprecision(2) << 100.0 * found * scopeNs * 1e-9 * numSamples / report.totalSeconds()
+        << "% of its profiled time\n" << std::defaultfloat;
+    Profiler::reset();
+    return ok;
+}
+
+// --- CHECK: CONVOLUTION LAYERS ---
+// Straight from the definition: outputs, input errors and the summed filter / bias gradients of one sample
+static void NaiveConv(const ConvShape& s, const float* w, const float* b, const float* in, float* out) {
+    for (int oc = 0; oc < s.outChannels; oc++) {
+        for (int oy = 0; oy < s.outHeight; oy++) {
+            for (int ox = 0; ox < s.outWidth; ox++) {
+                double sum = b[oc];
+                for (int c = 0; c < s.channels; c++) {
+                    for (int ky = 0; ky < s.kernel; ky++) {
+                        for (int kx = 0; kx < s.kernel; kx++) {
+                            int iy = oy * s.stride + ky - s.padding, ix = ox * s.stride + kx - s.padding;
+                            if (iy < 0 || iy >= s.height || ix < 0 || ix >= s.width) continue;
+                            sum += (double)w[((oc * s.channels + c) * s.kernel + ky) * s.kernel + kx] * in[(c * s.height + iy) * s.width + ix];
+                        }
+                    }
+                }
+                out[(oc * s.outHeight + oy) * s.outWidth + ox] = (float)sum;
+            }
+        }
+    }
+}
+
+static void NaiveConvBackward(const ConvShape& s, const float* w, const float* in, const float* d, float* errors, float* wGrad, float* bGrad) {
+    std::fill(errors, errors + s.channels * s.height * s.width, 0.0f);
+    for (int oc = 0; oc < s.outChannels; oc++) {
+        for (int oy = 0; oy < s.outHeight; oy++) {
+            for (int ox = 0; ox < s.outWidth; ox++) {
+                float delta = d[(oc * s.outHeight + oy) * s.outWidth + ox];
+                bGrad[oc] += delta;
+                for (int c = 0; c < s.channels; c++) {
+                    for (int ky = 0; ky < s.kernel; ky++) {
+                        for (int kx = 0; kx < s.kernel; kx++) {
+                            int iy = oy * s.stride + ky - s.padding, ix = ox * s.stride + kx - s.padding;
+                            if (iy < 0 || iy >= s.height || ix < 0 || ix >= s.width) continue;
+                            size_t wi = (size_t)((oc * s.channels + c) * s.kernel + ky) * s.kernel + kx;
+                            errors[(c * s.height + iy) * s.width + ix] += w[wi] * delta;
+                            wGrad[wi] += delta * in[(c * s.height + iy) * s.width + ix];
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Strokes that move: every class is a fixed set of three thick strokes, drawn up to 4 pixels off center
+// at a random brightness, with a little noise. A dense layer has to learn every position separately.
+static void MakeShiftedStrokes(int numSamples, std::vector<float>& inputs, std::vector<float>& targets) {
+    static std::vector<float> prototypes;
+    if (prototypes.empty()) {
+        prototypes.assign(10 * 784, 0.0f);
+        for (int c = 0; c < 10; c++) {
+            for (int stroke = 0; stroke < 3; stroke++) {
+                int x0 = 6 + rand() % 16, y0 = 6 + rand() % 16, x1 = 6 + rand() % 16, y1 = 6 + rand() % 16;
+                for (int t = 0; t <= 16; t++) {
+                    int x = x0 + (x1 - x0) * t / 16, y = y0 + (y1 - y0) * t / 16;
+                    for (int dy = 0; dy < 2; dy++) {
+                        for (int dx = 0; dx < 2; dx++) prototypes[c * 784 + (y + dy) * 28 + x + dx] = 1.0f;
+                    }
+                }
+            }
+        }
+    }
+
+    inputs.assign((size_t)numSamples * 784, 0.0f);
+    targets.assign((size_t)numSamples * 10, 0.0f);
+    for (int n = 0; n < numSamples; n++) {
+        int label = rand() % 10, sx = rand() % 9 - 4, sy = rand() % 9 - 4;
+        float level = 0.5f + 0.5f * (float)rand() / RAND_MAX;
+        targets[(size_t)n * 10 + label] = 1.0f;
+        float* img = &inputs[(size_t)n * 784];
+        for (int y = 0; y < 28; y++) {
+            for (int x = 0; x < 28; x++) {
+                int px = x - sx, py = y - sy;
+                float v = (px >= 0 && px < 28 && py >= 0 && py < 28) ? level * prototypes[label * 784 + py * 28 + px] : 0.0f;
+                if (rand() % 25 == 0) v = std::max(v, (float)rand() / RAND_MAX);
+                img[y * 28 + x] = v;
+            }
+        }
+    }
+}
+
+static double NetworkFlops(const Network& net) {
+    double flops = 0.0;
+    for (const Layer& layer : net.layers) flops += 2.0 * layer.flopsPerSample();
+    return flops;
+}
+
+static size_t NetworkParameters(const Network& net) {
+    size_t count = 0;
+    for (const Layer& layer : net.layers) count += layer.weights.size() + layer.biases.size();
+    return count;
+}
+
+// Summed cross-entropy of a batch, in double so finite differences see the change
+static double BatchLoss(const Network& net, const float* inputs, const float* targets, int batchSize, BatchWorkspace& ws) {
+    const float* outputs = net.feedForwardBatch(inputs, batchSize, ws);
+    double loss = 0.0;
+    for (int k = 0; k < batchSize * net.numOutputs(); k++) {
+        if (targets[k] > 0.0f) loss -= std::log((double)outputs[k]);
+    }
+    return loss;
+}
+
+static bool CheckConv() {
+    std::cout << "\n[Conv] Conv2D / MaxPool layers: im2col + GEMM and direct kernels\n";
+    bool ok = true;
+
+    // 1. Both convolution paths against the definition (outputs, input errors, filter and bias gradients),
+    //    with and without padding and stride
+    {
+        struct Shape { int channels, size, outChannels, kernel, stride, padding; };
+        const Shape shapes[] = { { 1, 28, 8, 5, 1, 0 }, { 8, 12, 16, 3, 1, 1 }, { 3, 11, 4, 5, 1, 2 }, { 4, 13, 6, 3, 2, 1 } };
+        const int batchSize = 3;
+        for (const Shape& sh : shapes) {
+            Layer layer = Layer::Conv2D(sh.channels, sh.size, sh.size, sh.outChannels, sh.kernel, ActivationType::RELU, sh.stride, sh.padding);
+            const ConvShape& s = layer.shape;
+            for (float& b : layer.biases) b = (float)rand() / RAND_MAX - 0.5f;
+            std::vector<float> in((size_t)batchSize * layer.numInputs), d((size_t)batchSize * layer.numNeurons);
+            for (float& v : in) v = (float)rand() / RAND_MAX;
+            for (float& v : d) v = (float)rand() / RAND_MAX - 0.5f;
+
+            std::vector<float> outRef(d.size()), errRef(in.size()), wGradRef(layer.weights.size(), 0.0f), bGradRef(layer.biases.size(), 0.0f);
+            for (int n = 0; n < batchSize; n++) {
+                NaiveConv(s, layer.weights.data(), layer.biases.data(), &in[(size_t)n * layer.numInputs], &outRef[(size_t)n * layer.numNeurons]);
+                NaiveConvBackward(s, layer.weights.data(), &in[(size_t)n * layer.numInputs], &d[(size_t)n * layer.numNeurons],
+                    &errRef[(size_t)n * layer.numInputs], wGradRef.data(), bGradRef.data());
+            }
+
+            std::cout << "   " << sh.channels << "x" << sh.size << "x" << sh.size << " -> " << sh.outChannels << " x " << sh.kernel << "x" << sh.kernel
+                << " stride " << sh.stride << " pad " << sh.padding << ", max diff outputs+errors / gradients:";
+            const bool paths[] = { false, true };
+            for (bool direct : paths) {
+                if (direct && !ConvHasDirect(s)) continue;
+                std::vector<float> out(d.size()), err(in.size());
+                std::vector<float> wGrad(layer.weights.size(), 0.0f), bGrad(layer.biases.size(), 0.0f);
+                ConvForward(layer, in.data(), batchSize, out.data(), 1.0f, direct);
+                ConvPropagate(layer, d.data(), batchSize, err.data(), direct);
+                ConvGradients(layer, in.data(), d.data(), batchSize, 1.0f, 1.0f, wGrad.data(), bGrad.data(), direct);
+                float diff = std::max(MaxAbsDiff(out, outRef), MaxAbsDiff(err, errRef));
+                float gradDiff = std::max(MaxAbsDiff(wGrad, wGradRef), MaxAbsDiff(bGrad, bGradRef));
+                ok = ok && diff < 1e-4f && gradDiff < 1e-3f;
+                std::cout << (direct ? "  direct " : "  im2col ") << diff << " / " << gradDiff;
+            }
+            std::cout << "\n";
+        }
+
+        // Pooling: every window's max forward, its delta back to the winner only
+        Layer pool = Layer::MaxPool(3, 9, 9, 2);
+        std::vector<float> in(pool.numInputs), out(pool.numNeurons), d(pool.numNeurons), err(pool.numInputs);
+        for (float& v : in) v = (float)rand() / RAND_MAX;
+        for (float& v : d) v = (float)rand() / RAND_MAX + 1.0f;
+        pool.feedForward(in.data(), out.data());
+        pool.propagateError(in.data(), d.data(), err.data());
+        bool poolOk = true;
+        float routed = 0.0f, expected = 0.0f;
+        for (int c = 0; c < 3; c++) {
+            for (int oy = 0; oy < 4; oy++) {
+                for (int ox = 0; ox < 4; ox++) {
+                    float best = 0.0f;
+                    for (int y = 0; y < 2; y++) {
+                        for (int x = 0; x < 2; x++) best = std::max(best, in[(c * 9 + oy * 2 + y) * 9 + ox * 2 + x]);
+                    }
+                    poolOk = poolOk && out[(c * 4 + oy) * 4 + ox] == best;
+                    expected += d[(c * 4 + oy) * 4 + ox];
+                }
+            }
+        }
+        for (int i = 0; i < pool.numInputs; i++) {
+            routed += err[i];
+            if (err[i] != 0.0f) poolOk = poolOk && std::find(d.begin(), d.end(), err[i]) != d.end();
+        }
+        poolOk = poolOk && std::fabs(routed - expected) < 1e-3f;
+        ok = ok && poolOk;
+        std::cout << "   maxpool 3x9x9 / 2: window maxima and routed deltas " << (poolOk ? "exact" : "WRONG") << "\n";
+    }
+
+    // 2. A whole network's gradients (conv, pool, dense) against finite differences of the loss
+    {
+        srand(7);
+        std::vector<Layer> features = { Layer::Conv2D(2, 9, 9, 3, 3, ActivationType::RELU, 1, 1), Layer::MaxPool(3, 9, 9, 2) };
+        Network net(features, { 8 }, 10);
+        const int batchSize = 4;
+        std::vector<float> inputs((size_t)batchSize * net.numInputs()), targets((size_t)batchSize * 10, 0.0f);
+        for (float& v : inputs) v = (float)rand() / RAND_MAX;
+        for (int n = 0; n < batchSize; n++) targets[(size_t)n * 10 + rand() % 10] = 1.0f;
+
+        BatchWorkspace ws(net, batchSize);
+        Gradients grads(net);
+        net.computeGradients(inputs.data(), targets.data(), batchSize, ws, grads);
+
+        // computeGradients gives the descent direction, -dLoss/dw
+        float worst = 0.0f;
+        const float eps = 1e-2f;
+        for (int k = 0; k < 24; k++) {
+            int layer = (k < 16) ? 0 : 2;
+            bool bias = k % 4 == 3;
+            std::vector<float>& params = bias ? net.layers[layer].biases : net.layers[layer].weights;
+            int index = rand() % (int)params.size();
+            float saved = params[index];
+            params[index] = saved + eps;
+            double up = BatchLoss(net, inputs.data(), targets.data(), batchSize, ws);
+            params[index] = saved - eps;
+            double down = BatchLoss(net, inputs.data(), targets.data(), batchSize, ws);
+            params[index] = saved;
+            float numeric = (float)(-(up - down) / (2.0 * eps));
+            float analytic = (bias ? grads.biases[layer] : grads.weights[layer])[index];
+            worst = std::max(worst, std::fabs(numeric - analytic) / std::max(0.1f, std::fabs(analytic)));
+        }
+        bool pass = worst < 2e-2f;
+        ok = ok && pass;
+        std::cout << "   network gradients vs finite differences: worst relative error " << worst << (pass ? "  (OK)\n" : "  (FAILED)\n");
+
+        // The data-parallel trainer sums per-thread gradients and updates biases by range: same step as trainBatch
+        srand(8);
+        Network reference(features, { 8 }, 10);
+        Network parallel = reference;
+        ParallelTrainer trainer(parallel, 3, batchSize);
+        for (int step = 0; step < 3; step++) {
+            reference.trainBatch(inputs.data(), targets.data(), batchSize, 0.1f, ws);
+            trainer.trainBatch(inputs.data(), targets.data(), batchSize, 0.1f);
+        }
+        float diff = MaxWeightDiff(reference, parallel);
+        pass = diff < 1e-5f;
+        ok = ok && pass;
+        std::cout << "   ParallelTrainer (3 threads) vs trainBatch: max weight difference " << diff << (pass ? "  (OK)\n" : "  (FAILED)\n");
+
+        // Model file: version 2 with the shapes, same outputs after a round trip
+        bool saved = SaveModel(reference, "bench-conv.nnm");
+        Network loaded;
+        bool roundTrip = saved && LoadModel("bench-conv.nnm", loaded) && loaded.layers.size() == reference.layers.size();
+        if (roundTrip) {
+            BatchWorkspace lws(loaded, batchSize);
+            std::vector<float> a(reference.feedForwardBatch(inputs.data(), batchSize, ws), reference.feedForwardBatch(inputs.data(), batchSize, ws) + batchSize * 10);
+            const float* b = loaded.feedForwardBatch(inputs.data(), batchSize, lws);
+            roundTrip = std::equal(a.begin(), a.end(), b) && loaded.layers[0].type == LayerType::CONV2D && loaded.layers[1].type == LayerType::MAXPOOL;
+        }
+        std::remove("bench-conv.nnm");
+        ok = ok && roundTrip;
+        std::cout << "   model file round trip " << (roundTrip ? "identical" : "DIFFERENT") << "\n";
+    }
+
+    // 3. im2col + GEMM vs direct: a training step's three passes per sample, and what the layer picks
+    {
+        struct Shape { int channels, size, outChannels, kernel, padding; };
+        const Shape shapes[] = { { 1, 28, 8, 5, 0 }, { 1, 28, 32, 3, 1 }, { 3, 32, 16, 3, 1 }, { 4, 12, 16, 3, 1 },
+            { 8, 12, 16, 5, 0 }, { 8, 12, 16, 3, 1 }, { 16, 12, 32, 3, 1 }, { 32, 8, 64, 3, 1 } };
+        const int batchSize = 16;
+        std::cout << "   us per sample (forward, propagate, gradients)    taps   im2col   direct   picked\n";
+        for (const Shape& sh : shapes) {
+            Layer layer = Layer::Conv2D(sh.channels, sh.size, sh.size, sh.outChannels, sh.kernel, ActivationType::RELU, 1, sh.padding);
+            std::vector<float> in((size_t)batchSize * layer.numInputs), out((size_t)batchSize * layer.numNeurons), err(in.size());
+            for (float& v : in) v = (float)rand() / RAND_MAX;
+
+            double us[2];
+            for (int direct = 0; direct < 2; direct++) {
+                ConvForward(layer, in.data(), batchSize, out.data(), 1.0f, direct != 0); // warm-up (scratch)
+                int reps = std::max(2, (int)(2e7 / (layer.flopsPerSample() * batchSize)));
+                auto start = std::chrono::steady_clock::now();
+                for (int r = 0; r < reps; r++) {
+                    ConvForward(layer, in.data(), batchSize, out.data(), 1.0f, direct != 0);
+                    ConvPropagate(layer, out.data(), batchSize, err.data(), direct != 0);
+                    ConvGradients(layer, in.data(), out.data(), batchSize, 1.0f, 1e-9f, layer.weights.data(), layer.biases.data(), direct != 0);
+                }
+                us[direct] = SecondsSince(start) / reps / batchSize * 1e6;
+                g_sink = err[0];
+            }
+            bool picked = ConvPrefersDirect(layer.shape);
+            std::cout << "   " << std::setw(2) << sh.channels << "x" << std::setw(2) << sh.size << "x" << std::setw(2) << sh.size
+                << " -> " << std::setw(2) << sh.outChannels << " x " << sh.kernel << "x" << sh.kernel << " pad " << sh.padding
+                << std::setw(13) << sh.channels * sh.kernel * sh.kernel << std::fixed << std::setprecision(2)
+                << std::setw(9) << us[0] << std::setw(9) << us[1] << "   " << (picked ? "direct" : "im2col")
+                << (picked == (us[1] < us[0]) ? "" : " (slower)") << "\n" << std::defaultfloat;
+        }
+    }
+
+    // 4. Accuracy per parameter and per FLOP on shifted strokes: widening the dense layer vs a conv front end
+    {
+        const int numTrain = 3000, numTest = 1000, epochs = 6, batchSize = 32;
+        srand(21);
+        std::vector<float> trainIn, trainOut, testIn, testOut;
+        MakeShiftedStrokes(numTrain, trainIn, trainOut);
+        MakeShiftedStrokes(numTest, testIn, testOut);
+
+        std::vector<Network> nets;
+        std::vector<const char*> names;
+        nets.push_back(Network({ 100 }, 10, 784));
+        names.push_back("784 -> 100 -> 10");
+        nets.push_back(Network({ 400 }, 10, 784));
+        names.push_back("784 -> 400 -> 10");
+        std::vector<Layer> features = { Layer::Conv2D(1, 28, 28, 8, 5, ActivationType::RELU), Layer::MaxPool(8, 24, 24, 2),
+            Layer::Conv2D(8, 12, 12, 16, 3, ActivationType::RELU), Layer::MaxPool(16, 10, 10, 2) };
+        nets.push_back(Network(features, { 32 }, 10));
+        names.push_back("conv 8x5, pool, 16x3, pool -> 32 -> 10");
+
+        std::cout << "   shifted strokes, " << numTrain << " training samples, " << epochs << " epochs of batch " << batchSize << "\n";
+        std::vector<float> accuracy;
+        for (size_t k = 0; k < nets.size(); k++) {
+            Network& net = nets[k];
+            BatchWorkspace ws(net, batchSize);
+            auto start = std::chrono::steady_clock::now();
+            for (int epoch = 0; epoch < epochs; epoch++) {
+                for (int n = 0; n + batchSize <= numTrain; n += batchSize) {
+                    net.trainBatch(&trainIn[(size_t)n * 784], &trainOut[(size_t)n * 10], batchSize, 0.05f, ws);
+                }
+            }
+            double seconds = SecondsSince(start);
+            float loss;
+            accuracy.push_back(Evaluate(net, testIn, testOut, loss));
+            std::cout << "   " << std::left << std::setw(40) << names[k] << std::right << std::setw(8) << NetworkParameters(net) << " params "
+                << std::fixed << std::setprecision(2) << std::setw(6) << NetworkFlops(net) / 1e6 << " MFLOP/sample | test accuracy "
+                << std::setprecision(3) << accuracy.back() << ", loss " << loss << " | "
+                << std::setprecision(0) << std::setw(6) << epochs * numTrain / seconds << " samples/s\n" << std::defaultfloat;
+        }
+        bool pass = accuracy[2] > accuracy[0] && accuracy[2] > accuracy[1];
+        ok = ok && pass;
+        std::cout << "   conv beats both dense networks with " << std::fixed << std::setprecision(1)
+            << (double)NetworkParameters(nets[1]) / NetworkParameters(nets[2]) << "x fewer parameters than the wide one"
+            << (pass ? "  (OK)\n" : "  (FAILED)\n") << std::defaultfloat;
+    }
+    return ok;
+}
+
+// --- CHECK + BENCH: PREPROCESSING AND AUGMENTATION ---
+// CenterImage's rounded whole-pixel move, in double. tie is set when the center of mass sits so close to a
+// rounding boundary that float summation order may legitimately pick the other side.
+static void CenterReference(const float* in, float* out, int width, int height, bool& tie) {
+    double total = 0.0, sumX = 0.0, sumY = 0.0;
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            double v = std::max(in[y * width + x], 0.0f);
+            total += v;
+            sumX += x * v;
+            sumY += y * v;
+        }
+    }
+    std::fill(out, out + width * height, 0.0f);
+    tie = false;
+    if (total == 0.0) return;
+    double targetX = width * 0.5 - sumX / total + 0.5, targetY = height * 0.5 - sumY / total + 0.5;
+    tie = std::fabs(targetX - std::round(targetX)) < 1e-4 || std::fabs(targetY - std::round(targetY)) < 1e-4;
+    int shiftX = (int)std::floor(targetX), shiftY = (int)std::floor(targetY);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            int nx = x + shiftX, ny = y + shiftY;
+            if (nx >= 0 && nx < width && ny >= 0 && ny < height) out[ny * width + nx] = std::max(in[y * width + x], 0.0f);
+        }
+    }
+}
+
+// Canvases of a few brush strokes anywhere on the grid, as 8-bit pixels
+static std::vector<unsigned char> MakeStrokeImages(int count) {
+    std::vector<unsigned char> pixels((size_t)count * 784);
+    std::vector<float> grid(784);
+    for (int n = 0; n < count; n++) {
+        std::fill(grid.begin(), grid.end(), 0.0f);
+        for (int stroke = 0; stroke < 1 + rand() % 3; stroke++) {
+            int x = rand() % 28, y = rand() % 28, dx = rand() % 3 - 1, dy = rand() % 3 - 1;
+            for (int step = 0; step < 4 + rand() % 10; step++) PaintCanvas(grid.data(), x + dx * step, y + dy * step);
+        }
+        for (int i = 0; i < 784; i++) pixels[(size_t)n * 784 + i] = (unsigned char)(grid[i] * 255.0f);
+    }
+    return pixels;
+}
+
+static bool ImageMoments(const float* image, float& x, float& y, float& mass) {
+    mass = 0.0f;
+    float sumX = 0.0f, sumY = 0.0f;
+    for (int i = 0; i < 784; i++) {
+        mass += image[i];
+        sumX += (i % 28) * image[i];
+        sumY += (i / 28) * image[i];
+    }
+    if (mass <= 0.0f) return false;
+    x = sumX / mass;
+    y = sumY / mass;
+    return true;
+}
+
+// Every batch of one AugmentStream epoch, inputs and labels back to back
+static void AugmentedEpoch(DataSource& source, const AugmentSettings& settings, int threads, unsigned int seed,
+    std::vector<float>& inputs, std::vector<unsigned char>& labels) {
+    BatchStream stream(source, 64);
+    AugmentStream augmented(stream, settings, 28, 28, threads);
+    augmented.startEpoch(seed);
+    inputs.clear();
+    labels.clear();
+    while (const AugmentedBatch* batch = augmented.next()) {
+        inputs.insert(inputs.end(), batch->inputs.begin(), batch->inputs.begin() + (size_t)batch->count * 784);
+        labels.insert(labels.end(), batch->labels.begin(), batch->labels.begin() + batch->count);
+    }
+}
+
+static bool CheckAugment() {
+    std::cout << "\n[Augment] vectorized centering and augmentation, AugmentStream pipeline, 28x28\n";
+    bool ok = true;
+
+    std::vector<SimdLevel> levels;
+    for (SimdLevel level : { SimdLevel::SCALAR, SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::AVX512 }) {
+        if (SimdKernelsFor(level)) levels.push_back(level);
+    }
+
+    // 1. Centering: CenterGrid and every level's Augmenter vs the reference, on off-center strokes
+    const int numImages = 500;
+    std::vector<unsigned char> pixels = MakeStrokeImages(numImages);
+    std::vector<float> image(784), expected(784), actual(784);
+    AugmentSettings centerOnly;
+    centerOnly.center = true;
+    int mismatches = 0, ties = 0;
+    for (int n = 0; n < numImages; n++) {
+        const unsigned char* px = &pixels[(size_t)n * 784];
+        for (int i = 0; i < 784; i++) image[i] = px[i] * PIXEL_SCALE;
+        bool tie;
+        CenterReference(image.data(), expected.data(), 28, 28, tie);
+        ties += tie;
+
+        CenterGrid(image.data(), actual.data());
+        bool same = actual == expected;
+        for (SimdLevel level : levels) {
+            Augmenter augmenter(centerOnly, 28, 28, level);
+            std::mt19937 rng(n);
+            augmenter.apply(px, actual.data(), rng);
+            same = same && actual == expected;
+        }
+        if (!same && !tie) mismatches++;
+    }
+    ok = ok && mismatches == 0;
+    std::cout << "   centering vs reference on " << numImages << " canvases x " << levels.size() + 1 << " kernels: "
+        << mismatches << " mismatches (" << ties << " on a rounding tie, either side accepted)"
+        << (mismatches == 0 ? "  (OK)\n" : "  (FAILED)\n");
+
+    // 2. Every level's warp (affine + elastic) against the scalar one, same generator
+    AugmentSettings full;
+    full.center = true;
+    full.maxShift = 2.0f;
+    full.maxRotation = 15.0f;
+    full.maxScale = 0.15f;
+    full.elasticAlpha = 8.0f;
+    std::vector<float> reference((size_t)numImages * 784), warped((size_t)numImages * 784);
+    {
+        Augmenter scalar(full, 28, 28, SimdLevel::SCALAR);
+        std::mt19937 rng(7);
+        scalar.applyBatch(pixels.data(), numImages, reference.data(), rng);
+    }
+    bool warpsAgree = true;
+    std::cout << "   shift+rotate+zoom+elastic warp, max diff vs scalar:";
+    for (SimdLevel level : levels) {
+        Augmenter augmenter(full, 28, 28, level);
+        std::mt19937 rng(7);
+        augmenter.applyBatch(pixels.data(), numImages, warped.data(), rng);
+        float diff = MaxAbsDiff(warped, reference);
+        warpsAgree = warpsAgree && diff < 1e-5f;
+        std::cout << " " << SimdLevelName(level) << " " << std::setprecision(2) << diff;
+    }
+    ok = ok && warpsAgree;
+    std::cout << std::defaultfloat << (warpsAgree ? "  (OK)\n" : "  (FAILED)\n");
+
+    // 3. Geometry: rotation and zoom keep a centered image's center of mass, shifts stay within maxShift
+    std::vector<unsigned char> disc(784, 0);
+    for (int i = 0; i < 784; i++) {
+        float x = i % 28 - 14.0f, y = i / 28 - 14.0f;
+        if (x * x + y * y <= 36.0f) disc[i] = 255;
+    }
+    AugmentSettings turn, shift;
+    turn.maxRotation = 30.0f;
+    turn.maxScale = 0.2f;
+    shift.maxShift = 3.0f;
+    Augmenter turner(turn, 28, 28), shifter(shift, 28, 28);
+    std::mt19937 rng(11);
+    float worstCenter = 0.0f, worstShift = 0.0f, meanShift = 0.0f;
+    for (int n = 0; n < 200; n++) {
+        float x, y, mass;
+        turner.apply(disc.data(), actual.data(), rng);
+        if (ImageMoments(actual.data(), x, y, mass)) worstCenter = std::max(worstCenter, std::max(std::fabs(x - 14.0f), std::fabs(y - 14.0f)));
+        shifter.apply(disc.data(), actual.data(), rng);
+        if (ImageMoments(actual.data(), x, y, mass)) {
+            worstShift = std::max(worstShift, std::max(std::fabs(x - 14.0f), std::fabs(y - 14.0f)));
+            meanShift += (std::fabs(x - 14.0f) + std::fabs(y - 14.0f)) / 400.0f;
+        }
+    }
+    bool geometry = worstCenter < 0.05f && worstShift <= 3.01f && meanShift > 1.0f;
+    ok = ok && geometry;
+    std::cout << std::fixed << std::setprecision(3) << "   rotate/zoom: center of mass moves <= " << worstCenter
+        << " px | shift 3: largest move " << worstShift << " px, mean " << meanShift << " px" << std::defaultfloat
+        << (geometry ? "  (OK)\n" : "  (FAILED)\n");
+
+    // 4. The pipeline: the same inputs with 1 and 3 workers, in the BatchStream's order
+    const char* imageFile = "bench-augment-images.idx3-ubyte";
+    const char* labelFile = "bench-augment-labels.idx1-ubyte";
+    const int numRecords = 6000;
+    WriteIdxFiles(imageFile, labelFile, numRecords);
+    IdxFileSource source;
+    ok = source.open(imageFile, labelFile) && ok;
+
+    std::vector<float> oneWorker, threeWorkers;
+    std::vector<unsigned char> labelsOne, labelsThree, streamLabels;
+    AugmentedEpoch(source, full, 1, 5, oneWorker, labelsOne);
+    AugmentedEpoch(source, full, 3, 5, threeWorkers, labelsThree);
+    {
+        BatchStream stream(source, 64);
+        stream.startEpoch(5);
+        while (const Batch* batch = stream.next()) streamLabels.insert(streamLabels.end(), batch->labels.begin(), batch->labels.begin() + batch->count);
+    }
+    bool deterministic = (int)labelsOne.size() == numRecords && labelsOne == labelsThree && labelsOne == streamLabels
+        && oneWorker == threeWorkers;
+
+    // Abandoning an epoch half way and starting another must not lose or duplicate anything
+    int restarted = 0;
+    {
+        BatchStream stream(source, 64);
+        AugmentStream augmented(stream, full, 28, 28, 3);
+        augmented.startEpoch(1);
+        for (int i = 0; i < 5; i++) augmented.next();
+        augmented.startEpoch(2);
+        while (const AugmentedBatch* batch = augmented.next()) restarted += batch->count;
+    }
+    deterministic = deterministic && restarted == numRecords;
+    ok = ok && deterministic;
+    std::cout << "   1 vs 3 workers: identical inputs, labels in BatchStream order, restart mid-epoch "
+        << restarted << "/" << numRecords << (deterministic ? "  (OK)\n" : "  (FAILED)\n");
+
+    // 5. Cost per image against a training step, and training with the pipeline on
+    auto perImage = [&](const AugmentSettings& settings) {
+        Augmenter augmenter(settings, 28, 28);
+        std::mt19937 gen(3);
+        const int reps = 4;
+        auto start = std::chrono::steady_clock::now();
+        for (int r = 0; r < reps; r++) augmenter.applyBatch(pixels.data(), numImages, warped.data(), gen);
+        return SecondsSince(start) * 1e6 / (reps * numImages);
+    };
+    AugmentSettings plain, affine = full;
+    affine.elasticAlpha = 0.0f;
+    const double normalizeUs = perImage(plain), centerUs = perImage(centerOnly), affineUs = perImage(affine), fullUs = perImage(full);
+
+    Network net({ 100 }, 10, 784);
+    ParallelTrainer trainer(net, 1, 64);
+    std::vector<float> inputs, targets;
+    MakeBatchData(64 * 20, inputs, targets);
+    auto start = std::chrono::steady_clock::now();
+    for (int b = 0; b < 20; b++) trainer.trainBatch(&inputs[(size_t)b * 64 * 784], &targets[(size_t)b * 64 * 10], 64, 0.01f);
+    const double trainUs = SecondsSince(start) * 1e6 / (20 * 64);
+
+    std::cout << std::fixed << std::setprecision(2) << "   us per image [" << Simd().name << "]: normalize " << normalizeUs
+        << " | center " << centerUs << " | shift+rotate+zoom " << affineUs << " | + elastic " << fullUs
+        << " | training step per sample (784 -> 100 -> 10) " << trainUs << "\n"
+        << "   one augmentation thread keeps up with " << std::setprecision(1) << trainUs / fullUs
+        << " training threads" << std::defaultfloat << "\n";
+
+    const int hardware = ThreadPool::defaultThreadCount();
+    for (int augmentThreads : { 0, 2 }) {
+        BatchStream stream(source, 64);
+        std::unique_ptr<AugmentStream> augmented;
+        if (augmentThreads) augmented.reset(new AugmentStream(stream, full, 28, 28, augmentThreads));
+        std::vector<float> batchInputs((size_t)64 * 784);
+        int samples = 0;
+        double stall = 0.0;
+        start = std::chrono::steady_clock::now();
+        for (int epoch = 1; epoch <= 2; epoch++) {
+            if (augmented) {
+                augmented->startEpoch(epoch);
+                while (const AugmentedBatch* batch = augmented->next()) {
+                    trainer.trainBatch(batch->inputs.data(), batch->targets.data(), batch->count, 0.01f);
+                    samples += batch->count;
+                }
+                stall = augmented->stallSeconds();
+            }
+            else {
+                stream.startEpoch(epoch);
+                while (const Batch* batch = stream.next()) {
+                    NormalizePixels(batch->pixels.data(), batch->count * 784, PIXEL_SCALE, 0.0f, batchInputs.data());
+                    trainer.trainBatch(batchInputs.data(), batch->targets.data(), batch->count, 0.01f);
+                    samples += batch->count;
+                }
+                stall = stream.stallSeconds();
+            }
+        }
+        double secs = SecondsSince(start);
+        std::cout << "   training " << (augmentThreads ? "augmented, 2 workers " : "raw batches          ") << std::setw(9)
+            << (int)(samples / secs) << " samples/s, stalled " << std::fixed << std::setprecision(2) << stall * 1000.0
+            << " ms of " << secs * 1000.0 << " ms" << std::defaultfloat << "\n";
+    }
+    if (hardware < 4) std::cout << "   (" << hardware << " hardware threads: the workers share cores with the trainer here)\n";
+
+    std::remove(imageFile);
+    std::remove(labelFile);
+    return ok;
+}
+
+// --- CHECK: INFERENCE SERVER ---
+// connections clients, each with pipeline requests in flight, send requests pixel requests in total
+static double ServeLoad(int port, int connections, int pipeline, int requests, const std::vector<unsigned char>& pixels, int& failures) {
+    std::vector<int> failed(connections, 0);
+    std::vector<std::thread> clients;
+    auto start = std::chrono::steady_clock::now();
+    for (int c = 0; c < connections; c++) {
+        clients.emplace_back([&, c]() {
+            ServeAddress address;
+            address.port = port;
+            ServeClient client;
+            if (!client.connect(address)) {
+                failed[c] = 1;
+                return;
+            }
+            int quota = requests / connections, sent = 0, received = 0;
+            ServeResponseHeader header;
+            std::vector<unsigned char> payload;
+            while (received < quota) {
+                while (sent < quota && sent - received < pipeline) {
+                    client.send(sent, ServeRequestType::PIXELS, &pixels[(size_t)(sent % 64) * 784], 784);
+                    sent++;
+                }
+                if (!client.receive(header, payload) || header.status != (unsigned int)ServeStatus::OK) {
+                    failed[c]++;
+                    return;
+                }
+                received++;
+            }
+        });
+    }
+    for (std::thread& t : clients) t.join();
+    for (int f : failed) failures += f;
+    return SecondsSince(start);
+}
+
+static bool CheckServe() {
+    std::cout << "\n[Serve] local inference server, 784 -> 100 -> 10 over localhost TCP\n";
+    bool ok = true;
+
+    Network net({ 100 }, 10, 784);
+    std::vector<unsigned char> pixels((size_t)64 * 784);
+    for (unsigned char& p : pixels) p = (unsigned char)(rand() & 0xFF);
+    std::vector<float> expected((size_t)64 * 10);
+    {
+        BatchWorkspace ws(net, 1);
+        for (int n = 0; n < 64; n++) {
+            const float* out = net.feedForwardBatch(&pixels[(size_t)n * 784], 1, ws);
+            std::copy(out, out + 10, &expected[(size_t)n * 10]);
+        }
+    }
+
+    // 1. Answers: 64 pixel and 64 float requests in flight on one connection, batched by the server,
+    //    each matched back by id against a forward pass of its own
+    ServeSettings settings;
+    settings.threads = 2;
+    settings.maxBatch = 16;
+    settings.maxDelayMicros = 200;
+    ModelSlot models(ReadOnlyModel::own(net));
+    InferenceServer server(models, settings);
+    ServeAddress address;
+    ok = server.start(address) && ok;
+    address.port = server.boundPort();
+
+    ServeClient client;
+    ok = client.connect(address) && ok;
+    std::vector<float> floats(784);
+    for (unsigned int id = 0; id < 128; id++) {
+        const unsigned char* image = &pixels[(size_t)(id % 64) * 784];
+        if (id < 64) {
+            client.send(id, ServeRequestType::PIXELS, image, 784);
+        }
+        else {
+            for (int i = 0; i < 784; i++) floats[i] = image[i] * PIXEL_SCALE;
+            client.send(id, ServeRequestType::FLOATS, floats.data(), 784 * sizeof(float));
+        }
+    }
+    float maxDiff = 0.0f;
+    int answered = 0;
+    ServeResponseHeader header;
+    std::vector<unsigned char> payload;
+    for (int n = 0; n < 128 && client.receive(header, payload); n++) {
+        if (header.status != (unsigned int)ServeStatus::OK || header.id >= 128 || header.bytes != 10 * sizeof(float)) continue;
+        const float* probs = (const float*)payload.data();
+        for (int k = 0; k < 10; k++) maxDiff = std::max(maxDiff, std::fabs(probs[k] - expected[(header.id % 64) * 10 + k]));
+        answered++;
+    }
+    bool answers = answered == 128 && maxDiff < 1e-5f;
+    ok = ok && answers;
+    std::cout << "   128 pipelined requests (pixels + floats): " << answered << " answered, max diff vs feedForwardBatch "
+        << std::setprecision(2) << maxDiff << std::defaultfloat << (answers ? "  (OK)\n" : "  (FAILED)\n");
+
+    // 2. Malformed requests get BAD_REQUEST and the connection keeps working
+    unsigned char shortImage[10] = {};
+    std::vector<float> outputs;
+    client.send(500, ServeRequestType::PIXELS, shortImage, sizeof(shortImage));
+    bool rejected = client.receive(header, payload) && header.id == 500 && header.status == (unsigned int)ServeStatus::BAD_REQUEST;
+    client.send(501, (ServeRequestType)99, nullptr, 0);
+    rejected = rejected && client.receive(header, payload) && header.id == 501 && header.status == (unsigned int)ServeStatus::BAD_REQUEST;
+    bool stillServing = client.predict(pixels.data(), 784, outputs) && outputs.size() == 10 && std::fabs(outputs[3] - expected[3]) < 1e-5f;
+    std::string json;
+    bool counted = client.stats(json) && json.find("\"requests\":129,") != std::string::npos && json.find("\"errors\":2,") != std::string::npos
+        && server.stats().batches > 0 && server.stats().queueMicros.count() == 129;
+    bool errors = rejected && stillServing && counted;
+    ok = ok && errors;
+    std::cout << "   wrong size and unknown type rejected, connection still serves, stats count 129 + 2 errors"
+        << (errors ? "  (OK)\n" : "  (FAILED)\n");
+    client.close();
+    server.stop();
+
+    // 3. Batching under load: one connection vs eight, then the latency budget with a lone client
+    const int requests = 4000;
+    auto run = [&](int connections, int delay, ServeStats& stats) {
+        ServeSettings s;
+        s.threads = 2;
+        s.maxBatch = 64;
+        s.maxDelayMicros = delay;
+        InferenceServer loadServer(models, s);
+        ServeAddress any;
+        int failures = 0;
+        ok = loadServer.start(any) && ok;
+        double seconds = ServeLoad(loadServer.boundPort(), connections, 1, requests, pixels, failures);
+        stats = loadServer.stats();
+        loadServer.stop();
+        ok = ok && failures == 0;
+        return requests / seconds;
+    };
+    ServeStats one, eight, eager, patient;
+    double oneRate = run(1, 200, one), eightRate = run(8, 200, eight);
+    double eagerRate = run(1, 0, eager), patientRate = run(1, 1000, patient);
+    (void)patientRate;
+    std::cout << std::fixed << std::setprecision(0)
+        << "   budget 200 us, 1 connection:  " << std::setw(6) << oneRate << " requests/s, mean batch " << std::setprecision(2)
+        << one.meanBatch() << ", latency p50 " << std::setprecision(0) << one.latencyMicros.percentile(0.5) << " us\n"
+        << "   budget 200 us, 8 connections: " << std::setw(6) << eightRate << " requests/s, mean batch " << std::setprecision(2)
+        << eight.meanBatch() << ", latency p50 " << std::setprecision(0) << eight.latencyMicros.percentile(0.5)
+        << " us, p99 " << eight.latencyMicros.percentile(0.99) << " us\n";
+    bool batched = eight.meanBatch() > 1.5 && one.meanBatch() < 1.01;
+    ok = ok && batched;
+    std::cout << "   8 clients coalesce into batches, 1 client runs alone" << std::defaultfloat << (batched ? "  (OK)\n" : "  (FAILED)\n");
+
+    // A lone request waits out the whole budget (nothing else can join its batch), so the budget is a
+    // latency floor at low load and should be sized to the arrival rate
+    bool budget = patient.queueMicros.mean() >= 1000.0 && eager.queueMicros.mean() < patient.queueMicros.mean();
+    ok = ok && budget;
+    std::cout << std::fixed << std::setprecision(0) << "   1 connection, budget 0 us: " << eagerRate << " requests/s, queue wait mean "
+        << eager.queueMicros.mean() << " us | budget 1000 us: queue wait mean " << patient.queueMicros.mean() << " us"
+        << std::defaultfloat << (budget ? "  (OK)\n" : "  (FAILED)\n");
+    return ok;
+}
+
+// --- CHECK: MAPPED MODELS AND HOT RELOAD ---
+// A const (possibly mapped) network's outputs for one input
+static std::vector<float> Outputs(const Network& net, const std::vector<float>& inputs) {
+    Workspace ws(net);
+    return net.feedForward(inputs.data(), ws);
+}
+
+static bool CheckMappedModel() {
+    std::cout << "\n[Mapped] read-only models served from the page cache, hot reload under load\n";
+    const char* modelFile = "bench-mapped.nnm";
+    const char* otherFile = "bench-mapped-other.nnm";
+    bool ok = true;
+
+    Network a({ 100 }, 10, 784), b({ 100 }, 10, 784);
+    ok = SaveModel(a, modelFile) && ok;
+    std::vector<float> image(784);
+    for (float& v : image) v = (rand() & 0xFF) * PIXEL_SCALE;
+    const std::vector<float> outA = a.feedForward(image), outB = b.feedForward(image);
+
+    // 1. Mapping leaves every weight in the file's pages: no copies, and the same outputs as LoadModel
+    Network loaded;
+    auto start = std::chrono::steady_clock::now();
+    ok = LoadModel(modelFile, loaded) && ok;
+    double loadSecs = SecondsSince(start);
+    start = std::chrono::steady_clock::now();
+    std::shared_ptr<const ReadOnlyModel> mapped = ReadOnlyModel::map(modelFile);
+    double mapSecs = SecondsSince(start);
+    bool views = mapped && mapped->isMapped() && mapped->network().layers.size() == 2;
+    long long copied = 0;
+    for (int i = 0; views && i < 2; i++) {
+        const Layer& layer = mapped->network().layers[i];
+        copied += layer.weights.size() + layer.biases.size();
+        views = layer.isView() && layer.weightCount() == loaded.layers[i].weightCount()
+            && std::equal(layer.weightData(), layer.weightData() + layer.weightCount(), loaded.layers[i].weights.begin())
+            && std::equal(layer.biasData(), layer.biasData() + layer.biasCount(), loaded.layers[i].biases.begin());
+    }
+    views = views && copied == 0 && MaxAbsDiff(Outputs(mapped->network(), image), loaded.feedForward(image)) == 0.0f;
+    ok = ok && views;
+    std::cout << std::fixed << std::setprecision(3) << "   LoadModel " << loadSecs * 1000.0 << " ms, map " << mapSecs * 1000.0
+        << " ms; mapped layers view the file (0 floats copied), outputs identical" << std::defaultfloat << (views ? "  (OK)\n" : "  (FAILED)\n");
+
+    // The incremental path (the GUI's) on the mapped weights: a full pass, a few changed inputs, a sparse edit
+    bool incremental = mapped != nullptr;
+    if (incremental) {
+        IncrementalWorkspace mappedWs(mapped->network()), loadedWs(loaded);
+        std::vector<float> edited = image;
+        for (int i = 0; i < 8; i++) edited[i * 97] = 1.0f - edited[i * 97];
+        const int indices[] = { 3, 400, 783 };
+        const float values[] = { 0.25f, 1.0f, 0.0f };
+        float diff = MaxAbsDiff(mapped->network().feedForwardIncremental(image.data(), mappedWs), loaded.feedForwardIncremental(image.data(), loadedWs));
+        diff = std::max(diff, MaxAbsDiff(mapped->network().feedForwardIncremental(edited.data(), mappedWs), loaded.feedForwardIncremental(edited.data(), loadedWs)));
+        diff = std::max(diff, MaxAbsDiff(mapped->network().updateInputs(indices, values, 3, mappedWs), loaded.updateInputs(indices, values, 3, loadedWs)));
+        incremental = diff == 0.0f && mappedWs.partialPasses == 2 && mappedWs.fullPasses == 1;
+    }
+    ok = ok && incremental;
+    std::cout << "   feedForwardIncremental / updateInputs on the mapped model match LoadModel's"
+        << (incremental ? "  (OK)\n" : "  (FAILED)\n");
+
+    // Copying a mapped network copies its weights out, so the copy trains (and outlives the mapping); the
+    // views themselves refuse every update. 'viewing' views loaded's arrays the way a mapped network views the file.
+    bool copies = mapped != nullptr;
+    if (copies) {
+        Network copy = mapped->network(), viewing = loaded, pristine = loaded;
+        for (int i = 0; i < 2; i++) {
+            viewing.layers[i].viewParameters(loaded.layers[i].weightData(), loaded.layers[i].biasData());
+            copies = copies && !copy.layers[i].isView() && copy.layers[i].weights.size() == loaded.layers[i].weightCount()
+                && MaxAbsDiff(copy.layers[i].weights, loaded.layers[i].weights) == 0.0f
+                && MaxAbsDiff(copy.layers[i].biases, loaded.layers[i].biases) == 0.0f;
+        }
+        Network viewCopy = viewing;
+        std::vector<float> target(10, 0.0f);
+        target[3] = 1.0f;
+        BatchWorkspace bws(copy, 1);
+        Gradients grads(viewing);
+        Optimizer optimizer(viewing, OptimizerSettings(OptimizerType::ADAM), LearningRateSchedule::constant(0.01f));
+        ParallelTrainer trainer(viewing, 2, 1);
+        copy.trainBatch(image.data(), target.data(), 1, 0.1f, bws);
+        viewCopy.trainBatch(image.data(), target.data(), 1, 0.1f, bws);
+
+        std::cout << "   ";
+        viewing.trainBatch(image.data(), target.data(), 1, 0.1f, bws);
+        std::cout << "   ";
+        viewing.backPropagate(image, target, 0.1f);
+        viewing.computeGradients(image.data(), target.data(), 1, bws, grads);
+        std::cout << "   ";
+        optimizer.step(viewing, grads, 1);
+        std::cout << "   ";
+        trainer.trainBatch(image.data(), target.data(), 1, 0.1f);
+        std::cout << "   ";
+        bool loadRefused = !viewing.loadNetwork(modelFile);
+        copies = copies && loadRefused && viewing.isReadOnly() && !viewCopy.isReadOnly() && MaxWeightDiff(loaded, pristine) == 0.0f
+            && MaxWeightDiff(copy, pristine) > 0.0f && MaxWeightDiff(viewCopy, copy) == 0.0f;
+    }
+    ok = ok && copies;
+    std::cout << "   a copy of a mapped network owns and trains its weights; training or loading into the view is refused"
+        << (copies ? "  (OK)\n" : "  (FAILED)\n");
+
+    // 2. Saving over the file swaps in a new one (SaveModel renames), so a snapshot taken before keeps its
+    //    old weights until it is let go: the grace period of the RCU swap
+    ModelSlot slot(mapped);
+    std::shared_ptr<const ReadOnlyModel> snapshot = slot.current();
+    ok = SaveModel(b, modelFile) && ok;
+    ok = slot.reload(modelFile) && ok;
+    bool grace = MaxAbsDiff(Outputs(snapshot->network(), image), outA) == 0.0f
+        && MaxAbsDiff(Outputs(slot.current()->network(), image), outB) == 0.0f && slot.generation() == 2;
+    snapshot.reset();
+    mapped.reset();
+
+    // A file of another shape is refused and the slot keeps serving what it had
+    Network wide({ 100 }, 12, 784);
+    ok = SaveModel(wide, otherFile) && ok;
+    std::cout << "   ";
+    bool refused = !slot.reload(otherFile) && slot.generation() == 2 && slot.current()->network().numOutputs() == 10;
+    bool swapped = grace && refused;
+    ok = ok && swapped;
+    std::cout << "   file replaced under a live snapshot: old snapshot keeps model A, reload serves B, other shapes refused"
+        << (swapped ? "  (OK)\n" : "  (FAILED)\n");
+
+    // 3. Hot reload under load: clients keep requests in flight while the file flips between A and B and
+    //    the server reloads it; every answer must be all of A's or all of B's outputs, and none may fail
+    ServeSettings settings;
+    settings.threads = 2;
+    settings.maxBatch = 32;
+    settings.maxDelayMicros = 100;
+    InferenceServer server(slot, settings);
+    ServeAddress address;
+    ok = server.start(address) && ok;
+    address.port = server.boundPort();
+
+    std::vector<unsigned char> pixels(784);
+    for (int i = 0; i < 784; i++) pixels[i] = (unsigned char)(image[i] / PIXEL_SCALE + 0.5f);
+    for (int i = 0; i < 784; i++) image[i] = pixels[i] * PIXEL_SCALE;
+    const std::vector<float> pixelA = a.feedForward(image), pixelB = b.feedForward(image);
+
+    const int connections = 4, reloads = 20;
+    std::atomic<bool> done(false);
+    std::vector<long long> answers(connections, 0), fromA(connections, 0), fromB(connections, 0), wrong(connections, 0);
+    std::vector<std::thread> clients;
+    for (int c = 0; c < connections; c++) {
+        clients.emplace_back([&, c]() {
+            ServeClient client;
+            if (!client.connect(address)) {
+                wrong[c]++;
+                return;
+            }
+            ServeResponseHeader header;
+            std::vector<unsigned char> payload;
+            unsigned int sent = 0, received = 0;
+            while (!done || received < sent) {
+                while (!done && sent - received < 4) client.send(sent++, ServeRequestType::PIXELS, pixels.data(), 784);
+                if (received == sent) continue;
+                if (!client.receive(header, payload) || header.status != (unsigned int)ServeStatus::OK || header.bytes != 10 * sizeof(float)) {
+                    wrong[c]++;
+                    return;
+                }
+                received++;
+                const float* probs = (const float*)payload.data();
+                float diffA = 0.0f, diffB = 0.0f;
+                for (int k = 0; k < 10; k++) {
+                    diffA = std::max(diffA, std::fabs(probs[k] - pixelA[k]));
+                    diffB = std::max(diffB, std::fabs(probs[k] - pixelB[k]));
+                }
+                if (diffA < 1e-5f) fromA[c]++;
+                else if (diffB < 1e-5f) fromB[c]++;
+                else wrong[c]++;
+                answers[c]++;
+            }
+        });
+    }
+    LatencyHistogram reloadMicros;
+    for (int r = 0; r < reloads; r++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        ok = SaveModel(r % 2 ? b : a, modelFile) && ok;
+        start = std::chrono::steady_clock::now();
+        ok = slot.reload(modelFile) && ok;
+        reloadMicros.record(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    done = true;
+    for (std::thread& t : clients) t.join();
+    ServeStats stats = server.stats();
+    server.stop();
+
+    long long total = 0, totalA = 0, totalB = 0, totalWrong = 0;
+    for (int c = 0; c < connections; c++) {
+        total += answers[c];
+        totalA += fromA[c];
+        totalB += fromB[c];
+        totalWrong += wrong[c];
+    }
+    bool live = totalWrong == 0 && totalA > 0 && totalB > 0 && stats.generation == 2 + reloads && stats.errors == 0;
+    ok = ok && live;
+    std::cout << std::fixed << std::setprecision(0) << "   " << reloads << " reloads during " << total << " requests on " << connections
+        << " connections: " << totalA << " answered by A, " << totalB << " by B, " << totalWrong << " failed or mixed\n"
+        << "   reload (map + check + swap) mean " << reloadMicros.mean() << " us; request latency p50 "
+        << stats.latencyMicros.percentile(0.5) << " us, p99 " << stats.latencyMicros.percentile(0.99) << " us, max "
+        << stats.latencyMicros.max() << " us" << std::defaultfloat << (live ? "  (OK)\n" : "  (FAILED)\n");
+
+    std::remove(modelFile);
+    std::remove(otherFile);
+    return ok;
+}
+
+int main() {
+    srand(1234);
+
+    std::cout << "=======================================\n";
+    std::cout << "        NEURALNET MICRO-BENCHMARKS      \n";
+    std::cout << "=======================================\n";
+
+    bool ok = CheckSimd();
+    ok = CheckAllocations() && ok;
+    ok = CheckParallel() && ok;
+    ok = CheckMnistLoader() && ok;
+    ok = CheckBatchStream() && ok;
+    ok = CheckModelFile() && ok;
+    ok = CheckQuantized() && ok;
+    ok = CheckPlan() && ok;
+    ok = CheckFixedNetwork() && ok;
+    ok = CheckIncremental() && ok;
+    ok = CheckSparse() && ok;
+    ok = CheckOptimizers() && ok;
+    ok = CheckTrainingStats() && ok;
+    ok = CheckMixedPrecision() && ok;
+    ok = CheckProfiler() && ok;
+    ok = CheckConv() && ok;
+    ok = CheckAugment() && ok;
+    ok = CheckServe() && ok;
+    ok = CheckMappedModel() && ok;
+    BenchLayout();
+    BenchBatch();
+    BenchGemm();
+    BenchThreads();
+    BenchHogwild();
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,211 @@
+// NeuralNetLoad.cpp : Load generator for NeuralNetServe. Opens several connections, keeps a number of
+// requests in flight on each, and reports throughput, the latency clients saw, and the server's own
+// statistics (queue wait, batch sizes, latency).
+//
+//   NeuralNetLoad (--socket /tmp/nn.sock | --port 7070) [--connections 8] [--pipeline 1]
+//                 [--requests 20000 | --duration SECONDS] [--images t10k-images.idx3-ubyte] [--float]
+
+#include "NeuNetCode.h"
+#include "MappedFile.h"
+#include "MnistDataset.h"
+#include "Serve.h"
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <chrono>
+#include <thread>
+#include <random>
+#include <unordered_map>
+#include <iostream>
+#include <iomanip>
+
+// --- OPTIONS ---
+struct Options {
+    ServeAddress address;
+    std::string images;      // IDX image file to send; random pixels otherwise
+    int inputSize = 784;
+    int connections = 8;
+    int pipeline = 1;        // requests in flight per connection
+    int requests = 20000;    // in total, unless duration is set
+    int duration = 0;        // seconds
+    bool floats = false;     // send FLOATS requests instead of pixels
+};
+
+static void PrintUsage() {
+    std::cout << "usage: NeuralNetLoad (--socket PATH | --port N) [options]\n"
+        << "  --socket PATH       server's Unix domain socket\n"
+        << "  --port N            server's port on 127.0.0.1\n"
+        << "  --connections N     concurrent connections, one thread each (default 8)\n"
+        << "  --pipeline N        requests in flight per connection (default 1)\n"
+        << "  --requests N        requests in total (default 20000)\n"
+        << "  --duration SECONDS  run this long instead of a request count\n"
+        << "  --images FILE       IDX image file to send (default: random images of --input-size pixels)\n"
+        << "  --input-size N      pixels per random image (default 784)\n"
+        << "  --float             send float inputs instead of 8-bit pixels\n";
+}
+
+static bool ParseInt(const char* text, int& value) {
+    char* end = nullptr;
+    long v = strtol(text, &end, 10);
+    if (end == text || *end != '\0' || v <= 0 || v > 1 << 30) return false;
+    value = (int)v;
+    return true;
+}
+
+static bool ParseOptions(int argc, char** argv, Options& opt) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        bool ok = true;
+
+        if (arg == "--float") opt.floats = true;
+        else if (!hasValue) ok = false;
+        else if (arg == "--socket") opt.address.socketPath = argv[++i];
+        else if (arg == "--port") ok = ParseInt(argv[++i], opt.address.port) && opt.address.port < 65536;
+        else if (arg == "--connections") ok = ParseInt(argv[++i], opt.connections);
+        else if (arg == "--pipeline") ok = ParseInt(argv[++i], opt.pipeline);
+        else if (arg == "--requests") ok = ParseInt(argv[++i], opt.requests);
+        else if (arg == "--duration") ok = ParseInt(argv[++i], opt.duration);
+        else if (arg == "--images") opt.images = argv[++i];
+        else if (arg == "--input-size") ok = ParseInt(argv[++i], opt.inputSize);
+        else ok = false;
+
+        if (!ok) {
+            std::cout << "error: bad argument " << arg << "\n";
+            return false;
+        }
+    }
+    return opt.address.socketPath.empty() != (opt.address.port == 0);
+}
+
+// --- LOAD ---
+struct Worker {
+    LatencyHistogram latency;
+    long long answered = 0;
+    long long failed = 0;   // error statuses and unknown ids
+    bool lost = false;      // the connection broke
+};
+
+// One connection: pipeline requests in flight, a new one sent as each response arrives
+static void RunConnection(const Options& opt, const std::vector<unsigned char>& pixels, int numImages, int quota,
+    std::chrono::steady_clock::time_point end, int seed, Worker& worker) {
+    typedef std::chrono::steady_clock Clock;
+    ServeClient client;
+    if (!client.connect(opt.address)) {
+        worker.lost = true;
+        return;
+    }
+
+    std::mt19937 rng(seed);
+    const int size = opt.inputSize;
+    std::vector<float> floats(size);
+    std::unordered_map<unsigned int, Clock::time_point> sentAt; // requests in flight
+    std::vector<unsigned char> payload;
+    ServeResponseHeader header;
+    unsigned int nextId = 0;
+    int sent = 0;
+    const bool timed = opt.duration > 0;
+
+    auto sendOne = [&]() {
+        const unsigned char* image = &pixels[(size_t)(rng() % numImages) * size];
+        unsigned int id = nextId++;
+        sentAt[id] = Clock::now();
+        sent++;
+        if (!opt.floats) return client.send(id, ServeRequestType::PIXELS, image, size);
+        for (int i = 0; i < size; i++) floats[i] = image[i] * PIXEL_SCALE;
+        return client.send(id, ServeRequestType::FLOATS, floats.data(), size * sizeof(float));
+    };
+
+    int inFlight = 0;
+    while (inFlight < opt.pipeline && (timed || sent < quota)) {
+        if (!sendOne()) {
+            worker.lost = true;
+            return;
+        }
+        inFlight++;
+    }
+    while (inFlight > 0) {
+        if (!client.receive(header, payload)) {
+            worker.lost = true;
+            return;
+        }
+        Clock::time_point now = Clock::now();
+        inFlight--;
+        auto request = sentAt.find(header.id);
+        if (request != sentAt.end() && header.status == (unsigned int)ServeStatus::OK) {
+            worker.latency.record(std::chrono::duration<double, std::micro>(now - request->second).count());
+            worker.answered++;
+        }
+        else worker.failed++;
+        if (request != sentAt.end()) sentAt.erase(request);
+
+        if (timed ? now < end : sent < quota) {
+            if (!sendOne()) {
+                worker.lost = true;
+                return;
+            }
+            inFlight++;
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+    if (!ParseOptions(argc, argv, opt)) {
+        PrintUsage();
+        return 2;
+    }
+
+    // 1. Images to send
+    std::vector<unsigned char> pixels;
+    int numImages = 256;
+    if (!opt.images.empty()) {
+        MappedFile file;
+        int rows, cols;
+        if (!file.open(opt.images) || !ReadIdxImageHeader(file.data(), file.size(), opt.images, numImages, rows, cols)) return 1;
+        opt.inputSize = rows * cols;
+        pixels.assign(file.data() + 16, file.data() + 16 + (size_t)numImages * opt.inputSize);
+    }
+    else {
+        std::mt19937 rng(1);
+        pixels.resize((size_t)numImages * opt.inputSize);
+        for (unsigned char& p : pixels) p = (unsigned char)(rng() & 0xFF);
+    }
+
+    // 2. Load from every connection at once
+    std::vector<Worker> workers(opt.connections);
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    auto end = start + std::chrono::seconds(opt.duration);
+    for (int c = 0; c < opt.connections; c++) {
+        int quota = opt.requests / opt.connections + (c < opt.requests % opt.connections ? 1 : 0);
+        threads.emplace_back(RunConnection, std::cref(opt), std::cref(pixels), numImages, quota, end, c + 1, std::ref(workers[c]));
+    }
+    for (std::thread& t : threads) t.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // 3. Report
+    LatencyHistogram latency;
+    long long answered = 0, failed = 0;
+    int lost = 0;
+    for (const Worker& w : workers) {
+        latency.add(w.latency);
+        answered += w.answered;
+        failed += w.failed;
+        lost += w.lost;
+    }
+    std::cout << "server    " << (opt.address.socketPath.empty() ? "127.0.0.1:" + std::to_string(opt.address.port) : opt.address.socketPath) << "\n"
+        << "load      " << opt.connections << " connections x " << opt.pipeline << " in flight, "
+        << (opt.floats ? "float" : "pixel") << " requests of " << opt.inputSize << " inputs\n"
+        << std::fixed << std::setprecision(3)
+        << "time      " << seconds << " s, " << std::setprecision(0) << answered / seconds << " requests/s\n"
+        << "answered  " << answered << ", failed " << failed << ", connections lost " << lost << "\n"
+        << "latency   ";
+    latency.print(std::cout);
+    std::cout << "\n";
+
+    ServeClient client;
+    std::string json;
+    if (client.connect(opt.address) && client.stats(json)) std::cout << "server    " << json << "\n";
+    return failed == 0 && lost == 0 ? 0 : 1;
+}
@@ -0,0 +1,536 @@
+// NeuralNetMicro.cpp : Micro-benchmark suite. Times every kernel on the training and drawing paths over
+// a sweep of layer widths and batch sizes, and reports time per call, GFLOP/s, GB/s and items/s.
+// The JSON output uses Google Benchmark's layout, so runs from two commits can be diffed with its tools.
+//
+//   NeuralNetMicro [--filter TEXT] [--json results.json] [--min-time 0.2] [--repetitions 3]
+//                  [--data DIR] [--label TEXT] [--list]
+//
+// Everything runs on generated data. The loader benchmarks use DIR/train-images.idx3-ubyte and
+// DIR/train-labels.idx1-ubyte when both are there and valid, and generated IDX files otherwise.
+
+// localtime() is fine here, the suite runs on one thread
+#define _CRT_SECURE_NO_WARNINGS
+#include "NeuNetCode.h"
+#include "ModelFile.h"
+#include "MnistDataset.h"
+#include "MnistLoader.h"
+#include "Preprocess.h"
+#include "Simd.h"
+#include "ThreadPool.h"
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+
+// --- OPTIONS ---
+struct Options {
+    std::string filter;
+    std::string json;
+    std::string data = "Data";
+    std::string label;
+    double minTime = 0.2;   // seconds per repetition
+    int repetitions = 3;
+    bool list = false;
+};
+
+static void PrintUsage() {
+    std::cout << "usage: NeuralNetMicro [options]\n"
+        << "  --filter TEXT      run only the benchmarks whose name contains TEXT (e.g. layer_feedforward/784)\n"
+        << "  --json FILE        also write the results as JSON (Google Benchmark layout)\n"
+        << "  --min-time SEC     minimum time of each repetition (default 0.2)\n"
+        << "  --repetitions N    repetitions per benchmark; the median is reported (default 3)\n"
+        << "  --data DIR         directory with train-images.idx3-ubyte / train-labels.idx1-ubyte (default Data)\n"
+        << "  --label TEXT       stored in the JSON context, e.g. a commit id\n"
+        << "  --list             print the benchmark names and exit\n";
+}
+
+static bool ParseOptions(int argc, char** argv, Options& opt) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool ok = true;
+
+        if (arg == "--list") opt.list = true;
+        else if (i + 1 >= argc) ok = false;
+        else if (arg == "--filter") opt.filter = argv[++i];
+        else if (arg == "--json") opt.json = argv[++i];
+        else if (arg == "--data") opt.data = argv[++i];
+        else if (arg == "--label") opt.label = argv[++i];
+        else if (arg == "--min-time") {
+            opt.minTime = strtod(argv[++i], nullptr);
+            ok = opt.minTime > 0.0 && opt.minTime < 1000.0;
+        }
+        else if (arg == "--repetitions") {
+            opt.repetitions = atoi(argv[++i]);
+            ok = opt.repetitions > 0 && opt.repetitions <= 1000;
+        }
+        else ok = false;
+
+        if (!ok) {
+            std::cout << "error: bad argument " << arg << "\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+// --- HARNESS ---
+// Work done by ONE call of the benchmarked operation; the rates are these over the time per call.
+// Zero leaves the column out.
+struct Work {
+    Work(double flops = 0.0, double bytes = 0.0, double items = 1.0) : flops(flops), bytes(bytes), items(items) {}
+    double flops;
+    double bytes; // memory the call has to read and write at least once
+    double items; // samples, images, parameters... whatever the benchmark counts
+};
+
+struct Result {
+    std::string name;
+    long long iterations;
+    double seconds;   // median time per call over the repetitions
+    double fastest;   // best repetition
+    Work work;
+};
+
+// body(n) runs the operation n times. A benchmark calls measure() once per case of its sweep.
+class Runner {
+
+public:
+    Runner(const Options& opt) : opt(opt) {}
+
+    // Whether measure(name, ...) would time anything: lets benchmarks skip expensive setup
+    bool runs(const std::string& name) const {
+        return !opt.list && name.find(opt.filter) != std::string::npos;
+    }
+
+    void measure(const std::string& name, const Work& work, const std::function<void(long long)>& body) {
+        if (name.find(opt.filter) == std::string::npos) return;
+        if (opt.list) {
+            std::cout << name << "\n";
+            return;
+        }
+
+        // Grow the call count until one run lasts minTime, then time the repetitions at that count
+        body(1); // warm-up: caches, lazy allocations, page faults
+        long long n = 1;
+        double seconds = Time(body, n);
+        while (seconds < opt.minTime && n < 1000000000LL) {
+            double scale = (seconds > 0.0) ? 1.4 * opt.minTime / seconds : 10.0;
+            n = (long long)(n * std::min(std::max(scale, 2.0), 100.0));
+            seconds = Time(body, n);
+        }
+
+        std::vector<double> perCall;
+        for (int r = 0; r < opt.repetitions; r++) perCall.push_back(Time(body, n) / n);
+        std::sort(perCall.begin(), perCall.end());
+
+        Result result;
+        result.name = name;
+        result.iterations = n;
+        result.seconds = perCall[perCall.size() / 2];
+        result.fastest = perCall.front();
+        result.work = work;
+        results.push_back(result);
+        Print(result);
+    }
+
+    const std::vector<Result>& all() const { return results; }
+
+    static void PrintHeader() {
+        std::cout << std::left << std::setw(44) << "benchmark" << std::right << std::setw(14) << "time/call"
+            << std::setw(13) << "iterations" << std::setw(10) << "GFLOP/s" << std::setw(10) << "GB/s"
+            << std::setw(14) << "Mitems/s" << "\n" << std::string(105, '-') << "\n";
+    }
+
+private:
+    static double Time(const std::function<void(long long)>& body, long long n) {
+        auto start = std::chrono::steady_clock::now();
+        body(n);
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    static void Print(const Result& r) {
+        double t = r.seconds;
+        const char* unit = "ns";
+        double shown = t * 1e9;
+        if (t >= 1e-3) { shown = t * 1e3; unit = "ms"; }
+        else if (t >= 1e-6) { shown = t * 1e6; unit = "us"; }
+
+        std::cout << std::left << std::setw(44) << r.name << std::right << std::fixed << std::setprecision(2)
+            << std::setw(11) << shown << " " << unit << std::setw(13) << r.iterations;
+        if (r.work.flops > 0.0) std::cout << std::setw(10) << r.work.flops / t * 1e-9;
+        else std::cout << std::setw(10) << "-";
+        if (r.work.bytes > 0.0) std::cout << std::setw(10) << r.work.bytes / t * 1e-9;
+        else std::cout << std::setw(10) << "-";
+        std::cout << std::setprecision(3) << std::setw(14) << r.work.items / t * 1e-6 << "\n" << std::defaultfloat;
+    }
+
+    const Options& opt;
+    std::vector<Result> results;
+};
+
+static bool WriteJson(const std::string& filename, const Options& opt, const std::vector<Result>& results) {
+    std::ofstream out(filename);
+    if (!out.is_open()) {
+        std::cout << "error: cannot write " << filename << std::endl;
+        return false;
+    }
+
+    char date[32];
+    time_t now = time(nullptr);
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+    out << "{\n  \"context\": {\n"
+        << "    \"date\": \"" << date << "\",\n"
+        << "    \"executable\": \"NeuralNetMicro\",\n"
+        << "    \"num_cpus\": " << ThreadPool::defaultThreadCount() << ",\n"
+        << "    \"simd\": \"" << Simd().name << "\",\n"
+        << "    \"label\": \"" << opt.label << "\",\n"
+        << "    \"min_time\": " << opt.minTime << ",\n"
+        << "    \"repetitions\": " << opt.repetitions << "\n"
+        << "  },\n  \"benchmarks\": [\n";
+
+    out << std::setprecision(9);
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result& r = results[i];
+        out << "    {\n"
+            << "      \"name\": \"" << r.name << "\",\n"
+            << "      \"run_name\": \"" << r.name << "\",\n"
+            << "      \"run_type\": \"iteration\",\n"
+            << "      \"iterations\": " << r.iterations << ",\n"
+            << "      \"real_time\": " << r.seconds * 1e9 << ",\n"
+            << "      \"cpu_time\": " << r.seconds * 1e9 << ",\n"
+            << "      \"fastest_time\": " << r.fastest * 1e9 << ",\n"
+            << "      \"time_unit\": \"ns\",\n";
+        if (r.work.flops > 0.0) out << "      \"gflops\": " << r.work.flops / r.seconds * 1e-9 << ",\n";
+        if (r.work.bytes > 0.0) out << "      \"bytes_per_second\": " << r.work.bytes / r.seconds << ",\n";
+        out << "      \"items_per_second\": " << r.work.items / r.seconds << "\n"
+            << "    }" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+    return true;
+}
+
+// --- DATA ---
+static volatile float g_sink = 0.0f; // keeps results alive so the optimizer cannot drop the work
+
+static std::vector<float> RandomFloats(size_t count, float low, float high) {
+    std::vector<float> values(count);
+    for (float& v : values) v = low + (high - low) * ((float)rand() / RAND_MAX);
+    return values;
+}
+
+static std::string Name(const std::string& family, const std::vector<int>& args) {
+    std::string name = family;
+    for (int a : args) name += "/" + std::to_string(a);
+    return name;
+}
+
+// FLOPs of a single-sample pass through every layer's weights (one multiply + one add each)
+static double ForwardFlops(const Network& net) {
+    double flops = 0.0;
+    for (const Layer& layer : net.layers) flops += 2.0 * layer.weights.size();
+    return flops;
+}
+
+static double ParameterBytes(const Network& net) {
+    double bytes = 0.0;
+    for (const Layer& layer : net.layers) bytes += 4.0 * (layer.weights.size() + layer.biases.size());
+    return bytes;
+}
+
+static void WriteBigEndian(std::ofstream& out, int value) {
+    unsigned char bytes[4] = { (unsigned char)(value >> 24), (unsigned char)(value >> 16), (unsigned char)(value >> 8), (unsigned char)value };
+    out.write((const char*)bytes, 4);
+}
+
+// MNIST-like IDX pair: about a fifth of the pixels lit
+static void WriteIdxFiles(const std::string& imageFile, const std::string& labelFile, int count) {
+    std::ofstream images(imageFile, std::ios::binary);
+    WriteBigEndian(images, 0x00000803);
+    WriteBigEndian(images, count);
+    WriteBigEndian(images, 28);
+    WriteBigEndian(images, 28);
+    std::vector<unsigned char> pixels(784);
+    for (int n = 0; n < count; n++) {
+        for (unsigned char& px : pixels) px = (rand() % 5 == 0) ? (unsigned char)(rand() % 256) : 0;
+        images.write((const char*)pixels.data(), pixels.size());
+    }
+
+    std::ofstream labels(labelFile, std::ios::binary);
+    WriteBigEndian(labels, 0x00000801);
+    WriteBigEndian(labels, count);
+    for (int n = 0; n < count; n++) labels.put((char)(rand() % 10));
+}
+
+static double FileBytes(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    return file.is_open() ? (double)file.tellg() : 0.0;
+}
+
+// --- BENCHMARKS: INFERENCE ---
+static void BenchNode(Runner& runner) {
+    const int widths[] = { 16, 64, 256, 784, 4096 };
+    for (int inputs : widths) {
+        Layer layer(1, inputs, ActivationType::RELU);
+        Node node = layer.neuron(0);
+        std::vector<float> x = RandomFloats(inputs, 0.0f, 1.0f);
+
+        runner.measure(Name("node_feedforward", { inputs }), Work(2.0 * inputs, 8.0 * inputs), [&](long long n) {
+            for (long long i = 0; i < n; i++) g_sink = node.feedForward(x.data());
+        });
+    }
+}
+
+static void BenchLayer(Runner& runner) {
+    const int shapes[][2] = { { 100, 10 }, { 784, 16 }, { 784, 100 }, { 784, 256 }, { 256, 256 }, { 1024, 1024 } };
+    for (const auto& shape : shapes) {
+        int inputs = shape[0], neurons = shape[1];
+        Layer layer(neurons, inputs, ActivationType::RELU);
+        std::vector<float> x = RandomFloats(inputs, 0.0f, 1.0f), y(neurons);
+
+        Work work(2.0 * inputs * neurons, 4.0 * ((double)inputs * neurons + neurons + inputs + neurons));
+        runner.measure(Name("layer_feedforward", { inputs, neurons }), work, [&](long long n) {
+            for (long long i = 0; i < n; i++) layer.feedForward(x.data(), y.data());
+            g_sink = y[0];
+        });
+    }
+}
+
+static void BenchLayerBatch(Runner& runner) {
+    const int shapes[][2] = { { 784, 100 }, { 1024, 1024 } };
+    const int batches[] = { 1, 8, 32, 128, 512 };
+    for (const auto& shape : shapes) {
+        int inputs = shape[0], neurons = shape[1];
+        Layer layer(neurons, inputs, ActivationType::RELU);
+        for (int batch : batches) {
+            std::vector<float> x = RandomFloats((size_t)batch * inputs, 0.0f, 1.0f), y((size_t)batch * neurons);
+
+            // The weights are read once per batch, the inputs and outputs once per sample
+            Work work(2.0 * inputs * neurons * batch, 4.0 * ((double)inputs * neurons + (double)batch * (inputs + neurons)), batch);
+            runner.measure(Name("layer_feedforward_batch", { inputs, neurons, batch }), work, [&](long long n) {
+                for (long long i = 0; i < n; i++) layer.feedForwardBatch(x.data(), batch, y.data());
+                g_sink = y[0];
+            });
+        }
+    }
+}
+
+// --- BENCHMARKS: TRAINING ---
+static void BenchBackPropagate(Runner& runner) {
+    const int hiddens[] = { 32, 100, 256, 512, 1024 };
+    for (int hidden : hiddens) {
+        Network net({ hidden }, 10, 784);
+        Workspace ws(net);
+        std::vector<float> x = RandomFloats(784, 0.0f, 1.0f), target(10, 0.0f);
+        target[3] = 1.0f;
+
+        // Forward (2 per weight), error back through the layers above the first (2 per weight),
+        // update (2 per weight). Every weight is read and written back once more by the update.
+        double backward = ForwardFlops(net) - 2.0 * net.layers[0].weights.size();
+        Work work(2.0 * ForwardFlops(net) + backward, 3.0 * ParameterBytes(net));
+        runner.measure(Name("network_backpropagate", { hidden }), work, [&](long long n) {
+            for (long long i = 0; i < n; i++) net.backPropagate(x.data(), target.data(), 0.0001f, ws);
+            g_sink = ws.activations.back()[0];
+        });
+    }
+}
+
+static void BenchTrainBatch(Runner& runner) {
+    const int hiddens[] = { 100, 512 };
+    const int batches[] = { 16, 64, 256 };
+    for (int hidden : hiddens) {
+        for (int batch : batches) {
+            Network net({ hidden }, 10, 784);
+            BatchWorkspace ws(net, batch);
+            std::vector<float> x = RandomFloats((size_t)batch * 784, 0.0f, 1.0f), targets((size_t)batch * 10, 0.0f);
+            for (int s = 0; s < batch; s++) targets[(size_t)s * 10 + s % 10] = 1.0f;
+
+            double perSample = 2.0 * ForwardFlops(net) + ForwardFlops(net) - 2.0 * net.layers[0].weights.size();
+            Work work(perSample * batch, 3.0 * ParameterBytes(net) + 4.0 * batch * (784 + 10), batch);
+            runner.measure(Name("network_trainbatch", { hidden, batch }), work, [&](long long n) {
+                for (long long i = 0; i < n; i++) net.trainBatch(x.data(), targets.data(), batch, 0.0001f, ws);
+                g_sink = ws.activations.back()[0];
+            });
+        }
+    }
+}
+
+// --- BENCHMARKS: FILES ---
+static void BenchLoader(Runner& runner, const Options& opt) {
+    // The real training set if it is there and valid, generated sets otherwise
+    std::string realImages = opt.data + "/train-images.idx3-ubyte";
+    std::string realLabels = opt.data + "/train-labels.idx1-ubyte";
+    MnistDataset probe;
+    bool real = FileBytes(realImages) > 16 && FileBytes(realLabels) > 8 && probe.load(realImages, realLabels);
+
+    std::vector<int> counts;
+    if (real) counts.push_back(probe.size());
+    else {
+        counts.push_back(10000);
+        counts.push_back(60000);
+    }
+
+    for (int count : counts) {
+        std::string images = real ? realImages : "micro-images.idx3-ubyte";
+        std::string labels = real ? realLabels : "micro-labels.idx1-ubyte";
+        std::string legacyName = Name(real ? "load_mnist_data" : "load_mnist_data_synthetic", { count });
+        std::string mappedName = Name(real ? "mnist_dataset_load" : "mnist_dataset_load_synthetic", { count });
+        bool generate = !real && (runner.runs(legacyName) || runner.runs(mappedName));
+        if (generate) WriteIdxFiles(images, labels, count);
+
+        Work work(0.0, FileBytes(images) + FileBytes(labels), count);
+        runner.measure(legacyName, work, [&](long long n) {
+            for (long long i = 0; i < n; i++) g_sink = (float)LoadMnistData(images, labels).size();
+        });
+        runner.measure(mappedName, work, [&](long long n) {
+            // Mapping alone touches nothing; sum a byte per page so the comparison includes reading the data
+            for (long long i = 0; i < n; i++) {
+                MnistDataset dataset;
+                dataset.load(images, labels);
+                unsigned int sum = 0;
+                const unsigned char* pixels = dataset.image(0);
+                for (size_t b = 0; b < (size_t)dataset.size() * dataset.imageSize(); b += 4096) sum += pixels[b];
+                g_sink = (float)sum;
+            }
+        });
+
+        if (generate) {
+            std::remove(images.c_str());
+            std::remove(labels.c_str());
+        }
+    }
+}
+
+// saveNetwork / loadNetwork report every call on std::cout; this silences them while they are timed
+class MuteOutput {
+
+public:
+    MuteOutput() : saved(std::cout.rdbuf(nullptr)) {}
+    ~MuteOutput() { std::cout.rdbuf(saved); }
+
+private:
+    std::streambuf* saved;
+};
+
+static void BenchModelFiles(Runner& runner) {
+    const int hiddens[] = { 100, 512 };
+    for (int hidden : hiddens) {
+        Network net({ hidden }, 10, 784);
+        Network loaded({ hidden }, 10, 784);
+        double params = ParameterBytes(net) / 4.0;
+        const std::string text = "micro-brain.txt", binary = "micro-brain.nnm";
+        const char* families[] = { "save_network", "load_network", "save_model", "load_model" };
+        bool any = false;
+        for (const char* family : families) any = any || runner.runs(Name(family, { hidden }));
+        if (!any) {
+            for (const char* family : families) runner.measure(Name(family, { hidden }), Work(), [](long long) {}); // --list
+            continue;
+        }
+
+        // Text (saveNetwork / loadNetwork, the GUI's brain.txt) and binary (ModelFile.h) formats
+        {
+            MuteOutput mute;
+            net.saveNetwork(text);
+        }
+        SaveModel(net, binary);
+        runner.measure(Name("save_network", { hidden }), Work(0.0, FileBytes(text), params), [&](long long n) {
+            MuteOutput mute;
+            for (long long i = 0; i < n; i++) net.saveNetwork(text);
+        });
+        runner.measure(Name("load_network", { hidden }), Work(0.0, FileBytes(text), params), [&](long long n) {
+            MuteOutput mute;
+            for (long long i = 0; i < n; i++) g_sink = loaded.loadNetwork(text) ? 1.0f : 0.0f;
+        });
+        runner.measure(Name("save_model", { hidden }), Work(0.0, FileBytes(binary), params), [&](long long n) {
+            for (long long i = 0; i < n; i++) g_sink = SaveModel(net, binary) ? 1.0f : 0.0f;
+        });
+        runner.measure(Name("load_model", { hidden }), Work(0.0, FileBytes(binary), params), [&](long long n) {
+            for (long long i = 0; i < n; i++) g_sink = LoadModel(binary, loaded) ? 1.0f : 0.0f;
+        });
+
+        std::remove(text.c_str());
+        std::remove(binary.c_str());
+    }
+}
+
+// --- BENCHMARKS: CANVAS ---
+static void BenchCenterGrid(Runner& runner) {
+    // Empty canvas, a stroke as drawn in the GUI (3x3 brush along a diagonal), and a full canvas
+    const int litCounts[] = { 0, 60, 784 };
+    for (int lit : litCounts) {
+        std::vector<float> grid(784, 0.0f), centered(784);
+        if (lit == 784) std::fill(grid.begin(), grid.end(), 0.5f);
+        for (int p = 0; lit < 784 && p < lit; p++) {
+            int x = 5 + p / 3, y = 4 + p / 4 + p % 3;
+            grid[y * 28 + x] = 1.0f;
+        }
+
+        runner.measure(Name("center_grid", { lit }), Work(0.0, 2.0 * 784 * 4), [&](long long n) {
+            for (long long i = 0; i < n; i++) CenterGrid(grid.data(), centered.data());
+            g_sink = centered[14 * 28 + 14];
+        });
+    }
+}
+
+static void BenchAugment(Runner& runner) {
+    // One off-center stroke, through each stage of the augmentation pipeline (Preprocess.h)
+    std::vector<unsigned char> pixels(784, 0);
+    for (int p = 0; p < 60; p++) pixels[(4 + p / 4 + p % 3) * 28 + 5 + p / 3] = 255;
+    std::vector<float> output(784);
+
+    AugmentSettings normalize, center, affine, elastic;
+    center.center = affine.center = elastic.center = true;
+    affine.maxShift = elastic.maxShift = 2.0f;
+    affine.maxRotation = elastic.maxRotation = 15.0f;
+    affine.maxScale = elastic.maxScale = 0.15f;
+    elastic.elasticAlpha = 8.0f;
+    const std::pair<const char*, AugmentSettings> stages[] = {
+        { "augment_normalize", normalize }, { "augment_center", center }, { "augment_affine", affine }, { "augment_elastic", elastic } };
+
+    for (const auto& stage : stages) {
+        Augmenter augmenter(stage.second, 28, 28);
+        std::mt19937 rng(1);
+        runner.measure(stage.first, Work(0.0, 784.0 * 5), [&](long long n) {
+            for (long long i = 0; i < n; i++) augmenter.apply(pixels.data(), output.data(), rng);
+            g_sink = output[14 * 28 + 14];
+        });
+    }
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+    if (!ParseOptions(argc, argv, opt)) {
+        PrintUsage();
+        return 2;
+    }
+    srand(1234);
+
+    Runner runner(opt);
+    if (!opt.list) {
+        std::cout << "NeuralNetMicro (" << Simd().name << ", " << ThreadPool::defaultThreadCount() << " hardware threads)\n";
+        Runner::PrintHeader();
+    }
+
+    BenchNode(runner);
+    BenchLayer(runner);
+    BenchLayerBatch(runner);
+    BenchBackPropagate(runner);
+    BenchTrainBatch(runner);
+    BenchLoader(runner, opt);
+    BenchModelFiles(runner);
+    BenchCenterGrid(runner);
+    BenchAugment(runner);
+
+    if (!opt.json.empty() && !opt.list) {
+        if (!WriteJson(opt.json, opt, runner.all())) return 1;
+        std::cout << "wrote " << opt.json << "\n";
+    }
+    return 0;
+}
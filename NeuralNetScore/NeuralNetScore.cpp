@@ -0,0 +1,321 @@
+// NeuralNetScore.cpp : Headless batch inference. Loads a model, scores a whole file of 8-bit images
+// in large batches on every core, and reports throughput and per-batch latency.
+//
+//   NeuralNetScore --model brain.nnm --images t10k-images.idx3-ubyte [--labels t10k-labels.idx1-ubyte]
+//                  [--raw inputs.bin --input-size 784] [--batch 256] [--threads N]
+//                  [--output predictions.csv [--probs]] [--int8 [--calibrate 1000] | --bf16 | --fp16] [--hidden 100]
+//   NeuralNetScore --convert brain.txt brain.nnm [--hidden 100] [--input-size 784]
+
+#include "NeuNetCode.h"
+#include "ModelFile.h"
+#include "MappedFile.h"
+#include "MnistDataset.h"
+#include "Quantize.h"
+#include "MixedPrecision.h"
+#include "ThreadPool.h"
+#include "Simd.h"
+#include <memory>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <atomic>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+
+// --- OPTIONS ---
+struct Options {
+    std::string model;
+    std::string images;      // IDX image file
+    std::string raw;         // or: headerless file of inputSize-byte records
+    std::string labels;      // optional IDX label file, for accuracy
+    std::string output;      // optional CSV
+    std::vector<int> hidden; // shape of a text model (binary models carry their own)
+    std::string convertFrom; // --convert: text model to rewrite as .nnm, instead of scoring
+    std::string convertTo;
+    int inputSize = 784;
+    int batchSize = 256;
+    int threads = 0;
+    int calibrate = 1000;
+    bool probs = false;
+    bool int8 = false;
+    bool bf16 = false;
+    bool fp16 = false;
+};
+
+static void PrintUsage() {
+    std::cout << "usage: NeuralNetScore --model FILE (--images IDX | --raw FILE [--input-size N]) [options]\n"
+        << "       NeuralNetScore --convert TEXT NNM [--hidden A,B,...] [--input-size N]\n"
+        << "  --model FILE       .nnm model, or a text brain (then --hidden gives its hidden layers, default 100)\n"
+        << "  --images FILE      IDX image file (unsigned bytes)\n"
+        << "  --raw FILE         headerless file of --input-size byte records\n"
+        << "  --labels FILE      IDX label file; adds accuracy to the report\n"
+        << "  --batch N          images per batch (default 256)\n"
+        << "  --threads N        worker threads (default: all cores)\n"
+        << "  --output FILE      write index,prediction[,probabilities] as CSV\n"
+        << "  --probs            include every output probability in the CSV\n"
+        << "  --int8             score with the int8 quantized model\n"
+        << "  --calibrate N      images used to calibrate --int8 (default 1000)\n"
+        << "  --bf16, --fp16     score with 16-bit weights and activations (fp32 sums)\n"
+        << "  --hidden A,B,...   hidden layer sizes of a text model\n"
+        << "  --convert IN OUT   write text model IN (10 outputs) as binary model OUT and exit\n";
+}
+
+static bool ParseInt(const char* text, int& value) {
+    char* end = nullptr;
+    long v = strtol(text, &end, 10);
+    if (end == text || *end != '\0' || v <= 0 || v > 1 << 30) return false;
+    value = (int)v;
+    return true;
+}
+
+static bool ParseOptions(int argc, char** argv, Options& opt) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        bool ok = true;
+
+        if (arg == "--probs") opt.probs = true;
+        else if (arg == "--int8") opt.int8 = true;
+        else if (arg == "--bf16") opt.bf16 = true;
+        else if (arg == "--fp16") opt.fp16 = true;
+        else if (!hasValue) ok = false;
+        else if (arg == "--model") opt.model = argv[++i];
+        else if (arg == "--convert") {
+            ok = i + 2 < argc;
+            if (ok) opt.convertFrom = argv[++i];
+            if (ok) opt.convertTo = argv[++i];
+        }
+        else if (arg == "--images") opt.images = argv[++i];
+        else if (arg == "--raw") opt.raw = argv[++i];
+        else if (arg == "--labels") opt.labels = argv[++i];
+        else if (arg == "--output") opt.output = argv[++i];
+        else if (arg == "--input-size") ok = ParseInt(argv[++i], opt.inputSize);
+        else if (arg == "--batch") ok = ParseInt(argv[++i], opt.batchSize);
+        else if (arg == "--threads") ok = ParseInt(argv[++i], opt.threads);
+        else if (arg == "--calibrate") ok = ParseInt(argv[++i], opt.calibrate);
+        else if (arg == "--hidden") {
+            std::stringstream list(argv[++i]);
+            std::string item;
+            while (ok && std::getline(list, item, ',')) {
+                int size;
+                ok = ParseInt(item.c_str(), size);
+                opt.hidden.push_back(size);
+            }
+        }
+        else ok = false;
+
+        if (!ok) {
+            std::cout << "error: bad argument " << arg << "\n";
+            return false;
+        }
+    }
+
+    if (opt.hidden.empty()) opt.hidden.push_back(100);
+    if (!opt.convertFrom.empty()) return opt.model.empty() && opt.images.empty() && opt.raw.empty();
+    if (opt.model.empty() || opt.images.empty() == opt.raw.empty()) return false;
+    if ((int)opt.int8 + (int)opt.bf16 + (int)opt.fp16 > 1) return false;
+    if (opt.threads == 0) opt.threads = ThreadPool::defaultThreadCount();
+    return true;
+}
+
+// --- MODEL ---
+static bool EndsWith(const std::string& text, const std::string& suffix) {
+    return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// Binary models are mapped rather than copied, so scorers running on the same file share its pages
+static std::shared_ptr<const ReadOnlyModel> LoadAnyModel(const Options& opt) {
+    if (!EndsWith(opt.model, ".txt")) return ReadOnlyModel::map(opt.model);
+    Network net;
+    if (!LoadTextModel(opt.model, opt.hidden, 10, opt.inputSize, net)) return nullptr;
+    return ReadOnlyModel::own(std::move(net), opt.model);
+}
+
+// --- INPUTS ---
+// Pixels stay in the mapped file; batches are views into it
+struct Inputs {
+    MappedFile file;
+    const unsigned char* pixels = nullptr;
+    int count = 0;
+    int size = 0;
+};
+
+static bool MapInputs(const Options& opt, Inputs& in) {
+    if (!opt.images.empty()) {
+        int rows, cols;
+        if (!in.file.open(opt.images)) return false;
+        if (!ReadIdxImageHeader(in.file.data(), in.file.size(), opt.images, in.count, rows, cols)) return false;
+        in.pixels = in.file.data() + 16;
+        in.size = rows * cols;
+        return true;
+    }
+
+    if (!in.file.open(opt.raw)) return false;
+    if (in.file.size() % opt.inputSize != 0) {
+        std::cout << "error: " << opt.raw << " is " << in.file.size() << " bytes, not a whole number of "
+            << opt.inputSize << "-byte records" << std::endl;
+        return false;
+    }
+    in.pixels = in.file.data();
+    in.size = opt.inputSize;
+    in.count = (int)(in.file.size() / opt.inputSize);
+    return true;
+}
+
+// --- SCORING ---
+static double Percentile(std::vector<double> values, double q) {
+    if (values.empty()) return 0.0;
+    std::sort(values.begin(), values.end());
+    size_t index = (size_t)(q * (values.size() - 1) + 0.5);
+    return values[index];
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+    if (!ParseOptions(argc, argv, opt)) {
+        PrintUsage();
+        return 2;
+    }
+
+    // Conversion only: text brain -> .nnm, which every tool then maps instead of parsing
+    if (!opt.convertFrom.empty()) {
+        if (!ConvertTextModel(opt.convertFrom, opt.hidden, 10, opt.inputSize, opt.convertTo)) return 1;
+        std::cout << "wrote     " << opt.convertTo << "\n";
+        return 0;
+    }
+
+    // 1. Model and inputs
+    std::shared_ptr<const ReadOnlyModel> model = LoadAnyModel(opt);
+    if (!model) return 1;
+    const Network& net = model->network();
+
+    Inputs in;
+    if (!MapInputs(opt, in)) return 1;
+    if (in.size != net.numInputs()) {
+        std::cout << "error: inputs have " << in.size << " values, the model takes " << net.numInputs() << std::endl;
+        return 1;
+    }
+
+    MappedFile labelFile;
+    const unsigned char* labels = nullptr;
+    if (!opt.labels.empty()) {
+        int numLabels;
+        if (!labelFile.open(opt.labels) || !ReadIdxLabelHeader(labelFile.data(), labelFile.size(), opt.labels, numLabels)) return 1;
+        if (numLabels != in.count) {
+            std::cout << "error: " << in.count << " inputs but " << numLabels << " labels" << std::endl;
+            return 1;
+        }
+        labels = labelFile.data() + 8;
+    }
+
+    QuantizedNetwork qnet;
+    if (opt.int8) {
+        int count = std::min(opt.calibrate, in.count);
+        std::vector<float> calibration((size_t)count * in.size);
+        for (size_t i = 0; i < calibration.size(); i++) calibration[i] = in.pixels[i] * PIXEL_SCALE;
+        if (!qnet.build(net, calibration.data(), count)) return 1;
+    }
+    const bool half = opt.bf16 || opt.fp16;
+    MixedPrecisionNetwork mixed;
+    if (half) {
+        mixed = MixedPrecisionNetwork(net, opt.bf16 ? HalfType::BF16 : HalfType::FP16);
+        if (mixed.numInputs() == 0) return 1;
+    }
+
+    // 2. Score: workers pull whole batches off a shared counter
+    const int numOutputs = net.numOutputs();
+    const int numBatches = (in.count + opt.batchSize - 1) / opt.batchSize;
+    std::vector<int> predictions(in.count);
+    std::vector<float> probabilities(opt.probs ? (size_t)in.count * numOutputs : 0);
+    std::vector<double> latencies(numBatches);
+
+    ThreadPool pool(opt.threads);
+    std::vector<BatchWorkspace> workspaces;
+    std::vector<QuantizedWorkspace> quantizedWorkspaces;
+    std::vector<MixedWorkspace> mixedWorkspaces;
+    for (int t = 0; t < pool.size(); t++) {
+        if (opt.int8) quantizedWorkspaces.push_back(QuantizedWorkspace(qnet));
+        else if (half) mixedWorkspaces.push_back(MixedWorkspace(mixed));
+        else workspaces.push_back(BatchWorkspace(net, opt.batchSize));
+    }
+
+    std::atomic<int> nextBatch(0);
+    auto start = std::chrono::steady_clock::now();
+    pool.run([&](int t) {
+        for (int b = nextBatch++; b < numBatches; b = nextBatch++) {
+            auto batchStart = std::chrono::steady_clock::now();
+            int first = b * opt.batchSize;
+            int count = std::min(opt.batchSize, in.count - first);
+
+            for (int n = 0; n < count; ) {
+                // fp32 scores the whole batch in one pass, int8 / bf16 / fp16 one image at a time
+                const float* out;
+                int done;
+                if (opt.int8) {
+                    out = qnet.feedForward(&in.pixels[(size_t)(first + n) * in.size], quantizedWorkspaces[t]).data();
+                    done = 1;
+                }
+                else if (half) {
+                    out = mixed.feedForward(&in.pixels[(size_t)(first + n) * in.size], mixedWorkspaces[t]).data();
+                    done = 1;
+                }
+                else {
+                    out = net.feedForwardBatch(&in.pixels[(size_t)first * in.size], count, workspaces[t]);
+                    done = count;
+                }
+
+                for (int s = 0; s < done; s++, n++) {
+                    const float* row = &out[(size_t)s * numOutputs];
+                    predictions[first + n] = (int)(std::max_element(row, row + numOutputs) - row);
+                    if (opt.probs) std::copy(row, row + numOutputs, &probabilities[(size_t)(first + n) * numOutputs]);
+                }
+            }
+
+            latencies[b] = std::chrono::duration<double>(std::chrono::steady_clock::now() - batchStart).count();
+        }
+    });
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // 3. Report
+    std::cout << "model     " << opt.model << " (";
+    for (int i = 0; i < net.layers.size(); i++) std::cout << (i ? " -> " : "") << net.layers[i].numInputs;
+    std::cout << " -> " << numOutputs << ", ";
+    if (half) std::cout << mixed.kernelName() << ")\n";
+    else std::cout << (opt.int8 ? "int8" : "fp32") << ", " << Simd().name << ")\n";
+    std::cout << "inputs    " << in.count << " x " << in.size << " in " << numBatches << " batches of " << opt.batchSize
+        << " on " << pool.size() << " threads\n";
+    std::cout << std::fixed << std::setprecision(3)
+        << "time      " << seconds * 1000.0 << " ms, " << std::setprecision(0) << in.count / seconds << " images/s\n"
+        << std::setprecision(3)
+        << "latency   per batch p50 " << Percentile(latencies, 0.50) * 1000.0 << " ms, p99 " << Percentile(latencies, 0.99) * 1000.0
+        << " ms, max " << Percentile(latencies, 1.0) * 1000.0 << " ms\n";
+    if (labels) {
+        int correct = 0;
+        for (int n = 0; n < in.count; n++) correct += predictions[n] == labels[n];
+        std::cout << std::setprecision(2) << "accuracy  " << correct << " / " << in.count << " = " << 100.0 * correct / in.count << "%\n";
+    }
+
+    // 4. Predictions
+    if (!opt.output.empty()) {
+        std::ofstream csv(opt.output);
+        if (!csv.is_open()) {
+            std::cout << "error: cannot write " << opt.output << std::endl;
+            return 1;
+        }
+        csv << "index,prediction";
+        if (opt.probs) for (int k = 0; k < numOutputs; k++) csv << ",p" << k;
+        csv << "\n" << std::setprecision(6) << std::defaultfloat;
+        for (int n = 0; n < in.count; n++) {
+            csv << n << "," << predictions[n];
+            if (opt.probs) for (int k = 0; k < numOutputs; k++) csv << "," << probabilities[(size_t)n * numOutputs + k];
+            csv << "\n";
+        }
+        std::cout << "wrote     " << opt.output << "\n";
+    }
+    return 0;
+}
@@ -0,0 +1,219 @@
+// NeuralNetServe.cpp : Local inference server. Loads a model and answers requests from other processes on
+// this machine over a Unix domain socket or localhost TCP, batching requests that arrive together (Serve.h).
+// A .nnm model is mapped rather than copied (ReadOnlyModel), so servers sharing a file share its pages, and
+// it can be swapped for a new version of the file without stopping (SIGHUP, or --watch).
+//
+//   NeuralNetServe --model brain.nnm (--socket /tmp/nn.sock | --port 7070) [--threads N]
+//                  [--max-batch 64] [--max-delay-us 500] [--report 10] [--watch 2] [--hidden 100]
+
+#include "NeuNetCode.h"
+#include "ModelFile.h"
+#include "Serve.h"
+#include "ThreadPool.h"
+#include "Simd.h"
+#include <memory>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <csignal>
+#include <sys/stat.h>
+#include <chrono>
+#include <thread>
+#include <iostream>
+#include <sstream>
+
+// --- OPTIONS ---
+struct Options {
+    std::string model;
+    std::vector<int> hidden; // shape of a text model (binary models carry their own)
+    ServeAddress address;
+    ServeSettings settings;
+    int report = 0;          // seconds between statistics lines, 0 = only at exit
+    int watch = 0;           // seconds between checks of the model file for a new version, 0 = off
+};
+
+static void PrintUsage() {
+    std::cout << "usage: NeuralNetServe --model FILE (--socket PATH | --port N) [options]\n"
+        << "  --model FILE        .nnm model, or a text brain (then --hidden gives its hidden layers, default 100)\n"
+        << "  --socket PATH       listen on a Unix domain socket\n"
+        << "  --port N            listen on 127.0.0.1:N (0 picks a free port and prints it)\n"
+        << "  --threads N         inference workers (default: all cores)\n"
+        << "  --max-batch N       requests per forward pass at most (default 64)\n"
+        << "  --max-delay-us N    how long a request may wait for its batch to fill (default 500, 0 = never wait)\n"
+        << "  --report SECONDS    print statistics this often (default: only at exit)\n"
+        << "  --watch SECONDS     reload the model when its file is replaced (checked this often)\n"
+        << "  --hidden A,B,...    hidden layer sizes of a text model\n"
+        << "Stops on Ctrl+C. SIGHUP reloads the model file; the new one must have the same inputs and outputs.\n";
+}
+
+static bool ParseInt(const char* text, int& value, int minimum = 1) {
+    char* end = nullptr;
+    long v = strtol(text, &end, 10);
+    if (end == text || *end != '\0' || v < minimum || v > 1 << 30) return false;
+    value = (int)v;
+    return true;
+}
+
+static bool ParseOptions(int argc, char** argv, Options& opt) {
+    bool hasPort = false;
+    opt.settings.threads = 0;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        bool ok = true;
+
+        if (!hasValue) ok = false;
+        else if (arg == "--model") opt.model = argv[++i];
+        else if (arg == "--socket") opt.address.socketPath = argv[++i];
+        else if (arg == "--port") ok = hasPort = ParseInt(argv[++i], opt.address.port, 0) && opt.address.port < 65536;
+        else if (arg == "--threads") ok = ParseInt(argv[++i], opt.settings.threads);
+        else if (arg == "--max-batch") ok = ParseInt(argv[++i], opt.settings.maxBatch);
+        else if (arg == "--max-delay-us") ok = ParseInt(argv[++i], opt.settings.maxDelayMicros, 0);
+        else if (arg == "--report") ok = ParseInt(argv[++i], opt.report);
+        else if (arg == "--watch") ok = ParseInt(argv[++i], opt.watch);
+        else if (arg == "--hidden") {
+            std::stringstream list(argv[++i]);
+            std::string item;
+            while (ok && std::getline(list, item, ',')) {
+                int size;
+                ok = ParseInt(item.c_str(), size);
+                opt.hidden.push_back(size);
+            }
+        }
+        else ok = false;
+
+        if (!ok) {
+            std::cout << "error: bad argument " << arg << "\n";
+            return false;
+        }
+    }
+
+    if (opt.model.empty() || opt.address.socketPath.empty() == !hasPort) return false;
+    if (opt.settings.threads == 0) opt.settings.threads = ThreadPool::defaultThreadCount();
+    if (opt.hidden.empty()) opt.hidden.push_back(100);
+    return true;
+}
+
+// --- MODEL ---
+static bool EndsWith(const std::string& text, const std::string& suffix) {
+    return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// Binary models are mapped in place; text models are parsed into a Network of their own
+static std::shared_ptr<const ReadOnlyModel> LoadAnyModel(const Options& opt) {
+    if (!EndsWith(opt.model, ".txt")) return ReadOnlyModel::map(opt.model);
+    Network net;
+    if (!LoadTextModel(opt.model, opt.hidden, 10, 784, net)) return nullptr;
+    return ReadOnlyModel::own(std::move(net), opt.model);
+}
+
+// What changes when the model file is replaced: SaveModel renames a new file over it, which gives it a new
+// inode on POSIX and a new modification time everywhere
+struct FileVersion {
+    long long modified = 0;
+    long long size = 0;
+    long long inode = 0;
+
+    bool operator!=(const FileVersion& other) const { return modified != other.modified || size != other.size || inode != other.inode; }
+};
+
+static FileVersion VersionOf(const std::string& filename) {
+    FileVersion version;
+    struct stat info;
+    if (stat(filename.c_str(), &info) == 0) {
+        version.modified = (long long)info.st_mtime;
+        version.size = (long long)info.st_size;
+        version.inode = (long long)info.st_ino;
+    }
+    return version;
+}
+
+// --- SIGNALS ---
+static volatile std::sig_atomic_t stopRequested = 0;
+static volatile std::sig_atomic_t reloadRequested = 0;
+
+static void RequestStop(int) {
+    stopRequested = 1;
+}
+
+static void RequestReload(int) {
+    reloadRequested = 1;
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+    if (!ParseOptions(argc, argv, opt)) {
+        PrintUsage();
+        return 2;
+    }
+
+    // 1. Model
+    std::shared_ptr<const ReadOnlyModel> model = LoadAnyModel(opt);
+    if (!model) return 1;
+    const bool reloadable = model->isMapped();
+    if (opt.watch > 0 && !reloadable) {
+        std::cout << "error: --watch needs a .nnm model; text models can't be reloaded" << std::endl;
+        return 2;
+    }
+    ModelSlot models(model);
+
+    // 2. Serve until Ctrl+C / SIGTERM
+    InferenceServer server(models, opt.settings);
+    if (!server.start(opt.address)) return 1;
+    std::signal(SIGINT, RequestStop);
+    std::signal(SIGTERM, RequestStop);
+#ifdef SIGHUP
+    std::signal(SIGHUP, RequestReload);
+#endif
+
+    const Network& net = model->network();
+    std::cout << "model     " << opt.model << " (";
+    for (int i = 0; i < net.layers.size(); i++) std::cout << (i ? " -> " : "") << net.layers[i].numInputs;
+    std::cout << " -> " << net.numOutputs() << ", fp32, " << Simd().name << (reloadable ? ", mapped" : "") << ")\n";
+    std::cout << "listening " << (opt.address.socketPath.empty() ? "127.0.0.1:" + std::to_string(server.boundPort()) : opt.address.socketPath)
+        << ", " << opt.settings.threads << " workers, batches of up to " << opt.settings.maxBatch << " within "
+        << opt.settings.maxDelayMicros << " us" << std::endl;
+
+    model.reset(); // the slot holds it from here on, so a reload can unmap it
+    auto lastReport = std::chrono::steady_clock::now();
+    auto lastWatch = lastReport;
+    FileVersion version = VersionOf(opt.model);
+    while (!stopRequested) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+        // Hot reload: the new file is mapped and checked while the workers keep serving the old one
+        if (opt.watch > 0 && std::chrono::steady_clock::now() - lastWatch >= std::chrono::seconds(opt.watch)) {
+            lastWatch = std::chrono::steady_clock::now();
+            FileVersion now = VersionOf(opt.model);
+            if (now != version) {
+                version = now;
+                reloadRequested = 1;
+            }
+        }
+        if (reloadRequested) {
+            reloadRequested = 0;
+            if (!reloadable) {
+                std::cout << "error: only .nnm models can be reloaded" << std::endl;
+            }
+            else {
+                auto start = std::chrono::steady_clock::now();
+                if (models.reload(opt.model)) {
+                    std::cout << "reloaded  " << opt.model << " (generation " << models.generation() << ", "
+                        << std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count() << " us)" << std::endl;
+                }
+            }
+        }
+
+        if (opt.report > 0 && std::chrono::steady_clock::now() - lastReport >= std::chrono::seconds(opt.report)) {
+            lastReport = std::chrono::steady_clock::now();
+            std::cout << "\n";
+            server.stats().print(std::cout);
+        }
+    }
+
+    // 3. Final statistics
+    server.stop();
+    std::cout << "\nstopped\n";
+    server.stats().print(std::cout);
+    return 0;
+}
@@ -0,0 +1,575 @@
+// NeuralNetTrain.cpp : Headless training. Trains a network on IDX files (or generated data) with the
+// parallel mini-batch trainer, reports loss, accuracy and throughput after every epoch, and can stop
+// as soon as a target test accuracy is reached (time-to-accuracy).
+//
+//   NeuralNetTrain --train-images train-images.idx3-ubyte --train-labels train-labels.idx1-ubyte
+//                  [--test-images t10k-images.idx3-ubyte --test-labels t10k-labels.idx1-ubyte]
+//                  [--conv 8x5,pool2,16x3,pool2] [--hidden 100] [--augment center,shift=2,rotate=10] [--epochs 5] [--batch 64] [--threads N] [--lr 0.01] [--optimizer sgd]
+//                  [--schedule constant] [--target-accuracy 97] [--output brain.nnm] [--metrics epochs.jsonl]
+//                  [--profile profile.jsonl [--trace trace.json] [--hw-counters]]   (NEURALNET_PROFILE builds)
+//   NeuralNetTrain --synthetic 20000 ...   (no files: a generated, learnable 10-class problem)
+
+#include "NeuNetCode.h"
+#include "Trainer.h"
+#include "Optimizer.h"
+#include "ModelFile.h"
+#include "MnistDataset.h"
+#include "DataStream.h"
+#include "ThreadPool.h"
+#include "Simd.h"
+#include "Profiler.h"
+#include "Preprocess.h"
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+
+// --- OPTIONS ---
+struct Options {
+    std::string trainImages;
+    std::string trainLabels;
+    std::string testImages;  // optional: without a test set only the training metrics are reported
+    std::string testLabels;
+    std::string output;      // optional .nnm, saved after every epoch
+    std::string metrics;     // optional JSON lines file, one object per epoch
+    std::string profile;     // optional JSON lines file, one Profiler report per epoch
+    std::string trace;       // optional Chrome trace of every profiled scope
+    bool hardwareCounters = false;
+    std::string conv;        // optional feature layers in front of the hidden layers, e.g. 8x5,pool2
+    std::vector<int> hidden;
+    AugmentSettings augment;
+    bool augmenting = false; // --augment given: batches go through an AugmentStream
+    int augmentThreads = 2;
+    int synthetic = 0;       // generated training samples instead of files (plus a fifth as many test samples)
+    int epochs = 5;
+    int batchSize = 64;
+    int threads = 0;
+    int warmup = 0;
+    int seed = 1;
+    float learningRate = 0.01f;
+    float weightDecay = 0.0f;
+    float targetAccuracy = 0.0f; // percent; 0 runs every epoch
+    OptimizerType optimizer = OptimizerType::SGD;
+    ScheduleType schedule = ScheduleType::CONSTANT;
+};
+
+static void PrintUsage() {
+    std::cout << "usage: NeuralNetTrain (--train-images IDX --train-labels IDX | --synthetic N) [options]\n"
+        << "  --train-images FILE  IDX training images (unsigned bytes)\n"
+        << "  --train-labels FILE  IDX training labels\n"
+        << "  --test-images FILE   IDX test images; with --test-labels adds test loss and accuracy\n"
+        << "  --test-labels FILE   IDX test labels\n"
+        << "  --synthetic N        train on N generated 28x28 images of 10 classes (and test on N / 5)\n"
+        << "  --conv SPEC,...      feature layers on the square single-channel image in front of the hidden\n"
+        << "                       layers: CxK is C filters of K x K (stride 1, no padding, relu), poolN is\n"
+        << "                       N x N max pooling, e.g. 8x5,pool2,16x3,pool2\n"
+        << "  --hidden A,B,...     hidden layer sizes (default 100)\n"
+        << "  --augment SPEC,...   preprocess and augment every training batch on worker threads ahead of the\n"
+        << "                       trainer: center (center of mass, also applied to the test set), shift=PIXELS,\n"
+        << "                       rotate=DEGREES, scale=FRACTION, elastic=ALPHA, sigma=PIXELS (elastic smoothing)\n"
+        << "  --augment-threads N  augmentation worker threads (default 2)\n"
+        << "  --epochs N           passes over the training set (default 5)\n"
+        << "  --batch N            samples per step (default 64)\n"
+        << "  --threads N          worker threads (default: all cores)\n"
+        << "  --lr RATE            learning rate (default 0.01)\n"
+        << "  --optimizer NAME     sgd, momentum, nesterov, adam, adamw or rmsprop (default sgd)\n"
+        << "  --schedule NAME      constant, step (x0.5 every epoch) or cosine (to 0 at the last step)\n"
+        << "  --warmup N           steps of linear learning rate warmup\n"
+        << "  --weight-decay W     L2 on the weights (decoupled for adamw)\n"
+        << "  --seed N             weight initialization and shuffling seed (default 1)\n"
+        << "  --target-accuracy P  stop once the test accuracy reaches P percent\n"
+        << "  --output FILE        save the model (.nnm) after every epoch\n"
+        << "  --metrics FILE       write every epoch's metrics as one JSON object per line\n"
+        << "  --profile FILE       print where each epoch's time went (per phase and layer), and write it as JSON lines\n"
+        << "  --trace FILE         write every profiled scope as a Chrome trace (chrome://tracing, Perfetto)\n"
+        << "  --hw-counters        add cycles, instructions, cache and branch misses to the profile (Linux)\n"
+        << "                       (--profile, --trace and --hw-counters need a build with NEURALNET_PROFILE)\n";
+}
+
+static bool ParseInt(const char* text, int& value) {
+    char* end = nullptr;
+    long v = strtol(text, &end, 10);
+    if (end == text || *end != '\0' || v <= 0 || v > 1 << 30) return false;
+    value = (int)v;
+    return true;
+}
+
+static bool ParseFloat(const char* text, float& value) {
+    char* end = nullptr;
+    double v = strtod(text, &end);
+    if (end == text || *end != '\0' || !(v >= 0.0) || v > 1e6) return false;
+    value = (float)v;
+    return true;
+}
+
+static bool ParseOptimizer(const std::string& name, OptimizerType& type) {
+    const OptimizerType all[] = { OptimizerType::SGD, OptimizerType::MOMENTUM, OptimizerType::NESTEROV,
+        OptimizerType::ADAM, OptimizerType::ADAMW, OptimizerType::RMSPROP };
+    for (OptimizerType t : all) {
+        if (name == OptimizerName(t)) {
+            type = t;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool ParseSchedule(const std::string& name, ScheduleType& type) {
+    if (name == "constant") type = ScheduleType::CONSTANT;
+    else if (name == "step") type = ScheduleType::STEP;
+    else if (name == "cosine") type = ScheduleType::COSINE;
+    else return false;
+    return true;
+}
+
+// center,shift=2,rotate=10,scale=0.1,elastic=8,sigma=4
+static bool ParseAugment(const std::string& spec, AugmentSettings& settings) {
+    std::stringstream list(spec);
+    std::string item;
+    while (std::getline(list, item, ',')) {
+        if (item == "center") {
+            settings.center = true;
+            continue;
+        }
+        size_t equals = item.find('=');
+        if (equals == std::string::npos) return false;
+        std::string name = item.substr(0, equals);
+        float value;
+        if (!ParseFloat(item.c_str() + equals + 1, value)) return false;
+        if (name == "shift") settings.maxShift = value;
+        else if (name == "rotate") settings.maxRotation = value;
+        else if (name == "scale" && value < 1.0f) settings.maxScale = value;
+        else if (name == "elastic") settings.elasticAlpha = value;
+        else if (name == "sigma" && value > 0.0f) settings.elasticSigma = value;
+        else return false;
+    }
+    return true;
+}
+
+static bool ParseOptions(int argc, char** argv, Options& opt) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool ok = true;
+
+        if (arg == "--hw-counters") opt.hardwareCounters = true;
+        else if (i + 1 >= argc) ok = false;
+        else if (arg == "--train-images") opt.trainImages = argv[++i];
+        else if (arg == "--train-labels") opt.trainLabels = argv[++i];
+        else if (arg == "--test-images") opt.testImages = argv[++i];
+        else if (arg == "--test-labels") opt.testLabels = argv[++i];
+        else if (arg == "--output") opt.output = argv[++i];
+        else if (arg == "--metrics") opt.metrics = argv[++i];
+        else if (arg == "--profile") opt.profile = argv[++i];
+        else if (arg == "--trace") opt.trace = argv[++i];
+        else if (arg == "--conv") opt.conv = argv[++i];
+        else if (arg == "--synthetic") ok = ParseInt(argv[++i], opt.synthetic);
+        else if (arg == "--epochs") ok = ParseInt(argv[++i], opt.epochs);
+        else if (arg == "--batch") ok = ParseInt(argv[++i], opt.batchSize);
+        else if (arg == "--threads") ok = ParseInt(argv[++i], opt.threads);
+        else if (arg == "--warmup") ok = ParseInt(argv[++i], opt.warmup);
+        else if (arg == "--seed") ok = ParseInt(argv[++i], opt.seed);
+        else if (arg == "--lr") ok = ParseFloat(argv[++i], opt.learningRate);
+        else if (arg == "--weight-decay") ok = ParseFloat(argv[++i], opt.weightDecay);
+        else if (arg == "--target-accuracy") ok = ParseFloat(argv[++i], opt.targetAccuracy);
+        else if (arg == "--optimizer") ok = ParseOptimizer(argv[++i], opt.optimizer);
+        else if (arg == "--schedule") ok = ParseSchedule(argv[++i], opt.schedule);
+        else if (arg == "--augment") ok = opt.augmenting = ParseAugment(argv[++i], opt.augment);
+        else if (arg == "--augment-threads") ok = ParseInt(argv[++i], opt.augmentThreads);
+        else if (arg == "--hidden") {
+            std::stringstream list(argv[++i]);
+            std::string item;
+            while (ok && std::getline(list, item, ',')) {
+                int size;
+                ok = ParseInt(item.c_str(), size);
+                opt.hidden.push_back(size);
+            }
+        }
+        else ok = false;
+
+        if (!ok) {
+            std::cout << "error: bad argument " << arg << "\n";
+            return false;
+        }
+    }
+
+    bool files = !opt.trainImages.empty() && !opt.trainLabels.empty();
+    if (files == (opt.synthetic > 0)) return false;
+    if (opt.testImages.empty() != opt.testLabels.empty()) return false;
+    if (opt.targetAccuracy > 0.0f && files && opt.testImages.empty()) {
+        std::cout << "error: --target-accuracy needs a test set\n";
+        return false;
+    }
+    if ((!opt.profile.empty() || !opt.trace.empty() || opt.hardwareCounters) && !Profiler::compiledIn()) {
+        std::cout << "error: --profile, --trace and --hw-counters need a build with NEURALNET_PROFILE\n";
+        return false;
+    }
+    if (opt.hardwareCounters && opt.profile.empty()) {
+        std::cout << "error: --hw-counters needs --profile\n";
+        return false;
+    }
+    if (opt.threads == 0) opt.threads = ThreadPool::defaultThreadCount();
+    if (opt.hidden.empty()) opt.hidden.push_back(100);
+    return true;
+}
+
+// Side of a square image of numInputs pixels; 'option' names what needs it in the error
+static bool SquareSide(int numInputs, const char* option, int& side) {
+    side = (int)std::lround(std::sqrt((double)numInputs));
+    if (side * side == numInputs) return true;
+    std::cout << "error: " << option << " needs square images, these have " << numInputs << " pixels" << std::endl;
+    return false;
+}
+
+// Builds the --conv feature layers for numInputs pixels (a square, single-channel image)
+static bool BuildFeatures(const std::string& spec, int numInputs, std::vector<Layer>& features) {
+    int side;
+    if (!SquareSide(numInputs, "--conv", side)) return false;
+
+    int channels = 1, height = side, width = side;
+    std::stringstream list(spec);
+    std::string item;
+    while (std::getline(list, item, ',')) {
+        int size = 0, filters = 0;
+        size_t x = item.find('x');
+        bool ok;
+        if (item.compare(0, 4, "pool") == 0) {
+            ok = ParseInt(item.c_str() + 4, size) && size <= height && size <= width;
+            if (ok) features.push_back(Layer::MaxPool(channels, height, width, size));
+        }
+        else {
+            ok = x != std::string::npos && ParseInt(item.substr(0, x).c_str(), filters)
+                && ParseInt(item.c_str() + x + 1, size) && size <= height && size <= width;
+            if (ok) features.push_back(Layer::Conv2D(channels, height, width, filters, size, ActivationType::RELU));
+        }
+        if (!ok) {
+            std::cout << "error: bad --conv layer " << item << " (on " << channels << " x " << height << " x "
+                << width << " inputs)" << std::endl;
+            return false;
+        }
+        channels = features.back().shape.outChannels;
+        height = features.back().shape.outHeight;
+        width = features.back().shape.outWidth;
+    }
+    return !features.empty();
+}
+
+// --- DATA ---
+// Labelled 8-bit images held in memory (the generated data set)
+class MemorySource : public DataSource {
+
+public:
+    MemorySource(int recordSize) : records(0), bytesPerRecord(recordSize) {}
+
+    int size() const override { return records; }
+    int recordSize() const override { return bytesPerRecord; }
+    bool readRange(int first, int count, unsigned char* pixelsOut, unsigned char* labelsOut) override {
+        if (first < 0 || count < 0 || first + count > records) {
+            std::cout << "error: records " << first << ".." << first + count << " are out of range" << std::endl;
+            return false;
+        }
+        std::memcpy(pixelsOut, &pixels[(size_t)first * bytesPerRecord], (size_t)count * bytesPerRecord);
+        std::memcpy(labelsOut, &labels[first], count);
+        return true;
+    }
+
+    void add(const unsigned char* image, unsigned char label) {
+        pixels.insert(pixels.end(), image, image + bytesPerRecord);
+        labels.push_back(label);
+        records++;
+    }
+
+private:
+    int records;
+    int bytesPerRecord;
+    std::vector<unsigned char> pixels;
+    std::vector<unsigned char> labels;
+};
+
+// Ten 28x28 "digits": every class is a fixed set of bright strokes, and every sample is its class's strokes
+// shifted by up to three pixels, dimmed at random, and speckled with noise. Learnable, but not in one step.
+static void GenerateImages(int count, std::mt19937& rng, MemorySource& train, MemorySource& test) {
+    const int SIDE = 28;
+    std::vector<std::vector<float>> prototypes(10, std::vector<float>(SIDE * SIDE, 0.0f));
+    std::mt19937 shapes(12345); // the classes are the same whatever the seed
+    std::uniform_int_distribution<int> coord(5, SIDE - 6);
+    for (auto& proto : prototypes) {
+        for (int stroke = 0; stroke < 3; stroke++) {
+            int x0 = coord(shapes), y0 = coord(shapes), x1 = coord(shapes), y1 = coord(shapes);
+            for (int s = 0; s <= 32; s++) {
+                int x = x0 + (x1 - x0) * s / 32, y = y0 + (y1 - y0) * s / 32;
+                for (int dy = -1; dy <= 1; dy++) {
+                    for (int dx = -1; dx <= 1; dx++) proto[(y + dy) * SIDE + x + dx] = 1.0f;
+                }
+            }
+        }
+    }
+
+    std::uniform_int_distribution<int> label(0, 9), shift(-3, 3);
+    std::uniform_real_distribution<float> brightness(0.5f, 1.0f);
+    std::normal_distribution<float> noise(0.0f, 70.0f);
+    std::vector<unsigned char> image(SIDE * SIDE);
+    int testCount = count / 5;
+    for (int n = 0; n < count + testCount; n++) {
+        int c = label(rng), sx = shift(rng), sy = shift(rng);
+        float level = 255.0f * brightness(rng);
+        for (int y = 0; y < SIDE; y++) {
+            for (int x = 0; x < SIDE; x++) {
+                int px = x - sx, py = y - sy;
+                float v = (px >= 0 && px < SIDE && py >= 0 && py < SIDE) ? level * prototypes[c][py * SIDE + px] : 0.0f;
+                v += noise(rng);
+                image[y * SIDE + x] = (unsigned char)(v < 60.0f ? 0.0f : (v > 255.0f ? 255.0f : v));
+            }
+        }
+        if (n < count) train.add(image.data(), (unsigned char)c);
+        else test.add(image.data(), (unsigned char)c);
+    }
+}
+
+// A whole labelled set as float inputs and one-hot targets, for ParallelTrainer::evaluate
+struct EvalSet {
+    int count = 0;
+    std::vector<float> inputs;
+    std::vector<float> targets;
+};
+
+static void WidenSet(DataSource& source, EvalSet& set) {
+    set.count = source.size();
+    std::vector<unsigned char> pixels((size_t)set.count * source.recordSize());
+    std::vector<unsigned char> labels(set.count);
+    if (set.count > 0 && !source.readRange(0, set.count, pixels.data(), labels.data())) {
+        set.count = 0;
+        return;
+    }
+    set.inputs.resize(pixels.size());
+    NormalizePixels(pixels.data(), (int)pixels.size(), PIXEL_SCALE, 0.0f, set.inputs.data());
+    set.targets.assign((size_t)set.count * 10, 0.0f);
+    for (int n = 0; n < set.count; n++) set.targets[(size_t)n * 10 + labels[n]] = 1.0f;
+}
+
+// --- METRICS ---
+struct EpochMetrics {
+    int epoch;
+    double seconds;       // training only (test evaluation excluded)
+    double evalSeconds;
+    double stallSeconds;  // time spent waiting on the batch loader (or the augmentation workers)
+    double elapsed;       // training time of all epochs so far
+    double samplesPerSecond;
+    float learningRate;   // at the last step of the epoch
+    TrainingStats train;  // taken during the epoch's backward passes
+    TrainingStats test;   // after the epoch (samples == 0 without a test set)
+};
+
+static void PrintEpoch(const EpochMetrics& m, int epochs) {
+    std::cout << std::fixed << "epoch " << std::setw(3) << m.epoch << "/" << epochs
+        << std::setprecision(2) << "  " << std::setw(7) << m.seconds << " s  "
+        << std::setprecision(0) << std::setw(8) << m.samplesPerSecond << " samples/s"
+        << std::setprecision(4) << "  loss " << m.train.meanLoss()
+        << std::setprecision(2) << "  train " << std::setw(6) << 100.0f * m.train.accuracy() << "%";
+    if (m.test.samples) {
+        std::cout << std::setprecision(4) << "  test loss " << m.test.meanLoss()
+            << std::setprecision(2) << "  test " << std::setw(6) << 100.0f * m.test.accuracy() << "%";
+    }
+    std::cout << "\n";
+}
+
+static void WriteEpochJson(std::ostream& out, const EpochMetrics& m) {
+    out << std::setprecision(6) << std::defaultfloat
+        << "{\"epoch\":" << m.epoch
+        << ",\"seconds\":" << m.seconds
+        << ",\"eval_seconds\":" << m.evalSeconds
+        << ",\"stall_seconds\":" << m.stallSeconds
+        << ",\"elapsed_seconds\":" << m.elapsed
+        << ",\"samples_per_second\":" << m.samplesPerSecond
+        << ",\"learning_rate\":" << m.learningRate
+        << ",\"train_samples\":" << m.train.samples
+        << ",\"train_loss\":" << m.train.meanLoss()
+        << ",\"train_accuracy\":" << m.train.accuracy();
+    if (m.test.samples) {
+        out << ",\"test_loss\":" << m.test.meanLoss()
+            << ",\"test_accuracy\":" << m.test.accuracy();
+    }
+    out << "}\n";
+    out.flush();
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+    if (!ParseOptions(argc, argv, opt)) {
+        PrintUsage();
+        return 2;
+    }
+
+    // 1. Data: the training set streams through shuffled, prefetched batches; the test set is widened once
+    MnistDataset trainFiles, testFiles;
+    MemorySource trainMemory(28 * 28), testMemory(28 * 28);
+    std::unique_ptr<MnistDatasetSource> trainFileSource, testFileSource;
+    DataSource* trainSource = &trainMemory;
+    DataSource* testSource = &testMemory;
+    if (opt.synthetic > 0) {
+        std::mt19937 rng(opt.seed);
+        GenerateImages(opt.synthetic, rng, trainMemory, testMemory);
+    }
+    else {
+        if (!trainFiles.load(opt.trainImages, opt.trainLabels)) return 1;
+        trainFileSource.reset(new MnistDatasetSource(trainFiles));
+        trainSource = trainFileSource.get();
+        testSource = nullptr;
+        if (!opt.testImages.empty()) {
+            if (!testFiles.load(opt.testImages, opt.testLabels)) return 1;
+            if (testFiles.imageSize() != trainFiles.imageSize()) {
+                std::cout << "error: test images have " << testFiles.imageSize() << " pixels, training images "
+                    << trainFiles.imageSize() << std::endl;
+                return 1;
+            }
+            testFileSource.reset(new MnistDatasetSource(testFiles));
+            testSource = testFileSource.get();
+        }
+    }
+
+    EvalSet test;
+    if (testSource) WidenSet(*testSource, test);
+    if (testSource && test.count == 0 && testSource->size() > 0) return 1;
+
+    // Training images are centered by the augmentation workers; test images get the same CenterImage once
+    int side = 0;
+    if (opt.augmenting && !SquareSide(trainSource->recordSize(), "--augment", side)) return 1;
+    if (opt.augment.center && test.count) {
+        std::vector<float> image((size_t)side * side);
+        for (int n = 0; n < test.count; n++) {
+            float* input = &test.inputs[(size_t)n * side * side];
+            std::copy(input, input + image.size(), image.begin());
+            CenterImage(image.data(), input, side, side);
+        }
+    }
+
+    // 2. Network, optimizer and trainer
+    srand((unsigned int)opt.seed);
+    const int numInputs = trainSource->recordSize();
+    std::vector<Layer> features;
+    if (!opt.conv.empty() && !BuildFeatures(opt.conv, numInputs, features)) return 1;
+    Network net = features.empty() ? Network(opt.hidden, 10, numInputs) : Network(features, opt.hidden, 10);
+
+    const int batchesPerEpoch = (trainSource->size() + opt.batchSize - 1) / opt.batchSize;
+    const int totalSteps = batchesPerEpoch * opt.epochs;
+    LearningRateSchedule schedule = LearningRateSchedule::constant(opt.learningRate);
+    if (opt.schedule == ScheduleType::STEP) schedule = LearningRateSchedule::step(opt.learningRate, batchesPerEpoch, 0.5f);
+    if (opt.schedule == ScheduleType::COSINE) schedule = LearningRateSchedule::cosine(opt.learningRate, totalSteps - opt.warmup);
+    OptimizerSettings settings(opt.optimizer);
+    settings.weightDecay = opt.weightDecay;
+    Optimizer optimizer(net, settings, schedule.withWarmup(opt.warmup));
+
+    ParallelTrainer trainer(net, opt.threads, opt.batchSize);
+    BatchStream stream(*trainSource, opt.batchSize);
+    std::unique_ptr<AugmentStream> augmented;
+    if (opt.augmenting) augmented.reset(new AugmentStream(stream, opt.augment, side, side, opt.augmentThreads));
+    std::vector<float> inputs((size_t)opt.batchSize * numInputs);
+
+    std::ofstream metrics, profile;
+    if (!opt.metrics.empty()) {
+        metrics.open(opt.metrics);
+        if (!metrics.is_open()) {
+            std::cout << "error: cannot write " << opt.metrics << std::endl;
+            return 1;
+        }
+    }
+    if (!opt.profile.empty()) {
+        profile.open(opt.profile);
+        if (!profile.is_open()) {
+            std::cout << "error: cannot write " << opt.profile << std::endl;
+            return 1;
+        }
+    }
+    if (opt.hardwareCounters && !Profiler::enableHardwareCounters()) return 1;
+    if (!opt.trace.empty()) Profiler::startTrace();
+
+    std::cout << "network   " << numInputs;
+    for (const Layer& layer : net.layers) std::cout << " -> " << layer.numNeurons;
+    std::cout << " (" << Simd().name << ")\n"
+        << "data      " << trainSource->size() << " training, " << test.count << " test samples"
+        << (opt.synthetic ? " (synthetic)" : "") << "\n"
+        << "training  " << opt.epochs << " epochs of " << batchesPerEpoch << " batches of " << opt.batchSize
+        << " on " << trainer.numThreads() << " threads, " << OptimizerName(opt.optimizer) << ", lr " << opt.learningRate << "\n";
+    if (augmented) {
+        const AugmentSettings& a = opt.augment;
+        std::cout << "augment   " << (a.center ? "center, " : "") << "shift " << a.maxShift << " px, rotate " << a.maxRotation
+            << " deg, scale " << a.maxScale << ", elastic " << a.elasticAlpha << " (sigma " << a.elasticSigma << ") on "
+            << augmented->numThreads() << " threads\n";
+    }
+
+    // 3. Train
+    double elapsed = 0.0, stalledBefore = 0.0;
+    int reachedEpoch = 0;
+    for (int epoch = 1; epoch <= opt.epochs && !reachedEpoch; epoch++) {
+        trainer.resetStats();
+        Profiler::reset();
+        const unsigned int epochSeed = (unsigned int)(opt.seed * 1000003 + epoch);
+
+        auto start = std::chrono::steady_clock::now();
+        if (augmented) {
+            augmented->startEpoch(epochSeed);
+            while (const AugmentedBatch* batch = augmented->next()) {
+                trainer.trainBatch(batch->inputs.data(), batch->targets.data(), batch->count, optimizer);
+            }
+            if (augmented->failed()) return 1;
+        }
+        else {
+            stream.startEpoch(epochSeed);
+            while (const Batch* batch = stream.next()) {
+                NormalizePixels(batch->pixels.data(), batch->count * numInputs, PIXEL_SCALE, 0.0f, inputs.data());
+                trainer.trainBatch(inputs.data(), batch->targets.data(), batch->count, optimizer);
+            }
+            if (stream.failed()) return 1;
+        }
+
+        EpochMetrics m;
+        m.epoch = epoch;
+        m.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        const double stalledTotal = augmented ? augmented->stallSeconds() : stream.stallSeconds();
+        m.stallSeconds = stalledTotal - stalledBefore;
+        stalledBefore = stalledTotal;
+        elapsed += m.seconds;
+        m.elapsed = elapsed;
+        m.train = trainer.stats();
+        m.samplesPerSecond = m.train.samples / m.seconds;
+        m.learningRate = optimizer.currentRate();
+        ProfileReport epochProfile = Profiler::report(); // training only, before the test pass adds to it
+
+        auto evalStart = std::chrono::steady_clock::now();
+        if (test.count) m.test = trainer.evaluate(test.inputs.data(), test.targets.data(), test.count);
+        m.evalSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - evalStart).count();
+
+        PrintEpoch(m, opt.epochs);
+        if (metrics.is_open()) WriteEpochJson(metrics, m);
+        if (profile.is_open()) {
+            epochProfile.print(std::cout);
+            epochProfile.writeJson(profile);
+        }
+        if (!opt.output.empty() && !SaveModel(net, opt.output)) return 1;
+
+        if (opt.targetAccuracy > 0.0f && m.test.samples && 100.0f * m.test.accuracy() >= opt.targetAccuracy) reachedEpoch = epoch;
+    }
+
+    // 4. Time to accuracy
+    if (opt.targetAccuracy > 0.0f) {
+        std::cout << std::fixed << std::setprecision(2);
+        if (reachedEpoch) std::cout << "target    " << opt.targetAccuracy << "% test accuracy after " << reachedEpoch
+            << " epochs, " << elapsed << " s of training\n";
+        else std::cout << "target    " << opt.targetAccuracy << "% test accuracy not reached in " << opt.epochs << " epochs\n";
+    }
+    if (!opt.trace.empty()) {
+        Profiler::stopTrace();
+        if (!Profiler::writeChromeTrace(opt.trace)) return 1;
+        std::cout << "wrote     " << opt.trace << "\n";
+    }
+    if (!opt.output.empty()) std::cout << "wrote     " << opt.output << "\n";
+    return 0;
+}